@@ -0,0 +1,129 @@
+/*
+ *  Copyright 2024 Diligent Graphics LLC
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+
+#pragma once
+
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "../../../DiligentCore/Primitives/interface/BasicTypes.h"
+#include "../../../DiligentCore/Common/interface/BasicMath.hpp"
+
+namespace Diligent
+{
+
+namespace USD
+{
+
+/// Simplified triangle list of a mesh level of detail.
+struct HnMeshLOD
+{
+    /// Triangle list indices that reference the vertices of the source mesh.
+    std::vector<Uint32> Indices;
+
+    /// Object-space geometric error of the LOD relative to the source mesh.
+    float Error = 0;
+};
+
+/// Chain of mesh LODs ordered from the finest to the coarsest.
+struct HnMeshLODChain
+{
+    std::vector<HnMeshLOD> LODs;
+
+    /// The number of vertices and indices of the source mesh.
+    Uint32 NumSourceVertices = 0;
+    Uint32 NumSourceIndices  = 0;
+
+    /// The number of all LOD indices.
+    size_t GetNumIndices() const;
+};
+
+struct HnMeshLODSettings
+{
+    /// The minimum number of triangles in the coarsest LOD.
+    Uint32 MinTriangles = 512;
+
+    /// The maximum number of LODs in the chain.
+    Uint32 MaxLODs = 8;
+};
+
+/// Generates a chain of simplified LODs of the triangle mesh using the quadric error metric.
+///
+/// \remarks    Every LOD has at most half the triangles of the previous one, so that all
+///             LODs together take fewer indices than the source mesh. The chain ends when
+///             the next LOD would have fewer than MinTriangles triangles, or when the mesh
+///             can't be simplified further.
+///
+///             Edges are collapsed into one of their end points, so the LODs reference the
+///             vertices of the source mesh and share its vertex buffers. Vertices with identical
+///             positions are welded, so that face-varying meshes are simplified as one surface.
+///             Vertices on the mesh boundaries are never removed.
+HnMeshLODChain GenerateMeshLODs(const float3*            pPositions,
+                                Uint32                   NumVertices,
+                                const Uint32*            pIndices,
+                                Uint32                   NumIndices,
+                                const HnMeshLODSettings& Settings);
+
+/// Thread-safe cache of the generated mesh LOD chains.
+///
+/// The chains are keyed by the hash of the source geometry, so that meshes with identical
+/// geometry share their LODs. The cache does not own the chains: an entry expires when
+/// the last mesh that uses the chain releases it.
+///
+/// A chain is only returned when the vertex and index counts of its source mesh match
+/// the requested ones, so that a hash collision can't produce indices that are out of
+/// range of the mesh vertices.
+class HnMeshLODCache
+{
+public:
+    /// Computes the cache key of the mesh geometry.
+    static size_t ComputeKey(const float3*            pPositions,
+                             Uint32                   NumVertices,
+                             const Uint32*            pIndices,
+                             Uint32                   NumIndices,
+                             const HnMeshLODSettings& Settings);
+
+    /// Returns the chain with the given key that was generated from the mesh with the given
+    /// number of vertices and indices, or null if there is no such chain in the cache.
+    std::shared_ptr<const HnMeshLODChain> Find(size_t Key, Uint32 NumVertices, Uint32 NumIndices) const;
+
+    /// Adds the chain to the cache.
+    void Add(size_t Key, const std::shared_ptr<const HnMeshLODChain>& Chain);
+
+private:
+    mutable std::mutex                                              m_Mtx;
+    std::unordered_map<size_t, std::weak_ptr<const HnMeshLODChain>> m_Chains;
+
+    // The number of entries at which the expired entries are removed
+    size_t m_PurgeSize = 64;
+};
+
+} // namespace USD
+
+} // namespace Diligent
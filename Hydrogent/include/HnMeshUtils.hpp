@@ -0,0 +1,61 @@
+/*
+ *  Copyright 2024 Diligent Graphics LLC
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+#pragma once
+
+#include <cstddef>
+
+#include "pxr/imaging/hd/meshTopology.h"
+#include "pxr/base/gf/vec3i.h"
+#include "pxr/base/vt/array.h"
+#include "pxr/usd/sdf/path.h"
+
+namespace Diligent
+{
+
+namespace USD
+{
+
+/// Triangulates the mesh faces.
+///
+/// The result is identical to that of pxr::HdMeshUtil::ComputeTriangleIndices.
+/// Meshes that only consist of triangles and quads and have no holes are triangulated
+/// directly; all other meshes fall back to HdMeshUtil.
+void ComputeTriangleIndices(const pxr::HdMeshTopology& Topology, const pxr::SdfPath& Id, pxr::VtVec3iArray& Triangles);
+
+/// Computes smooth vertex normals for the mesh.
+///
+/// The result matches that of Hd_SmoothNormals::ComputeSmoothNormals up to floating-point
+/// rounding. pPoints and pNormals are tightly packed arrays of NumPoints float3 elements.
+/// Returns false if the face vertex counts are inconsistent with the face vertex indices.
+bool ComputeSmoothNormals(const pxr::HdMeshTopology& Topology,
+                          const float*               pPoints,
+                          size_t                     NumPoints,
+                          float*                     pNormals);
+
+} // namespace USD
+
+} // namespace Diligent
@@ -45,12 +45,14 @@ class HnRenderParam final : public pxr::HdRenderParam
 public:
     HnRenderParam(bool                              UseVertexPool,
                   bool                              UseIndexPool,
-                  HN_MATERIAL_TEXTURES_BINDING_MODE TextureBindingMode) noexcept;
+                  HN_MATERIAL_TEXTURES_BINDING_MODE TextureBindingMode,
+                  bool                              UseIndirectDraws) noexcept;
     ~HnRenderParam();
 
     bool                              GetUseVertexPool() const { return m_UseVertexPool; }
     bool                              GetUseIndexPool() const { return m_UseIndexPool; }
     HN_MATERIAL_TEXTURES_BINDING_MODE GetTextureBindingMode() const { return m_TextureBindingMode; }
+    bool                              GetUseIndirectDraws() const { return m_UseIndirectDraws; }
 
     HN_RENDER_MODE GetRenderMode() const { return m_RenderMode; }
     void           SetRenderMode(HN_RENDER_MODE Mode) { m_RenderMode = Mode; }
@@ -83,6 +85,8 @@ private:
 
     const HN_MATERIAL_TEXTURES_BINDING_MODE m_TextureBindingMode;
 
+    const bool m_UseIndirectDraws;
+
     HN_RENDER_MODE m_RenderMode = HN_RENDER_MODE_SOLID;
 
     pxr::SdfPath m_SelectedPrimId;
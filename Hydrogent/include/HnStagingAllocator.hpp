@@ -0,0 +1,108 @@
+/*
+ *  Copyright 2024 Diligent Graphics LLC
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+
+#pragma once
+
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+
+#include "../../../DiligentCore/Primitives/interface/BasicTypes.h"
+#include "../../../DiligentCore/Primitives/interface/MemoryAllocator.h"
+#include "../../../DiligentCore/Common/interface/DynamicLinearAllocator.hpp"
+
+namespace Diligent
+{
+
+namespace USD
+{
+
+/// Linear allocator for the staging data that meshes prepare during the sync.
+///
+/// Hydra syncs meshes in parallel. Every sync thread allocates from its own arena,
+/// so allocations do not contend with each other and do not go through the heap.
+/// A thread looks up its arena under the lock only once after each reset, and then
+/// uses the arena pointer cached in thread-local storage.
+/// The memory stays valid until Reset() is called. The render delegate resets the
+/// allocator after all meshes have committed their GPU resources, and the arena
+/// memory is then reused by the next sync.
+class HnStagingAllocator
+{
+public:
+    explicit HnStagingAllocator(IMemoryAllocator& RawAllocator);
+    ~HnStagingAllocator();
+
+    // clang-format off
+    HnStagingAllocator           (const HnStagingAllocator&)  = delete;
+    HnStagingAllocator           (      HnStagingAllocator&&) = delete;
+    HnStagingAllocator& operator=(const HnStagingAllocator&)  = delete;
+    HnStagingAllocator& operator=(      HnStagingAllocator&&) = delete;
+    // clang-format on
+
+    /// Allocates memory from the arena of the calling thread.
+    void* Allocate(size_t Size, size_t Alignment);
+
+    template <typename T>
+    T* Allocate(size_t Count)
+    {
+        return static_cast<T*>(Allocate(sizeof(T) * Count, alignof(T)));
+    }
+
+    /// Invalidates all allocations made since the last reset.
+    ///
+    /// \remarks    The method must not be called while any thread may allocate memory.
+    void Reset();
+
+private:
+    struct Arena
+    {
+        Arena(IMemoryAllocator& RawAllocator, Uint32 BlockSize) :
+            Allocator{RawAllocator, BlockSize}
+        {}
+
+        DynamicLinearAllocator Allocator;
+
+        size_t AllocatedSize = 0;
+    };
+
+    Arena& GetThreadArena();
+
+private:
+    IMemoryAllocator& m_RawAllocator;
+
+    // Unique generation of the allocator arenas that is changed by every reset.
+    // Thread-local arena pointers cached for other generations are not used.
+    Uint64 m_Generation = 0;
+
+    std::mutex                                                  m_ArenasMtx;
+    std::unordered_map<std::thread::id, std::unique_ptr<Arena>> m_Arenas;
+};
+
+} // namespace USD
+
+} // namespace Diligent
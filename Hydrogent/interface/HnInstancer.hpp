@@ -0,0 +1,82 @@
+/*
+ *  Copyright 2024 Diligent Graphics LLC
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+#pragma once
+
+#include <mutex>
+#include <unordered_map>
+
+#include "pxr/imaging/hd/instancer.h"
+#include "pxr/base/vt/types.h"
+#include "pxr/base/tf/token.h"
+
+namespace Diligent
+{
+
+namespace USD
+{
+
+/// Instancer implementation in Hydrogent.
+///
+/// The instancer caches its instance-rate primvars and computes the instance transforms
+/// of its prototypes. Meshes use the transforms to render all instances of the prototype
+/// with a single instanced draw call.
+class HnInstancer final : public pxr::HdInstancer
+{
+public:
+    static HnInstancer* Create(pxr::HdSceneDelegate* Delegate, const pxr::SdfPath& Id);
+
+    ~HnInstancer();
+
+    // Synchronizes the instancer primvars from the scene delegate.
+    virtual void Sync(pxr::HdSceneDelegate* Delegate,
+                      pxr::HdRenderParam*   RenderParam,
+                      pxr::HdDirtyBits*     DirtyBits) override final;
+
+    /// Computes the world-space transforms of all instances of the given prototype.
+    ///
+    /// \remarks    The transforms include the instancer transform and the transforms
+    ///             of all parent instancers, but not the prototype transform itself.
+    ///             The prototype transform must be applied before the instance transform.
+    pxr::VtMatrix4dArray ComputeInstanceTransforms(const pxr::SdfPath& PrototypeId);
+
+private:
+    HnInstancer(pxr::HdSceneDelegate* Delegate, const pxr::SdfPath& Id);
+
+    void SyncPrimvars(pxr::HdSceneDelegate& Delegate, pxr::HdDirtyBits DirtyBits);
+
+    pxr::VtValue GetPrimvar(const pxr::TfToken& Name) const;
+
+private:
+    // Primvars are read by the prototypes that may be synced in parallel.
+    mutable std::mutex m_PrimvarsMtx;
+
+    std::unordered_map<pxr::TfToken, pxr::VtValue, pxr::TfToken::HashFunctor> m_Primvars;
+};
+
+} // namespace USD
+
+} // namespace Diligent
@@ -27,6 +27,7 @@
 #pragma once
 
 #include "pxr/imaging/hd/light.h"
+#include "pxr/base/tf/token.h"
 
 #include "../../../../DiligentCore/Common/interface/BasicMath.hpp"
 
@@ -37,10 +38,22 @@ namespace USD
 {
 
 /// Light implementation in Hydrogent.
+///
+/// The light reads its type, transform and parameters from the scene delegate
+/// when the corresponding Hydra dirty bits are set. The render delegate then
+/// writes the lights whose data has changed to the punctual light buffer
+/// (see HnRenderDelegate::CreateInfo::MaxLightCount).
 class HnLight final : public pxr::HdLight
 {
 public:
-    static HnLight* Create(const pxr::SdfPath& Id);
+    enum class TYPE : Uint8
+    {
+        DIRECTIONAL,
+        POINT,
+        SPOT
+    };
+
+    static HnLight* Create(const pxr::SdfPath& Id, const pxr::TfToken& TypeId);
 
     ~HnLight();
 
@@ -56,15 +69,43 @@ public:
     const float3& GetDirection() const { return m_Direction; }
     const float4& GetIntensity() const { return m_Intensity; }
 
-    void SetDirection(const float3& Direction) { m_Direction = Direction; }
-    void SetIntensity(const float4& Intensity) { m_Intensity = Intensity; }
+    void SetDirection(const float3& Direction);
+    void SetIntensity(const float4& Intensity);
+
+    TYPE          GetType() const { return m_Type; }
+    const float3& GetPosition() const { return m_Position; }
+    float         GetRange() const { return m_Range; }
+    float         GetConeInnerAngle() const { return m_ConeInnerAngle; }
+    float         GetConeOuterAngle() const { return m_ConeOuterAngle; }
+    bool          IsVisible() const { return m_IsVisible; }
+
+    /// Index of the light in the punctual light buffer, or ~0u if the light is not in the buffer.
+    Uint32 GetBufferIndex() const { return m_BufferIndex; }
+    void   SetBufferIndex(Uint32 Index);
+
+    /// Whether the light attributes have changed since the light was last written to the buffer.
+    bool IsGPUDataDirty() const { return m_GPUDataDirty; }
+    void SetGPUDataClean() { m_GPUDataDirty = false; }
 
 private:
-    HnLight(const pxr::SdfPath& Id);
+    HnLight(const pxr::SdfPath& Id, const pxr::TfToken& TypeId);
+
+    void UpdateRange();
 
 private:
+    const pxr::TfToken m_TypeId;
+
+    TYPE   m_Type = TYPE::DIRECTIONAL;
+    float3 m_Position;
     float3 m_Direction;
     float4 m_Intensity;
+    float  m_Range          = 0;
+    float  m_ConeInnerAngle = 0;
+    float  m_ConeOuterAngle = 0;
+    bool   m_IsVisible      = true;
+
+    Uint32 m_BufferIndex  = ~0u;
+    bool   m_GPUDataDirty = true;
 };
 
 } // namespace USD
@@ -78,8 +78,17 @@ public:
     /// Creates an SRB cache that should be passed to UpdateSRB().
     static RefCntAutoPtr<IObject> CreateSRBCache();
 
+    /// Creates the material SRB if it has not been created yet or if its textures have changed.
+    ///
+    /// \remarks   The method does not use the device context, and the render delegate may call it for
+    ///            multiple materials in parallel when the device supports multithreaded resource creation.
     void UpdateSRB(HnRenderDelegate& RendererDelegate);
 
+    /// Uploads the material data to the renderer material buffer if it has changed since the last upload.
+    ///
+    /// \remarks   The method uses the immediate context and must be called from the render thread.
+    void UpdateMaterialBuffer(HnRenderDelegate& RendererDelegate);
+
     IShaderResourceBinding* GetSRB() const { return m_SRB; }
     IShaderResourceBinding* GetSRB(Uint32 PrimitiveAttribsOffset) const
     {
@@ -90,6 +99,17 @@ public:
 
     const GLTF::Material& GetMaterialData() const { return m_MaterialData; }
 
+    /// Returns the material version that is incremented every time the material data changes.
+    Uint32 GetVersion() const { return m_Version; }
+
+    /// Returns the index of the material in the renderer material buffer,
+    /// or ~0u if the material has not been allocated in the buffer
+    /// (see PBR_Renderer::CreateInfo::MaxMaterialCount).
+    Uint32 GetMaterialBufferId() const
+    {
+        return m_MaterialBufferRange ? m_MaterialBufferRange->FirstMaterialId : ~0u;
+    }
+
     /// Texture coordinate set info
     struct TextureCoordinateSetInfo
     {
@@ -116,6 +136,10 @@ public:
         return m_ShaderTextureIndexingId;
     }
 
+    /// Requests the material textures for a mesh that covers the given screen area, in pixels
+    /// (see HnTextureRegistry::RequestTexture()).
+    void RequestTextures(HnTextureRegistry& TexRegistry, float ScreenArea) const;
+
 private:
     HnMaterial(pxr::SdfPath const& id);
 
@@ -137,11 +161,24 @@ private:
     void ProcessMaterialNetwork();
     void InitTextureAttribs(HnTextureRegistry& TexRegistry, const USD_Renderer& UsdRenderer, const TexNameToCoordSetMapType& TexNameToCoordSetMap);
 
+    // Returns the handle of the material texture, or the handle of its placeholder
+    // if the texture is still being loaded.
+    const HnTextureRegistry::TextureHandle* GetTextureOrPlaceholder(const pxr::TfToken& Name) const;
+
+    // Returns true if the registry has replaced any of the material textures
+    // since the given storage version (e.g. when texture mip levels are streamed).
+    bool HasTexturesReplacedSince(Uint32 StorageVersion) const;
+
 private:
     HnMaterialNetwork m_Network;
 
     std::unordered_map<pxr::TfToken, HnTextureRegistry::TextureHandleSharedPtr, pxr::TfToken::HashFunctor> m_Textures;
 
+    // Default textures that are used in place of the textures that are still being loaded
+    std::unordered_map<pxr::TfToken, HnTextureRegistry::TextureHandleSharedPtr, pxr::TfToken::HashFunctor> m_PlaceholderTextures;
+
+    TexNameToCoordSetMapType m_TexNameToCoordSetMap;
+
     RefCntAutoPtr<IShaderResourceBinding> m_SRB;
     IShaderResourceVariable*              m_PrimitiveAttribsVar = nullptr; // cbPrimitiveAttribs
 
@@ -154,7 +191,16 @@ private:
     // Current atlas version
     Uint32 m_AtlasVersion = 0;
 
+    // Texture registry storage version when the material textures were last checked
+    Uint32 m_TextureStorageVersion = 0;
+
     ShaderTextureIndexingIdType m_ShaderTextureIndexingId = 0;
+
+    Uint32 m_Version = 0;
+
+    // Material slot in the renderer material buffer and the material version that was uploaded to it.
+    PBR_Renderer::MaterialBufferRangePtr m_MaterialBufferRange;
+    Uint32                               m_MaterialBufferVersion = ~0u;
 };
 
 } // namespace USD
@@ -46,11 +46,15 @@ namespace Diligent
 
 struct IVertexPoolAllocation;
 struct IBufferSuballocation;
+struct IAsyncTask;
 
 namespace USD
 {
 
 class HnRenderDelegate;
+class HnStagingAllocator;
+class HnTextureRegistry;
+struct HnMeshLODChain;
 
 /// Hydra mesh implementation in Hydrogent.
 class HnMesh final : public pxr::HdMesh
@@ -120,11 +124,37 @@ public:
     ///             for the points drawing commands.
     Uint32 GetPointsStartIndex() const { return m_IndexData.PointsStartIndex; }
 
+    /// Simplified level of detail of the mesh faces.
+    struct FaceLOD
+    {
+        /// The start index of the LOD triangles in the face index buffer.
+        Uint32 StartIndex = 0;
+
+        /// The number of indices in the LOD.
+        Uint32 NumIndices = 0;
+
+        /// Object-space geometric error of the LOD relative to the full-resolution faces.
+        float Error = 0;
+    };
+
+    /// Returns the face LODs ordered from the finest to the coarsest.
+    ///
+    /// \remarks    The LOD triangles are stored in the face index buffer after the
+    ///             full-resolution triangles. The list is empty if mesh LODs are disabled
+    ///             (see HnRenderDelegate::CreateInfo::EnableMeshLODs), or have not been
+    ///             generated yet.
+    const std::vector<FaceLOD>& GetFaceLODs() const { return m_IndexData.LODs; }
+
     struct Attributes
     {
         float4x4 Transform     = float4x4::Identity();
         float4   DisplayColor  = {1, 1, 1, 1};
         bool     IsDoubleSided = false;
+
+        // Local-space bounding box. Only valid if HasExtent is true.
+        float3 ExtentMin = {0, 0, 0};
+        float3 ExtentMax = {0, 0, 0};
+        bool   HasExtent = false;
     };
     const Attributes& GetAttributes() const { return m_Attribs; }
 
@@ -132,6 +162,33 @@ public:
 
     Uint32 GetVersion() const { return m_Version; }
 
+    /// Returns true if the mesh is a prototype of an instancer.
+    bool IsInstanced() const { return !GetInstancerId().IsEmpty(); }
+
+    /// Returns the number of instances of the instanced mesh.
+    Uint32 GetNumInstances() const { return static_cast<Uint32>(m_InstanceData.Transforms.size()); }
+
+    /// Returns the world transforms of the mesh instances.
+    ///
+    /// \remarks    The transforms include the mesh transform that is applied
+    ///             before the instance transform.
+    const std::vector<float4x4>& GetInstanceTransforms() const { return m_InstanceData.Transforms; }
+
+    /// Returns the instance transforms from the previous frame.
+    const std::vector<float4x4>& GetPrevInstanceTransforms() const { return m_InstanceData.PrevTransforms; }
+
+    /// Returns the index of the first instance in the instance transforms buffer
+    /// (see PBR_Renderer::GetInstanceTransformsBuffer()), or ~0u if the
+    /// instance transforms are not in the buffer.
+    Uint32 GetFirstInstance() const { return m_InstanceData.FirstInstance; }
+
+    /// Releases the range of the instance transforms buffer allocated by the mesh.
+    void FreeInstances(HnRenderDelegate& RenderDelegate);
+
+    /// Requests the textures of all materials used by the mesh
+    /// (see HnMaterial::RequestTextures()).
+    void RequestTextures(HnTextureRegistry& TexRegistry, float ScreenArea);
+
 protected:
     // This callback from Rprim gives the prim an opportunity to set
     // additional dirty bits based on those already set.
@@ -177,10 +234,15 @@ private:
                                 pxr::HdDirtyBits&     DirtyBits,
                                 const pxr::TfToken&   ReprToken);
 
-    void GenerateSmoothNormals();
+    void GenerateSmoothNormals(HnStagingAllocator& Allocator);
 
     // Converts vertex primvar sources into face-varying primvar sources.
-    void ConvertVertexPrimvarSources(FaceSourcesMapType&& FaceSources);
+    void ConvertVertexPrimvarSources(FaceSourcesMapType&& FaceSources, HnStagingAllocator& Allocator);
+
+    void UpdateInstances(pxr::HdSceneDelegate& SceneDelegate,
+                         pxr::HdDirtyBits      DirtyBits);
+
+    void UpdateInstanceTransformsBuffer(HnRenderDelegate& RenderDelegate);
 
     void UpdateTopology(pxr::HdSceneDelegate& SceneDelegate,
                         pxr::HdRenderParam*   RenderParam,
@@ -195,6 +257,14 @@ private:
     void UpdateDrawItemGpuGeometry(HnRenderDelegate& RenderDelegate);
     void UpdateDrawItemGpuTopology();
 
+    // Returns the staging points the face LODs are generated from, or null if the LODs
+    // are disabled or can't be generated for the current staging data.
+    const pxr::HdBufferSource* GetLODSourcePoints(const HnRenderDelegate& RenderDelegate) const;
+    // Starts generating the face LODs from the staging data.
+    void GenerateLODs(HnRenderDelegate& RenderDelegate);
+    // Uploads the face LODs to the index buffer when they have been generated.
+    void UpdateLODs(HnRenderDelegate& RenderDelegate);
+
     template <typename HandleDrawItemFuncType, typename HandleGeomSubsetDrawItemFuncType>
     void ProcessDrawItems(HandleDrawItemFuncType&&           HandleDrawItem,
                           HandleGeomSubsetDrawItemFuncType&& HandleGeomSubsetDrawItem);
@@ -216,11 +286,20 @@ private:
 
     struct StagingVertexData
     {
-        // Use map to keep buffer sources sorted by name
+        // Use map to keep buffer sources sorted by name.
+        // Generated sources keep their data in the staging allocator memory
+        // (see HnStagingAllocator) that is only valid until the GPU resources are committed.
         std::map<pxr::TfToken, std::shared_ptr<pxr::HdBufferSource>> Sources;
     };
     std::unique_ptr<StagingVertexData> m_StagingVertexData;
 
+    struct StagingInstanceData
+    {
+        // Empty if the mesh is no longer instanced
+        std::vector<float4x4> Transforms;
+    };
+    std::unique_ptr<StagingInstanceData> m_StagingInstanceData;
+
     Attributes m_Attribs;
 
     struct IndexData
@@ -238,9 +317,33 @@ private:
         RefCntAutoPtr<IBufferSuballocation> FaceAllocation;
         RefCntAutoPtr<IBufferSuballocation> EdgeAllocation;
         RefCntAutoPtr<IBufferSuballocation> PointsAllocation;
+
+        // The number of indices reserved for the LODs after the face indices
+        Uint32 NumLODIndices = 0;
+
+        std::vector<FaceLOD> LODs;
     };
     IndexData m_IndexData;
 
+    struct LODData
+    {
+        // The task that generates the LODs on a worker thread
+        RefCntAutoPtr<IAsyncTask> Task;
+
+        // The chain that is set by the task. The pointer is shared with the task,
+        // so that the mesh can be destroyed while the task is running.
+        std::shared_ptr<std::shared_ptr<const HnMeshLODChain>> pPendingChain;
+
+        // The number of vertices the pending chain is generated for.
+        // The chain indices are validated against it before they are uploaded.
+        Uint32 NumVertices = 0;
+
+        // The chain in the index buffer. The mesh keeps the chain alive,
+        // so that meshes with identical geometry can share it (see HnMeshLODCache).
+        std::shared_ptr<const HnMeshLODChain> Chain;
+    };
+    LODData m_LODData;
+
     struct VertexData
     {
         RefCntAutoPtr<IVertexPoolAllocation> PoolAllocation;
@@ -253,6 +356,20 @@ private:
     };
     VertexData m_VertexData;
 
+    struct InstanceData
+    {
+        std::vector<float4x4> Transforms;
+        std::vector<float4x4> PrevTransforms;
+
+        // The range of the instance transforms buffer allocated from the render delegate
+        Uint32 FirstInstance = ~0u;
+        Uint32 Capacity      = 0;
+
+        // Previous transforms differ from the current ones and must be updated in the next frame
+        bool PrevTransformsDirty = false;
+    };
+    InstanceData m_InstanceData;
+
     Uint32 m_Version = 0;
 };
 
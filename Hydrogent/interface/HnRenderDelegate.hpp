@@ -32,6 +32,8 @@
 #include <string>
 #include <atomic>
 #include <mutex>
+#include <array>
+#include <vector>
 
 #include "pxr/imaging/hd/renderDelegate.h"
 
@@ -46,6 +48,9 @@
 namespace Diligent
 {
 
+class VariableSizeAllocationsManager;
+struct IThreadPool;
+
 namespace GLTF
 {
 class ResourceManager;
@@ -58,6 +63,8 @@ class HnMaterial;
 class HnMesh;
 class HnLight;
 class HnRenderParam;
+class HnStagingAllocator;
+class HnMeshLODCache;
 
 /// Memory usage statistics of the render delegate.
 struct HnRenderDelegateMemoryStats
@@ -111,6 +118,29 @@ struct HnRenderDelegateMemoryStats
         Uint64 AllocatedTexels = 0;
     };
     TextureAtlasUsage Atlas;
+
+    /// Texture residency statistics.
+    struct TextureResidencyUsage
+    {
+        /// The GPU memory budget for the streamed textures, in bytes.
+        Uint64 Budget = 0;
+
+        /// The memory size of the resident mip levels of all streamed textures, in bytes.
+        Uint64 ResidentSize = 0;
+
+        /// The memory size that the streamed textures would use if all their mip levels were resident, in bytes.
+        Uint64 FullSize = 0;
+
+        /// The memory size of the mip levels that are being streamed in, in bytes.
+        Uint64 PendingSize = 0;
+
+        /// The number of streamed textures.
+        Uint32 TextureCount = 0;
+
+        /// The number of textures whose mip levels are being streamed in.
+        Uint32 PendingCount = 0;
+    };
+    TextureResidencyUsage TextureResidency;
 };
 
 /// USD render delegate implementation in Hydrogent.
@@ -145,6 +175,119 @@ public:
         ///
         /// If zero, the renderer will automatically determine the array size.
         Uint32 TexturesArraySize = 0;
+
+        /// Whether to use GPU-driven indirect rendering.
+        ///
+        /// \remarks    In this mode, render passes keep their draw lists and primitive
+        ///             attributes in persistent GPU buffers and only update the data that
+        ///             has changed. Indirect draw arguments are built by a compute shader,
+        ///             and items that share the pipeline state, material and geometry buffers
+        ///             are rendered with a single indirect draw call.
+        ///
+        ///             The mode requires compute shaders and indirect rendering support.
+        ///             If the device does not support them, the mode is disabled.
+        ///
+        ///             Non-indexed items and expanded instances are rendered with regular
+        ///             draw calls, and are not culled on the GPU.
+        bool UseIndirectDraws = false;
+
+        /// When UseIndirectDraws is true, the size of the primitive attributes
+        /// buffer that holds persistent attributes of all render passes, in bytes.
+        Uint32 IndirectPrimitiveAttribsBufferSize = 16u << 20u;
+
+        /// The maximum total number of instances of all instanced meshes that
+        /// can be rendered with hardware instancing.
+        ///
+        /// \remarks    Instance transforms are kept in a GPU buffer, and all instances
+        ///             of a mesh prototype are rendered with a single instanced draw call.
+        ///             If the buffer is full, or hardware instancing is not available (e.g. when
+        ///             UseIndirectDraws is true), instances are rendered with separate draw calls.
+        Uint32 MaxInstanceCount = 16384;
+
+        /// The maximum number of materials in the material buffer.
+        ///
+        /// \remarks    If this value is not zero, material attributes are uploaded to a persistent
+        ///             GPU buffer once per material change, and per-draw attributes only contain
+        ///             the transforms and the material index (see PBR_Renderer::CreateInfo::MaxMaterialCount).
+        ///             If this value is zero (default), material attributes are written for every draw.
+        Uint32 MaxMaterialCount = 0;
+
+        /// The maximum number of USD lights that are rendered with clustered lighting.
+        ///
+        /// \remarks    Distant, sphere, disk, rect and cylinder lights are synchronized from the scene
+        ///             into the punctual light buffer (see PBR_Renderer::CreateInfo::MaxLightCount).
+        ///             Only the lights whose parameters or transforms have changed are rewritten
+        ///             every frame. Area lights are approximated by point and spot lights.
+        ///             Clustered lighting requires compute shaders, and adds a light binning
+        ///             compute pass every frame. If this value is zero (default) or the device
+        ///             does not support compute shaders, only the first distant light is used.
+        Uint32 MaxLightCount = 0;
+
+        /// Thread pool to load textures in.
+        ///
+        /// \remarks    If the thread pool is provided, texture files are read and decoded by
+        ///             the worker threads, and materials use placeholder textures until
+        ///             the textures are loaded. Textures of the meshes that cover a larger
+        ///             area of the screen are loaded first.
+        ///             If the thread pool is null, textures are loaded synchronously.
+        IThreadPool* pTextureLoaderThreadPool = nullptr;
+
+        /// Thread pool to create pipeline states in.
+        ///
+        /// \remarks    If the thread pool is provided and the device supports multithreaded
+        ///             pipeline state creation, meshes whose pipeline states are not ready are
+        ///             rendered with simplified fallback pipeline states while the full
+        ///             pipeline states are compiled by the worker threads.
+        ///             If the thread pool is null, pipeline states are created synchronously.
+        IThreadPool* pShaderCompilationThreadPool = nullptr;
+
+        /// Thread pool to commit the resources of the dirty objects in.
+        ///
+        /// \remarks    If the thread pool is provided and the device supports multithreaded
+        ///             resource creation, CommitResources() creates the shader resource bindings
+        ///             of the dirty materials in the worker threads. GPU data uploads are always
+        ///             performed by the render thread through the immediate context.
+        IThreadPool* pResourceCommitThreadPool = nullptr;
+
+        /// The maximum number of bytes of texture data that are uploaded
+        /// to the GPU in one frame. Zero means no limit.
+        ///
+        /// \remarks    The budget only applies to the textures loaded asynchronously
+        ///             (see pTextureLoaderThreadPool). At least one texture is uploaded
+        ///             every frame, even if its size exceeds the budget.
+        Uint64 TextureUploadBudget = 0;
+
+        /// The GPU memory budget, in bytes, for the mip levels of the streamed textures.
+        /// Zero disables texture streaming.
+        ///
+        /// \remarks    Streaming requires the texture loader thread pool (see pTextureLoaderThreadPool).
+        ///             Only 2D textures that are not allocated in the texture atlas are streamed:
+        ///             the coarse mip levels are loaded first, and the finer mip levels are
+        ///             streamed in and out based on the screen area covered by the meshes
+        ///             that use the textures. The coarse mip levels are always resident,
+        ///             and may exceed the budget.
+        Uint64 TextureResidencyBudget = 0;
+
+        /// Whether to generate simplified levels of detail of the mesh faces.
+        ///
+        /// \remarks    When a mesh topology changes, a chain of LODs is generated from the
+        ///             triangulated faces with the quadric error metric. Every LOD has at most
+        ///             half the triangles of the previous one, and is stored in the index buffer
+        ///             after the full-resolution faces. The LODs are generated by the worker
+        ///             threads of pResourceCommitThreadPool, if it is provided, and meshes are
+        ///             rendered at full resolution until their LODs are ready. Meshes with
+        ///             identical geometry share the generated LODs.
+        ///
+        ///             In the solid render mode, render passes draw every non-instanced mesh with
+        ///             the coarsest LOD whose projected error does not exceed MeshLODErrorThreshold.
+        bool EnableMeshLODs = false;
+
+        /// The minimum number of triangles in the coarsest mesh LOD.
+        /// Meshes with fewer than twice this number of triangles have no LODs.
+        Uint32 MinMeshLODTriangles = 1024;
+
+        /// The maximum projected error of the selected mesh LOD, in pixels.
+        float MeshLODErrorThreshold = 1.f;
     };
     static std::unique_ptr<HnRenderDelegate> Create(const CreateInfo& CI);
 
@@ -285,8 +428,53 @@ public:
     IBuffer*           GetFrameAttribsCB() const { return m_FrameAttribsCB; }
     IBuffer*           GetPrimitiveAttribsCB() const { return m_PrimitiveAttribsCB; }
 
+    /// Returns the size of the primitive attributes buffer range that render passes
+    /// rewrite every frame. When indirect draws are enabled, the rest of the buffer
+    /// is reserved for persistent attributes.
+    Uint32 GetTransientPrimitiveAttribsSize() const { return m_TransientPrimitiveAttribsSize; }
+
+    /// When indirect draws are enabled, allocates a persistent region of the given size
+    /// in the primitive attributes buffer. Returns the region offset or ~0u on failure.
+    Uint32 AllocatePrimitiveAttribs(Uint32 Size);
+
+    /// Releases the region allocated by AllocatePrimitiveAttribs().
+    void FreePrimitiveAttribs(Uint32 Offset, Uint32 Size);
+
+    /// Allocates a range of the given number of instances in the instance transforms
+    /// buffer (see PBR_Renderer::GetInstanceTransformsBuffer()). Returns the index of
+    /// the first instance, or ~0u if the range can't be allocated or instancing is disabled.
+    Uint32 AllocateInstances(Uint32 Count);
+
+    /// Releases the range allocated by AllocateInstances().
+    void FreeInstances(Uint32 FirstInstance, Uint32 Count);
+
+    /// Returns the compute pipeline that builds indirect draw arguments, or null
+    /// if indirect draws are disabled.
+    ///
+    /// \param [in] EnableCulling - Whether the pipeline should also perform frustum and
+    ///                              occlusion culling using the data provided by HnCullRprimsTask.
+    IPipelineState* GetBuildIndirectDrawArgsPSO(bool EnableCulling) const { return m_BuildIndirectDrawArgsPSO[EnableCulling ? 1 : 0]; }
+
+    /// Returns the allocator for the mesh staging data (see HnStagingAllocator).
+    HnStagingAllocator& GetStagingAllocator() const { return *m_StagingAllocator; }
+
+    /// Returns the cache of the mesh LOD chains, or null if mesh LODs are disabled.
+    const std::shared_ptr<HnMeshLODCache>& GetMeshLODCache() const { return m_MeshLODCache; }
+
+    /// Returns the minimum number of triangles in the coarsest mesh LOD.
+    Uint32 GetMinMeshLODTriangles() const { return m_MinMeshLODTriangles; }
+
+    /// Returns the maximum projected error of the selected mesh LOD, in pixels.
+    float GetMeshLODErrorThreshold() const { return m_MeshLODErrorThreshold; }
+
+    IThreadPool* GetResourceCommitThreadPool() const { return m_pResourceCommitThreadPool; }
+
     const auto& GetLights() const { return m_Lights; }
 
+    /// Returns the number of lights in the punctual light buffer.
+    Uint32 GetPunctualLightCount() const { return m_PunctualLightCount; }
+    const auto& GetMeshes() const { return m_Meshes; }
+
     HnRenderDelegateMemoryStats GetMemoryStats() const;
 
     void SetDebugView(PBR_Renderer::DebugViewType DebugView);
@@ -295,6 +483,75 @@ public:
 
     IObject* GetMaterialSRBCache() const { return m_MaterialSRBCache; }
 
+    /// Adds the mesh to the list of meshes whose GPU resources are updated by the next CommitResources() call.
+    ///
+    /// \remarks    The method is thread-safe and is called by HnMesh::Sync(), and by
+    ///             HnMesh::CommitGPUResources() while the mesh LODs are being generated.
+    void MarkMeshDirty(HnMesh& Mesh) { m_DirtyMeshes.Push(&Mesh); }
+
+    /// Adds the material to the list of materials whose SRBs are updated by the next CommitResources() call.
+    ///
+    /// \remarks    The method is thread-safe and is called by HnMaterial::Sync().
+    void MarkMaterialDirty(HnMaterial& Material) { m_DirtyMaterials.Push(&Material); }
+
+private:
+    void CommitLights();
+    void CommitMaterials();
+    void CommitMeshes();
+
+    // Lock-free multiple-producer list of the objects whose GPU resources need to be committed.
+    // The objects are pushed by Sync() that Hydra may run in multiple threads, and are all taken
+    // at once by CommitResources(). An object may be pushed multiple times, and may have been
+    // destroyed by the time it is taken, so the consumer must validate the objects.
+    template <typename ObjectType>
+    class DirtyList
+    {
+    public:
+        DirtyList() = default;
+
+        // clang-format off
+        DirtyList           (const DirtyList&)  = delete;
+        DirtyList           (      DirtyList&&) = delete;
+        DirtyList& operator=(const DirtyList&)  = delete;
+        DirtyList& operator=(      DirtyList&&) = delete;
+        // clang-format on
+
+        ~DirtyList()
+        {
+            std::vector<ObjectType*> Objects;
+            TakeAll(Objects);
+        }
+
+        void Push(ObjectType* pObject)
+        {
+            Node* pNode = new Node{pObject, m_Head.load(std::memory_order_relaxed)};
+            while (!m_Head.compare_exchange_weak(pNode->pNext, pNode, std::memory_order_release, std::memory_order_relaxed))
+            {
+            }
+        }
+
+        // Appends all objects in the list to Objects and empties the list.
+        void TakeAll(std::vector<ObjectType*>& Objects)
+        {
+            Node* pNode = m_Head.exchange(nullptr, std::memory_order_acquire);
+            while (pNode != nullptr)
+            {
+                Objects.push_back(pNode->pObject);
+                Node* pNext = pNode->pNext;
+                delete pNode;
+                pNode = pNext;
+            }
+        }
+
+    private:
+        struct Node
+        {
+            ObjectType* const pObject;
+            Node*             pNext;
+        };
+        std::atomic<Node*> m_Head{nullptr};
+    };
+
 private:
     static const pxr::TfTokenVector SupportedRPrimTypes;
     static const pxr::TfTokenVector SupportedSPrimTypes;
@@ -304,15 +561,24 @@ private:
     RefCntAutoPtr<IDeviceContext>    m_pContext;
     RefCntAutoPtr<IRenderStateCache> m_pRenderStateCache;
 
+    const bool m_UseIndirectDraws;
+
     RefCntAutoPtr<GLTF::ResourceManager> m_ResourceMgr;
     RefCntAutoPtr<IBuffer>               m_FrameAttribsCB;
     RefCntAutoPtr<IBuffer>               m_PrimitiveAttribsCB;
     RefCntAutoPtr<IObject>               m_MaterialSRBCache;
     std::shared_ptr<USD_Renderer>        m_USDRenderer;
 
+    Uint32                                          m_TransientPrimitiveAttribsSize = 0;
+    std::unique_ptr<VariableSizeAllocationsManager> m_PrimitiveAttribsAllocator;
+    std::array<RefCntAutoPtr<IPipelineState>, 2>    m_BuildIndirectDrawArgsPSO;
+    std::unique_ptr<VariableSizeAllocationsManager> m_InstanceAllocator;
+
     HnTextureRegistry              m_TextureRegistry;
     std::unique_ptr<HnRenderParam> m_RenderParam;
 
+    std::unique_ptr<HnStagingAllocator> m_StagingAllocator;
+
     std::atomic<Uint32>                      m_RPrimNextUID{1};
     mutable std::mutex                       m_RPrimUIDToSdfPathMtx;
     std::unordered_map<Uint32, pxr::SdfPath> m_RPrimUIDToSdfPath;
@@ -323,8 +589,28 @@ private:
     std::mutex                      m_MaterialsMtx;
     std::unordered_set<HnMaterial*> m_Materials;
 
+    DirtyList<HnMesh>     m_DirtyMeshes;
+    DirtyList<HnMaterial> m_DirtyMaterials;
+
+    // Texture registry versions at the time the SRBs of all materials were last updated.
+    // When the versions change, the textures of any material may have been replaced.
+    Uint32 m_MaterialsAtlasVersion      = ~0u;
+    Uint32 m_MaterialsTexStorageVersion = ~0u;
+
+    RefCntAutoPtr<IThreadPool> m_pResourceCommitThreadPool;
+
+    std::shared_ptr<HnMeshLODCache> m_MeshLODCache;
+    const Uint32                    m_MinMeshLODTriangles;
+    const float                     m_MeshLODErrorThreshold;
+
     std::mutex                   m_LightsMtx;
     std::unordered_set<HnLight*> m_Lights;
+
+    // Lights in the order of the punctual light buffer
+    std::vector<HnLight*>                      m_LightBufferSlots;
+    std::vector<HLSL::PBRPunctualLightAttribs> m_LightsData;
+    Uint32                                     m_PunctualLightCount     = 0;
+    bool                                       m_LightCountWarningShown = false;
 };
 
 } // namespace USD
@@ -45,6 +45,16 @@ class HnDrawItem;
 class HnRenderPassState;
 class HnMaterial;
 
+} // namespace USD
+
+namespace HLSL
+{
+struct HnDrawCommand;
+} // namespace HLSL
+
+namespace USD
+{
+
 struct HnMeshRenderParams
 {
     float4x4 Transform = float4x4::Identity();
@@ -80,6 +90,8 @@ public:
     HnRenderPass(pxr::HdRenderIndex*           pIndex,
                  const pxr::HdRprimCollection& Collection);
 
+    virtual ~HnRenderPass() override final;
+
     void SetParams(const HnRenderPassParams& Params);
     void SetMeshRenderParams(const HnMeshRenderParams& Params);
 
@@ -96,6 +108,29 @@ public:
         DRAW_LIST_ITEM_DIRTY_FLAG_ALL       = DRAW_LIST_ITEM_DIRTY_FLAG_LAST * 2 - 1
     };
 
+    /// State change statistics of the draw list.
+    struct DrawListStats
+    {
+        struct StateChanges
+        {
+            Uint32 PSO           = 0;
+            Uint32 SRB           = 0;
+            Uint32 IndexBuffer   = 0;
+            Uint32 VertexBuffers = 0;
+            Uint32 Draws         = 0;
+        };
+        // State changes required to render the draw list in its original order.
+        StateChanges Unsorted;
+
+        // State changes required to render the draw list in the sorted order with merged draws.
+        StateChanges Sorted;
+    };
+    /// Returns the draw list statistics that are updated every time the draw list is sorted.
+    ///
+    /// \remarks   The statistics include all items of the draw list, and do not take
+    ///             the visibility and culling into account.
+    const DrawListStats& GetDrawListStats() const { return m_DrawListStats; }
+
 protected:
     // Virtual API: Execute the buckets corresponding to renderTags;
     // renderTags.empty() implies execute everything.
@@ -111,6 +146,13 @@ private:
     {
         const HnDrawItem& DrawItem;
 
+        // UID of the draw item's mesh, which is used to match the items when the draw list is updated.
+        Uint32 MeshUID = 0;
+
+        // GPU resources of the item that need to be updated in addition to the ones
+        // marked dirty for all items. New items are fully updated.
+        DRAW_LIST_ITEM_DIRTY_FLAGS DirtyFlags = DRAW_LIST_ITEM_DIRTY_FLAG_ALL;
+
         IPipelineState* pPSO = nullptr;
 
         IBuffer* IndexBuffer = nullptr;
@@ -137,6 +179,25 @@ private:
 
         float4x4 PrevTransform = float4x4::Identity();
 
+        // The number of instances rendered by each draw call of the item.
+        // Zero if the mesh is instanced, but has no instances.
+        Uint32 NumInstances = 1;
+
+        // Whether the instances of an instanced mesh are rendered with separate draw calls,
+        // which happens when their transforms are not in the instance transforms buffer.
+        bool ExpandInstances = false;
+
+        // Indirect draw mode: the index of the item's draw command, the offset of its primitive
+        // attributes relative to the beginning of the persistent region, and the material version
+        // that was used to write the attributes.
+        Uint32 DrawCommandIdx  = ~0u;
+        Uint32 AttribsOffset   = 0;
+        Uint32 MaterialVersion = ~0u;
+        bool   AttribsDirty    = true;
+
+        // Render order sort key that combines the PSO, SRB, vertex pool page, index buffer and mesh.
+        Uint64 SortKey = 0;
+
         explicit DrawListItem(const HnDrawItem& Item) noexcept;
 
         operator bool() const noexcept
@@ -150,6 +211,41 @@ private:
 
     void RenderPendingDrawItems(RenderState& State);
 
+    // Selects the index range of the item: the coarsest face LOD of the mesh whose projected
+    // error does not exceed the render delegate threshold, or the item's own range.
+    void SelectLOD(const DrawListItem& ListItem, const RenderState& State, Uint32& StartIndex, Uint32& NumIndices) const;
+
+    // Sorts the render order by the state sort key and updates the draw list statistics.
+    void SortDrawList();
+    // Counts the state changes in the original order, or in the sorted order with merged draws.
+    DrawListStats::StateChanges CountStateChanges(bool MergeDraws) const;
+    // Returns true if the items use the same bindings and primitive attributes,
+    // so that they can be rendered by one draw call if their index ranges are contiguous.
+    static bool CanMergeDraws(const DrawListItem& Item0, const DrawListItem& Item1);
+
+    // Writes the primitive attributes of the item. When the instances of the item are expanded,
+    // InstanceIdx is the index of the instance to write the attributes for.
+    void WritePrimitiveAttribs(DrawListItem& ListItem, const RenderState& State, void* pDst, Uint32 InstanceIdx = ~0u);
+
+    enum class IndirectDrawStatus
+    {
+        // Indirect draws could not be used (e.g. the persistent primitive attributes
+        // region could not be allocated), so all items must be rendered by the regular path.
+        Unavailable,
+
+        // The indirect draw list is empty, so there is nothing to render indirectly.
+        Empty,
+
+        // The items in the indirect draw list have been rendered.
+        Rendered
+    };
+    IndirectDrawStatus RenderIndirect(RenderState& State);
+    // Updates the world-space bounds of the draw command. Returns true if the command has changed.
+    bool UpdateDrawCommandBounds(const DrawListItem& ListItem, HLSL::HnDrawCommand& Cmd) const;
+    bool UpdateIndirectDrawList(RenderState& State);
+    void UpdateIndirectDrawCommandsBuffer(RenderState& State, IPipelineState* pBuildDrawArgsPSO);
+    void UpdateIndirectPrimitiveAttribs(RenderState& State);
+
     GraphicsPipelineDesc GetGraphicsDesc(const HnRenderPassState& RPState) const;
 
 private:
@@ -159,17 +255,76 @@ private:
     HN_RENDER_MODE              m_RenderMode = HN_RENDER_MODE_SOLID;
     PBR_Renderer::DebugViewType m_DebugView  = PBR_Renderer::DebugViewType::None;
 
+    // Whether some draw list items use fallback PSOs while their PSOs are created asynchronously.
+    bool m_UsesFallbackPSOs = false;
+    // Renderer's async PSO version when the PSOs were last requested.
+    Uint32 m_AsyncPSOVersion = 0;
+
     // All draw items in the collection returned by the render index.
     pxr::HdRenderIndex::HdDrawItemPtrVector m_DrawItems;
     // Only selected/unselected draw items in the collection.
     std::vector<DrawListItem> m_DrawList;
+    struct PendingDrawItem
+    {
+        const DrawListItem* pListItem = nullptr;
+
+        // The start index of the draw, which differs from the item's start index when a mesh LOD is selected.
+        Uint32 StartIndex = 0;
+
+        // The number of indices to draw, which includes the indices of the following
+        // items whose draws were merged into this one.
+        Uint32 NumVertices = 0;
+    };
     // Draw list items to be rendered in the current batch.
-    std::vector<const DrawListItem*> m_PendingDrawItems;
-    // Rendering order of the draw list items sorted by the PSO.
+    std::vector<PendingDrawItem> m_PendingDrawItems;
+    // Rendering order of the draw list items sorted by the state sort key.
     std::vector<Uint32> m_RenderOrder;
 
+    DrawListStats m_DrawListStats;
+
     std::vector<Uint8> m_PrimitiveAttribsData;
 
+    // Indirect draw mode data.
+    struct IndirectDrawBatch
+    {
+        // Index of the first item in the draw list. All items in the batch
+        // use the same PSO, material and geometry buffers.
+        Uint32 FirstListItem = 0;
+
+        Uint32 FirstCommand = 0;
+        Uint32 NumCommands  = 0;
+
+        // Offset of the batch primitive attributes array relative to the beginning of the persistent region
+        Uint32 AttribsOffset = 0;
+        Uint32 AttribsStride = 0;
+    };
+    std::vector<IndirectDrawBatch> m_IndirectBatches;
+
+    // Draw list item index for each draw command
+    std::vector<Uint32> m_IndirectDrawItems;
+
+    std::vector<HLSL::HnDrawCommand> m_DrawCommands;
+    // CPU copy of the persistent primitive attributes
+    std::vector<Uint8> m_IndirectAttribsData;
+
+    RefCntAutoPtr<IBuffer>                m_DrawCommandsBuffer;
+    RefCntAutoPtr<IBuffer>                m_DrawArgsBuffer;
+    RefCntAutoPtr<IBufferView>            m_DrawArgsUAV;
+    RefCntAutoPtr<IShaderResourceBinding> m_BuildDrawArgsSRB;
+    // Pipeline that m_BuildDrawArgsSRB was created for. The pipelines are owned by the render delegate.
+    IPipelineState* m_BuildDrawArgsPSO = nullptr;
+
+    // Persistent region in the primitive attributes buffer allocated from the render delegate
+    Uint32 m_AttribsRegionOffset = ~0u;
+    Uint32 m_AttribsRegionSize   = 0;
+
+    // Whether the render order needs to be updated because items were added to or removed from the draw list.
+    bool m_RenderOrderDirty = true;
+
+    bool m_IndirectDrawListDirty = true;
+    bool m_DrawCommandsDirty     = true;
+    bool m_IndirectAttribsDirty  = true;
+
     pxr::SdfPath m_SelectedPrimId             = {};
     unsigned int m_CollectionVersion          = ~0u;
     unsigned int m_RprimRenderTagVersion      = ~0u;
@@ -27,6 +27,7 @@
 #pragma once
 
 #include <array>
+#include <vector>
 
 #include "../../../DiligentCore/Graphics/GraphicsEngine/interface/RasterizerState.h"
 #include "../../../DiligentCore/Graphics/GraphicsEngine/interface/BlendState.h"
@@ -98,6 +99,42 @@ struct HnFramebufferTargets
     static const char* GetTargetName(GBUFFER_TARGET Id);
 };
 
+/// Per-frame culling data produced by HnCullRprimsTask.
+struct HnCullingData
+{
+    /// Frustum culling results indexed by the mesh UID. A non-zero value indicates
+    /// that the mesh is culled. Null if CPU frustum culling was not performed.
+    const std::vector<Uint8>* pCulledMeshes = nullptr;
+
+    /// Constant buffer that contains the GPU culling attributes (HLSL::HnCullingAttribs).
+    /// Null if GPU culling is disabled.
+    IBuffer* pCullingAttribsCB = nullptr;
+
+    /// Max-depth hierarchy built from the previous frame depth buffer.
+    /// Null if GPU culling is disabled.
+    ITextureView* pDepthHierarchySRV = nullptr;
+
+    bool IsMeshCulled(Uint32 MeshUID) const
+    {
+        return pCulledMeshes != nullptr && MeshUID < pCulledMeshes->size() && (*pCulledMeshes)[MeshUID] != 0;
+    }
+
+    bool IsGPUCullingEnabled() const
+    {
+        return pCullingAttribsCB != nullptr && pDepthHierarchySRV != nullptr;
+    }
+};
+
+/// Per-frame data used by HnRenderPass to select the mesh LODs.
+struct HnLODSelectionData
+{
+    /// Camera view-projection matrix.
+    float4x4 ViewProj = float4x4::Identity();
+
+    /// Viewport height in pixels. If zero, meshes are drawn at full resolution.
+    float ViewportHeight = 0;
+};
+
 /// Hydra render pass state implementation in Hydrogent.
 class HnRenderPassState final : public pxr::HdRenderPassState
 {
@@ -157,6 +194,15 @@ public:
         return m_FramebufferTargets;
     }
 
+    void SetCullingData(const HnCullingData& Data)
+    {
+        m_CullingData = Data;
+    }
+    const HnCullingData& GetCullingData() const
+    {
+        return m_CullingData;
+    }
+
     void SetClearColor(const float3& ClearColor)
     {
         m_ClearColor = ClearColor;
@@ -175,6 +221,15 @@ public:
         return m_ClearDepth;
     }
 
+    void SetLODSelectionData(const HnLODSelectionData& Data)
+    {
+        m_LODSelectionData = Data;
+    }
+    const HnLODSelectionData& GetLODSelectionData() const
+    {
+        return m_LODSelectionData;
+    }
+
 private:
     Uint32                                         m_NumRenderTargets = 0;
     std::array<TEXTURE_FORMAT, MAX_RENDER_TARGETS> m_RTVFormats       = {};
@@ -184,8 +239,12 @@ private:
 
     HnFramebufferTargets m_FramebufferTargets;
 
+    HnCullingData m_CullingData;
+
     float3 m_ClearColor = {0, 0, 0};
     float  m_ClearDepth = 1.f;
+
+    HnLODSelectionData m_LODSelectionData;
 };
 
 } // namespace USD
@@ -30,6 +30,8 @@
 #include <mutex>
 #include <unordered_map>
 #include <atomic>
+#include <vector>
+#include <functional>
 
 #include "pxr/pxr.h"
 #include "pxr/base/tf/token.h"
@@ -45,6 +47,8 @@ namespace Diligent
 {
 
 struct ITextureAtlasSuballocation;
+struct IThreadPool;
+struct IAsyncTask;
 
 namespace GLTF
 {
@@ -59,8 +63,21 @@ struct HnTextureIdentifier;
 class HnTextureRegistry final
 {
 public:
+    /// \param [in] pDevice          - Render device.
+    /// \param [in] pResourceManager - Resource manager to allocate textures in the atlas.
+    ///                                 If null, textures are created as standalone textures.
+    /// \param [in] pThreadPool      - Thread pool to load textures in. If null, textures are
+    ///                                 loaded synchronously by the thread that allocates them.
+    /// \param [in] UploadBudget     - The maximum number of bytes of asynchronously loaded texture
+    ///                                 data that Commit() uploads to the GPU. Zero means no limit.
+    /// \param [in] ResidencyBudget  - The GPU memory budget, in bytes, for the mip levels of the streamed
+    ///                                 textures. Zero disables streaming. Only asynchronously loaded
+    ///                                 standalone 2D textures are streamed.
     HnTextureRegistry(IRenderDevice*         pDevice,
-                      GLTF::ResourceManager* pResourceManager);
+                      GLTF::ResourceManager* pResourceManager,
+                      IThreadPool*           pThreadPool     = nullptr,
+                      Uint64                 UploadBudget    = 0,
+                      Uint64                 ResidencyBudget = 0);
     ~HnTextureRegistry();
 
     void Commit(IDeviceContext* pContext);
@@ -74,6 +91,10 @@ public:
 
         Uint32 TextureId = ~0u;
 
+        // The storage version at which the texture object was last replaced
+        // (see GetStorageVersion()).
+        Uint32 StorageVersion = 0;
+
         explicit operator bool() const noexcept
         {
             return pTexture != nullptr || pAtlasSuballocation != nullptr;
@@ -88,10 +109,14 @@ public:
 
     // Allocates texture handle for the specified texture file path.
     // If the texture is not loaded, calls CreateLoader() to create the texture loader.
+    // If AsyncLoad is true and the registry has a thread pool, CreateLoader() is called
+    // by a worker thread, and the handle is initialized by one of the subsequent
+    // Commit() calls. Until then, the handle is empty.
     TextureHandleSharedPtr Allocate(const pxr::TfToken&                            FilePath,
                                     const TextureComponentMapping&                 Swizzle,
                                     const pxr::HdSamplerParameters&                SamplerParams,
-                                    std::function<RefCntAutoPtr<ITextureLoader>()> CreateLoader);
+                                    std::function<RefCntAutoPtr<ITextureLoader>()> CreateLoader,
+                                    bool                                           AsyncLoad = false);
 
     TextureHandleSharedPtr Get(const pxr::TfToken& Path)
     {
@@ -100,6 +125,50 @@ public:
 
     Uint32 GetAtlasVersion() const;
 
+    /// Returns the number of textures that are being loaded asynchronously
+    /// or wait to be uploaded to the GPU.
+    Uint32 GetNumPendingLoads() const { return m_NumPendingLoads.load(); }
+
+    /// Returns the version that is incremented every time Commit() initializes
+    /// asynchronously loaded textures or replaces the textures of the streamed handles.
+    /// Materials use it to replace placeholder textures and to rebind streamed textures.
+    Uint32 GetStorageVersion() const { return m_StorageVersion.load(); }
+
+    /// Returns true if the registry streams the mip levels of the textures.
+    bool IsStreamingEnabled() const { return m_pThreadPool && m_ResidencyBudget != 0; }
+
+    /// Notifies the registry that the texture is used by a mesh that covers the given
+    /// area of the screen, in pixels.
+    ///
+    /// \remarks    The area is used as the load priority of the texture if it is still
+    ///             waiting to be loaded: textures with higher priority are loaded first.
+    ///             If the texture is streamed, the largest area requested since the last
+    ///             Commit() determines the mip levels that need to be resident.
+    ///             The method must be called from the same thread as Commit().
+    void RequestTexture(const TextureHandle& Handle, float ScreenArea);
+
+    struct ResidencyStats
+    {
+        // The GPU memory budget for the streamed textures, in bytes.
+        Uint64 Budget = 0;
+
+        // The memory size of the resident mip levels of all streamed textures, in bytes.
+        Uint64 ResidentSize = 0;
+
+        // The memory size that the streamed textures would use if all their mip levels were resident, in bytes.
+        Uint64 FullSize = 0;
+
+        // The memory size of the mip levels that are being streamed in, in bytes.
+        Uint64 PendingSize = 0;
+
+        // The number of streamed textures.
+        Uint32 TextureCount = 0;
+
+        // The number of textures whose mip levels are being streamed in.
+        Uint32 PendingCount = 0;
+    };
+    ResidencyStats GetResidencyStats() const;
+
     template <typename HandlerType>
     void ProcessTextures(HandlerType&& Handler)
     {
@@ -111,7 +180,22 @@ private:
                           IDeviceContext*    pContext,
                           ITextureLoader*    pLoader,
                           const SamplerDesc& SamDesc,
-                          TextureHandle&     Handle);
+                          TextureHandle&     Handle,
+                          Uint32             FirstMip = 0);
+
+    void AllocateAtlasSpace(const pxr::TfToken& FilePath,
+                            ITextureLoader*     pLoader,
+                            TextureHandle&      Handle);
+
+    struct AsyncLoadInfo;
+    void LoadTexture(AsyncLoadInfo& LoadInfo);
+    void EnqueueLoadTask(std::shared_ptr<AsyncLoadInfo> pLoadInfo);
+    void CommitLoadedTextures(IDeviceContext* pContext);
+
+    struct StreamedTextureInfo;
+    void UpdateResidency(IDeviceContext* pContext);
+    bool StreamIn(StreamedTextureInfo& TexInfo, Uint32 TargetMip);
+    bool EvictMips(IDeviceContext* pContext, StreamedTextureInfo& TexInfo, Uint32 NewResidentMip);
 
 private:
     RefCntAutoPtr<IRenderDevice> m_pDevice;
@@ -131,6 +215,79 @@ private:
     std::unordered_map<pxr::TfToken, PendingTextureInfo, pxr::TfToken::HashFunctor> m_PendingTextures;
 
     std::atomic<Uint32> m_NextTextureId{0};
+
+    RefCntAutoPtr<IThreadPool> m_pThreadPool;
+
+    const Uint64 m_UploadBudget;
+    const Uint64 m_ResidencyBudget;
+
+    struct AsyncLoadInfo
+    {
+        pxr::TfToken                                   FilePath;
+        std::function<RefCntAutoPtr<ITextureLoader>()> CreateLoader;
+        SamplerDesc                                    SamDesc;
+        TextureHandleSharedPtr                         Handle;
+
+        // Whether the texture is streamed and only the mip levels starting from FirstMip are loaded
+        bool Streamed = false;
+        // Whether the load streams in finer mip levels of the texture that is already resident
+        bool   StreamIn = false;
+        Uint32 FirstMip = 0;
+        // Description of the streamed texture with all mip levels
+        TextureDesc FullDesc;
+
+        // Loader created by the worker thread. Released once the texture data is uploaded.
+        RefCntAutoPtr<ITextureLoader> pLoader;
+
+        // Texture data prepared by the worker thread: the atlas region or, if the device
+        // supports multithreaded resource creation, the standalone texture.
+        // It is copied to Handle by Commit() so that the handle only changes in the main thread.
+        TextureHandle LoadedData;
+    };
+
+    std::mutex m_AsyncLoadsMtx;
+    // Load tasks that have not completed yet, indexed by the texture id
+    std::unordered_map<Uint32, RefCntAutoPtr<IAsyncTask>> m_LoadTasks;
+    // Loaded textures in the order of completion
+    std::vector<std::shared_ptr<AsyncLoadInfo>> m_LoadedTextures;
+
+    std::atomic<Uint32> m_NumPendingLoads{0};
+    std::atomic<Uint32> m_StorageVersion{0};
+    std::atomic<bool>   m_StopLoading{false};
+
+    struct StreamedTextureInfo
+    {
+        pxr::TfToken                                   FilePath;
+        std::function<RefCntAutoPtr<ITextureLoader>()> CreateLoader;
+        SamplerDesc                                    SamDesc;
+        TextureHandleSharedPtr                         Handle;
+
+        // Description of the texture with all mip levels
+        TextureDesc FullDesc;
+
+        // The most detailed resident mip level
+        Uint32 ResidentMip = 0;
+        // The coarse mip levels starting from this one are always resident
+        Uint32 TailMip = 0;
+        // The most detailed mip level that needs to be resident
+        Uint32 DesiredMip = 0;
+        // The mip level that is being streamed in, or ~0u
+        Uint32 PendingMip = ~0u;
+
+        // The largest screen area requested in the frame LastRequestFrame
+        float ScreenArea = 0;
+        // The value of m_FrameNumber when the texture was last requested
+        Uint64 LastRequestFrame = 0;
+    };
+    // Streamed textures indexed by the texture id.
+    // Only accessed by the thread that calls Commit().
+    std::unordered_map<Uint32, StreamedTextureInfo> m_StreamedTextures;
+
+    Uint64 m_FrameNumber          = 0;
+    Uint64 m_ResidentSize         = 0;
+    Uint64 m_FullSize             = 0;
+    Uint64 m_PendingSize          = 0;
+    Uint32 m_NumStreamingTextures = 0;
 };
 
 } // namespace USD
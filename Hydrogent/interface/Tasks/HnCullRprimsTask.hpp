@@ -0,0 +1,160 @@
+/*
+ *  Copyright 2024 Diligent Graphics LLC
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+#pragma once
+
+#include <array>
+#include <vector>
+
+#include "HnTask.hpp"
+
+#include "../../../../DiligentCore/Graphics/GraphicsEngine/interface/PipelineState.h"
+#include "../../../../DiligentCore/Graphics/GraphicsEngine/interface/ShaderResourceBinding.h"
+#include "../../../../DiligentCore/Graphics/GraphicsEngine/interface/Buffer.h"
+#include "../../../../DiligentCore/Graphics/GraphicsEngine/interface/Texture.h"
+#include "../../../../DiligentCore/Graphics/GraphicsEngine/interface/DeviceContext.h"
+#include "../../../../DiligentCore/Common/interface/RefCntAutoPtr.hpp"
+#include "../../../../DiligentCore/Common/interface/BasicMath.hpp"
+
+namespace Diligent
+{
+
+namespace USD
+{
+
+struct HnCullRprimsTaskParams
+{
+    /// Whether to cull Rprims that are outside of the camera frustum.
+    bool FrustumCulling = true;
+
+    /// Whether to cull Rprims that are hidden behind the geometry rendered in the previous frame.
+    ///
+    /// \remarks    Occlusion culling is only performed when indirect draws are enabled
+    ///             (see HnRenderDelegate::CreateInfo::UseIndirectDraws).
+    bool OcclusionCulling = false;
+
+    /// Transform that is applied to all Rprims.
+    /// This must be the same transform as in HnRenderRprimsTaskParams.
+    float4x4 Transform = float4x4::Identity();
+
+    constexpr bool operator==(const HnCullRprimsTaskParams& rhs) const
+    {
+        // clang-format off
+        return FrustumCulling   == rhs.FrustumCulling &&
+               OcclusionCulling == rhs.OcclusionCulling &&
+               Transform        == rhs.Transform;
+        // clang-format on
+    }
+
+    constexpr bool operator!=(const HnCullRprimsTaskParams& rhs) const
+    {
+        return !(*this == rhs);
+    }
+};
+
+/// Culls Rprims that are not visible from the camera.
+///
+/// The task must be executed after HnBeginFrameTask and before the render Rprims tasks.
+/// When indirect draws are disabled, the task tests mesh bounding boxes against the
+/// camera frustum on the CPU, and render passes skip the culled meshes.
+/// When indirect draws are enabled, the task builds the max-depth hierarchy from the
+/// previous frame depth buffer, and render passes cull draw commands on the GPU when
+/// they build the indirect draw arguments.
+/// While textures are being loaded asynchronously or streamed, the task also requests
+/// the textures of the visible meshes with the screen area that the meshes cover, so
+/// that the registry loads the textures of the larger meshes first and streams in
+/// the mip levels that the meshes need.
+class HnCullRprimsTask final : public HnTask
+{
+public:
+    HnCullRprimsTask(pxr::HdSceneDelegate* ParamsDelegate, const pxr::SdfPath& Id);
+    ~HnCullRprimsTask();
+
+    virtual void Sync(pxr::HdSceneDelegate* Delegate,
+                      pxr::HdTaskContext*   TaskCtx,
+                      pxr::HdDirtyBits*     DirtyBits) override final;
+
+    virtual void Prepare(pxr::HdTaskContext* TaskCtx,
+                         pxr::HdRenderIndex* RenderIndex) override final;
+
+    virtual void Execute(pxr::HdTaskContext* TaskCtx) override final;
+
+private:
+    void CullMeshes(const float4x4& ViewProj);
+    void RequestTextures(const float4x4& ViewProj, float ScreenArea);
+
+    bool PrepareDepthHierarchy(const TextureDesc& DepthDesc);
+    void PrepareTechniques();
+    void BuildDepthHierarchy(IDeviceContext* pCtx, ITextureView* pDepthSRV);
+
+private:
+    HnCullRprimsTaskParams m_Params;
+
+    pxr::HdRenderIndex* m_RenderIndex = nullptr;
+
+    // Frustum culling results indexed by the mesh UID.
+    std::vector<Uint8> m_CulledMeshes;
+
+    RefCntAutoPtr<IBuffer> m_CullingAttribsCB;
+
+    // Max-depth hierarchy. The first level has half of the depth buffer resolution.
+    RefCntAutoPtr<ITexture>                  m_DepthHierarchy;
+    std::vector<RefCntAutoPtr<ITextureView>> m_DepthHierarchyMipUAVs;
+
+    // Depth buffer that was rendered in the last frame. The depth hierarchy may only be
+    // built from the previous frame depth buffer if it is the same texture.
+    RefCntAutoPtr<ITexture> m_LastDepthBuffer;
+
+    // Computes one level of the depth hierarchy from the depth buffer (Idx 0)
+    // or from the previous level of the hierarchy (Idx 1).
+    struct DownsampleDepthTech
+    {
+        RefCntAutoPtr<IPipelineState>         PSO;
+        RefCntAutoPtr<IShaderResourceBinding> SRB;
+        struct ShaderVariables
+        {
+            IShaderResourceVariable* Src = nullptr;
+            IShaderResourceVariable* Dst = nullptr;
+
+            constexpr explicit operator bool() const
+            {
+                return Src != nullptr && Dst != nullptr;
+            }
+        } Vars;
+
+        explicit operator bool() const
+        {
+            return PSO && SRB && Vars;
+        }
+    };
+    std::array<DownsampleDepthTech, 2> m_DownsampleTechs;
+
+    bool m_TechniquesFailed = false;
+};
+
+} // namespace USD
+
+} // namespace Diligent
@@ -40,6 +40,7 @@ namespace USD
 {
 
 struct HnBeginFrameTaskParams;
+struct HnCullRprimsTaskParams;
 struct HnRenderRprimsTaskParams;
 struct HnPostProcessTaskParams;
 struct HnRenderPassParams;
@@ -52,6 +53,7 @@ class HnTaskManager
 public:
     using TaskUID                                                    = uint64_t;
     static constexpr TaskUID TaskUID_BeginFrame                      = 0x8362faac57354542;
+    static constexpr TaskUID TaskUID_CullRprims                      = 0x5b2e07c9d1a84f36;
     static constexpr TaskUID TaskUID_RenderRprimsDefaultSelected     = 0x1cdf84fa9ab5423e;
     static constexpr TaskUID TaskUID_RenderRprimsMaskedSelected      = 0xe926da1de43d4f47;
     static constexpr TaskUID TaskUID_CopySelectionDepth              = 0xf3026cea7404c64a;
@@ -84,6 +86,8 @@ public:
     ///                         - BeginFrame
     ///                             * Prepares render targets
     ///                             * Binds the Color and Mesh Id render targes and the the selection depth buffer
+    ///                         - CullRprims
+    ///                             * Culls Rprims against the camera frustum and builds the depth hierarchy for occlusion culling
     ///                         - RenderRprimsDefaultSelected
     ///                             * Renders only selected Rprims with the default material tag
     ///                         - RenderRprimsMaskedSelected
@@ -115,6 +119,7 @@ public:
     ///     | Task                            |  Selected Rprims | Unselected Rprims | Color  |  Mesh ID  | G-Buffer |  Selection Detph | Main Depth |
     ///     |---------------------------------|------------------|-------------------|--------|-----------|----------|------------------|------------|
     ///     | BeginFrame                      |                  |                   |  bind  |   bind    |   bind   |      bind        |            |
+    ///     | CullRprims                      |                  |                   |        |           |          |                  |            |
     ///     | RenderRprimsDefaultSelected     |       V          |                   |   V    |     V     |    V     |        V         |            |
     ///     | RenderRprimsMaskedSelected      |       V          |                   |   V    |     V     |    V     |        V         |            |
     ///     | CopySelectionDepth              |                  |                   |  bind  |   bind    |   bind   |        V---copy--|---->V bind |
@@ -179,6 +184,7 @@ public:
                        TaskParamsType&&    Params);
 
     void SetFrameParams(const HnBeginFrameTaskParams& Params);
+    void SetCullRprimsParams(const HnCullRprimsTaskParams& Params);
     void SetRenderRprimParams(const HnRenderRprimsTaskParams& Params);
     void SetPostProcessParams(const HnPostProcessTaskParams& Params);
     void SetReadRprimIdParams(const HnReadRprimIdTaskParams& Params);
@@ -222,6 +228,7 @@ private:
     pxr::SdfPath GetRenderRprimsTaskId(const pxr::TfToken& MaterialTag, const HnRenderPassParams& RenderPassParams) const;
 
     void CreateBeginFrameTask();
+    void CreateCullRprimsTask();
     void CreateRenderRprimsTask(const pxr::TfToken& MaterialTag, TaskUID UID, const HnRenderPassParams& RenderPassParams);
     void CreateRenderEnvMapTask();
     void CreateRenderAxesTask();
@@ -0,0 +1,235 @@
+/*
+ *  Copyright 2024 Diligent Graphics LLC
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+#include "HnInstancer.hpp"
+
+#include "DebugUtilities.hpp"
+
+#include "pxr/imaging/hd/sceneDelegate.h"
+#include "pxr/imaging/hd/renderIndex.h"
+#include "pxr/imaging/hd/changeTracker.h"
+#include "pxr/imaging/hd/tokens.h"
+#include "pxr/base/gf/matrix4d.h"
+#include "pxr/base/gf/matrix4f.h"
+#include "pxr/base/gf/quatd.h"
+#include "pxr/base/gf/quatf.h"
+#include "pxr/base/gf/quath.h"
+#include "pxr/base/gf/vec3f.h"
+#include "pxr/base/gf/vec4f.h"
+
+namespace Diligent
+{
+
+namespace USD
+{
+
+HnInstancer* HnInstancer::Create(pxr::HdSceneDelegate* Delegate, const pxr::SdfPath& Id)
+{
+    return new HnInstancer{Delegate, Id};
+}
+
+HnInstancer::HnInstancer(pxr::HdSceneDelegate* Delegate, const pxr::SdfPath& Id) :
+    pxr::HdInstancer{Delegate, Id}
+{
+}
+
+HnInstancer::~HnInstancer()
+{
+}
+
+void HnInstancer::Sync(pxr::HdSceneDelegate* Delegate,
+                       pxr::HdRenderParam*   RenderParam,
+                       pxr::HdDirtyBits*     DirtyBits)
+{
+    if (Delegate == nullptr || DirtyBits == nullptr)
+        return;
+
+    _UpdateInstancer(Delegate, DirtyBits);
+
+    if (pxr::HdChangeTracker::IsAnyPrimvarDirty(*DirtyBits, GetId()))
+    {
+        SyncPrimvars(*Delegate, *DirtyBits);
+    }
+}
+
+void HnInstancer::SyncPrimvars(pxr::HdSceneDelegate& Delegate, pxr::HdDirtyBits DirtyBits)
+{
+    const pxr::SdfPath& Id = GetId();
+
+    const pxr::HdPrimvarDescriptorVector PrimvarDescs = Delegate.GetPrimvarDescriptors(Id, pxr::HdInterpolationInstance);
+
+    std::lock_guard<std::mutex> Guard{m_PrimvarsMtx};
+    for (const pxr::HdPrimvarDescriptor& PrimDesc : PrimvarDescs)
+    {
+        if (!pxr::HdChangeTracker::IsPrimvarDirty(DirtyBits, Id, PrimDesc.name))
+            continue;
+
+        pxr::VtValue Value = Delegate.Get(Id, PrimDesc.name);
+        if (!Value.IsEmpty())
+            m_Primvars[PrimDesc.name] = std::move(Value);
+        else
+            m_Primvars.erase(PrimDesc.name);
+    }
+}
+
+pxr::VtValue HnInstancer::GetPrimvar(const pxr::TfToken& Name) const
+{
+    std::lock_guard<std::mutex> Guard{m_PrimvarsMtx};
+
+    auto it = m_Primvars.find(Name);
+    return it != m_Primvars.end() ? it->second : pxr::VtValue{};
+}
+
+template <typename QuatType>
+static void ApplyInstanceRotations(const pxr::VtArray<QuatType>& Rotations, const pxr::VtIntArray& InstanceIndices, pxr::VtMatrix4dArray& Transforms)
+{
+    for (size_t i = 0; i < InstanceIndices.size(); ++i)
+    {
+        const size_t Idx = static_cast<size_t>(InstanceIndices[i]);
+        if (Idx >= Rotations.size())
+            continue;
+
+        pxr::GfMatrix4d RotateMat{1};
+        RotateMat.SetRotate(pxr::GfQuatd{Rotations[Idx]});
+        Transforms[i] = RotateMat * Transforms[i];
+    }
+}
+
+pxr::VtMatrix4dArray HnInstancer::ComputeInstanceTransforms(const pxr::SdfPath& PrototypeId)
+{
+    const pxr::HdInstancerTokensType& Tokens   = *pxr::HdInstancerTokens;
+    pxr::HdSceneDelegate*             Delegate = GetDelegate();
+
+    const pxr::GfMatrix4d InstancerTransform = Delegate->GetInstancerTransform(GetId());
+    const pxr::VtIntArray InstanceIndices    = Delegate->GetInstanceIndices(GetId(), PrototypeId);
+    const size_t          NumInstances       = InstanceIndices.size();
+    pxr::VtMatrix4dArray  Transforms(NumInstances, InstancerTransform);
+
+    // The final instance transform is
+    //     InstanceTransform * Scale * Rotate * Translate * InstancerTransform
+    // Apply the components right to left.
+
+    const pxr::VtValue Translations = GetPrimvar(Tokens.instanceTranslations);
+    if (Translations.IsHolding<pxr::VtVec3fArray>())
+    {
+        const pxr::VtVec3fArray& Translates = Translations.UncheckedGet<pxr::VtVec3fArray>();
+        for (size_t i = 0; i < NumInstances; ++i)
+        {
+            const size_t Idx = static_cast<size_t>(InstanceIndices[i]);
+            if (Idx >= Translates.size())
+                continue;
+
+            pxr::GfMatrix4d TranslateMat{1};
+            TranslateMat.SetTranslate(pxr::GfVec3d{Translates[Idx]});
+            Transforms[i] = TranslateMat * Transforms[i];
+        }
+    }
+
+    const pxr::VtValue Rotations = GetPrimvar(Tokens.instanceRotations);
+    if (Rotations.IsHolding<pxr::VtQuathArray>())
+    {
+        ApplyInstanceRotations(Rotations.UncheckedGet<pxr::VtQuathArray>(), InstanceIndices, Transforms);
+    }
+    else if (Rotations.IsHolding<pxr::VtQuatfArray>())
+    {
+        ApplyInstanceRotations(Rotations.UncheckedGet<pxr::VtQuatfArray>(), InstanceIndices, Transforms);
+    }
+    else if (Rotations.IsHolding<pxr::VtVec4fArray>())
+    {
+        // Rotations stored as (real, i, j, k)
+        const pxr::VtVec4fArray& Rotates = Rotations.UncheckedGet<pxr::VtVec4fArray>();
+        pxr::VtQuatfArray        Quats(Rotates.size());
+        for (size_t i = 0; i < Rotates.size(); ++i)
+            Quats[i] = pxr::GfQuatf{Rotates[i][0], Rotates[i][1], Rotates[i][2], Rotates[i][3]};
+        ApplyInstanceRotations(Quats, InstanceIndices, Transforms);
+    }
+
+    const pxr::VtValue Scales = GetPrimvar(Tokens.instanceScales);
+    if (Scales.IsHolding<pxr::VtVec3fArray>())
+    {
+        const pxr::VtVec3fArray& ScaleValues = Scales.UncheckedGet<pxr::VtVec3fArray>();
+        for (size_t i = 0; i < NumInstances; ++i)
+        {
+            const size_t Idx = static_cast<size_t>(InstanceIndices[i]);
+            if (Idx >= ScaleValues.size())
+                continue;
+
+            pxr::GfMatrix4d ScaleMat{1};
+            ScaleMat.SetScale(pxr::GfVec3d{ScaleValues[Idx]});
+            Transforms[i] = ScaleMat * Transforms[i];
+        }
+    }
+
+    const pxr::VtValue InstanceTransforms = GetPrimvar(Tokens.instanceTransforms);
+    if (InstanceTransforms.IsHolding<pxr::VtMatrix4dArray>() || InstanceTransforms.IsHolding<pxr::VtMatrix4fArray>())
+    {
+        const bool IsDouble = InstanceTransforms.IsHolding<pxr::VtMatrix4dArray>();
+
+        const size_t NumMatrices = IsDouble ?
+            InstanceTransforms.UncheckedGet<pxr::VtMatrix4dArray>().size() :
+            InstanceTransforms.UncheckedGet<pxr::VtMatrix4fArray>().size();
+        for (size_t i = 0; i < NumInstances; ++i)
+        {
+            const size_t Idx = static_cast<size_t>(InstanceIndices[i]);
+            if (Idx >= NumMatrices)
+                continue;
+
+            const pxr::GfMatrix4d InstanceMat = IsDouble ?
+                InstanceTransforms.UncheckedGet<pxr::VtMatrix4dArray>()[Idx] :
+                pxr::GfMatrix4d{InstanceTransforms.UncheckedGet<pxr::VtMatrix4fArray>()[Idx]};
+            Transforms[i] = InstanceMat * Transforms[i];
+        }
+    }
+
+    const pxr::SdfPath& ParentId = GetParentId();
+    if (ParentId.IsEmpty())
+        return Transforms;
+
+    // Nested instancing: every instance of this instancer is replicated
+    // for each instance of the parent instancer.
+    pxr::HdInstancer* ParentInstancer = Delegate->GetRenderIndex().GetInstancer(ParentId);
+    if (ParentInstancer == nullptr)
+    {
+        UNEXPECTED("Parent instancer ", ParentId, " of instancer ", GetId(), " is not found in the render index");
+        return Transforms;
+    }
+
+    const pxr::VtMatrix4dArray ParentTransforms = static_cast<HnInstancer*>(ParentInstancer)->ComputeInstanceTransforms(GetId());
+
+    pxr::VtMatrix4dArray FinalTransforms(ParentTransforms.size() * NumInstances);
+    for (size_t i = 0; i < ParentTransforms.size(); ++i)
+    {
+        for (size_t j = 0; j < NumInstances; ++j)
+        {
+            FinalTransforms[i * NumInstances + j] = Transforms[j] * ParentTransforms[i];
+        }
+    }
+    return FinalTransforms;
+}
+
+} // namespace USD
+
+} // namespace Diligent
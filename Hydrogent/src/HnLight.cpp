@@ -25,6 +25,14 @@
  */
 
 #include "HnLight.hpp"
+#include "GfTypeConversions.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+#include "pxr/imaging/hd/sceneDelegate.h"
+#include "pxr/imaging/hd/tokens.h"
+#include "pxr/base/gf/vec3f.h"
 
 namespace Diligent
 {
@@ -32,13 +40,22 @@ namespace Diligent
 namespace USD
 {
 
-HnLight* HnLight::Create(const pxr::SdfPath& Id)
+// Point and spot lights in USD have infinite range. To let the lights be binned into
+// the light clusters, the range is limited to the distance at which the light intensity
+// falls below this value.
+static constexpr float LightIntensityCutoff = 1e-3f;
+
+// USD lights with a shaping cone angle less than this value are treated as spot lights.
+static constexpr float MaxSpotLightConeAngle = 90.f;
+
+HnLight* HnLight::Create(const pxr::SdfPath& Id, const pxr::TfToken& TypeId)
 {
-    return new HnLight{Id};
+    return new HnLight{Id, TypeId};
 }
 
-HnLight::HnLight(const pxr::SdfPath& Id) :
-    pxr::HdLight{Id}
+HnLight::HnLight(const pxr::SdfPath& Id, const pxr::TfToken& TypeId) :
+    pxr::HdLight{Id},
+    m_TypeId{TypeId}
 {
 }
 
@@ -51,6 +68,47 @@ pxr::HdDirtyBits HnLight::GetInitialDirtyBitsMask() const
     return pxr::HdLight::AllDirty;
 }
 
+void HnLight::SetDirection(const float3& Direction)
+{
+    m_Direction    = Direction;
+    m_GPUDataDirty = true;
+}
+
+void HnLight::SetIntensity(const float4& Intensity)
+{
+    m_Intensity = Intensity;
+    UpdateRange();
+    m_GPUDataDirty = true;
+}
+
+void HnLight::SetBufferIndex(Uint32 Index)
+{
+    if (m_BufferIndex != Index)
+    {
+        m_BufferIndex  = Index;
+        m_GPUDataDirty = true;
+    }
+}
+
+void HnLight::UpdateRange()
+{
+    if (m_Type == TYPE::DIRECTIONAL)
+    {
+        m_Range = 0;
+        return;
+    }
+
+    const float MaxIntensity = std::max(std::max(m_Intensity.r, m_Intensity.g), m_Intensity.b);
+    m_Range                  = std::max(std::sqrt(std::max(MaxIntensity, 0.f) / LightIntensityCutoff), 1e-3f);
+}
+
+template <typename T>
+static T GetLightParam(pxr::HdSceneDelegate& SceneDelegate, const pxr::SdfPath& Id, const pxr::TfToken& Name, const T& Default)
+{
+    const pxr::VtValue Value = pxr::VtValue::Cast<T>(SceneDelegate.GetLightParamValue(Id, Name));
+    return Value.IsHolding<T>() ? Value.UncheckedGet<T>() : Default;
+}
+
 void HnLight::Sync(pxr::HdSceneDelegate* SceneDelegate,
                    pxr::HdRenderParam*   RenderParam,
                    pxr::HdDirtyBits*     DirtyBits)
@@ -58,6 +116,66 @@ void HnLight::Sync(pxr::HdSceneDelegate* SceneDelegate,
     if (*DirtyBits == pxr::HdLight::Clean)
         return;
 
+    // Generic lights are set up by the application with SetDirection() and SetIntensity().
+    if (SceneDelegate == nullptr || m_TypeId == pxr::HdPrimTypeTokens->light)
+    {
+        *DirtyBits = HdLight::Clean;
+        return;
+    }
+
+    const pxr::SdfPath& Id = GetId();
+
+    if (*DirtyBits & pxr::HdLight::DirtyTransform)
+    {
+        const float4x4 Transform = ToFloat4x4(SceneDelegate->GetTransform(Id));
+
+        m_Position = float3{Transform[3][0], Transform[3][1], Transform[3][2]};
+
+        // USD lights emit light along the negative Z axis
+        const float3 Direction = -float3{Transform[2][0], Transform[2][1], Transform[2][2]};
+        const float  Length    = length(Direction);
+        m_Direction            = Length > 0 ? Direction / Length : float3{0, 0, -1};
+
+        m_GPUDataDirty = true;
+    }
+
+    if (*DirtyBits & pxr::HdLight::DirtyParams)
+    {
+        const pxr::HdLightTokensType& Tokens = *pxr::HdLightTokens;
+
+        const float3 Color     = ToFloat3(GetLightParam(*SceneDelegate, Id, Tokens.color, pxr::GfVec3f{1, 1, 1}));
+        const float  Intensity = GetLightParam(*SceneDelegate, Id, Tokens.intensity, 1.f);
+        const float  Exposure  = GetLightParam(*SceneDelegate, Id, Tokens.exposure, 0.f);
+
+        m_Intensity = float4{Color * (Intensity * std::exp2(Exposure)), 1};
+        m_IsVisible = SceneDelegate->GetVisible(Id);
+
+        if (m_TypeId == pxr::HdPrimTypeTokens->distantLight)
+        {
+            m_Type = TYPE::DIRECTIONAL;
+        }
+        else
+        {
+            // Shaping cone angle is the half-angle of the cone in degrees.
+            // Softness defines the fraction of the angle where the intensity falls off.
+            const float ConeAngle    = GetLightParam(*SceneDelegate, Id, Tokens.shapingConeAngle, MaxSpotLightConeAngle);
+            const float ConeSoftness = GetLightParam(*SceneDelegate, Id, Tokens.shapingConeSoftness, 0.f);
+            if (ConeAngle < MaxSpotLightConeAngle)
+            {
+                m_Type           = TYPE::SPOT;
+                m_ConeOuterAngle = std::max(ConeAngle, 0.f) * PI_F / 180.f;
+                m_ConeInnerAngle = m_ConeOuterAngle * (1.f - clamp(ConeSoftness, 0.f, 1.f));
+            }
+            else
+            {
+                m_Type = TYPE::POINT;
+            }
+        }
+        UpdateRange();
+
+        m_GPUDataDirty = true;
+    }
+
     *DirtyBits = HdLight::Clean;
 }
 
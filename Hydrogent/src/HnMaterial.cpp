@@ -28,6 +28,7 @@
 
 #include <vector>
 #include <set>
+#include <algorithm>
 
 #include "HnRenderDelegate.hpp"
 #include "HnTokens.hpp"
@@ -43,6 +44,7 @@
 #include "pxr/imaging/hd/sceneDelegate.h"
 
 #include "USD_Renderer.hpp"
+#include "GLTF_PBR_Renderer.hpp"
 #include "DebugUtilities.hpp"
 #include "Image.h"
 
@@ -109,7 +111,7 @@ void HnMaterial::Sync(pxr::HdSceneDelegate* SceneDelegate,
     const USD_Renderer& UsdRenderer    = *RenderDelegate->GetUSDRenderer();
 
     // A mapping from the texture name to the texture coordinate set index (e.g. "diffuseColor" -> 0)
-    TexNameToCoordSetMapType TexNameToCoordSetMap;
+    m_TexNameToCoordSetMap.clear();
 
     pxr::VtValue vtMat = SceneDelegate->GetMaterialResource(GetId());
     if (vtMat.IsHolding<pxr::HdMaterialNetworkMap>())
@@ -121,7 +123,7 @@ void HnMaterial::Sync(pxr::HdSceneDelegate* SceneDelegate,
             {
                 m_Network = HnMaterialNetwork{GetId(), hdNetworkMap}; // May throw
 
-                TexNameToCoordSetMap = AllocateTextures(TexRegistry);
+                m_TexNameToCoordSetMap = AllocateTextures(TexRegistry);
                 ProcessMaterialNetwork();
             }
             catch (const std::runtime_error& err)
@@ -138,7 +140,11 @@ void HnMaterial::Sync(pxr::HdSceneDelegate* SceneDelegate,
     }
 
     // It is important to initialize texture attributes with default values even if there is no material network.
-    InitTextureAttribs(TexRegistry, UsdRenderer, TexNameToCoordSetMap);
+    InitTextureAttribs(TexRegistry, UsdRenderer, m_TexNameToCoordSetMap);
+
+    ++m_Version;
+
+    RenderDelegate->MarkMaterialDirty(*this);
 
     *DirtyBits = HdMaterial::Clean;
 }
@@ -225,6 +231,9 @@ void HnMaterial::InitTextureAttribs(HnTextureRegistry& TexRegistry, const USD_Re
 {
     GLTF::MaterialBuilder MatBuilder{m_MaterialData};
 
+    m_TextureStorageVersion = TexRegistry.GetStorageVersion();
+    m_PlaceholderTextures.clear();
+
     auto SetTextureParams = [&](const pxr::TfToken& Name, Uint32 Idx) {
         GLTF::Material::TextureShaderAttribs& TexAttribs = MatBuilder.GetTextureAttrib(Idx);
 
@@ -260,14 +269,22 @@ void HnMaterial::InitTextureAttribs(HnTextureRegistry& TexRegistry, const USD_Re
             tex_it = m_Textures.emplace(Name, GetDefaultTexture(TexRegistry, Name)).first;
         }
 
-        if (ITextureAtlasSuballocation* pAtlasSuballocation = tex_it->second->pAtlasSuballocation)
+        if (!*tex_it->second)
+        {
+            // The texture is still being loaded
+            m_PlaceholderTextures.emplace(Name, GetDefaultTexture(TexRegistry, Name));
+        }
+
+        const HnTextureRegistry::TextureHandle* pTexHandle = GetTextureOrPlaceholder(Name);
+        VERIFY_EXPR(pTexHandle != nullptr);
+        if (ITextureAtlasSuballocation* pAtlasSuballocation = pTexHandle->pAtlasSuballocation)
         {
             TexAttribs.TextureSlice        = static_cast<float>(pAtlasSuballocation->GetSlice());
             TexAttribs.AtlasUVScaleAndBias = pAtlasSuballocation->GetUVScaleBias();
         }
         else
         {
-            TexAttribs.TextureSlice        = static_cast<float>(tex_it->second->TextureId);
+            TexAttribs.TextureSlice        = static_cast<float>(pTexHandle->TextureId);
             TexAttribs.AtlasUVScaleAndBias = float4{1, 1, 0, 0};
         }
     };
@@ -285,6 +302,38 @@ void HnMaterial::InitTextureAttribs(HnTextureRegistry& TexRegistry, const USD_Re
     MatBuilder.Finalize();
 }
 
+const HnTextureRegistry::TextureHandle* HnMaterial::GetTextureOrPlaceholder(const pxr::TfToken& Name) const
+{
+    auto tex_it = m_Textures.find(Name);
+    if (tex_it == m_Textures.end())
+        return nullptr;
+
+    if (*tex_it->second)
+        return tex_it->second.get();
+
+    auto placeholder_it = m_PlaceholderTextures.find(Name);
+    return placeholder_it != m_PlaceholderTextures.end() ? placeholder_it->second.get() : nullptr;
+}
+
+bool HnMaterial::HasTexturesReplacedSince(Uint32 StorageVersion) const
+{
+    for (const auto& it : m_Textures)
+    {
+        if (it.second && it.second->StorageVersion > StorageVersion)
+            return true;
+    }
+    return false;
+}
+
+void HnMaterial::RequestTextures(HnTextureRegistry& TexRegistry, float ScreenArea) const
+{
+    for (const auto& it : m_Textures)
+    {
+        if (it.second)
+            TexRegistry.RequestTexture(*it.second, ScreenArea);
+    }
+}
+
 static RefCntAutoPtr<Image> CreateDefaultImage(const pxr::TfToken& Name, Uint32 Dimension = 64)
 {
     ImageDesc ImgDesc;
@@ -593,7 +642,9 @@ void HnMaterial::UpdateSRB(HnRenderDelegate& RendererDelegate)
 
     HN_MATERIAL_TEXTURES_BINDING_MODE BindingMode = static_cast<const HnRenderParam*>(RendererDelegate.GetRenderParam())->GetTextureBindingMode();
 
-    const Uint32 AtlasVersion = RendererDelegate.GetTextureRegistry().GetAtlasVersion();
+    HnTextureRegistry& TexRegistry = RendererDelegate.GetTextureRegistry();
+
+    const Uint32 AtlasVersion = TexRegistry.GetAtlasVersion();
     if (BindingMode == HN_MATERIAL_TEXTURES_BINDING_MODE_ATLAS && AtlasVersion != m_AtlasVersion)
     {
         m_SRB.Release();
@@ -601,9 +652,29 @@ void HnMaterial::UpdateSRB(HnRenderDelegate& RendererDelegate)
         m_AtlasVersion        = AtlasVersion;
     }
 
+    const Uint32 TexStorageVersion = TexRegistry.GetStorageVersion();
+    if (TexStorageVersion != m_TextureStorageVersion)
+    {
+        if (!m_PlaceholderTextures.empty() || HasTexturesReplacedSince(m_TextureStorageVersion))
+        {
+            // Some textures may have been loaded or streamed: replace the placeholders
+            // and bind the new texture objects
+            InitTextureAttribs(TexRegistry, *RendererDelegate.GetUSDRenderer(), m_TexNameToCoordSetMap);
+            m_SRB.Release();
+            m_PrimitiveAttribsVar = nullptr;
+        }
+        else
+        {
+            m_TextureStorageVersion = TexStorageVersion;
+        }
+    }
+
     if (m_SRB)
         return;
 
+    // Texture attributes may change when the SRB is recreated
+    ++m_Version;
+
     USD_Renderer& UsdRenderer       = *RendererDelegate.GetUSDRenderer();
     const Uint32  TexturesArraySize = UsdRenderer.GetSettings().MaterialTexturesArraySize;
 
@@ -649,8 +720,8 @@ void HnMaterial::UpdateSRB(HnRenderDelegate& RendererDelegate)
             if (TexName.IsEmpty())
                 continue;
 
-            auto tex_it = m_Textures.find(TexName);
-            if (tex_it == m_Textures.end())
+            const HnTextureRegistry::TextureHandle* pTexHandle = GetTextureOrPlaceholder(TexName);
+            if (pTexHandle == nullptr)
             {
                 UNEXPECTED("Texture '", TexName, "' is not found. This is unexpected as at least the default texture must always be set.");
                 continue;
@@ -658,7 +729,6 @@ void HnMaterial::UpdateSRB(HnRenderDelegate& RendererDelegate)
 
             ITexture* pTexture = nullptr;
 
-            const HnTextureRegistry::TextureHandleSharedPtr& pTexHandle = tex_it->second;
             if (pTexHandle->pTexture)
             {
                 const auto& TexDesc = pTexHandle->pTexture->GetDesc();
@@ -769,6 +839,13 @@ void HnMaterial::UpdateSRB(HnRenderDelegate& RendererDelegate)
         }
     }
 
+    if (BindingMode == HN_MATERIAL_TEXTURES_BINDING_MODE_DYNAMIC)
+    {
+        // The texture array contains all textures of the registry, so a new SRB
+        // is needed every time asynchronously loaded textures are initialized.
+        SRBKey.UniqueIDs.push_back(static_cast<Int32>(TexRegistry.GetStorageVersion()));
+    }
+
     m_SRB = SRBCache->GetSRB(SRBKey, [&]() {
         RefCntAutoPtr<IShaderResourceBinding> pSRB;
 
@@ -780,7 +857,9 @@ void HnMaterial::UpdateSRB(HnRenderDelegate& RendererDelegate)
             // Primitive attribs buffer is a large buffer that fits multiple primitives.
             // In the render loop, we write multiple primitive attribs into this buffer
             // and use the SetBufferOffset function to select the attribs for the current primitive.
-            pVar->SetBufferRange(UsdRenderer.GetPBRPrimitiveAttribsCB(), 0, UsdRenderer.GetPBRPrimitiveAttribsSize(HnRenderPass::GetMaterialPSOFlags(*this)));
+            // If the renderer uses primitive arrays, the range covers the entire array.
+            const Uint32 AttribsSize = UsdRenderer.GetPBRPrimitiveAttribsSize(HnRenderPass::GetMaterialPSOFlags(*this));
+            pVar->SetBufferRange(UsdRenderer.GetPBRPrimitiveAttribsCB(), 0, AttribsSize * std::max(UsdRenderer.GetSettings().PrimitiveArraySize, 1u));
         }
         else
         {
@@ -800,9 +879,12 @@ void HnMaterial::UpdateSRB(HnRenderDelegate& RendererDelegate)
                     // that contains all textures.
                     TexArray.resize(TexturesArraySize);
 
-                    HnTextureRegistry& TexRegistry = RendererDelegate.GetTextureRegistry();
                     TexRegistry.ProcessTextures(
                         [&TexArray](const pxr::TfToken& Name, const HnTextureRegistry::TextureHandle& Handle) {
+                            // Skip the textures that are still being loaded
+                            if (!Handle)
+                                return;
+
                             if (!Handle.pTexture)
                             {
                                 UNEXPECTED("Texture '", Name, "' is not initialized.");
@@ -885,6 +967,33 @@ void HnMaterial::UpdateSRB(HnRenderDelegate& RendererDelegate)
     }
 }
 
+void HnMaterial::UpdateMaterialBuffer(HnRenderDelegate& RendererDelegate)
+{
+    USD_Renderer& UsdRenderer = *RendererDelegate.GetUSDRenderer();
+    if (UsdRenderer.GetMaterialsBuffer() == nullptr || m_MaterialBufferVersion == m_Version)
+        return;
+
+    if (!m_MaterialBufferRange)
+    {
+        m_MaterialBufferRange = UsdRenderer.AllocateMaterials(1);
+        if (!m_MaterialBufferRange)
+        {
+            // The error has been reported by AllocateMaterials(). Do not try again until the material changes.
+            m_MaterialBufferVersion = m_Version;
+            return;
+        }
+    }
+
+    const PBR_Renderer::PSO_FLAGS LayoutFlags = UsdRenderer.GetMaterialBufferLayoutFlags();
+
+    std::vector<Uint8> MaterialData(UsdRenderer.GetPBRMaterialAttribsSize(LayoutFlags));
+    GLTF_PBR_Renderer::WritePBRMaterialShaderAttribs(MaterialData.data(), LayoutFlags, UsdRenderer.GetSettings().TextureAttribIndices, m_MaterialData,
+                                                     nullptr, nullptr, /*AllowMissingAttribs = */ true);
+    UsdRenderer.UpdateMaterials(RendererDelegate.GetDeviceContext(), m_MaterialBufferRange->FirstMaterialId, 1, MaterialData.data());
+
+    m_MaterialBufferVersion = m_Version;
+}
+
 } // namespace USD
 
 } // namespace Diligent
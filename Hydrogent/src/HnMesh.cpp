@@ -26,23 +26,31 @@
 
 
 #include "HnMesh.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
 #include "HnTokens.hpp"
 #include "HnMaterial.hpp"
+#include "HnInstancer.hpp"
 #include "HnRenderDelegate.hpp"
 #include "HnRenderParam.hpp"
 #include "HnRenderPass.hpp"
 #include "HnDrawItem.hpp"
+#include "HnStagingAllocator.hpp"
+#include "HnMeshSimplifier.hpp"
+#include "HnMeshUtils.hpp"
 #include "GfTypeConversions.hpp"
 
 #include "DebugUtilities.hpp"
 #include "GraphicsTypesX.hpp"
 #include "GLTFResourceManager.hpp"
+#include "ThreadPool.hpp"
 
 #include "pxr/base/gf/vec2f.h"
 #include "pxr/imaging/hd/meshUtil.h"
 #include "pxr/imaging/hd/vtBufferSource.h"
-#include "pxr/imaging/hd/vertexAdjacency.h"
-#include "pxr/imaging/hd/smoothNormals.h"
 
 namespace Diligent
 {
@@ -171,7 +179,11 @@ void HnMesh::Sync(pxr::HdSceneDelegate* Delegate,
     const pxr::SdfPath& Id = GetId();
     if (Delegate != nullptr && DirtyBits != nullptr)
     {
+        _UpdateInstancer(Delegate, DirtyBits);
+        pxr::HdInstancer::_SyncInstancerAndParents(Delegate->GetRenderIndex(), GetInstancerId());
+
         UpdateRepr(*Delegate, RenderParam, *DirtyBits, ReprToken);
+        UpdateInstances(*Delegate, *DirtyBits);
     }
 
     if (UpdateMaterials)
@@ -186,6 +198,10 @@ void HnMesh::Sync(pxr::HdSceneDelegate* Delegate,
 
     ++m_Version;
 
+    // GPU resources are updated by HnRenderDelegate::CommitResources()
+    if (Delegate != nullptr)
+        static_cast<HnRenderDelegate*>(Delegate->GetRenderIndex().GetRenderDelegate())->MarkMeshDirty(*this);
+
     *DirtyBits &= ~pxr::HdChangeTracker::AllSceneDirtyBits;
 }
 
@@ -274,6 +290,9 @@ void HnMesh::UpdateRepr(pxr::HdSceneDelegate& SceneDelegate,
 
         if (m_StagingVertexData->Sources.find(pxr::HdTokens->points) != m_StagingVertexData->Sources.end())
         {
+            HnRenderDelegate*   RenderDelegate   = static_cast<HnRenderDelegate*>(SceneDelegate.GetRenderIndex().GetRenderDelegate());
+            HnStagingAllocator& StagingAllocator = RenderDelegate->GetStagingAllocator();
+
             // Collect face-varying primvar sources
             FaceSourcesMapType FaceSources;
             UpdateFaceVaryingPrimvars(SceneDelegate, RenderParam, DirtyBits, ReprToken, FaceSources);
@@ -282,17 +301,25 @@ void HnMesh::UpdateRepr(pxr::HdSceneDelegate& SceneDelegate,
             if (m_StagingVertexData->Sources.find(pxr::HdTokens->normals) == m_StagingVertexData->Sources.end() &&
                 FaceSources.find(pxr::HdTokens->normals) == FaceSources.end())
             {
-                GenerateSmoothNormals();
+                GenerateSmoothNormals(StagingAllocator);
             }
 
             // If there are face-varying sources, we need to convert all vertex sources into face-varying sources
             if (!FaceSources.empty())
             {
-                ConvertVertexPrimvarSources(std::move(FaceSources));
+                ConvertVertexPrimvarSources(std::move(FaceSources), StagingAllocator);
             }
 
             UpdateConstantPrimvars(SceneDelegate, RenderParam, DirtyBits, ReprToken);
 
+            if (m_StagingIndexData)
+            {
+                // The topology has changed: reserve the space for the face LODs after the face indices
+                // if they will be generated. Every LOD has at most half of the triangles of the previous
+                // one, so the whole chain never takes more indices than the faces.
+                m_IndexData.NumLODIndices = GetLODSourcePoints(*RenderDelegate) != nullptr ? GetNumFaceTriangles() * 3 : 0;
+            }
+
             // Allocate space for vertex and index buffers.
             // Note that this only reserves space, but does not create any buffers.
             AllocatePooledResources(SceneDelegate, RenderParam);
@@ -316,6 +343,18 @@ void HnMesh::UpdateRepr(pxr::HdSceneDelegate& SceneDelegate,
         }
     }
 
+    if (pxr::HdChangeTracker::IsExtentDirty(DirtyBits, Id))
+    {
+        const pxr::GfRange3d Extent = SceneDelegate.GetExtent(Id);
+        // Meshes without authored extent are never culled
+        m_Attribs.HasExtent = !Extent.IsEmpty();
+        if (m_Attribs.HasExtent)
+        {
+            m_Attribs.ExtentMin = ToFloat3(Extent.GetMin());
+            m_Attribs.ExtentMax = ToFloat3(Extent.GetMax());
+        }
+    }
+
     if (pxr::HdChangeTracker::IsVisibilityDirty(DirtyBits, Id))
     {
         _sharedData.visible = SceneDelegate.GetVisible(Id);
@@ -324,6 +363,135 @@ void HnMesh::UpdateRepr(pxr::HdSceneDelegate& SceneDelegate,
     DirtyBits &= ~pxr::HdChangeTracker::NewRepr;
 }
 
+void HnMesh::UpdateInstances(pxr::HdSceneDelegate& SceneDelegate,
+                             pxr::HdDirtyBits      DirtyBits)
+{
+    const pxr::SdfPath& Id = GetId();
+    if (!pxr::HdChangeTracker::IsInstancerDirty(DirtyBits, Id) &&
+        !pxr::HdChangeTracker::IsInstanceIndexDirty(DirtyBits, Id) &&
+        !pxr::HdChangeTracker::IsTransformDirty(DirtyBits, Id))
+        return;
+
+    const pxr::SdfPath& InstancerId = GetInstancerId();
+    if (InstancerId.IsEmpty())
+    {
+        // Release the instance data if the mesh was instanced before
+        if (!m_InstanceData.Transforms.empty() || m_InstanceData.FirstInstance != ~0u)
+            m_StagingInstanceData = std::make_unique<StagingInstanceData>();
+        return;
+    }
+
+    m_StagingInstanceData = std::make_unique<StagingInstanceData>();
+
+    HnInstancer* Instancer = static_cast<HnInstancer*>(SceneDelegate.GetRenderIndex().GetInstancer(InstancerId));
+    if (Instancer == nullptr)
+    {
+        LOG_WARNING_MESSAGE("Unable to find instancer ", InstancerId, " of rprim ", Id, ".");
+        return;
+    }
+
+    const pxr::VtMatrix4dArray InstanceTransforms = Instancer->ComputeInstanceTransforms(Id);
+    const pxr::GfMatrix4d      MeshTransform      = SceneDelegate.GetTransform(Id);
+
+    std::vector<float4x4>& Transforms = m_StagingInstanceData->Transforms;
+    Transforms.resize(InstanceTransforms.size());
+    for (size_t i = 0; i < InstanceTransforms.size(); ++i)
+    {
+        // Compose the transforms in double precision to avoid precision loss for large scenes
+        Transforms[i] = ToFloat4x4(MeshTransform * InstanceTransforms[i]);
+    }
+}
+
+void HnMesh::UpdateInstanceTransformsBuffer(HnRenderDelegate& RenderDelegate)
+{
+    if (m_StagingInstanceData)
+    {
+        std::vector<float4x4>& Transforms = m_StagingInstanceData->Transforms;
+
+        // Previous transforms are only meaningful if the number of instances has not changed
+        if (Transforms.size() == m_InstanceData.Transforms.size())
+            m_InstanceData.PrevTransforms = std::move(m_InstanceData.Transforms);
+        else
+            m_InstanceData.PrevTransforms = Transforms;
+        m_InstanceData.Transforms          = std::move(Transforms);
+        m_InstanceData.PrevTransformsDirty = true;
+        m_StagingInstanceData.reset();
+        // Previous transforms must be updated in the next frame
+        RenderDelegate.MarkMeshDirty(*this);
+
+        const Uint32 NumInstances = GetNumInstances();
+        if (NumInstances > m_InstanceData.Capacity || NumInstances == 0)
+        {
+            FreeInstances(RenderDelegate);
+            if (NumInstances > 0)
+            {
+                m_InstanceData.FirstInstance = RenderDelegate.AllocateInstances(NumInstances);
+                if (m_InstanceData.FirstInstance != ~0u)
+                {
+                    m_InstanceData.Capacity = NumInstances;
+                }
+                else if (RenderDelegate.GetUSDRenderer()->GetInstanceTransformsBuffer() != nullptr)
+                {
+                    LOG_WARNING_MESSAGE("Failed to allocate ", NumInstances, " instances for rprim ", GetId(),
+                                        ". Increase MaxInstanceCount. The instances will be rendered with separate draw calls.");
+                }
+            }
+        }
+    }
+    else if (m_InstanceData.PrevTransformsDirty)
+    {
+        m_InstanceData.PrevTransforms      = m_InstanceData.Transforms;
+        m_InstanceData.PrevTransformsDirty = false;
+    }
+    else
+    {
+        return;
+    }
+
+    if (m_InstanceData.FirstInstance == ~0u)
+        return;
+
+    const std::shared_ptr<USD_Renderer>& USDRenderer = RenderDelegate.GetUSDRenderer();
+
+    IBuffer*        pInstanceTransforms = USDRenderer->GetInstanceTransformsBuffer();
+    IDeviceContext* pCtx                = RenderDelegate.GetDeviceContext();
+    VERIFY_EXPR(pInstanceTransforms != nullptr);
+
+    // The buffer contains current transforms followed by previous-frame transforms
+    const Uint64 MaxInstanceCount = USDRenderer->GetSettings().MaxInstanceCount;
+    const Uint64 DataSize         = sizeof(float4x4) * m_InstanceData.Transforms.size();
+    pCtx->UpdateBuffer(pInstanceTransforms, sizeof(float4x4) * m_InstanceData.FirstInstance,
+                       DataSize, m_InstanceData.Transforms.data(), RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
+    pCtx->UpdateBuffer(pInstanceTransforms, sizeof(float4x4) * (MaxInstanceCount + m_InstanceData.FirstInstance),
+                       DataSize, m_InstanceData.PrevTransforms.data(), RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
+}
+
+void HnMesh::FreeInstances(HnRenderDelegate& RenderDelegate)
+{
+    if (m_InstanceData.FirstInstance != ~0u)
+    {
+        RenderDelegate.FreeInstances(m_InstanceData.FirstInstance, m_InstanceData.Capacity);
+    }
+    m_InstanceData.FirstInstance = ~0u;
+    m_InstanceData.Capacity      = 0;
+}
+
+void HnMesh::RequestTextures(HnTextureRegistry& TexRegistry, float ScreenArea)
+{
+    auto RequestMaterialTextures = [&](const HnDrawItem& DrawItem) {
+        if (const HnMaterial* pMaterial = DrawItem.GetMaterial())
+            pMaterial->RequestTextures(TexRegistry, ScreenArea);
+    };
+
+    ProcessDrawItems(
+        [&](HnDrawItem& DrawItem) {
+            RequestMaterialTextures(DrawItem);
+        },
+        [&](const pxr::HdGeomSubset& Subset, HnDrawItem& DrawItem) {
+            RequestMaterialTextures(DrawItem);
+        });
+}
+
 void HnMesh::UpdateDrawItemsForGeometrySubsets(pxr::HdSceneDelegate& SceneDelegate,
                                                pxr::HdRenderParam*   RenderParam)
 {
@@ -366,13 +534,20 @@ void HnMesh::UpdateTopology(pxr::HdSceneDelegate& SceneDelegate,
 
     m_StagingIndexData = std::make_unique<StagingIndexData>();
 
+    ComputeTriangleIndices(m_Topology, Id, m_StagingIndexData->TrianglesFaceIndices);
+
     pxr::HdMeshUtil MeshUtil{&m_Topology, Id};
-    pxr::VtIntArray PrimitiveParams;
-    MeshUtil.ComputeTriangleIndices(&m_StagingIndexData->TrianglesFaceIndices, &PrimitiveParams, nullptr);
     MeshUtil.EnumerateEdges(&m_StagingIndexData->MeshEdgeIndices);
     m_IndexData.NumFaceTriangles = static_cast<Uint32>(m_StagingIndexData->TrianglesFaceIndices.size());
     m_IndexData.NumEdges         = static_cast<Uint32>(m_StagingIndexData->MeshEdgeIndices.size());
 
+    // The LODs of the previous topology are no longer valid. A task that is still running
+    // keeps its own reference to the pending chain, so its result is simply discarded.
+    // The space for the new LODs is reserved by UpdateRepr() if the points are available.
+    m_IndexData.LODs.clear();
+    m_IndexData.NumLODIndices = 0;
+    m_LODData                 = {};
+
     DirtyBits &= ~pxr::HdChangeTracker::DirtyTopology;
 }
 
@@ -580,56 +755,22 @@ void HnMesh::UpdateConstantPrimvars(pxr::HdSceneDelegate& SceneDelegate,
     }
 }
 
-void HnMesh::GenerateSmoothNormals()
-{
-    pxr::Hd_VertexAdjacency Adjacency;
-    Adjacency.BuildAdjacencyTable(&m_Topology);
-    if (Adjacency.GetNumPoints() == 0)
-    {
-        LOG_WARNING_MESSAGE("Skipping smooth normal generation for ", GetId(), " because its adjacency information is empty.");
-        return;
-    }
-
-    auto points_it = m_StagingVertexData->Sources.find(pxr::HdTokens->points);
-    if (points_it == m_StagingVertexData->Sources.end())
-    {
-        LOG_ERROR_MESSAGE("Skipping smooth normal generation for ", GetId(), " because its points data is missing.");
-        return;
-    }
-
-    const pxr::HdBufferSource& PointsSource = *points_it->second;
-    if (PointsSource.GetTupleType().type != pxr::HdTypeFloatVec3)
-    {
-        LOG_ERROR_MESSAGE("Skipping smooth normal generation for ", GetId(), " because its points data is not float3.");
-        return;
-    }
-
-    pxr::VtVec3fArray Normals = pxr::Hd_SmoothNormals::ComputeSmoothNormals(&Adjacency, static_cast<int>(PointsSource.GetNumElements()), static_cast<const pxr::GfVec3f*>(PointsSource.GetData()));
-    if (Normals.size() != PointsSource.GetNumElements())
-    {
-        LOG_ERROR_MESSAGE("Failed to generate smooth normals for ", GetId(), ". Expected ", PointsSource.GetNumElements(), " normals, got ", Normals.size(), ".");
-        return;
-    }
-
-    if (auto BufferSource = CreateBufferSource(pxr::HdTokens->normals, pxr::VtValue{Normals}, PointsSource.GetNumElements(), GetId()))
-    {
-        m_StagingVertexData->Sources.emplace(pxr::HdTokens->normals, std::move(BufferSource));
-    }
-}
-
 namespace
 {
 
-class TriangulatedFaceBufferSource final : public pxr::HdBufferSource
+// Buffer source that keeps its data in the staging allocator memory.
+// The data remains valid until the mesh commits its GPU resources.
+class StagingBufferSource final : public pxr::HdBufferSource
 {
 public:
-    TriangulatedFaceBufferSource(const pxr::TfToken& Name,
-                                 pxr::HdTupleType    TupleType,
-                                 size_t              NumElements) :
+    StagingBufferSource(const pxr::TfToken& Name,
+                        pxr::HdTupleType    TupleType,
+                        size_t              NumElements,
+                        HnStagingAllocator& Allocator) :
         m_Name{Name},
         m_TupleType{TupleType},
         m_NumElements{NumElements},
-        m_Data(HdDataSizeOfType(TupleType.type) * NumElements)
+        m_pData{static_cast<Uint8*>(Allocator.Allocate(HdDataSizeOfType(TupleType.type) * NumElements, 16))}
     {
     }
 
@@ -640,7 +781,7 @@ public:
 
     virtual void const* GetData() const override
     {
-        return m_Data.data();
+        return m_pData;
     }
 
     virtual size_t ComputeHash() const override
@@ -671,32 +812,95 @@ public:
 
     virtual bool _CheckValid() const override final
     {
-        return !m_Data.empty();
+        return m_pData != nullptr;
     }
 
-    std::vector<Uint8>& GetData()
+    Uint8* GetData()
     {
-        return m_Data;
+        return m_pData;
     }
 
 private:
-    pxr::TfToken       m_Name;
-    pxr::HdTupleType   m_TupleType;
-    size_t             m_NumElements;
-    std::vector<Uint8> m_Data;
+    pxr::TfToken     m_Name;
+    pxr::HdTupleType m_TupleType;
+    size_t           m_NumElements;
+    Uint8*           m_pData;
 };
 
 } // namespace
 
-void HnMesh::ConvertVertexPrimvarSources(FaceSourcesMapType&& FaceSources)
+void HnMesh::GenerateSmoothNormals(HnStagingAllocator& Allocator)
+{
+    if (m_Topology.GetFaceVertexCounts().empty())
+    {
+        LOG_WARNING_MESSAGE("Skipping smooth normal generation for ", GetId(), " because its topology is empty.");
+        return;
+    }
+
+    auto points_it = m_StagingVertexData->Sources.find(pxr::HdTokens->points);
+    if (points_it == m_StagingVertexData->Sources.end())
+    {
+        LOG_ERROR_MESSAGE("Skipping smooth normal generation for ", GetId(), " because its points data is missing.");
+        return;
+    }
+
+    const pxr::HdBufferSource& PointsSource = *points_it->second;
+    if (PointsSource.GetTupleType().type != pxr::HdTypeFloatVec3)
+    {
+        LOG_ERROR_MESSAGE("Skipping smooth normal generation for ", GetId(), " because its points data is not float3.");
+        return;
+    }
+
+    const size_t NumPoints     = PointsSource.GetNumElements();
+    auto         NormalsSource = std::make_shared<StagingBufferSource>(pxr::HdTokens->normals, pxr::HdTupleType{pxr::HdTypeFloatVec3, 1}, NumPoints, Allocator);
+    if (!NormalsSource->IsValid())
+        return;
+
+    static_assert(sizeof(pxr::GfVec3f) == sizeof(float) * 3, "Unexpected GfVec3f size");
+    if (!ComputeSmoothNormals(m_Topology, static_cast<const float*>(PointsSource.GetData()), NumPoints, reinterpret_cast<float*>(NormalsSource->GetData())))
+    {
+        LOG_ERROR_MESSAGE("Failed to generate smooth normals for ", GetId(), " because its topology is invalid.");
+        return;
+    }
+
+    m_StagingVertexData->Sources.emplace(pxr::HdTokens->normals, std::move(NormalsSource));
+}
+
+template <size_t ElementSize>
+static void UnfoldVertexData(const Uint8* pSrcData, const int* pIndices, size_t NumIndices, Uint8* pDstData)
+{
+    for (size_t i = 0; i < NumIndices; ++i)
+    {
+        std::memcpy(pDstData + i * ElementSize, pSrcData + static_cast<size_t>(pIndices[i]) * ElementSize, ElementSize);
+    }
+}
+
+// Gathers vertex data into the linear list of triangle vertices.
+static void UnfoldVertexData(const Uint8* pSrcData, size_t ElementSize, const int* pIndices, size_t NumIndices, Uint8* pDstData)
+{
+    // Copies of the common element sizes are compiled into plain loads and stores
+    switch (ElementSize)
+    {
+        case 4: UnfoldVertexData<4>(pSrcData, pIndices, NumIndices, pDstData); break;
+        case 8: UnfoldVertexData<8>(pSrcData, pIndices, NumIndices, pDstData); break;
+        case 12: UnfoldVertexData<12>(pSrcData, pIndices, NumIndices, pDstData); break;
+        case 16: UnfoldVertexData<16>(pSrcData, pIndices, NumIndices, pDstData); break;
+
+        default:
+            for (size_t i = 0; i < NumIndices; ++i)
+            {
+                std::memcpy(pDstData + i * ElementSize, pSrcData + static_cast<size_t>(pIndices[i]) * ElementSize, ElementSize);
+            }
+    }
+}
+
+void HnMesh::ConvertVertexPrimvarSources(FaceSourcesMapType&& FaceSources, HnStagingAllocator& Allocator)
 {
     pxr::VtVec3iArray TrianglesFaceIndices;
     if (!m_StagingIndexData || m_StagingIndexData->TrianglesFaceIndices.empty())
     {
         // Need to regenerate triangle indices
-        pxr::HdMeshUtil MeshUtil{&m_Topology, GetId()};
-        pxr::VtIntArray PrimitiveParams;
-        MeshUtil.ComputeTriangleIndices(&TrianglesFaceIndices, &PrimitiveParams, nullptr);
+        ComputeTriangleIndices(m_Topology, GetId(), TrianglesFaceIndices);
         if (TrianglesFaceIndices.empty())
             return;
     }
@@ -705,6 +909,10 @@ void HnMesh::ConvertVertexPrimvarSources(FaceSourcesMapType&& FaceSources)
            "The number of indices is not consistent with the previously computed value. "
            "This may indicate that the topology was not updated during the last sync.");
 
+    static_assert(sizeof(pxr::GfVec3i) == sizeof(int) * 3, "Unexpected GfVec3i size");
+    const int*   pIndices   = Indices.cdata()->data();
+    const size_t NumIndices = Indices.size() * 3;
+
     // Unpack vertex sources by unfolding triangle indices into linear list of vertices
     for (auto& source_it : m_StagingVertexData->Sources)
     {
@@ -713,23 +921,14 @@ void HnMesh::ConvertVertexPrimvarSources(FaceSourcesMapType&& FaceSources)
             continue;
 
         const auto*       pSrcData    = static_cast<const Uint8*>(pSource->GetData());
-        const size_t      NumElements = pSource->GetNumElements();
         const pxr::HdType ElementType = pSource->GetTupleType().type;
         const size_t      ElementSize = HdDataSizeOfType(ElementType);
 
-        auto  FaceSource = std::make_shared<TriangulatedFaceBufferSource>(pSource->GetName(), pSource->GetTupleType(), Indices.size() * 3);
-        auto& FaceData   = FaceSource->GetData();
-        VERIFY_EXPR(FaceData.size() == Indices.size() * 3 * ElementSize);
-        auto* pDstData = FaceData.data();
-        for (size_t i = 0; i < Indices.size(); ++i)
-        {
-            const pxr::GfVec3i& Tri = Indices[i];
-            for (size_t v = 0; v < 3; ++v)
-            {
-                const auto* pSrc = pSrcData + Tri[v] * ElementSize;
-                memcpy(pDstData + (i * 3 + v) * ElementSize, pSrc, ElementSize);
-            }
-        }
+        auto FaceSource = std::make_shared<StagingBufferSource>(pSource->GetName(), pSource->GetTupleType(), NumIndices, Allocator);
+        if (!FaceSource->IsValid())
+            continue;
+
+        UnfoldVertexData(pSrcData, ElementSize, pIndices, NumIndices, FaceSource->GetData());
         // Replace original vertex source with the triangulated face source
         pSource = std::move(FaceSource);
     }
@@ -750,13 +949,20 @@ void HnMesh::ConvertVertexPrimvarSources(FaceSourcesMapType&& FaceSources)
     //  Indices:  3 4 5 0 1 2
     //  Unfolded: D E F A B C
     //  Mapping:  0->3, 1->4, 2->5, 3->0, 4->1, 5->2
-    std::unordered_map<size_t, size_t> ReverseVertexMapping;
-    for (size_t i = 0; i < Indices.size(); ++i)
+    //
+    // Vertices that are not referenced by any triangle are mapped to ~0u.
+    const size_t NumPoints            = GetNumPoints();
+    Uint32*      ReverseVertexMapping = Allocator.Allocate<Uint32>(NumPoints);
+    std::fill_n(ReverseVertexMapping, NumPoints, ~0u);
+    for (size_t i = 0; i < NumIndices; ++i)
     {
-        const pxr::GfVec3i& Tri = Indices[i];
-        for (size_t v = 0; v < 3; ++v)
-            ReverseVertexMapping.emplace(Tri[v], i * 3 + v);
+        const size_t v = static_cast<size_t>(pIndices[i]);
+        if (v < NumPoints && ReverseVertexMapping[v] == ~0u)
+            ReverseVertexMapping[v] = static_cast<Uint32>(i);
     }
+    auto MapVertex = [&](int v) {
+        return static_cast<size_t>(v) < NumPoints ? ReverseVertexMapping[v] : ~0u;
+    };
 
     // Replace original triangle indices with the list of unfolded face indices
     m_StagingIndexData->TrianglesFaceIndices.resize(GetNumFaceTriangles());
@@ -771,12 +977,12 @@ void HnMesh::ConvertVertexPrimvarSources(FaceSourcesMapType&& FaceSources)
     // Update edge indices
     for (pxr::GfVec2i& Edge : m_StagingIndexData->MeshEdgeIndices)
     {
-        auto v0_it = ReverseVertexMapping.find(Edge[0]);
-        auto v1_it = ReverseVertexMapping.find(Edge[1]);
-        if (v0_it != ReverseVertexMapping.end() && v1_it != ReverseVertexMapping.end())
+        const Uint32 v0 = MapVertex(Edge[0]);
+        const Uint32 v1 = MapVertex(Edge[1]);
+        if (v0 != ~0u && v1 != ~0u)
         {
-            Edge[0] = static_cast<int>(v0_it->second);
-            Edge[1] = static_cast<int>(v1_it->second);
+            Edge[0] = static_cast<int>(v0);
+            Edge[1] = static_cast<int>(v1);
         }
         else
         {
@@ -786,11 +992,11 @@ void HnMesh::ConvertVertexPrimvarSources(FaceSourcesMapType&& FaceSources)
     }
 
     // Create point indices
-    m_StagingIndexData->PointIndices.resize(GetNumPoints());
-    for (size_t i = 0; i < m_StagingIndexData->PointIndices.size(); ++i)
+    m_StagingIndexData->PointIndices.resize(NumPoints);
+    for (size_t i = 0; i < NumPoints; ++i)
     {
-        auto v_it                           = ReverseVertexMapping.find(i);
-        m_StagingIndexData->PointIndices[i] = v_it != ReverseVertexMapping.end() ? static_cast<Uint32>(v_it->second) : 0;
+        const Uint32 v                      = ReverseVertexMapping[i];
+        m_StagingIndexData->PointIndices[i] = v != ~0u ? v : 0;
     }
 }
 
@@ -891,7 +1097,8 @@ void HnMesh::AllocatePooledResources(pxr::HdSceneDelegate& SceneDelegate,
     {
         if (!m_StagingIndexData->TrianglesFaceIndices.empty())
         {
-            m_IndexData.FaceAllocation = ResMgr.AllocateIndices(sizeof(Uint32) * GetNumFaceTriangles() * 3);
+            // The face allocation includes the space reserved for the LODs
+            m_IndexData.FaceAllocation = ResMgr.AllocateIndices(sizeof(Uint32) * (GetNumFaceTriangles() * 3 + m_IndexData.NumLODIndices));
             m_IndexData.FaceStartIndex = m_IndexData.FaceAllocation->GetOffset() / sizeof(Uint32);
         }
 
@@ -975,30 +1182,40 @@ void HnMesh::UpdateIndexBuffer(HnRenderDelegate& RenderDelegate)
 {
     VERIFY_EXPR(m_StagingIndexData);
 
+    // BufferSize may be greater than DataSize if the space after the data is reserved
+    // for the data that is written later (e.g. face LODs).
     auto PrepareIndexBuffer = [&](const char*           BufferName,
                                   const void*           pData,
                                   size_t                DataSize,
+                                  size_t                BufferSize,
                                   IBufferSuballocation* pSuballocation) {
         const std::string Name = GetId().GetString() + " - " + BufferName;
 
+        IDeviceContext* pCtx = RenderDelegate.GetDeviceContext();
         if (pSuballocation == nullptr)
         {
             BufferDesc Desc{
                 Name.c_str(),
-                DataSize,
+                BufferSize,
                 BIND_INDEX_BUFFER,
-                USAGE_IMMUTABLE,
+                BufferSize > DataSize ? USAGE_DEFAULT : USAGE_IMMUTABLE,
             };
-            BufferData InitData{pData, Desc.Size};
 
             const RenderDeviceX_N& Device{RenderDelegate.GetDevice()};
-            return Device.CreateBuffer(Desc, &InitData);
+            if (Desc.Usage == USAGE_IMMUTABLE)
+            {
+                BufferData InitData{pData, Desc.Size};
+                return Device.CreateBuffer(Desc, &InitData);
+            }
+
+            RefCntAutoPtr<IBuffer> pBuffer = Device.CreateBuffer(Desc);
+            pCtx->UpdateBuffer(pBuffer, 0, DataSize, pData, RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
+            return pBuffer;
         }
         else
         {
             RefCntAutoPtr<IBuffer> pBuffer{pSuballocation->GetBuffer()};
-            IDeviceContext*        pCtx = RenderDelegate.GetDeviceContext();
-            VERIFY_EXPR(pSuballocation->GetSize() == DataSize);
+            VERIFY_EXPR(pSuballocation->GetSize() == BufferSize);
             pCtx->UpdateBuffer(pBuffer, pSuballocation->GetOffset(), DataSize, pData, RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
             return pBuffer;
         }
@@ -1011,7 +1228,12 @@ void HnMesh::UpdateIndexBuffer(HnRenderDelegate& RenderDelegate)
         m_IndexData.Faces = PrepareIndexBuffer("Triangle Index Buffer",
                                                m_StagingIndexData->TrianglesFaceIndices.data(),
                                                GetNumFaceTriangles() * sizeof(Uint32) * 3,
+                                               (GetNumFaceTriangles() * 3 + m_IndexData.NumLODIndices) * sizeof(Uint32),
                                                m_IndexData.FaceAllocation);
+
+        // Must be called before the staging vertex data is released by UpdateVertexBuffers()
+        if (m_IndexData.NumLODIndices > 0)
+            GenerateLODs(RenderDelegate);
     }
 
     if (!m_StagingIndexData->MeshEdgeIndices.empty())
@@ -1020,6 +1242,7 @@ void HnMesh::UpdateIndexBuffer(HnRenderDelegate& RenderDelegate)
         m_IndexData.Edges = PrepareIndexBuffer("Edge Index Buffer",
                                                m_StagingIndexData->MeshEdgeIndices.data(),
                                                GetNumEdges() * sizeof(Uint32) * 2,
+                                               GetNumEdges() * sizeof(Uint32) * 2,
                                                m_IndexData.EdgeAllocation);
     }
 
@@ -1029,12 +1252,152 @@ void HnMesh::UpdateIndexBuffer(HnRenderDelegate& RenderDelegate)
         m_IndexData.Points = PrepareIndexBuffer("Points Index Buffer",
                                                 m_StagingIndexData->PointIndices.data(),
                                                 GetNumPoints() * sizeof(Uint32),
+                                                GetNumPoints() * sizeof(Uint32),
                                                 m_IndexData.PointsAllocation);
     }
 
     m_StagingIndexData.reset();
 }
 
+const pxr::HdBufferSource* HnMesh::GetLODSourcePoints(const HnRenderDelegate& RenderDelegate) const
+{
+    if (!RenderDelegate.GetMeshLODCache() || GetNumFaceTriangles() / 2 < RenderDelegate.GetMinMeshLODTriangles())
+        return nullptr;
+
+    if (!m_StagingIndexData || !m_StagingVertexData)
+        return nullptr;
+
+    auto points_it = m_StagingVertexData->Sources.find(pxr::HdTokens->points);
+    if (points_it == m_StagingVertexData->Sources.end() || !points_it->second)
+        return nullptr;
+
+    const pxr::HdBufferSource* pPoints = points_it->second.get();
+    return pPoints->GetTupleType().type == pxr::HdTypeFloatVec3 ? pPoints : nullptr;
+}
+
+void HnMesh::GenerateLODs(HnRenderDelegate& RenderDelegate)
+{
+    VERIFY_EXPR(m_StagingIndexData);
+
+    // The space is only reserved when the points are available (see UpdateRepr())
+    const pxr::HdBufferSource* pPointsSource = GetLODSourcePoints(RenderDelegate);
+    if (pPointsSource == nullptr)
+    {
+        UNEXPECTED("The space for the LODs is reserved, but the LODs can't be generated");
+        return;
+    }
+
+    const std::shared_ptr<HnMeshLODCache>& pCache = RenderDelegate.GetMeshLODCache();
+    const pxr::HdBufferSource&             Points = *pPointsSource;
+
+    // Face indices are offset by the start vertex of the vertex pool allocation (see AllocatePooledResources()).
+    const Uint32 BaseVertex = m_VertexData.PoolAllocation ? m_VertexData.PoolAllocation->GetStartVertex() : 0;
+
+    const float3* pPoints = static_cast<const float3*>(Points.GetData());
+    std::vector<float3> Positions{pPoints, pPoints + Points.GetNumElements()};
+
+    const Uint32*       pFaceIndices = reinterpret_cast<const Uint32*>(m_StagingIndexData->TrianglesFaceIndices.data());
+    std::vector<Uint32> Indices(GetNumFaceTriangles() * 3);
+    for (size_t i = 0; i < Indices.size(); ++i)
+        Indices[i] = pFaceIndices[i] - BaseVertex;
+
+    HnMeshLODSettings Settings;
+    Settings.MinTriangles = RenderDelegate.GetMinMeshLODTriangles();
+
+    m_LODData.NumVertices   = static_cast<Uint32>(Positions.size());
+    m_LODData.pPendingChain = std::make_shared<std::shared_ptr<const HnMeshLODChain>>();
+
+    auto Generate = [pCache, pPendingChain = m_LODData.pPendingChain, Positions = std::move(Positions), Indices = std::move(Indices), Settings](Uint32 /*ThreadId*/) {
+        const Uint32 NumVertices = static_cast<Uint32>(Positions.size());
+        const Uint32 NumIndices  = static_cast<Uint32>(Indices.size());
+
+        const size_t Key = HnMeshLODCache::ComputeKey(Positions.data(), NumVertices, Indices.data(), NumIndices, Settings);
+
+        std::shared_ptr<const HnMeshLODChain> Chain = pCache->Find(Key, NumVertices, NumIndices);
+        if (!Chain)
+        {
+            Chain = std::make_shared<const HnMeshLODChain>(GenerateMeshLODs(Positions.data(), NumVertices, Indices.data(), NumIndices, Settings));
+            pCache->Add(Key, Chain);
+        }
+        *pPendingChain = std::move(Chain);
+
+        return ASYNC_TASK_STATUS_COMPLETE;
+    };
+
+    if (IThreadPool* pThreadPool = RenderDelegate.GetResourceCommitThreadPool())
+    {
+        m_LODData.Task = EnqueueAsyncWork(pThreadPool, std::move(Generate));
+    }
+    else
+    {
+        Generate(0);
+    }
+}
+
+void HnMesh::UpdateLODs(HnRenderDelegate& RenderDelegate)
+{
+    if (!m_LODData.pPendingChain)
+        return;
+
+    if (m_LODData.Task && !m_LODData.Task->IsFinished())
+    {
+        // Check the task again in the next commit
+        RenderDelegate.MarkMeshDirty(*this);
+        return;
+    }
+    m_LODData.Task.Release();
+
+    std::shared_ptr<const HnMeshLODChain> Chain = std::move(*m_LODData.pPendingChain);
+    m_LODData.pPendingChain.reset();
+    if (!Chain || Chain->LODs.empty())
+        return;
+
+    IBuffer* pIndexBuffer = GetFaceIndexBuffer();
+    if (pIndexBuffer == nullptr)
+        return;
+
+    if (Chain->GetNumIndices() > m_IndexData.NumLODIndices)
+    {
+        UNEXPECTED("The LOD chain has ", Chain->GetNumIndices(), " indices, while only ", m_IndexData.NumLODIndices, " indices are reserved");
+        return;
+    }
+
+    if (Chain->NumSourceVertices != m_LODData.NumVertices)
+    {
+        UNEXPECTED("The LOD chain was generated for ", Chain->NumSourceVertices, " vertices, while the mesh has ", m_LODData.NumVertices, " vertices");
+        return;
+    }
+    for (const HnMeshLOD& LOD : Chain->LODs)
+    {
+        for (Uint32 Idx : LOD.Indices)
+        {
+            if (Idx >= m_LODData.NumVertices)
+            {
+                UNEXPECTED("LOD index ", Idx, " is out of range [0, ", m_LODData.NumVertices, ")");
+                return;
+            }
+        }
+    }
+
+    const Uint32 BaseVertex    = m_VertexData.PoolAllocation ? m_VertexData.PoolAllocation->GetStartVertex() : 0;
+    const Uint32 LODStartIndex = GetFaceStartIndex() + GetNumFaceTriangles() * 3;
+
+    std::vector<Uint32> Indices;
+    Indices.reserve(Chain->GetNumIndices());
+    m_IndexData.LODs.clear();
+    for (const HnMeshLOD& LOD : Chain->LODs)
+    {
+        m_IndexData.LODs.push_back({LODStartIndex + static_cast<Uint32>(Indices.size()), static_cast<Uint32>(LOD.Indices.size()), LOD.Error});
+        for (Uint32 Idx : LOD.Indices)
+            Indices.push_back(Idx + BaseVertex);
+    }
+
+    IDeviceContext* pCtx = RenderDelegate.GetDeviceContext();
+    pCtx->UpdateBuffer(pIndexBuffer, LODStartIndex * sizeof(Uint32), Indices.size() * sizeof(Uint32), Indices.data(), RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
+
+    m_LODData.Chain = std::move(Chain);
+}
+
 void HnMesh::UpdateDrawItemGpuGeometry(HnRenderDelegate& RenderDelegate)
 {
     for (auto& it : _reprs)
@@ -1128,6 +1491,10 @@ void HnMesh::CommitGPUResources(HnRenderDelegate& RenderDelegate)
         UpdateVertexBuffers(RenderDelegate);
         UpdateDrawItemGpuGeometry(RenderDelegate);
     }
+
+    UpdateLODs(RenderDelegate);
+
+    UpdateInstanceTransformsBuffer(RenderDelegate);
 }
 
 IBuffer* HnMesh::GetVertexBuffer(const pxr::TfToken& Name) const
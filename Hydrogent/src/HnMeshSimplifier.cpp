@@ -0,0 +1,604 @@
+/*
+ *  Copyright 2024 Diligent Graphics LLC
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+
+#include "HnMeshSimplifier.hpp"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <functional>
+#include <numeric>
+#include <queue>
+
+#include "DebugUtilities.hpp"
+#include "HashUtils.hpp"
+
+namespace Diligent
+{
+
+namespace USD
+{
+
+namespace
+{
+
+// Quadric Q(p) = p^T A p + 2 b^T p + c that accumulates the squared distances to the planes
+// of the adjacent triangles weighted by the triangle areas, and the total weight of the planes.
+struct Quadric
+{
+    double a00 = 0, a01 = 0, a02 = 0, a11 = 0, a12 = 0, a22 = 0;
+    double b0 = 0, b1 = 0, b2 = 0;
+    double c = 0;
+    double w = 0;
+
+    static Quadric FromPlane(double nx, double ny, double nz, double d, double Weight)
+    {
+        Quadric Q;
+        Q.a00 = nx * nx * Weight;
+        Q.a01 = nx * ny * Weight;
+        Q.a02 = nx * nz * Weight;
+        Q.a11 = ny * ny * Weight;
+        Q.a12 = ny * nz * Weight;
+        Q.a22 = nz * nz * Weight;
+        Q.b0  = nx * d * Weight;
+        Q.b1  = ny * d * Weight;
+        Q.b2  = nz * d * Weight;
+        Q.c   = d * d * Weight;
+        Q.w   = Weight;
+        return Q;
+    }
+
+    Quadric& operator+=(const Quadric& rhs)
+    {
+        a00 += rhs.a00;
+        a01 += rhs.a01;
+        a02 += rhs.a02;
+        a11 += rhs.a11;
+        a12 += rhs.a12;
+        a22 += rhs.a22;
+        b0 += rhs.b0;
+        b1 += rhs.b1;
+        b2 += rhs.b2;
+        c += rhs.c;
+        w += rhs.w;
+        return *this;
+    }
+
+    // Returns the weighted mean squared distance from the point to the planes.
+    double GetError(const float3& p) const
+    {
+        if (w <= 0)
+            return 0;
+
+        const double x = p.x;
+        const double y = p.y;
+        const double z = p.z;
+
+        const double E = (a00 * x * x + a11 * y * y + a22 * z * z +
+                          2 * (a01 * x * y + a02 * x * z + a12 * y * z) +
+                          2 * (b0 * x + b1 * y + b2 * z) +
+                          c);
+        return std::max(E / w, 0.0);
+    }
+};
+
+struct EdgeCollapse
+{
+    // Squared error of the collapse
+    float  Error = 0;
+    Uint32 From  = 0;
+    Uint32 To    = 0;
+
+    // Vertex versions at the time the collapse was evaluated. The collapse is
+    // discarded if any of the vertices has changed since then.
+    Uint32 FromVersion = 0;
+    Uint32 ToVersion   = 0;
+
+    bool operator>(const EdgeCollapse& rhs) const { return Error > rhs.Error; }
+};
+
+class MeshSimplifier
+{
+public:
+    MeshSimplifier(const float3* pPositions,
+                   Uint32        NumVertices,
+                   const Uint32* pIndices,
+                   Uint32        NumIndices);
+
+    // Collapses edges until the number of triangles does not exceed the target.
+    // Returns false if the mesh can't be simplified to the target.
+    bool Simplify(Uint32 TargetTriangles);
+
+    Uint32 GetNumTriangles() const { return m_NumTriangles; }
+
+    // Returns the largest error of all collapses performed so far.
+    float GetError() const { return std::sqrt(m_MaxError); }
+
+    void GetIndices(std::vector<Uint32>& Indices) const;
+
+private:
+    void WeldVertices(const float3* pPositions, Uint32 NumVertices);
+    // Builds the adjacency, locks the boundary vertices and returns the unique edges.
+    void InitTopology(std::vector<Uint64>& Edges);
+    void InitQuadrics();
+
+    // Adds the collapse of the edge into one of its vertices to the queue.
+    void AddCollapse(Uint32 v0, Uint32 v1);
+    bool Collapse(Uint32 From, Uint32 To);
+
+    int FindCorner(Uint32 Tri, Uint32 Vertex) const
+    {
+        for (int c = 0; c < 3; ++c)
+        {
+            if (m_Corners[Tri * 3 + c] == Vertex)
+                return c;
+        }
+        return -1;
+    }
+
+private:
+    // Positions of the welded vertices
+    std::vector<float3> m_Positions;
+    // Source vertex to welded vertex
+    std::vector<Uint32> m_WeldedVertex;
+
+    // Welded vertices of the triangle corners
+    std::vector<Uint32> m_Corners;
+    // Source vertices of the triangle corners that are written to the output
+    std::vector<Uint32> m_SourceCorners;
+    std::vector<bool>   m_TriAlive;
+    Uint32              m_NumTriangles = 0;
+
+    // Live triangles adjacent to each welded vertex
+    std::vector<std::vector<Uint32>> m_VertexTris;
+
+    std::vector<Quadric> m_Quadrics;
+    std::vector<Uint32>  m_Versions;
+    std::vector<bool>    m_Removed;
+    std::vector<bool>    m_Locked;
+
+    std::priority_queue<EdgeCollapse, std::vector<EdgeCollapse>, std::greater<EdgeCollapse>> m_Collapses;
+
+    double m_MaxError = 0;
+
+    // Marks of the vertices visited by the current collapse
+    std::vector<Uint32> m_Marks;
+    Uint32              m_Mark = 0;
+};
+
+MeshSimplifier::MeshSimplifier(const float3* pPositions,
+                               Uint32        NumVertices,
+                               const Uint32* pIndices,
+                               Uint32        NumIndices) :
+    m_SourceCorners{pIndices, pIndices + NumIndices / 3 * 3}
+{
+    WeldVertices(pPositions, NumVertices);
+
+    std::vector<Uint64> Edges;
+    InitTopology(Edges);
+    InitQuadrics();
+
+    for (Uint64 Edge : Edges)
+    {
+        const Uint32 v0 = static_cast<Uint32>(Edge >> 32u);
+        const Uint32 v1 = static_cast<Uint32>(Edge & 0xFFFFFFFFu);
+        AddCollapse(v0, v1);
+    }
+}
+
+void MeshSimplifier::WeldVertices(const float3* pPositions, Uint32 NumVertices)
+{
+    std::vector<Uint32> Order(NumVertices);
+    std::iota(Order.begin(), Order.end(), 0u);
+    std::sort(Order.begin(), Order.end(),
+              [pPositions](Uint32 v0, Uint32 v1) {
+                  const float3& p0 = pPositions[v0];
+                  const float3& p1 = pPositions[v1];
+                  if (p0.x != p1.x)
+                      return p0.x < p1.x;
+                  if (p0.y != p1.y)
+                      return p0.y < p1.y;
+                  return p0.z < p1.z;
+              });
+
+    m_WeldedVertex.resize(NumVertices);
+    m_Positions.reserve(NumVertices);
+    for (size_t i = 0; i < Order.size(); ++i)
+    {
+        const float3& Pos = pPositions[Order[i]];
+        if (i == 0 || Pos != m_Positions.back())
+            m_Positions.push_back(Pos);
+        m_WeldedVertex[Order[i]] = static_cast<Uint32>(m_Positions.size() - 1);
+    }
+}
+
+void MeshSimplifier::InitTopology(std::vector<Uint64>& Edges)
+{
+    const Uint32 NumWelded = static_cast<Uint32>(m_Positions.size());
+    const Uint32 NumTris   = static_cast<Uint32>(m_SourceCorners.size() / 3);
+
+    m_Corners.resize(m_SourceCorners.size());
+    m_TriAlive.resize(NumTris);
+    for (Uint32 t = 0; t < NumTris; ++t)
+    {
+        const Uint32 v0 = m_WeldedVertex[m_SourceCorners[t * 3 + 0]];
+        const Uint32 v1 = m_WeldedVertex[m_SourceCorners[t * 3 + 1]];
+        const Uint32 v2 = m_WeldedVertex[m_SourceCorners[t * 3 + 2]];
+
+        m_Corners[t * 3 + 0] = v0;
+        m_Corners[t * 3 + 1] = v1;
+        m_Corners[t * 3 + 2] = v2;
+
+        // Triangles that are degenerate after welding are dropped
+        m_TriAlive[t] = v0 != v1 && v1 != v2 && v2 != v0;
+        if (m_TriAlive[t])
+            ++m_NumTriangles;
+    }
+
+    m_VertexTris.resize(NumWelded);
+    for (Uint32 t = 0; t < NumTris; ++t)
+    {
+        if (!m_TriAlive[t])
+            continue;
+        for (int c = 0; c < 3; ++c)
+            m_VertexTris[m_Corners[t * 3 + c]].push_back(t);
+    }
+
+    m_Versions.assign(NumWelded, 0);
+    m_Removed.assign(NumWelded, false);
+    m_Locked.assign(NumWelded, false);
+    m_Marks.assign(NumWelded, 0);
+
+    // Find the edges, and lock the vertices of the boundary and non-manifold edges
+    Edges.clear();
+    Edges.reserve(size_t{m_NumTriangles} * 3);
+    for (Uint32 t = 0; t < NumTris; ++t)
+    {
+        if (!m_TriAlive[t])
+            continue;
+        for (int c = 0; c < 3; ++c)
+        {
+            const Uint32 v0 = m_Corners[t * 3 + c];
+            const Uint32 v1 = m_Corners[t * 3 + (c + 1) % 3];
+            Edges.push_back((Uint64{std::min(v0, v1)} << 32u) | Uint64{std::max(v0, v1)});
+        }
+    }
+    std::sort(Edges.begin(), Edges.end());
+
+    size_t NumUniqueEdges = 0;
+    for (size_t i = 0; i < Edges.size();)
+    {
+        size_t j = i + 1;
+        while (j < Edges.size() && Edges[j] == Edges[i])
+            ++j;
+
+        if (j - i != 2)
+        {
+            m_Locked[Edges[i] >> 32u]         = true;
+            m_Locked[Edges[i] & 0xFFFFFFFFu] = true;
+        }
+        Edges[NumUniqueEdges++] = Edges[i];
+        i                       = j;
+    }
+    Edges.resize(NumUniqueEdges);
+}
+
+void MeshSimplifier::InitQuadrics()
+{
+    m_Quadrics.assign(m_Positions.size(), Quadric{});
+    for (Uint32 t = 0; t < m_TriAlive.size(); ++t)
+    {
+        if (!m_TriAlive[t])
+            continue;
+
+        const Uint32  v0 = m_Corners[t * 3 + 0];
+        const Uint32  v1 = m_Corners[t * 3 + 1];
+        const Uint32  v2 = m_Corners[t * 3 + 2];
+        const float3& p0 = m_Positions[v0];
+
+        const float3 N   = cross(m_Positions[v1] - p0, m_Positions[v2] - p0);
+        const double Len = std::sqrt(double{N.x} * N.x + double{N.y} * N.y + double{N.z} * N.z);
+        if (Len == 0)
+            continue;
+
+        const double nx = N.x / Len;
+        const double ny = N.y / Len;
+        const double nz = N.z / Len;
+        const double d  = -(nx * p0.x + ny * p0.y + nz * p0.z);
+
+        const Quadric Q = Quadric::FromPlane(nx, ny, nz, d, Len * 0.5);
+        m_Quadrics[v0] += Q;
+        m_Quadrics[v1] += Q;
+        m_Quadrics[v2] += Q;
+    }
+}
+
+void MeshSimplifier::AddCollapse(Uint32 v0, Uint32 v1)
+{
+    if (m_Locked[v0] && m_Locked[v1])
+        return;
+
+    Quadric Q = m_Quadrics[v0];
+    Q += m_Quadrics[v1];
+
+    // Only the direction with the smaller error is added to the queue
+    const float Error0 = !m_Locked[v0] ? static_cast<float>(Q.GetError(m_Positions[v1])) : FLT_MAX;
+    const float Error1 = !m_Locked[v1] ? static_cast<float>(Q.GetError(m_Positions[v0])) : FLT_MAX;
+
+    EdgeCollapse Collapse;
+    Collapse.Error       = std::min(Error0, Error1);
+    Collapse.From        = Error0 <= Error1 ? v0 : v1;
+    Collapse.To          = Error0 <= Error1 ? v1 : v0;
+    Collapse.FromVersion = m_Versions[Collapse.From];
+    Collapse.ToVersion   = m_Versions[Collapse.To];
+    m_Collapses.push(Collapse);
+}
+
+bool MeshSimplifier::Collapse(Uint32 From, Uint32 To)
+{
+    std::vector<Uint32>& FromTris = m_VertexTris[From];
+    std::vector<Uint32>& ToTris   = m_VertexTris[To];
+
+    // Triangles removed by the collapses of the neighboring edges are still in the lists
+    const auto IsRemoved = [this](Uint32 t) { return !m_TriAlive[t]; };
+    FromTris.erase(std::remove_if(FromTris.begin(), FromTris.end(), IsRemoved), FromTris.end());
+    ToTris.erase(std::remove_if(ToTris.begin(), ToTris.end(), IsRemoved), ToTris.end());
+
+    // Mark the neighbors of the removed vertex
+    ++m_Mark;
+    Uint32 NumSharedTris = 0;
+    for (Uint32 t : FromTris)
+    {
+        if (FindCorner(t, To) >= 0)
+            ++NumSharedTris;
+        for (int c = 0; c < 3; ++c)
+            m_Marks[m_Corners[t * 3 + c]] = m_Mark;
+    }
+    if (NumSharedTris == 0)
+        return false;
+
+    // The vertices must only share the neighbors opposite to the collapsed edge,
+    // otherwise the collapse makes the surface non-manifold.
+    Uint32 NumSharedNeighbors = 0;
+    for (Uint32 t : ToTris)
+    {
+        for (int c = 0; c < 3; ++c)
+        {
+            const Uint32 v = m_Corners[t * 3 + c];
+            if (m_Marks[v] == m_Mark && v != From && v != To)
+            {
+                ++NumSharedNeighbors;
+                // Count every neighbor once
+                m_Marks[v] = 0;
+            }
+        }
+    }
+    if (NumSharedNeighbors > NumSharedTris)
+        return false;
+
+    // Reject the collapse if it flips or degenerates any of the remaining triangles
+    const float3& NewPos = m_Positions[To];
+    for (Uint32 t : FromTris)
+    {
+        const int Corner = FindCorner(t, From);
+        if (FindCorner(t, To) >= 0 || Corner < 0)
+            continue;
+
+        const float3& p0 = m_Positions[m_Corners[t * 3 + (Corner + 1) % 3]];
+        const float3& p1 = m_Positions[m_Corners[t * 3 + (Corner + 2) % 3]];
+
+        const float3 OldN = cross(p0 - m_Positions[From], p1 - m_Positions[From]);
+        const float3 NewN = cross(p0 - NewPos, p1 - NewPos);
+        // Reject normals that rotate by more than ~75 degrees
+        if (dot(OldN, NewN) <= 0.25f * length(OldN) * length(NewN))
+            return false;
+    }
+
+    // The remaining triangles use the source vertex of the removed triangle corner
+    // that belongs to the kept vertex.
+    Uint32 SourceVertex = ~0u;
+    for (Uint32 t : FromTris)
+    {
+        const int Corner = FindCorner(t, To);
+        if (Corner >= 0)
+        {
+            if (SourceVertex == ~0u)
+                SourceVertex = m_SourceCorners[t * 3 + Corner];
+            m_TriAlive[t] = false;
+            --m_NumTriangles;
+        }
+    }
+    VERIFY_EXPR(SourceVertex != ~0u);
+
+    ToTris.erase(std::remove_if(ToTris.begin(), ToTris.end(), IsRemoved), ToTris.end());
+    for (Uint32 t : FromTris)
+    {
+        if (!m_TriAlive[t])
+            continue;
+
+        const int Corner = FindCorner(t, From);
+        VERIFY_EXPR(Corner >= 0);
+        m_Corners[t * 3 + Corner]       = To;
+        m_SourceCorners[t * 3 + Corner] = SourceVertex;
+        ToTris.push_back(t);
+    }
+
+    m_Quadrics[To] += m_Quadrics[From];
+    m_Removed[From] = true;
+    ++m_Versions[To];
+    FromTris = {};
+
+    // Re-evaluate the collapses of all edges of the kept vertex
+    ++m_Mark;
+    m_Marks[To] = m_Mark;
+    for (Uint32 t : ToTris)
+    {
+        for (int c = 0; c < 3; ++c)
+        {
+            const Uint32 v = m_Corners[t * 3 + c];
+            if (m_Marks[v] != m_Mark)
+            {
+                m_Marks[v] = m_Mark;
+                AddCollapse(To, v);
+            }
+        }
+    }
+
+    return true;
+}
+
+bool MeshSimplifier::Simplify(Uint32 TargetTriangles)
+{
+    while (m_NumTriangles > TargetTriangles && !m_Collapses.empty())
+    {
+        const EdgeCollapse Candidate = m_Collapses.top();
+        m_Collapses.pop();
+
+        // Skip the collapses that are out of date
+        if (m_Removed[Candidate.From] || m_Removed[Candidate.To] ||
+            m_Versions[Candidate.From] != Candidate.FromVersion ||
+            m_Versions[Candidate.To] != Candidate.ToVersion)
+            continue;
+
+        if (Collapse(Candidate.From, Candidate.To))
+            m_MaxError = std::max(m_MaxError, double{Candidate.Error});
+    }
+
+    return m_NumTriangles <= TargetTriangles;
+}
+
+void MeshSimplifier::GetIndices(std::vector<Uint32>& Indices) const
+{
+    Indices.clear();
+    Indices.reserve(size_t{m_NumTriangles} * 3);
+    for (Uint32 t = 0; t < m_TriAlive.size(); ++t)
+    {
+        if (m_TriAlive[t])
+            Indices.insert(Indices.end(), &m_SourceCorners[t * 3], &m_SourceCorners[t * 3] + 3);
+    }
+}
+
+} // namespace
+
+size_t HnMeshLODChain::GetNumIndices() const
+{
+    size_t NumIndices = 0;
+    for (const HnMeshLOD& LOD : LODs)
+        NumIndices += LOD.Indices.size();
+    return NumIndices;
+}
+
+HnMeshLODChain GenerateMeshLODs(const float3*            pPositions,
+                                Uint32                   NumVertices,
+                                const Uint32*            pIndices,
+                                Uint32                   NumIndices,
+                                const HnMeshLODSettings& Settings)
+{
+    HnMeshLODChain Chain;
+    Chain.NumSourceVertices = NumVertices;
+    Chain.NumSourceIndices  = NumIndices;
+
+    const Uint32 MinTriangles = std::max(Settings.MinTriangles, 1u);
+    if (pPositions == nullptr || pIndices == nullptr || NumIndices / 3 / 2 < MinTriangles)
+        return Chain;
+
+    for (Uint32 i = 0; i < NumIndices; ++i)
+    {
+        if (pIndices[i] >= NumVertices)
+        {
+            UNEXPECTED("Index ", pIndices[i], " is out of range [0, ", NumVertices, ")");
+            return Chain;
+        }
+    }
+
+    MeshSimplifier Simplifier{pPositions, NumVertices, pIndices, NumIndices};
+
+    Uint32 NumTriangles = NumIndices / 3;
+    while (Chain.LODs.size() < Settings.MaxLODs)
+    {
+        const Uint32 TargetTriangles = NumTriangles / 2;
+        if (TargetTriangles < MinTriangles || !Simplifier.Simplify(TargetTriangles))
+            break;
+
+        HnMeshLOD LOD;
+        Simplifier.GetIndices(LOD.Indices);
+        LOD.Error = Simplifier.GetError();
+        Chain.LODs.emplace_back(std::move(LOD));
+
+        NumTriangles = Simplifier.GetNumTriangles();
+    }
+
+    return Chain;
+}
+
+size_t HnMeshLODCache::ComputeKey(const float3*            pPositions,
+                                  Uint32                   NumVertices,
+                                  const Uint32*            pIndices,
+                                  Uint32                   NumIndices,
+                                  const HnMeshLODSettings& Settings)
+{
+    return ComputeHash(ComputeHashRaw(pPositions, sizeof(float3) * NumVertices),
+                       ComputeHashRaw(pIndices, sizeof(Uint32) * NumIndices),
+                       NumVertices, NumIndices, Settings.MinTriangles, Settings.MaxLODs);
+}
+
+std::shared_ptr<const HnMeshLODChain> HnMeshLODCache::Find(size_t Key, Uint32 NumVertices, Uint32 NumIndices) const
+{
+    std::shared_ptr<const HnMeshLODChain> Chain;
+    {
+        std::lock_guard<std::mutex> Guard{m_Mtx};
+
+        auto it = m_Chains.find(Key);
+        if (it != m_Chains.end())
+            Chain = it->second.lock();
+    }
+
+    // Different geometry with the same hash
+    if (Chain && (Chain->NumSourceVertices != NumVertices || Chain->NumSourceIndices != NumIndices))
+        return nullptr;
+
+    return Chain;
+}
+
+void HnMeshLODCache::Add(size_t Key, const std::shared_ptr<const HnMeshLODChain>& Chain)
+{
+    std::lock_guard<std::mutex> Guard{m_Mtx};
+
+    m_Chains[Key] = Chain;
+
+    // Remove expired entries when the number of entries doubles
+    if (m_Chains.size() >= m_PurgeSize)
+    {
+        for (auto it = m_Chains.begin(); it != m_Chains.end();)
+            it = it->second.expired() ? m_Chains.erase(it) : std::next(it);
+        m_PurgeSize = std::max(m_Chains.size() * 2, size_t{64});
+    }
+}
+
+} // namespace USD
+
+} // namespace Diligent
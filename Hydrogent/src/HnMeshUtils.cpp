@@ -0,0 +1,158 @@
+/*
+ *  Copyright 2024 Diligent Graphics LLC
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+#include "HnMeshUtils.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+#include "DebugUtilities.hpp"
+
+#include "pxr/imaging/hd/meshUtil.h"
+#include "pxr/imaging/hd/tokens.h"
+
+namespace Diligent
+{
+
+namespace USD
+{
+
+// Triangulates the mesh faces. The result is identical to that of HdMeshUtil::ComputeTriangleIndices,
+// but meshes that only consist of triangles and quads and have no holes, which is the case
+// for the vast majority of assets, are triangulated directly in a single pass.
+void ComputeTriangleIndices(const pxr::HdMeshTopology& Topology, const pxr::SdfPath& Id, pxr::VtVec3iArray& Triangles)
+{
+    const pxr::VtIntArray& FaceVertexCounts  = Topology.GetFaceVertexCounts();
+    const pxr::VtIntArray& FaceVertexIndices = Topology.GetFaceVertexIndices();
+
+    bool   TrianglesAndQuadsOnly = Topology.GetHoleIndices().empty();
+    size_t NumTriangles          = 0;
+    size_t NumIndices            = 0;
+    for (size_t i = 0; i < FaceVertexCounts.size() && TrianglesAndQuadsOnly; ++i)
+    {
+        const int NumFaceVerts = FaceVertexCounts[i];
+        TrianglesAndQuadsOnly  = NumFaceVerts == 3 || NumFaceVerts == 4;
+        NumTriangles += NumFaceVerts - 2;
+        NumIndices += NumFaceVerts;
+    }
+
+    if (!TrianglesAndQuadsOnly || NumIndices != FaceVertexIndices.size())
+    {
+        pxr::HdMeshUtil MeshUtil{&Topology, Id};
+        pxr::VtIntArray PrimitiveParams;
+        MeshUtil.ComputeTriangleIndices(&Triangles, &PrimitiveParams, nullptr);
+        return;
+    }
+
+    // Left-handed faces are triangulated with the opposite winding
+    const bool Flip = Topology.GetOrientation() != pxr::HdTokens->rightHanded;
+    const int  i1   = Flip ? 2 : 1;
+    const int  i2   = Flip ? 1 : 2;
+
+    Triangles.resize(NumTriangles);
+    pxr::GfVec3i* pDst  = Triangles.data();
+    const int*    pFace = FaceVertexIndices.cdata();
+    for (const int NumFaceVerts : FaceVertexCounts)
+    {
+        // Fan triangulation: (0, 1, 2), (0, 2, 3)
+        *pDst++ = pxr::GfVec3i{pFace[0], pFace[i1], pFace[i2]};
+        if (NumFaceVerts == 4)
+            *pDst++ = pxr::GfVec3i{pFace[0], pFace[i1 + 1], pFace[i2 + 1]};
+        pFace += NumFaceVerts;
+    }
+    VERIFY_EXPR(pDst == Triangles.data() + Triangles.size());
+}
+
+// Computes smooth vertex normals the same way as Hd_SmoothNormals does, but without
+// building the vertex adjacency table: every face corner adds the cross product of its
+// edges to the normal of the corner vertex. The normals are then normalized in a separate
+// pass over the flat array that the compiler is able to vectorize.
+bool ComputeSmoothNormals(const pxr::HdMeshTopology& Topology,
+                                 const float*               pPoints,
+                                 size_t                     NumPoints,
+                                 float*                     pNormals)
+{
+    const pxr::VtIntArray& FaceVertexCounts  = Topology.GetFaceVertexCounts();
+    const pxr::VtIntArray& FaceVertexIndices = Topology.GetFaceVertexIndices();
+
+    const int*   pIndices   = FaceVertexIndices.cdata();
+    const size_t NumIndices = FaceVertexIndices.size();
+    const bool   Flip       = Topology.GetOrientation() != pxr::HdTokens->rightHanded;
+
+    std::fill_n(pNormals, NumPoints * 3, 0.f);
+
+    size_t FaceStart = 0;
+    for (const int NumFaceVerts : FaceVertexCounts)
+    {
+        if (NumFaceVerts < 0 || FaceStart + NumFaceVerts > NumIndices)
+            return false;
+
+        const int* pFace = pIndices + FaceStart;
+        for (int v = 0, prev = NumFaceVerts - 1; v < NumFaceVerts; prev = v++)
+        {
+            const int next = v + 1 < NumFaceVerts ? v + 1 : 0;
+
+            const size_t Curr = static_cast<size_t>(pFace[v]);
+            size_t       Prev = static_cast<size_t>(pFace[prev]);
+            size_t       Next = static_cast<size_t>(pFace[next]);
+            if (Flip)
+                std::swap(Prev, Next);
+            if (Curr >= NumPoints || Prev >= NumPoints || Next >= NumPoints)
+                continue;
+
+            const float* c = pPoints + Curr * 3;
+            const float* p = pPoints + Prev * 3;
+            const float* n = pPoints + Next * 3;
+
+            const float e0[] = {n[0] - c[0], n[1] - c[1], n[2] - c[2]};
+            const float e1[] = {p[0] - c[0], p[1] - c[1], p[2] - c[2]};
+
+            float* Normal = pNormals + Curr * 3;
+            Normal[0] += e0[1] * e1[2] - e0[2] * e1[1];
+            Normal[1] += e0[2] * e1[0] - e0[0] * e1[2];
+            Normal[2] += e0[0] * e1[1] - e0[1] * e1[0];
+        }
+
+        FaceStart += NumFaceVerts;
+    }
+
+    for (size_t i = 0; i < NumPoints; ++i)
+    {
+        float* Normal = pNormals + i * 3;
+        // Same as GfVec3f::Normalize(), which leaves degenerate normals near zero
+        const float Len   = std::sqrt(Normal[0] * Normal[0] + Normal[1] * Normal[1] + Normal[2] * Normal[2]);
+        const float Scale = 1.f / std::max(Len, 1e-10f);
+        Normal[0] *= Scale;
+        Normal[1] *= Scale;
+        Normal[2] *= Scale;
+    }
+
+    return true;
+}
+
+} // namespace USD
+
+} // namespace Diligent
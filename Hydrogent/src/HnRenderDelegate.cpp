@@ -29,8 +29,11 @@
 #include "HnMaterial.hpp"
 #include "HnCamera.hpp"
 #include "HnLight.hpp"
+#include "HnInstancer.hpp"
 #include "HnRenderPass.hpp"
 #include "HnRenderParam.hpp"
+#include "HnStagingAllocator.hpp"
+#include "HnMeshSimplifier.hpp"
 #include "HnRenderPassState.hpp"
 #include "DebugUtilities.hpp"
 #include "GraphicsUtilities.h"
@@ -38,6 +41,16 @@
 #include "Align.hpp"
 #include "PlatformMisc.hpp"
 #include "GLTFResourceManager.hpp"
+#include "HnShaderSourceFactory.hpp"
+#include "RenderStateCache.hpp"
+#include "VariableSizeAllocationsManager.hpp"
+#include "DefaultRawMemoryAllocator.hpp"
+#include "ShaderMacroHelper.hpp"
+#include "GraphicsTypesX.hpp"
+#include "ThreadPool.hpp"
+
+#include <cmath>
+#include <algorithm>
 
 #include "pxr/imaging/hd/material.h"
 
@@ -72,6 +85,11 @@ const pxr::TfTokenVector HnRenderDelegate::SupportedSPrimTypes =
 {
     pxr::HdPrimTypeTokens->material,
     pxr::HdPrimTypeTokens->light,
+    pxr::HdPrimTypeTokens->distantLight,
+    pxr::HdPrimTypeTokens->sphereLight,
+    pxr::HdPrimTypeTokens->diskLight,
+    pxr::HdPrimTypeTokens->rectLight,
+    pxr::HdPrimTypeTokens->cylinderLight,
     pxr::HdPrimTypeTokens->camera,
 };
 
@@ -94,11 +112,37 @@ static RefCntAutoPtr<IBuffer> CreateFrameAttribsCB(IRenderDevice* pDevice)
     return FrameAttribsCB;
 }
 
-static RefCntAutoPtr<IBuffer> CreatePrimitiveAttribsCB(IRenderDevice* pDevice)
+static bool CheckIndirectDrawsSupport(const HnRenderDelegate::CreateInfo& CI)
+{
+    if (!CI.UseIndirectDraws)
+        return false;
+
+    const DeviceFeatures& Features = CI.pDevice->GetDeviceInfo().Features;
+    if (!Features.ComputeShaders || !Features.IndirectRendering)
+    {
+        LOG_WARNING_MESSAGE("This device does not support compute shaders or indirect rendering. Indirect draws will be disabled");
+        return false;
+    }
+
+    return true;
+}
+
+// The size of the primitive attributes buffer range that is rewritten every frame
+static constexpr Uint32 TransientPrimitiveAttribsSize = 65536;
+
+static RefCntAutoPtr<IBuffer> CreatePrimitiveAttribsCB(IRenderDevice* pDevice, bool UseIndirectDraws, Uint32 IndirectBufferSize)
 {
-    Uint64 Size  = 65536;
+    Uint64 Size  = TransientPrimitiveAttribsSize;
     USAGE  Usage = USAGE_DYNAMIC;
-    if (pDevice->GetDeviceInfo().IsGLDevice())
+    if (UseIndirectDraws)
+    {
+        // Persistent attributes of all render passes are kept in a large USAGE_DEFAULT buffer
+        // and are updated with UpdateBuffer() method only when they change. The first
+        // TransientPrimitiveAttribsSize bytes are used the same way as on OpenGL.
+        Size  = std::max(Uint64{IndirectBufferSize}, Uint64{TransientPrimitiveAttribsSize} * 2);
+        Usage = USAGE_DEFAULT;
+    }
+    else if (pDevice->GetDeviceInfo().IsGLDevice())
     {
         // On OpenGL, use large USAGE_DEFAULT buffer and update it
         // with UpdateBuffer() method.
@@ -114,6 +158,7 @@ static RefCntAutoPtr<IBuffer> CreatePrimitiveAttribsCB(IRenderDevice* pDevice)
 }
 
 static std::shared_ptr<USD_Renderer> CreateUSDRenderer(const HnRenderDelegate::CreateInfo& RenderDelegateCI,
+                                                       bool                                UseIndirectDraws,
                                                        IBuffer*                            pPrimitiveAttribsCB,
                                                        IObject*                            MaterialSRBCache)
 {
@@ -128,6 +173,8 @@ static std::shared_ptr<USD_Renderer> CreateUSDRenderer(const HnRenderDelegate::C
     // Enable clear coat support
     USDRendererCI.EnableClearCoat = true;
 
+    USDRendererCI.pAsyncPSOThreadPool = RenderDelegateCI.pShaderCompilationThreadPool;
+
     USDRendererCI.ColorTargetIndex        = HnFramebufferTargets::GBUFFER_TARGET_SCENE_COLOR;
     USDRendererCI.MeshIdTargetIndex       = HnFramebufferTargets::GBUFFER_TARGET_MESH_ID;
     USDRendererCI.MotionVectorTargetIndex = HnFramebufferTargets::GBUFFER_TARGET_MOTION_VECTOR;
@@ -187,6 +234,21 @@ static std::shared_ptr<USD_Renderer> CreateUSDRenderer(const HnRenderDelegate::C
     USDRendererCI.InputLayout.NumElements    = _countof(Inputs);
 
     USDRendererCI.pPrimitiveAttribsCB = pPrimitiveAttribsCB;
+    USDRendererCI.MaxMaterialCount    = RenderDelegateCI.MaxMaterialCount;
+    USDRendererCI.MaxLightCount       = RenderDelegateCI.MaxLightCount;
+
+    if (UseIndirectDraws)
+    {
+        // Use primitive arrays so that multiple draw commands can be rendered with a single
+        // indirect draw call. The renderer will clamp the size to fit into the constant buffer.
+        USDRendererCI.PrimitiveArraySize = 256;
+    }
+    else
+    {
+        // Instance transforms can't be used with primitive arrays, so
+        // instances are expanded into separate draws in indirect mode.
+        USDRendererCI.MaxInstanceCount = RenderDelegateCI.MaxInstanceCount;
+    }
 
     return std::make_shared<USD_Renderer>(RenderDelegateCI.pDevice, RenderDelegateCI.pRenderStateCache, RenderDelegateCI.pContext, USDRendererCI);
 }
@@ -254,18 +316,169 @@ static RefCntAutoPtr<GLTF::ResourceManager> CreateResourceManager(const HnRender
     return GLTF::ResourceManager::Create(CI.pDevice, ResMgrCI);
 }
 
+static RefCntAutoPtr<IPipelineState> CreateBuildIndirectDrawArgsPSO(IRenderDevice*     pDevice,
+                                                                    IRenderStateCache* pStateCache,
+                                                                    IBuffer*           pFrameAttribsCB,
+                                                                    bool               EnableCulling)
+{
+    RefCntAutoPtr<IPipelineState> PSO;
+    try
+    {
+        // RenderDeviceWithCache_E throws exceptions in case of errors
+        RenderDeviceWithCache_E Device{pDevice, pStateCache};
+
+        ShaderCreateInfo ShaderCI;
+        ShaderCI.SourceLanguage = SHADER_SOURCE_LANGUAGE_HLSL;
+
+        auto pHnFxCompoundSourceFactory     = HnShaderSourceFactory::CreateHnFxCompoundFactory();
+        ShaderCI.pShaderSourceStreamFactory = pHnFxCompoundSourceFactory;
+
+        ShaderMacroHelper Macros;
+        Macros.Add("HN_GPU_CULLING", EnableCulling);
+        ShaderCI.Macros = Macros;
+
+        ShaderCI.Desc       = {EnableCulling ? "Build indirect draw args with culling CS" : "Build indirect draw args CS", SHADER_TYPE_COMPUTE, true};
+        ShaderCI.EntryPoint = "main";
+        ShaderCI.FilePath   = "HnBuildIndirectDrawArgs.csh";
+
+        auto pCS = Device.CreateShader(ShaderCI); // Throws exception in case of error
+
+        PipelineResourceLayoutDescX ResourceLayout;
+        ResourceLayout.SetDefaultVariableType(SHADER_RESOURCE_VARIABLE_TYPE_MUTABLE);
+        if (EnableCulling)
+        {
+            // Culling resources are owned by HnCullRprimsTask and may change every frame
+            ResourceLayout
+                .AddVariable(SHADER_TYPE_COMPUTE, "cbFrameAttribs", SHADER_RESOURCE_VARIABLE_TYPE_STATIC)
+                .AddVariable(SHADER_TYPE_COMPUTE, "cbCullingAttribs", SHADER_RESOURCE_VARIABLE_TYPE_DYNAMIC)
+                .AddVariable(SHADER_TYPE_COMPUTE, "g_DepthHierarchy", SHADER_RESOURCE_VARIABLE_TYPE_DYNAMIC);
+        }
+
+        ComputePipelineStateCreateInfo PsoCI;
+        PsoCI.PSODesc.Name           = EnableCulling ? "Build indirect draw args with culling" : "Build indirect draw args";
+        PsoCI.PSODesc.PipelineType   = PIPELINE_TYPE_COMPUTE;
+        PsoCI.PSODesc.ResourceLayout = ResourceLayout;
+        PsoCI.pCS                    = pCS;
+
+        PSO = Device.CreateComputePipelineState(PsoCI); // Throws exception in case of error
+        if (EnableCulling)
+        {
+            PSO->GetStaticVariableByName(SHADER_TYPE_COMPUTE, "cbFrameAttribs")->Set(pFrameAttribsCB);
+        }
+    }
+    catch (const std::runtime_error& err)
+    {
+        LOG_ERROR_MESSAGE("Failed to create build indirect draw args PSO: ", err.what());
+    }
+    catch (...)
+    {
+        LOG_ERROR_MESSAGE("Failed to create build indirect draw args PSO");
+    }
+
+    return PSO;
+}
+
 HnRenderDelegate::HnRenderDelegate(const CreateInfo& CI) :
     m_pDevice{CI.pDevice},
     m_pContext{CI.pContext},
     m_pRenderStateCache{CI.pRenderStateCache},
+    m_UseIndirectDraws{CheckIndirectDrawsSupport(CI)},
     m_ResourceMgr{CreateResourceManager(CI)},
     m_FrameAttribsCB{CreateFrameAttribsCB(CI.pDevice)},
-    m_PrimitiveAttribsCB{CreatePrimitiveAttribsCB(CI.pDevice)},
+    m_PrimitiveAttribsCB{CreatePrimitiveAttribsCB(CI.pDevice, m_UseIndirectDraws, CI.IndirectPrimitiveAttribsBufferSize)},
     m_MaterialSRBCache{HnMaterial::CreateSRBCache()},
-    m_USDRenderer{CreateUSDRenderer(CI, m_PrimitiveAttribsCB, m_MaterialSRBCache)},
-    m_TextureRegistry{CI.pDevice, CI.TextureAtlasDim != 0 ? m_ResourceMgr : nullptr},
-    m_RenderParam{std::make_unique<HnRenderParam>(CI.UseVertexPool, CI.UseIndexPool, CI.TextureBindingMode)}
+    m_USDRenderer{CreateUSDRenderer(CI, m_UseIndirectDraws, m_PrimitiveAttribsCB, m_MaterialSRBCache)},
+    m_TextureRegistry{CI.pDevice, CI.TextureAtlasDim != 0 ? m_ResourceMgr : nullptr, CI.pTextureLoaderThreadPool, CI.TextureUploadBudget, CI.TextureResidencyBudget},
+    m_RenderParam{std::make_unique<HnRenderParam>(CI.UseVertexPool, CI.UseIndexPool, CI.TextureBindingMode, m_UseIndirectDraws)},
+    m_StagingAllocator{std::make_unique<HnStagingAllocator>(DefaultRawMemoryAllocator::GetAllocator())},
+    m_pResourceCommitThreadPool{CI.pResourceCommitThreadPool},
+    m_MeshLODCache{CI.EnableMeshLODs ? std::make_shared<HnMeshLODCache>() : nullptr},
+    m_MinMeshLODTriangles{std::max(CI.MinMeshLODTriangles, 1u)},
+    m_MeshLODErrorThreshold{CI.MeshLODErrorThreshold}
+{
+    const Uint64 AttribsBufferSize = m_PrimitiveAttribsCB->GetDesc().Size;
+    if (m_UseIndirectDraws)
+    {
+        m_TransientPrimitiveAttribsSize = TransientPrimitiveAttribsSize;
+
+        // Reserve the space at the end of the buffer for the primitive array range bound
+        // at the offset of the last region.
+        const Uint32 PrimitiveArrayRange =
+            m_USDRenderer->GetPBRPrimitiveAttribsSize(PBR_Renderer::PSO_FLAG_ALL) * std::max(m_USDRenderer->GetSettings().PrimitiveArraySize, 1u);
+        const Uint32 Alignment      = m_pDevice->GetAdapterInfo().Buffer.ConstantBufferOffsetAlignment;
+        const Uint64 PersistentSize = AlignDown(AttribsBufferSize - m_TransientPrimitiveAttribsSize - PrimitiveArrayRange, Uint64{Alignment});
+        m_PrimitiveAttribsAllocator = std::make_unique<VariableSizeAllocationsManager>(PersistentSize, DefaultRawMemoryAllocator::GetAllocator());
+
+        m_BuildIndirectDrawArgsPSO[0] = CreateBuildIndirectDrawArgsPSO(CI.pDevice, CI.pRenderStateCache, m_FrameAttribsCB, false);
+        m_BuildIndirectDrawArgsPSO[1] = CreateBuildIndirectDrawArgsPSO(CI.pDevice, CI.pRenderStateCache, m_FrameAttribsCB, true);
+    }
+    else
+    {
+        m_TransientPrimitiveAttribsSize = static_cast<Uint32>(AttribsBufferSize);
+    }
+
+    if (m_USDRenderer->GetInstanceTransformsBuffer() != nullptr)
+    {
+        m_InstanceAllocator = std::make_unique<VariableSizeAllocationsManager>(m_USDRenderer->GetSettings().MaxInstanceCount, DefaultRawMemoryAllocator::GetAllocator());
+    }
+}
+
+Uint32 HnRenderDelegate::AllocatePrimitiveAttribs(Uint32 Size)
 {
+    if (!m_PrimitiveAttribsAllocator)
+    {
+        UNEXPECTED("Persistent primitive attributes are only available when indirect draws are enabled");
+        return ~0u;
+    }
+
+    const Uint32 Alignment   = m_pDevice->GetAdapterInfo().Buffer.ConstantBufferOffsetAlignment;
+    const Uint32 AlignedSize = AlignUp(Size, Alignment);
+
+    VariableSizeAllocationsManager::Allocation Allocation = m_PrimitiveAttribsAllocator->Allocate(AlignedSize, Alignment);
+    if (!Allocation.IsValid())
+        return ~0u;
+
+    // All allocation sizes are multiples of the alignment, so no padding is ever required
+    // and the region can be released using the offset and size.
+    VERIFY_EXPR((Allocation.UnalignedOffset % Alignment) == 0 && Allocation.Size == AlignedSize);
+    return m_TransientPrimitiveAttribsSize + static_cast<Uint32>(Allocation.UnalignedOffset);
+}
+
+void HnRenderDelegate::FreePrimitiveAttribs(Uint32 Offset, Uint32 Size)
+{
+    if (!m_PrimitiveAttribsAllocator)
+    {
+        UNEXPECTED("Persistent primitive attributes are only available when indirect draws are enabled");
+        return;
+    }
+
+    VERIFY_EXPR(Offset >= m_TransientPrimitiveAttribsSize);
+    const Uint32 Alignment = m_pDevice->GetAdapterInfo().Buffer.ConstantBufferOffsetAlignment;
+    m_PrimitiveAttribsAllocator->Free(Offset - m_TransientPrimitiveAttribsSize, AlignUp(Size, Alignment));
+}
+
+Uint32 HnRenderDelegate::AllocateInstances(Uint32 Count)
+{
+    if (!m_InstanceAllocator || Count == 0)
+        return ~0u;
+
+    VariableSizeAllocationsManager::Allocation Allocation = m_InstanceAllocator->Allocate(Count, 1);
+    if (!Allocation.IsValid())
+        return ~0u;
+
+    VERIFY_EXPR(Allocation.Size == Count);
+    return static_cast<Uint32>(Allocation.UnalignedOffset);
+}
+
+void HnRenderDelegate::FreeInstances(Uint32 FirstInstance, Uint32 Count)
+{
+    if (!m_InstanceAllocator)
+    {
+        UNEXPECTED("Instancing is disabled");
+        return;
+    }
+
+    m_InstanceAllocator->Free(FirstInstance, Count);
 }
 
 HnRenderDelegate::~HnRenderDelegate()
@@ -308,11 +521,12 @@ pxr::HdRenderPassSharedPtr HnRenderDelegate::CreateRenderPass(pxr::HdRenderIndex
 pxr::HdInstancer* HnRenderDelegate::CreateInstancer(pxr::HdSceneDelegate* Delegate,
                                                     const pxr::SdfPath&   Id)
 {
-    return nullptr;
+    return HnInstancer::Create(Delegate, Id);
 }
 
 void HnRenderDelegate::DestroyInstancer(pxr::HdInstancer* Instancer)
 {
+    delete Instancer;
 }
 
 pxr::HdRprim* HnRenderDelegate::CreateRprim(const pxr::TfToken& TypeId,
@@ -343,13 +557,27 @@ pxr::HdRprim* HnRenderDelegate::CreateRprim(const pxr::TfToken& TypeId,
 
 void HnRenderDelegate::DestroyRprim(pxr::HdRprim* rPrim)
 {
+    HnMesh* Mesh = static_cast<HnMesh*>(rPrim);
     {
         std::lock_guard<std::mutex> Guard{m_MeshesMtx};
-        m_Meshes.erase(static_cast<HnMesh*>(rPrim));
+        m_Meshes.erase(Mesh);
     }
+    Mesh->FreeInstances(*this);
     delete rPrim;
 }
 
+static bool IsLightType(const pxr::TfToken& TypeId)
+{
+    // clang-format off
+    return TypeId == pxr::HdPrimTypeTokens->light        ||
+           TypeId == pxr::HdPrimTypeTokens->distantLight ||
+           TypeId == pxr::HdPrimTypeTokens->sphereLight  ||
+           TypeId == pxr::HdPrimTypeTokens->diskLight    ||
+           TypeId == pxr::HdPrimTypeTokens->rectLight    ||
+           TypeId == pxr::HdPrimTypeTokens->cylinderLight;
+    // clang-format on
+}
+
 pxr::HdSprim* HnRenderDelegate::CreateSprim(const pxr::TfToken& TypeId,
                                             const pxr::SdfPath& SPrimId)
 {
@@ -367,12 +595,14 @@ pxr::HdSprim* HnRenderDelegate::CreateSprim(const pxr::TfToken& TypeId,
     {
         SPrim = HnCamera::Create(SPrimId);
     }
-    else if (TypeId == pxr::HdPrimTypeTokens->light)
+    else if (IsLightType(TypeId))
     {
-        HnLight* Light = HnLight::Create(SPrimId);
+        HnLight* Light = HnLight::Create(SPrimId, TypeId);
         {
             std::lock_guard<std::mutex> Guard{m_LightsMtx};
             m_Lights.emplace(Light);
+            Light->SetBufferIndex(static_cast<Uint32>(m_LightBufferSlots.size()));
+            m_LightBufferSlots.push_back(Light);
         }
         SPrim = Light;
     }
@@ -393,10 +623,12 @@ pxr::HdSprim* HnRenderDelegate::CreateFallbackSprim(const pxr::TfToken& TypeId)
             std::lock_guard<std::mutex> Guard{m_MaterialsMtx};
             m_Materials.emplace(Mat);
         }
+        // Fallback material is never synced
+        MarkMaterialDirty(*Mat);
         SPrim = Mat;
     }
     else if (TypeId == pxr::HdPrimTypeTokens->camera ||
-             TypeId == pxr::HdPrimTypeTokens->light)
+             IsLightType(TypeId))
     {
         SPrim = nullptr;
     }
@@ -416,8 +648,21 @@ void HnRenderDelegate::DestroySprim(pxr::HdSprim* SPrim)
     }
     else if (dynamic_cast<HnLight*>(SPrim) != nullptr)
     {
+        HnLight* Light = static_cast<HnLight*>(SPrim);
+
         std::lock_guard<std::mutex> Guard{m_LightsMtx};
-        m_Lights.erase(static_cast<HnLight*>(SPrim));
+        m_Lights.erase(Light);
+
+        // Move the last light into the slot of the removed light to keep the buffer compact.
+        // The moved light is marked dirty and is rewritten by CommitResources().
+        const Uint32 Index = Light->GetBufferIndex();
+        if (Index < m_LightBufferSlots.size())
+        {
+            VERIFY_EXPR(m_LightBufferSlots[Index] == Light);
+            m_LightBufferSlots[Index] = m_LightBufferSlots.back();
+            m_LightBufferSlots[Index]->SetBufferIndex(Index);
+            m_LightBufferSlots.pop_back();
+        }
     }
 
     delete SPrim;
@@ -455,21 +700,172 @@ void HnRenderDelegate::CommitResources(pxr::HdChangeTracker* tracker)
 
     m_TextureRegistry.Commit(m_pContext);
 
+    CommitMaterials();
+    CommitMeshes();
+
+    // All meshes have released their staging data
+    m_StagingAllocator->Reset();
+
+    CommitLights();
+
+    if (IBuffer* pInstanceTransforms = m_USDRenderer->GetInstanceTransformsBuffer())
     {
-        std::lock_guard<std::mutex> Guard{m_MaterialsMtx};
-        for (auto* pMat : m_Materials)
+        // Meshes update instance transforms with UpdateBuffer
+        if (pInstanceTransforms->GetState() != RESOURCE_STATE_SHADER_RESOURCE)
         {
+            StateTransitionDesc Barrier{pInstanceTransforms, RESOURCE_STATE_UNKNOWN, RESOURCE_STATE_SHADER_RESOURCE, STATE_TRANSITION_FLAG_UPDATE_STATE};
+            m_pContext->TransitionResourceStates(1, &Barrier);
+        }
+    }
+}
+
+// Takes the objects from the dirty list and removes the duplicates and the objects that have been destroyed.
+// The address of a destroyed object may be reused by a new one, which is harmless as the new object is only
+// committed one more time.
+template <typename ObjectType, typename DirtyListType>
+static std::vector<ObjectType*> TakeDirtyObjects(DirtyListType& DirtyList, const std::unordered_set<ObjectType*>& LiveObjects)
+{
+    std::vector<ObjectType*> Objects;
+    DirtyList.TakeAll(Objects);
+    std::sort(Objects.begin(), Objects.end());
+    Objects.erase(std::unique(Objects.begin(), Objects.end()), Objects.end());
+    Objects.erase(std::remove_if(Objects.begin(), Objects.end(),
+                                 [&LiveObjects](ObjectType* pObject) {
+                                     return LiveObjects.find(pObject) == LiveObjects.end();
+                                 }),
+                  Objects.end());
+    return Objects;
+}
+
+void HnRenderDelegate::CommitMaterials()
+{
+    std::lock_guard<std::mutex> Guard{m_MaterialsMtx};
+
+    std::vector<HnMaterial*> DirtyMaterials = TakeDirtyObjects(m_DirtyMaterials, m_Materials);
+
+    // When textures are loaded or the atlas is resized, the textures of any material may have changed
+    const Uint32 AtlasVersion      = m_TextureRegistry.GetAtlasVersion();
+    const Uint32 TexStorageVersion = m_TextureRegistry.GetStorageVersion();
+    if (AtlasVersion != m_MaterialsAtlasVersion || TexStorageVersion != m_MaterialsTexStorageVersion)
+    {
+        DirtyMaterials.assign(m_Materials.begin(), m_Materials.end());
+        m_MaterialsAtlasVersion      = AtlasVersion;
+        m_MaterialsTexStorageVersion = TexStorageVersion;
+    }
+
+    if (DirtyMaterials.empty())
+        return;
+
+    constexpr size_t MaterialsPerTask = 64;
+    if (m_pResourceCommitThreadPool && m_pDevice->GetDeviceInfo().Features.MultithreadedResourceCreation && DirtyMaterials.size() > MaterialsPerTask)
+    {
+        std::vector<RefCntAutoPtr<IAsyncTask>> Tasks;
+        for (size_t First = 0; First < DirtyMaterials.size(); First += MaterialsPerTask)
+        {
+            const size_t Last = std::min(First + MaterialsPerTask, DirtyMaterials.size());
+            Tasks.emplace_back(
+                EnqueueAsyncWork(m_pResourceCommitThreadPool,
+                                 [this, &DirtyMaterials, First, Last](Uint32 /*ThreadId*/) {
+                                     for (size_t i = First; i < Last; ++i)
+                                         DirtyMaterials[i]->UpdateSRB(*this);
+                                     return ASYNC_TASK_STATUS_COMPLETE;
+                                 }));
+        }
+        for (IAsyncTask* pTask : Tasks)
+            pTask->WaitForCompletion();
+    }
+    else
+    {
+        for (HnMaterial* pMat : DirtyMaterials)
             pMat->UpdateSRB(*this);
+    }
+
+    // Material buffer is updated through the immediate context
+    for (HnMaterial* pMat : DirtyMaterials)
+    {
+        pMat->UpdateMaterialBuffer(*this);
+        if (pMat->GetSRB() == nullptr)
+        {
+            // Try again in the next frame
+            MarkMaterialDirty(*pMat);
         }
     }
+}
+
+void HnRenderDelegate::CommitMeshes()
+{
+    std::lock_guard<std::mutex> Guard{m_MeshesMtx};
 
+    const std::vector<HnMesh*> DirtyMeshes = TakeDirtyObjects(m_DirtyMeshes, m_Meshes);
+    for (HnMesh* pMesh : DirtyMeshes)
     {
-        std::lock_guard<std::mutex> Guard{m_MeshesMtx};
-        for (auto* pMesh : m_Meshes)
+        pMesh->CommitGPUResources(*this);
+    }
+}
+
+static void WritePunctualLightAttribs(const HnLight& Light, HLSL::PBRPunctualLightAttribs& Attribs)
+{
+    const float3& Pos       = Light.GetPosition();
+    const float3& Dir       = Light.GetDirection();
+    const float4& Intensity = Light.GetIntensity();
+
+    int LightType = PBR_LIGHT_TYPE_DIRECTIONAL;
+    switch (Light.GetType())
+    {
+        case HnLight::TYPE::DIRECTIONAL: LightType = PBR_LIGHT_TYPE_DIRECTIONAL; break;
+        case HnLight::TYPE::POINT: LightType = PBR_LIGHT_TYPE_POINT; break;
+        case HnLight::TYPE::SPOT: LightType = PBR_LIGHT_TYPE_SPOT; break;
+        default: UNEXPECTED("Unexpected light type");
+    }
+
+    Attribs.PosAndRange = float4{Pos.x, Pos.y, Pos.z, Light.GetRange()};
+    Attribs.DirAndType  = float4{Dir.x, Dir.y, Dir.z, static_cast<float>(LightType)};
+    // Lights with zero intensity are not binned into the light clusters
+    Attribs.Intensity = Light.IsVisible() ? float4{Intensity.r, Intensity.g, Intensity.b, 0} : float4{0, 0, 0, 0};
+
+    const float CosInner     = std::cos(Light.GetConeInnerAngle());
+    const float CosOuter     = std::cos(Light.GetConeOuterAngle());
+    const float SpotScale    = 1.f / std::max(CosInner - CosOuter, 0.001f);
+    Attribs.SpotAngleAttribs = float4{SpotScale, -CosOuter * SpotScale, 0, 0};
+}
+
+void HnRenderDelegate::CommitLights()
+{
+    if (m_USDRenderer->GetPunctualLightsBuffer() == nullptr)
+        return;
+
+    std::lock_guard<std::mutex> Guard{m_LightsMtx};
+
+    const Uint32 MaxLightCount = m_USDRenderer->GetSettings().MaxLightCount;
+    const Uint32 NumLights     = std::min(static_cast<Uint32>(m_LightBufferSlots.size()), MaxLightCount);
+    if (m_LightBufferSlots.size() > MaxLightCount && !m_LightCountWarningShown)
+    {
+        LOG_WARNING_MESSAGE("The number of lights (", m_LightBufferSlots.size(), ") exceeds the maximum light count (", MaxLightCount,
+                            "). Extra lights will be ignored. Increase HnRenderDelegate::CreateInfo::MaxLightCount.");
+        m_LightCountWarningShown = true;
+    }
+    m_LightsData.resize(NumLights);
+
+    // Only rewrite the lights whose data has changed. Consecutive dirty lights are uploaded together.
+    Uint32 FirstDirtyLight = ~0u;
+    for (Uint32 i = 0; i <= NumLights; ++i)
+    {
+        HnLight* Light = i < NumLights ? m_LightBufferSlots[i] : nullptr;
+        if (Light != nullptr && Light->IsGPUDataDirty())
+        {
+            WritePunctualLightAttribs(*Light, m_LightsData[i]);
+            Light->SetGPUDataClean();
+            if (FirstDirtyLight == ~0u)
+                FirstDirtyLight = i;
+        }
+        else if (FirstDirtyLight != ~0u)
         {
-            pMesh->CommitGPUResources(*this);
+            m_USDRenderer->UpdatePunctualLights(m_pContext, FirstDirtyLight, i - FirstDirtyLight, &m_LightsData[FirstDirtyLight]);
+            FirstDirtyLight = ~0u;
         }
     }
+
+    m_PunctualLightCount = NumLights;
 }
 
 const pxr::SdfPath* HnRenderDelegate::GetRPrimId(Uint32 UID) const
@@ -502,6 +898,15 @@ HnRenderDelegateMemoryStats HnRenderDelegate::GetMemoryStats() const
     MemoryStats.Atlas.TotalTexels     = AtlasUsage.TotalArea;
     MemoryStats.Atlas.AllocatedTexels = AtlasUsage.AllocatedArea;
 
+    const HnTextureRegistry::ResidencyStats ResidencyStats = m_TextureRegistry.GetResidencyStats();
+
+    MemoryStats.TextureResidency.Budget       = ResidencyStats.Budget;
+    MemoryStats.TextureResidency.ResidentSize = ResidencyStats.ResidentSize;
+    MemoryStats.TextureResidency.FullSize     = ResidencyStats.FullSize;
+    MemoryStats.TextureResidency.PendingSize  = ResidencyStats.PendingSize;
+    MemoryStats.TextureResidency.TextureCount = ResidencyStats.TextureCount;
+    MemoryStats.TextureResidency.PendingCount = ResidencyStats.PendingCount;
+
     return MemoryStats;
 }
 
@@ -34,6 +34,8 @@
 #include "HnRenderParam.hpp"
 
 #include <array>
+#include <algorithm>
+#include <unordered_map>
 
 #include "pxr/imaging/hd/renderIndex.h"
 
@@ -41,6 +43,8 @@
 #include "GLTF_PBR_Renderer.hpp"
 #include "MapHelper.hpp"
 #include "ScopedDebugGroup.hpp"
+#include "Align.hpp"
+#include "GraphicsTypesX.hpp"
 
 namespace Diligent
 {
@@ -51,6 +55,7 @@ namespace HLSL
 #include "Shaders/Common/public/BasicStructures.fxh"
 #include "Shaders/PBR/public/PBR_Structures.fxh"
 #include "Shaders/PBR/private/RenderPBR_Structures.fxh"
+#include "../shaders/HnIndirectDrawStructures.fxh"
 
 } // namespace HLSL
 
@@ -81,6 +86,7 @@ pxr::HdRenderPassSharedPtr HnRenderPass::Create(pxr::HdRenderIndex*           pI
 
 HnRenderPass::DrawListItem::DrawListItem(const HnDrawItem& Item) noexcept :
     DrawItem{Item},
+    MeshUID{Item.GetMesh().GetUID()},
     PrevTransform{Item.GetMesh().GetAttributes().Transform}
 {}
 
@@ -90,6 +96,15 @@ HnRenderPass::HnRenderPass(pxr::HdRenderIndex*           pIndex,
 {
 }
 
+HnRenderPass::~HnRenderPass()
+{
+    if (m_AttribsRegionOffset != ~0u)
+    {
+        HnRenderDelegate* pRenderDelegate = static_cast<HnRenderDelegate*>(GetRenderIndex()->GetRenderDelegate());
+        pRenderDelegate->FreePrimitiveAttribs(m_AttribsRegionOffset, m_AttribsRegionSize);
+    }
+}
+
 struct HnRenderPass::RenderState
 {
     const HnRenderPass&       RenderPass;
@@ -105,6 +120,10 @@ struct HnRenderPass::RenderState
 
     const Uint32 ConstantBufferOffsetAlignment;
 
+    // Primitive ID buffer used when the renderer uses primitive arrays
+    IBuffer* const pPrimitiveIdBuffer;
+    const Uint32   PrimitiveIdBufferSlot;
+
     RenderState(const HnRenderPass&      _RenderPass,
                 const HnRenderPassState& _RPState) :
         RenderPass{_RenderPass},
@@ -115,8 +134,11 @@ struct HnRenderPass::RenderState
         USDRenderer{*RenderDelegate.GetUSDRenderer()},
         pCtx{RenderDelegate.GetDeviceContext()},
         AlphaMode{MaterialTagToPbrAlphaMode(RenderPass.m_MaterialTag)},
-        ConstantBufferOffsetAlignment{RenderDelegate.GetDevice()->GetAdapterInfo().Buffer.ConstantBufferOffsetAlignment}
+        ConstantBufferOffsetAlignment{RenderDelegate.GetDevice()->GetAdapterInfo().Buffer.ConstantBufferOffsetAlignment},
+        pPrimitiveIdBuffer{USDRenderer.GetPrimitiveIdBuffer()},
+        PrimitiveIdBufferSlot{USDRenderer.GetPrimitiveIdBufferSlot()}
     {
+        VERIFY_EXPR(pPrimitiveIdBuffer == nullptr || PrimitiveIdBufferSlot < ppVertexBuffers.size());
     }
 
     void SetPipelineState(IPipelineState* pNewPSO)
@@ -163,7 +185,19 @@ struct HnRenderPass::RenderState
 
         if (SetBuffers)
         {
-            pCtx->SetVertexBuffers(0, NumBuffers, ppBuffers, nullptr, RESOURCE_STATE_TRANSITION_MODE_TRANSITION, SET_VERTEX_BUFFERS_FLAG_RESET);
+            if (pPrimitiveIdBuffer != nullptr)
+            {
+                // Primitive ID buffer is bound to the slot that follows the vertex buffers.
+                std::array<IBuffer*, 5> Buffers{};
+                for (Uint32 i = 0; i < NumBuffers; ++i)
+                    Buffers[i] = ppBuffers[i];
+                Buffers[PrimitiveIdBufferSlot] = pPrimitiveIdBuffer;
+                pCtx->SetVertexBuffers(0, PrimitiveIdBufferSlot + 1, Buffers.data(), nullptr, RESOURCE_STATE_TRANSITION_MODE_TRANSITION, SET_VERTEX_BUFFERS_FLAG_RESET);
+            }
+            else
+            {
+                pCtx->SetVertexBuffers(0, NumBuffers, ppBuffers, nullptr, RESOURCE_STATE_TRANSITION_MODE_TRANSITION, SET_VERTEX_BUFFERS_FLAG_RESET);
+            }
         }
     }
 
@@ -185,7 +219,7 @@ private:
     IShaderResourceBinding* pSRB = nullptr;
 
     IBuffer*                pIndexBuffer    = nullptr;
-    std::array<IBuffer*, 4> ppVertexBuffers = {};
+    std::array<IBuffer*, 5> ppVertexBuffers = {};
 
     USD_Renderer::PsoCacheAccessor PsoCache;
 };
@@ -251,6 +285,18 @@ void HnRenderPass::_Execute(const pxr::HdRenderPassStateSharedPtr& RPState,
         }
     }
 
+    {
+        // Request the PSOs again when the pipelines that replace the fallback PSOs have been created.
+        const Uint32 AsyncPSOVersion = State.USDRenderer.GetAsyncPSOVersion();
+        if (m_UsesFallbackPSOs && m_AsyncPSOVersion != AsyncPSOVersion)
+        {
+            m_DrawListItemsDirtyFlags |= DRAW_LIST_ITEM_DIRTY_FLAG_PSO;
+            // The flag is set again by the items that still use the fallback PSOs
+            m_UsesFallbackPSOs = false;
+        }
+        m_AsyncPSOVersion = AsyncPSOVersion;
+    }
+
     {
         HN_RENDER_MODE RenderMode = State.RenderParam.GetRenderMode();
         if (m_RenderMode != RenderMode)
@@ -264,7 +310,8 @@ void HnRenderPass::_Execute(const pxr::HdRenderPassStateSharedPtr& RPState,
     VERIFY_EXPR(pPrimitiveAttribsCB != nullptr);
 
     const BufferDesc& AttribsBuffDesc = pPrimitiveAttribsCB->GetDesc();
-    const bool        ApplyTransform  = m_RenderParams.Transform != float4x4::Identity();
+    // When indirect draws are enabled, only the beginning of the buffer is rewritten every frame.
+    const Uint32 AttribsBufferSize = State.RenderDelegate.GetTransientPrimitiveAttribsSize();
 
     m_PendingDrawItems.clear();
     void*  pMappedBufferData = nullptr;
@@ -288,7 +335,10 @@ void HnRenderPass::_Execute(const pxr::HdRenderPassStateSharedPtr& RPState,
         CurrOffset = 0;
     };
 
-    bool DrawListDirty = false;
+    // The render order must be updated when items are added to or removed from the draw list
+    bool DrawListDirty    = m_RenderOrderDirty;
+    // Whether some items are excluded from the indirect draw list (see UpdateIndirectDrawList())
+    bool HasRegularItems = false;
     for (DrawListItem& ListItem : m_DrawList)
     {
         const HnDrawItem& DrawItem  = ListItem.DrawItem;
@@ -297,47 +347,71 @@ void HnRenderPass::_Execute(const pxr::HdRenderPassStateSharedPtr& RPState,
         if (pMaterial == nullptr)
             continue;
 
-        auto DrawItemGPUResDirtyFlags = m_DrawListItemsDirtyFlags;
+        auto DrawItemGPUResDirtyFlags = m_DrawListItemsDirtyFlags | ListItem.DirtyFlags;
         if (ListItem.Version != Mesh.GetVersion())
             DrawItemGPUResDirtyFlags |= DRAW_LIST_ITEM_DIRTY_FLAG_PSO | DRAW_LIST_ITEM_DIRTY_FLAG_MESH_DATA;
         if (DrawItemGPUResDirtyFlags != DRAW_LIST_ITEM_DIRTY_FLAG_NONE)
         {
+            const DrawListItem PrevItem{ListItem};
             UpdateDrawListItemGPUResources(ListItem, State, DrawItemGPUResDirtyFlags);
-            DrawListDirty = true;
+            ListItem.DirtyFlags   = DRAW_LIST_ITEM_DIRTY_FLAG_NONE;
+            ListItem.AttribsDirty = true;
+
+            // Mesh version also changes when e.g. only the transform is updated,
+            // in which case the draw order does not need to be updated.
+            if (ListItem.pPSO != PrevItem.pPSO ||
+                ListItem.IndexBuffer != PrevItem.IndexBuffer ||
+                ListItem.StartIndex != PrevItem.StartIndex ||
+                ListItem.NumVertices != PrevItem.NumVertices ||
+                ListItem.VertexBuffers != PrevItem.VertexBuffers ||
+                ListItem.NumVertexBuffers != PrevItem.NumVertexBuffers ||
+                ListItem.ExpandInstances != PrevItem.ExpandInstances)
+            {
+                DrawListDirty = true;
+            }
         }
+
+        if (ListItem.ExpandInstances || ListItem.IndexBuffer == nullptr)
+            HasRegularItems = true;
     }
 
     if (DrawListDirty)
     {
-        if (m_RenderOrder.size() != m_DrawList.size())
-        {
-            m_RenderOrder.resize(m_DrawList.size());
-            for (Uint32 i = 0; i < m_RenderOrder.size(); ++i)
-                m_RenderOrder[i] = i;
-        }
-        std::sort(m_RenderOrder.begin(), m_RenderOrder.end(),
-                  [this](Uint32 i0, Uint32 i1) {
-                      return m_DrawList[i0].pPSO < m_DrawList[i1].pPSO;
-                  });
+        SortDrawList();
+        m_RenderOrderDirty      = false;
+        m_IndirectDrawListDirty = true;
     }
 
-    for (Uint32 ListItemId : m_RenderOrder)
+    const IndirectDrawStatus IndirectStatus = State.RenderParam.GetUseIndirectDraws() ? RenderIndirect(State) : IndirectDrawStatus::Unavailable;
+    // When the indirect draw list is available, the regular path only renders the items that are excluded from it
+    const bool IndirectDrawsRendered = IndirectStatus != IndirectDrawStatus::Unavailable;
+    if (IndirectDrawsRendered && !HasRegularItems)
     {
-        DrawListItem&     ListItem  = m_DrawList[ListItemId];
-        const HnDrawItem& DrawItem  = ListItem.DrawItem;
-        const HnMesh&     Mesh      = DrawItem.GetMesh();
-        const HnMaterial* pMaterial = DrawItem.GetMaterial();
-        if (pMaterial == nullptr)
-            continue;
+        m_DrawListItemsDirtyFlags = DRAW_LIST_ITEM_DIRTY_FLAG_NONE;
+        return;
+    }
 
-        // Make sure we update all items before skipping any since we will clear the
-        // m_DrawListItemsDirtyFlags at the end of the function.
-        if (!ListItem || !DrawItem.GetVisible())
-            continue;
+    auto AddPendingDrawItem = [&](DrawListItem& ListItem, Uint32 InstanceIdx) {
+        Uint32 StartIndex = 0;
+        Uint32 NumIndices = 0;
+        SelectLOD(ListItem, State, StartIndex, NumIndices);
+
+        if (InstanceIdx == ~0u && !m_PendingDrawItems.empty())
+        {
+            // Extend the previous draw if the item uses the same bindings and primitive attributes,
+            // and its indices immediately follow the indices of the previous draw.
+            PendingDrawItem& LastItem = m_PendingDrawItems.back();
+            if (CanMergeDraws(*LastItem.pListItem, ListItem) &&
+                LastItem.StartIndex + LastItem.NumVertices == StartIndex)
+            {
+                LastItem.NumVertices += NumIndices;
+                return true;
+            }
+        }
 
         // Note that the actual attribs size may be smaller than the range, but we need
         // to check for the entire range to avoid errors.
-        if (CurrOffset + ListItem.ShaderAttribsBufferAlignedRange > AttribsBuffDesc.Size)
+        if (CurrOffset + ListItem.ShaderAttribsBufferAlignedRange > AttribsBufferSize)
         {
             // The buffer is full. Render the pending items and start filling the buffer from the beginning.
             FlushPendingDraws();
@@ -352,7 +426,7 @@ void HnRenderPass::_Execute(const pxr::HdRenderPassStateSharedPtr& RPState,
                 if (pMappedBufferData == nullptr)
                 {
                     UNEXPECTED("Failed to map the primitive attributes buffer");
-                    break;
+                    return false;
                 }
             }
             pCurrPrimitive = reinterpret_cast<Uint8*>(pMappedBufferData) + CurrOffset;
@@ -367,36 +441,47 @@ void HnRenderPass::_Execute(const pxr::HdRenderPassStateSharedPtr& RPState,
         CurrOffset += ListItem.ShaderAttribsDataAlignedSize;
 
         // Write current primitive attributes
-        float4 CustomData{
-            static_cast<float>(Mesh.GetUID()),
-            m_Params.Selection == HnRenderPassParams::SelectionType::Selected ? 1.f : 0.f,
-            0,
-            0,
-        };
-
-        const HnMesh::Attributes& MeshAttribs   = Mesh.GetAttributes();
-        const float4x4&           Transform     = ApplyTransform ? (MeshAttribs.Transform * m_RenderParams.Transform) : MeshAttribs.Transform;
-        const float4x4&           PrevTransform = ApplyTransform ? (ListItem.PrevTransform * m_RenderParams.Transform) : ListItem.PrevTransform;
-        const GLTF::Material&     MaterialData  = pMaterial->GetMaterialData();
-
-        HLSL::PBRMaterialBasicAttribs* pDstMaterialBasicAttribs = nullptr;
-
-        GLTF_PBR_Renderer::PBRPrimitiveShaderAttribsData AttribsData{
-            ListItem.PSOFlags,
-            &Transform,
-            &PrevTransform,
-            0,
-            &CustomData,
-            sizeof(CustomData),
-            &pDstMaterialBasicAttribs,
-        };
-        GLTF_PBR_Renderer::WritePBRPrimitiveShaderAttribs(pCurrPrimitive, AttribsData, State.USDRenderer.GetSettings().TextureAttribIndices, pMaterial->GetMaterialData());
+        WritePrimitiveAttribs(ListItem, State, pCurrPrimitive, InstanceIdx);
 
-        pDstMaterialBasicAttribs->BaseColorFactor = MaterialData.Attribs.BaseColorFactor * MeshAttribs.DisplayColor;
+        m_PendingDrawItems.push_back({&ListItem, StartIndex, NumIndices});
+        return true;
+    };
+
+    for (Uint32 ListItemId : m_RenderOrder)
+    {
+        DrawListItem&     ListItem  = m_DrawList[ListItemId];
+        const HnDrawItem& DrawItem  = ListItem.DrawItem;
+        const HnMaterial* pMaterial = DrawItem.GetMaterial();
+        if (pMaterial == nullptr)
+            continue;
 
-        ListItem.PrevTransform = MeshAttribs.Transform;
+        // Make sure we update all items before skipping any since we will clear the
+        // m_DrawListItemsDirtyFlags at the end of the function.
+        if (!ListItem || !DrawItem.GetVisible() || ListItem.NumInstances == 0)
+            continue;
+
+        // Only the items that were not added to the indirect draw list are rendered by the regular path
+        if (IndirectDrawsRendered && ListItem.DrawCommandIdx != ~0u)
+            continue;
+
+        if (State.RPState.GetCullingData().IsMeshCulled(DrawItem.GetMesh().GetUID()))
+            continue;
+
+        if (ListItem.ExpandInstances)
+        {
+            // Render each instance with a separate draw call
+            const Uint32 NumInstances = DrawItem.GetMesh().GetNumInstances();
 
-        m_PendingDrawItems.push_back(&ListItem);
+            bool Added = true;
+            for (Uint32 InstanceIdx = 0; InstanceIdx < NumInstances && Added; ++InstanceIdx)
+                Added = AddPendingDrawItem(ListItem, InstanceIdx);
+            if (!Added)
+                break;
+        }
+        else if (!AddPendingDrawItem(ListItem, ~0u))
+        {
+            break;
+        }
     }
     if (CurrOffset != 0)
     {
@@ -406,6 +491,464 @@ void HnRenderPass::_Execute(const pxr::HdRenderPassStateSharedPtr& RPState,
     m_DrawListItemsDirtyFlags = DRAW_LIST_ITEM_DIRTY_FLAG_NONE;
 }
 
+void HnRenderPass::WritePrimitiveAttribs(DrawListItem& ListItem, const RenderState& State, void* pDst, Uint32 InstanceIdx)
+{
+    const HnDrawItem& DrawItem  = ListItem.DrawItem;
+    const HnMesh&     Mesh      = DrawItem.GetMesh();
+    const HnMaterial* pMaterial = DrawItem.GetMaterial();
+    VERIFY_EXPR(pMaterial != nullptr);
+
+    float4 CustomData{
+        static_cast<float>(Mesh.GetUID()),
+        m_Params.Selection == HnRenderPassParams::SelectionType::Selected ? 1.f : 0.f,
+        0,
+        0,
+    };
+
+    const bool                ApplyTransform = m_RenderParams.Transform != float4x4::Identity();
+    const HnMesh::Attributes& MeshAttribs    = Mesh.GetAttributes();
+    const GLTF::Material&     MaterialData   = pMaterial->GetMaterialData();
+
+    float4x4 Transform;
+    float4x4 PrevTransform;
+    if (ListItem.PSOFlags & PBR_Renderer::PSO_FLAG_USE_INSTANCE_TRANSFORMS)
+    {
+        // Instance transforms include the mesh transform and are applied
+        // by the shader before the node matrix.
+        Transform     = m_RenderParams.Transform;
+        PrevTransform = m_RenderParams.Transform;
+    }
+    else if (InstanceIdx != ~0u)
+    {
+        VERIFY_EXPR(InstanceIdx < Mesh.GetNumInstances());
+        Transform     = Mesh.GetInstanceTransforms()[InstanceIdx];
+        PrevTransform = Mesh.GetPrevInstanceTransforms()[InstanceIdx];
+        if (ApplyTransform)
+        {
+            Transform     = Transform * m_RenderParams.Transform;
+            PrevTransform = PrevTransform * m_RenderParams.Transform;
+        }
+    }
+    else
+    {
+        Transform     = ApplyTransform ? (MeshAttribs.Transform * m_RenderParams.Transform) : MeshAttribs.Transform;
+        PrevTransform = ApplyTransform ? (ListItem.PrevTransform * m_RenderParams.Transform) : ListItem.PrevTransform;
+    }
+
+    HLSL::PBRMaterialBasicAttribs* pDstMaterialBasicAttribs = nullptr;
+
+    GLTF_PBR_Renderer::PBRPrimitiveShaderAttribsData AttribsData{
+        ListItem.PSOFlags,
+        &Transform,
+        &PrevTransform,
+        0,
+        &CustomData,
+        sizeof(CustomData),
+        &pDstMaterialBasicAttribs,
+        Mesh.GetFirstInstance(),
+    };
+    if (State.USDRenderer.GetMaterialsBuffer() != nullptr)
+    {
+        // Material attributes are read from the material buffer, so only the display color is written.
+        // If the material could not be allocated in the buffer, the first material is used.
+        const Uint32 MaterialBufferId = pMaterial->GetMaterialBufferId();
+        AttribsData.MaterialId        = MaterialBufferId != ~0u ? MaterialBufferId : 0;
+        AttribsData.BaseColorFactor   = MeshAttribs.DisplayColor;
+    }
+    GLTF_PBR_Renderer::WritePBRPrimitiveShaderAttribs(pDst, AttribsData, State.USDRenderer.GetSettings().TextureAttribIndices, MaterialData);
+
+    if (pDstMaterialBasicAttribs != nullptr)
+        pDstMaterialBasicAttribs->BaseColorFactor = MaterialData.Attribs.BaseColorFactor * MeshAttribs.DisplayColor;
+
+    ListItem.PrevTransform = MeshAttribs.Transform;
+}
+
+bool HnRenderPass::UpdateDrawCommandBounds(const DrawListItem& ListItem, HLSL::HnDrawCommand& Cmd) const
+{
+    const HnMesh::Attributes& MeshAttribs = ListItem.DrawItem.GetMesh().GetAttributes();
+    if (!MeshAttribs.HasExtent)
+    {
+        const bool Changed = (Cmd.Flags & HN_DRAW_COMMAND_FLAG_HAS_BOUNDS) != 0;
+        Cmd.Flags &= ~Uint32{HN_DRAW_COMMAND_FLAG_HAS_BOUNDS};
+        return Changed;
+    }
+
+    const bool      ApplyTransform = m_RenderParams.Transform != float4x4::Identity();
+    const float4x4& Transform      = ApplyTransform ? (MeshAttribs.Transform * m_RenderParams.Transform) : MeshAttribs.Transform;
+
+    // Transform the box center and extent to get the world-space axis-aligned box
+    const float3 Center = (MeshAttribs.ExtentMin + MeshAttribs.ExtentMax) * 0.5f;
+    const float3 Extent = (MeshAttribs.ExtentMax - MeshAttribs.ExtentMin) * 0.5f;
+
+    float3 WorldCenter = float3{Transform.m30, Transform.m31, Transform.m32};
+    float3 WorldExtent;
+    for (int c = 0; c < 3; ++c)
+    {
+        for (int r = 0; r < 3; ++r)
+        {
+            WorldCenter[c] += Center[r] * Transform[r][c];
+            WorldExtent[c] += Extent[r] * std::abs(Transform[r][c]);
+        }
+    }
+
+    const float4 BoundsMin{WorldCenter - WorldExtent, 1};
+    const float4 BoundsMax{WorldCenter + WorldExtent, 1};
+    const Uint32 Flags = Cmd.Flags | HN_DRAW_COMMAND_FLAG_HAS_BOUNDS;
+    if (Cmd.BoundsMin == BoundsMin && Cmd.BoundsMax == BoundsMax && Cmd.Flags == Flags)
+        return false;
+
+    Cmd.BoundsMin = BoundsMin;
+    Cmd.BoundsMax = BoundsMax;
+    Cmd.Flags     = Flags;
+    return true;
+}
+
+HnRenderPass::IndirectDrawStatus HnRenderPass::RenderIndirect(RenderState& State)
+{
+    const HnCullingData& CullingData = State.RPState.GetCullingData();
+    // Fall back to the pipeline without culling if the culling pipeline could not be created
+    const bool GPUCulling = CullingData.IsGPUCullingEnabled() && State.RenderDelegate.GetBuildIndirectDrawArgsPSO(true) != nullptr;
+
+    IPipelineState* pBuildDrawArgsPSO = State.RenderDelegate.GetBuildIndirectDrawArgsPSO(GPUCulling);
+    if (pBuildDrawArgsPSO == nullptr)
+        return IndirectDrawStatus::Unavailable;
+
+    if (m_IndirectDrawListDirty)
+    {
+        m_IndirectDrawListDirty = false;
+        if (!UpdateIndirectDrawList(State))
+        {
+            m_IndirectBatches.clear();
+            m_IndirectDrawItems.clear();
+        }
+    }
+    if (m_AttribsRegionOffset == ~0u)
+    {
+        // The persistent primitive attributes region could not be allocated
+        VERIFY_EXPR(m_IndirectBatches.empty() && m_IndirectDrawItems.empty());
+        return IndirectDrawStatus::Unavailable;
+    }
+    if (m_IndirectBatches.empty())
+    {
+        VERIFY_EXPR(m_IndirectDrawItems.empty());
+        return IndirectDrawStatus::Empty;
+    }
+
+    // Update visibility and LODs
+    for (size_t CmdIdx = 0; CmdIdx < m_IndirectDrawItems.size(); ++CmdIdx)
+    {
+        const DrawListItem&  ListItem = m_DrawList[m_IndirectDrawItems[CmdIdx]];
+        HLSL::HnDrawCommand& Cmd      = m_DrawCommands[CmdIdx];
+
+        Uint32 StartIndex = 0;
+        Uint32 NumIndices = 0;
+        SelectLOD(ListItem, State, StartIndex, NumIndices);
+
+        const Uint32 Flags = (Cmd.Flags & ~Uint32{HN_DRAW_COMMAND_FLAG_VISIBLE}) | (ListItem.DrawItem.GetVisible() ? HN_DRAW_COMMAND_FLAG_VISIBLE : 0u);
+        if (Cmd.Flags != Flags || Cmd.StartIndex != StartIndex || Cmd.NumIndices != NumIndices)
+        {
+            Cmd.Flags           = Flags;
+            Cmd.StartIndex      = StartIndex;
+            Cmd.NumIndices      = NumIndices;
+            m_DrawCommandsDirty = true;
+        }
+    }
+
+    UpdateIndirectPrimitiveAttribs(State);
+
+    if (pBuildDrawArgsPSO != m_BuildDrawArgsPSO)
+    {
+        // Culling was enabled or disabled: all arguments must be recomputed
+        m_DrawCommandsDirty = true;
+    }
+
+    // With GPU culling, the arguments depend on the camera and the depth hierarchy,
+    // so they are recomputed every frame.
+    if (m_DrawCommandsDirty || GPUCulling)
+    {
+        UpdateIndirectDrawCommandsBuffer(State, pBuildDrawArgsPSO);
+        if (!m_BuildDrawArgsSRB)
+            return IndirectDrawStatus::Unavailable;
+
+        if (GPUCulling)
+        {
+            ShaderResourceVariableX{m_BuildDrawArgsSRB, SHADER_TYPE_COMPUTE, "cbCullingAttribs"}.Set(CullingData.pCullingAttribsCB);
+            ShaderResourceVariableX{m_BuildDrawArgsSRB, SHADER_TYPE_COMPUTE, "g_DepthHierarchy"}.Set(CullingData.pDepthHierarchySRV);
+        }
+
+        // Note that the pass has not set any pipeline state yet, so the
+        // cached state in the render state remains valid.
+        State.pCtx->SetPipelineState(pBuildDrawArgsPSO);
+        State.pCtx->CommitShaderResources(m_BuildDrawArgsSRB, RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
+        State.pCtx->DispatchCompute({static_cast<Uint32>(m_DrawCommands.size()) / HN_INDIRECT_DRAW_THREAD_GROUP_SIZE, 1, 1});
+
+        m_DrawCommandsDirty = false;
+    }
+
+    constexpr Uint32 DrawArgsStride = sizeof(Uint32) * 5;
+    for (const IndirectDrawBatch& Batch : m_IndirectBatches)
+    {
+        const DrawListItem& ListItem = m_DrawList[Batch.FirstListItem];
+
+        State.SetPipelineState(ListItem.pPSO);
+
+        IShaderResourceBinding* pSRB = ListItem.DrawItem.GetMaterial()->GetSRB(m_AttribsRegionOffset + Batch.AttribsOffset);
+        VERIFY(pSRB != nullptr, "Material SRB is null. This may happen if UpdateSRB was not called for this material.");
+        State.CommitShaderResources(pSRB);
+
+        VERIFY(ListItem.IndexBuffer != nullptr, "Non-indexed items must be rendered by the regular path");
+        State.SetIndexBuffer(ListItem.IndexBuffer);
+        State.SetVertexBuffers(ListItem.VertexBuffers.data(), ListItem.NumVertexBuffers);
+
+        DrawIndexedIndirectAttribs DrawAttribs;
+        DrawAttribs.pAttribsBuffer                   = m_DrawArgsBuffer;
+        DrawAttribs.DrawArgsOffset                   = Uint64{Batch.FirstCommand} * DrawArgsStride;
+        DrawAttribs.DrawArgsStride                   = DrawArgsStride;
+        DrawAttribs.DrawCount                        = Batch.NumCommands;
+        DrawAttribs.IndexType                        = VT_UINT32;
+        DrawAttribs.Flags                            = DRAW_FLAG_VERIFY_ALL;
+        DrawAttribs.AttribsBufferStateTransitionMode = RESOURCE_STATE_TRANSITION_MODE_TRANSITION;
+        State.pCtx->DrawIndexedIndirect(DrawAttribs);
+    }
+
+    return IndirectDrawStatus::Rendered;
+}
+
+bool HnRenderPass::UpdateIndirectDrawList(RenderState& State)
+{
+    // The render order is sorted by PSO, material SRB and geometry buffers (see SortDrawList()),
+    // so the items that can be rendered by a single indirect draw call are adjacent.
+
+    const Uint32 PrimitiveArraySize = State.USDRenderer.GetSettings().PrimitiveArraySize;
+    VERIFY_EXPR(PrimitiveArraySize > 0);
+
+    m_IndirectBatches.clear();
+    m_IndirectDrawItems.clear();
+    m_DrawCommands.clear();
+
+    Uint32 AttribsSize = 0;
+    for (Uint32 ListItemId : m_RenderOrder)
+    {
+        DrawListItem& ListItem = m_DrawList[ListItemId];
+
+        ListItem.DrawCommandIdx = ~0u;
+        // Instances of instanced meshes and non-indexed items (which are rare) are rendered
+        // by the regular path. They are not culled on the GPU, but the regular path still
+        // applies the CPU frustum culling results.
+        if (!ListItem || ListItem.DrawItem.GetMaterial() == nullptr || ListItem.ExpandInstances || ListItem.IndexBuffer == nullptr)
+            continue;
+
+        IndirectDrawBatch* pBatch = !m_IndirectBatches.empty() ? &m_IndirectBatches.back() : nullptr;
+        if (pBatch != nullptr)
+        {
+            const DrawListItem& FirstItem = m_DrawList[pBatch->FirstListItem];
+            if (pBatch->NumCommands >= PrimitiveArraySize ||
+                FirstItem.pPSO != ListItem.pPSO ||
+                FirstItem.DrawItem.GetMaterial() != ListItem.DrawItem.GetMaterial() ||
+                FirstItem.IndexBuffer != ListItem.IndexBuffer ||
+                FirstItem.VertexBuffers != ListItem.VertexBuffers ||
+                FirstItem.NumVertexBuffers != ListItem.NumVertexBuffers)
+            {
+                pBatch = nullptr;
+            }
+        }
+
+        if (pBatch == nullptr)
+        {
+            IndirectDrawBatch Batch;
+            Batch.FirstListItem = ListItemId;
+            Batch.FirstCommand  = static_cast<Uint32>(m_DrawCommands.size());
+            // Each primitive attributes array must start at the properly aligned offset
+            Batch.AttribsOffset = AlignUp(AttribsSize, State.ConstantBufferOffsetAlignment);
+            // All items in the batch use the same PSO and thus the same attributes size
+            Batch.AttribsStride = State.USDRenderer.GetPBRPrimitiveAttribsSize(ListItem.PSOFlags);
+            m_IndirectBatches.push_back(Batch);
+            pBatch = &m_IndirectBatches.back();
+        }
+
+        ListItem.DrawCommandIdx = static_cast<Uint32>(m_DrawCommands.size());
+        ListItem.AttribsOffset  = pBatch->AttribsOffset + pBatch->NumCommands * pBatch->AttribsStride;
+        ListItem.AttribsDirty   = true;
+
+        HLSL::HnDrawCommand Cmd;
+        Cmd.NumIndices    = ListItem.NumVertices;
+        Cmd.StartIndex    = ListItem.StartIndex;
+        Cmd.FirstInstance = pBatch->NumCommands;
+        Cmd.Flags         = ListItem.DrawItem.GetVisible() ? HN_DRAW_COMMAND_FLAG_VISIBLE : 0u;
+        m_DrawCommands.push_back(Cmd);
+        m_IndirectDrawItems.push_back(ListItemId);
+
+        ++pBatch->NumCommands;
+        AttribsSize = ListItem.AttribsOffset + pBatch->AttribsStride;
+    }
+
+    // Pad the commands to the thread group size with empty commands
+    m_DrawCommands.resize(AlignUp(m_DrawCommands.size(), size_t{HN_INDIRECT_DRAW_THREAD_GROUP_SIZE}), HLSL::HnDrawCommand{});
+    m_DrawCommandsDirty = true;
+
+    AttribsSize = AlignUp(AttribsSize, State.ConstantBufferOffsetAlignment);
+    if (AttribsSize > m_AttribsRegionSize || m_AttribsRegionOffset == ~0u)
+    {
+        HnRenderDelegate* pRenderDelegate = static_cast<HnRenderDelegate*>(GetRenderIndex()->GetRenderDelegate());
+        if (m_AttribsRegionOffset != ~0u)
+        {
+            pRenderDelegate->FreePrimitiveAttribs(m_AttribsRegionOffset, m_AttribsRegionSize);
+            m_AttribsRegionOffset = ~0u;
+            m_AttribsRegionSize   = 0;
+        }
+
+        // Reserve some space to avoid reallocating the region every time an item is added.
+        const Uint32 RegionSize = AlignUp(std::max(AttribsSize + AttribsSize / 4, State.ConstantBufferOffsetAlignment), State.ConstantBufferOffsetAlignment);
+        const Uint32 Offset     = pRenderDelegate->AllocatePrimitiveAttribs(RegionSize);
+        if (Offset == ~0u)
+        {
+            LOG_WARNING_MESSAGE("Failed to allocate ", RegionSize, " bytes for the persistent primitive attributes of render pass '",
+                                m_MaterialTag.GetString(), "'. Increase IndirectPrimitiveAttribsBufferSize. The pass will use regular draw calls.");
+            return false;
+        }
+        m_AttribsRegionOffset = Offset;
+        m_AttribsRegionSize   = RegionSize;
+    }
+    m_IndirectAttribsData.resize(m_AttribsRegionSize);
+
+    return true;
+}
+
+void HnRenderPass::UpdateIndirectDrawCommandsBuffer(RenderState& State, IPipelineState* pBuildDrawArgsPSO)
+{
+    const Uint32 NumCommands = static_cast<Uint32>(m_DrawCommands.size());
+    VERIFY_EXPR(NumCommands % HN_INDIRECT_DRAW_THREAD_GROUP_SIZE == 0);
+
+    if (!m_DrawCommandsBuffer || m_DrawCommandsBuffer->GetDesc().Size < sizeof(HLSL::HnDrawCommand) * NumCommands)
+    {
+        m_DrawCommandsBuffer.Release();
+        m_DrawArgsBuffer.Release();
+        m_DrawArgsUAV.Release();
+        m_BuildDrawArgsSRB.Release();
+
+        IRenderDevice* pDevice = State.RenderDelegate.GetDevice();
+
+        BufferDesc CmdBuffDesc;
+        CmdBuffDesc.Name              = "Hydrogent draw commands";
+        CmdBuffDesc.Size              = sizeof(HLSL::HnDrawCommand) * NumCommands;
+        CmdBuffDesc.BindFlags         = BIND_SHADER_RESOURCE;
+        CmdBuffDesc.Usage             = USAGE_DEFAULT;
+        CmdBuffDesc.Mode              = BUFFER_MODE_STRUCTURED;
+        CmdBuffDesc.ElementByteStride = sizeof(HLSL::HnDrawCommand);
+        pDevice->CreateBuffer(CmdBuffDesc, nullptr, &m_DrawCommandsBuffer);
+        if (!m_DrawCommandsBuffer)
+        {
+            UNEXPECTED("Failed to create draw commands buffer");
+            return;
+        }
+
+        BufferDesc ArgsBuffDesc;
+        ArgsBuffDesc.Name              = "Hydrogent indirect draw args";
+        ArgsBuffDesc.Size              = sizeof(Uint32) * 5 * NumCommands;
+        ArgsBuffDesc.BindFlags         = BIND_UNORDERED_ACCESS | BIND_INDIRECT_DRAW_ARGS;
+        ArgsBuffDesc.Usage             = USAGE_DEFAULT;
+        ArgsBuffDesc.Mode              = BUFFER_MODE_FORMATTED;
+        ArgsBuffDesc.ElementByteStride = sizeof(Uint32);
+        pDevice->CreateBuffer(ArgsBuffDesc, nullptr, &m_DrawArgsBuffer);
+        if (!m_DrawArgsBuffer)
+        {
+            UNEXPECTED("Failed to create indirect draw args buffer");
+            return;
+        }
+
+        BufferViewDesc UAVDesc;
+        UAVDesc.ViewType             = BUFFER_VIEW_UNORDERED_ACCESS;
+        UAVDesc.Format.ValueType     = VT_UINT32;
+        UAVDesc.Format.NumComponents = 1;
+        m_DrawArgsBuffer->CreateView(UAVDesc, &m_DrawArgsUAV);
+        VERIFY_EXPR(m_DrawArgsUAV);
+
+        // Commands must be uploaded to the new buffer
+        m_DrawCommandsDirty = true;
+    }
+
+    if (!m_BuildDrawArgsSRB || m_BuildDrawArgsPSO != pBuildDrawArgsPSO)
+    {
+        m_BuildDrawArgsSRB.Release();
+        m_BuildDrawArgsPSO = nullptr;
+
+        pBuildDrawArgsPSO->CreateShaderResourceBinding(&m_BuildDrawArgsSRB, true);
+        VERIFY_EXPR(m_BuildDrawArgsSRB);
+        ShaderResourceVariableX{m_BuildDrawArgsSRB, SHADER_TYPE_COMPUTE, "g_DrawCommands"}.Set(m_DrawCommandsBuffer->GetDefaultView(BUFFER_VIEW_SHADER_RESOURCE));
+        ShaderResourceVariableX{m_BuildDrawArgsSRB, SHADER_TYPE_COMPUTE, "g_DrawArgs"}.Set(m_DrawArgsUAV);
+        m_BuildDrawArgsPSO = pBuildDrawArgsPSO;
+    }
+
+    if (m_DrawCommandsDirty)
+    {
+        State.pCtx->UpdateBuffer(m_DrawCommandsBuffer, 0, sizeof(HLSL::HnDrawCommand) * NumCommands, m_DrawCommands.data(), RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
+    }
+}
+
+void HnRenderPass::UpdateIndirectPrimitiveAttribs(RenderState& State)
+{
+    IBuffer* const pPrimitiveAttribsCB = State.RenderDelegate.GetPrimitiveAttribsCB();
+    VERIFY_EXPR(pPrimitiveAttribsCB->GetDesc().Usage == USAGE_DEFAULT);
+
+    // Upload contiguous ranges of modified batches
+    Uint32 DirtyRangeStart = ~0u;
+    Uint32 DirtyRangeEnd   = 0;
+
+    auto FlushDirtyRange = [&]() {
+        if (DirtyRangeStart >= DirtyRangeEnd)
+            return;
+
+        State.pCtx->UpdateBuffer(pPrimitiveAttribsCB, m_AttribsRegionOffset + DirtyRangeStart, DirtyRangeEnd - DirtyRangeStart,
+                                 &m_IndirectAttribsData[DirtyRangeStart], RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
+        DirtyRangeStart = ~0u;
+        DirtyRangeEnd   = 0;
+    };
+
+    for (const IndirectDrawBatch& Batch : m_IndirectBatches)
+    {
+        bool BatchDirty = false;
+        for (Uint32 CmdIdx = Batch.FirstCommand; CmdIdx < Batch.FirstCommand + Batch.NumCommands; ++CmdIdx)
+        {
+            DrawListItem&     ListItem  = m_DrawList[m_IndirectDrawItems[CmdIdx]];
+            const HnMaterial* pMaterial = ListItem.DrawItem.GetMaterial();
+
+            if (!m_IndirectAttribsDirty &&
+                !ListItem.AttribsDirty &&
+                ListItem.MaterialVersion == pMaterial->GetVersion() &&
+                ListItem.PrevTransform == ListItem.DrawItem.GetMesh().GetAttributes().Transform)
+                continue;
+
+            // If the mesh has moved, the record will contain different current and previous
+            // transforms, so it must be rewritten once more after the mesh stops.
+            const bool Moved = ListItem.PrevTransform != ListItem.DrawItem.GetMesh().GetAttributes().Transform;
+
+            VERIFY_EXPR(ListItem.AttribsOffset + Batch.AttribsStride <= m_IndirectAttribsData.size());
+            WritePrimitiveAttribs(ListItem, State, &m_IndirectAttribsData[ListItem.AttribsOffset]);
+            ListItem.MaterialVersion = pMaterial->GetVersion();
+            ListItem.AttribsDirty    = Moved;
+
+            // The bounds are updated whenever the transform or the mesh changes
+            if (UpdateDrawCommandBounds(ListItem, m_DrawCommands[CmdIdx]))
+                m_DrawCommandsDirty = true;
+
+            BatchDirty = true;
+        }
+
+        if (BatchDirty)
+        {
+            DirtyRangeStart = std::min(DirtyRangeStart, Batch.AttribsOffset);
+            DirtyRangeEnd   = Batch.AttribsOffset + Batch.NumCommands * Batch.AttribsStride;
+        }
+        else
+        {
+            FlushDirtyRange();
+        }
+    }
+    FlushDirtyRange();
+
+    m_IndirectAttribsDirty = false;
+}
+
 void HnRenderPass::_MarkCollectionDirty()
 {
     // Force any cached data based on collection to be refreshed.
@@ -414,6 +957,9 @@ void HnRenderPass::_MarkCollectionDirty()
 
 void HnRenderPass::SetMeshRenderParams(const HnMeshRenderParams& Params)
 {
+    if (m_RenderParams.Transform != Params.Transform)
+        m_IndirectAttribsDirty = true;
+
     m_RenderParams = Params;
 }
 
@@ -421,6 +967,8 @@ void HnRenderPass::SetParams(const HnRenderPassParams& Params)
 {
     if (m_Params.UsdPsoFlags != Params.UsdPsoFlags)
         m_DrawListItemsDirtyFlags |= DRAW_LIST_ITEM_DIRTY_FLAG_PSO;
+    if (m_Params.Selection != Params.Selection)
+        m_IndirectAttribsDirty = true;
 
     m_Params = Params;
 }
@@ -493,7 +1041,15 @@ void HnRenderPass::UpdateDrawList(const pxr::TfTokenVector& RenderTags)
 
     if (UpdateDrawList)
     {
-        m_DrawList.clear();
+        // Both the draw items and the draw list are sorted by the draw item address, so the items
+        // that are present in both lists are found in a single pass and keep their cached GPU
+        // resources. Only new items are fully updated.
+        // Note that the draw items of the previous list may have been destroyed, so they must not be dereferenced.
+        std::vector<DrawListItem> PrevDrawList;
+        PrevDrawList.swap(m_DrawList);
+        m_DrawList.reserve(m_DrawItems.size());
+
+        size_t PrevItemIdx = 0;
         for (const pxr::HdDrawItem* pDrawItem : m_DrawItems)
         {
             if (pDrawItem == nullptr)
@@ -510,12 +1066,32 @@ void HnRenderPass::UpdateDrawList(const pxr::TfTokenVector& RenderTags)
                 (m_Params.Selection == HnRenderPassParams::SelectionType::Unselected && !IsSelected))
             {
                 const HnDrawItem& DrawItem = static_cast<const HnDrawItem&>(*pDrawItem);
-                if (DrawItem.IsValid())
+                if (!DrawItem.IsValid())
+                    continue;
+
+                while (PrevItemIdx < PrevDrawList.size() && &PrevDrawList[PrevItemIdx].DrawItem < &DrawItem)
+                    ++PrevItemIdx;
+
+                // The address of a destroyed draw item may be reused by a new one, so the mesh UID must also match.
+                if (PrevItemIdx < PrevDrawList.size() &&
+                    &PrevDrawList[PrevItemIdx].DrawItem == &DrawItem &&
+                    PrevDrawList[PrevItemIdx].MeshUID == DrawItem.GetMesh().GetUID())
+                {
+                    m_DrawList.push_back(PrevDrawList[PrevItemIdx++]);
+                }
+                else
+                {
                     m_DrawList.push_back(DrawListItem{DrawItem});
+                }
             }
         }
 
-        m_DrawListItemsDirtyFlags = DRAW_LIST_ITEM_DIRTY_FLAG_ALL;
+        if (MaterialTagChanged)
+        {
+            // Alpha mode is derived from the material tag, so all PSOs need to be updated
+            m_DrawListItemsDirtyFlags = DRAW_LIST_ITEM_DIRTY_FLAG_ALL;
+        }
+        m_RenderOrderDirty = true;
     }
 
     m_CollectionVersion          = CollectionVersion;
@@ -595,6 +1171,22 @@ void HnRenderPass::UpdateDrawListItemGPUResources(DrawListItem& ListItem, Render
         const HnMesh& Mesh          = DrawItem.GetMesh();
         const bool    IsDoubleSided = Mesh.GetAttributes().IsDoubleSided;
 
+        ListItem.NumInstances    = 1;
+        ListItem.ExpandInstances = false;
+        if (Mesh.IsInstanced())
+        {
+            if (Mesh.GetFirstInstance() != ~0u)
+            {
+                // All instances are rendered by a single instanced draw call
+                PSOFlags |= PBR_Renderer::PSO_FLAG_USE_INSTANCE_TRANSFORMS;
+                ListItem.NumInstances = Mesh.GetNumInstances();
+            }
+            else
+            {
+                ListItem.ExpandInstances = true;
+            }
+        }
+
         // Use the material's texture indexing ID as the user value in the PSO key.
         // The USD renderer will use this ID to return the indexing.
         const auto ShaderTextureIndexingId = pMaterial->GetStaticShaderTextureIndexingId();
@@ -614,6 +1206,8 @@ void HnRenderPass::UpdateDrawListItemGPUResources(DrawListItem& ListItem, Render
                 if (m_Params.UsdPsoFlags & USD_Renderer::USD_PSO_FLAG_ENABLE_COLOR_OUTPUT)
                 {
                     PSOFlags |= MaterialPSOFlags | PBR_Renderer::PSO_FLAG_USE_IBL;
+                    if (State.USDRenderer.GetLightClustersBuffer() != nullptr)
+                        PSOFlags |= PBR_Renderer::PSO_FLAG_USE_LIGHT_CLUSTERS;
                 }
                 else
                 {
@@ -629,7 +1223,17 @@ void HnRenderPass::UpdateDrawListItemGPUResources(DrawListItem& ListItem, Render
             if (State.RenderParam.GetTextureBindingMode() == HN_MATERIAL_TEXTURES_BINDING_MODE_ATLAS)
                 PSOFlags |= PBR_Renderer::PSO_FLAG_USE_TEXTURE_ATLAS;
 
-            ListItem.pPSO = PsoCache.Get({PSOFlags, static_cast<PBR_Renderer::ALPHA_MODE>(State.AlphaMode), IsDoubleSided, m_DebugView, ShaderTextureIndexingId}, true);
+            // If the PSO is not ready yet, the fallback PSO with the reduced set of flags
+            // is used until the PSO is created in the renderer's thread pool.
+            const PBR_Renderer::PSOKey Key{PSOFlags, static_cast<PBR_Renderer::ALPHA_MODE>(State.AlphaMode), IsDoubleSided, m_DebugView, ShaderTextureIndexingId};
+            PBR_Renderer::PSOKey       UsedKey;
+            ListItem.pPSO = PsoCache.GetAsync(Key, UsedKey);
+            if (UsedKey != Key)
+            {
+                // Primitive attributes must be written using the flags of the fallback PSO
+                PSOFlags           = UsedKey.GetFlags();
+                m_UsesFallbackPSOs = true;
+            }
         }
         else if (m_RenderMode == HN_RENDER_MODE_MESH_EDGES ||
                  m_RenderMode == HN_RENDER_MODE_POINTS)
@@ -701,9 +1305,9 @@ void HnRenderPass::UpdateDrawListItemGPUResources(DrawListItem& ListItem, Render
 void HnRenderPass::RenderPendingDrawItems(RenderState& State)
 {
     Uint32 BufferOffset = 0;
-    for (size_t i = 0; i < m_PendingDrawItems.size(); ++i)
+    for (const PendingDrawItem& PendingItem : m_PendingDrawItems)
     {
-        const DrawListItem& ListItem = *m_PendingDrawItems[i];
+        const DrawListItem& ListItem = *PendingItem.pListItem;
         const HnDrawItem&   DrawItem = ListItem.DrawItem;
 
         State.SetPipelineState(ListItem.pPSO);
@@ -719,12 +1323,11 @@ void HnRenderPass::RenderPendingDrawItems(RenderState& State)
 
         if (ListItem.IndexBuffer != nullptr)
         {
-            constexpr Uint32 NumInstances = 1;
-            State.pCtx->DrawIndexed({ListItem.NumVertices, VT_UINT32, DRAW_FLAG_VERIFY_ALL, NumInstances, ListItem.StartIndex});
+            State.pCtx->DrawIndexed({PendingItem.NumVertices, VT_UINT32, DRAW_FLAG_VERIFY_ALL, ListItem.NumInstances, PendingItem.StartIndex});
         }
         else
         {
-            State.pCtx->Draw({ListItem.NumVertices, DRAW_FLAG_VERIFY_ALL});
+            State.pCtx->Draw({PendingItem.NumVertices, DRAW_FLAG_VERIFY_ALL, ListItem.NumInstances});
         }
 
         BufferOffset += ListItem.ShaderAttribsDataAlignedSize;
@@ -733,6 +1336,184 @@ void HnRenderPass::RenderPendingDrawItems(RenderState& State)
     m_PendingDrawItems.clear();
 }
 
+void HnRenderPass::SelectLOD(const DrawListItem& ListItem, const RenderState& State, Uint32& StartIndex, Uint32& NumIndices) const
+{
+    StartIndex = ListItem.StartIndex;
+    NumIndices = ListItem.NumVertices;
+
+    if (m_RenderMode != HN_RENDER_MODE_SOLID)
+        return;
+
+    // Instances of an instanced mesh may be at different distances from the camera,
+    // so they are always rendered at full resolution.
+    const HnMesh&                       Mesh = ListItem.DrawItem.GetMesh();
+    const std::vector<HnMesh::FaceLOD>& LODs = Mesh.GetFaceLODs();
+    if (LODs.empty() || Mesh.IsInstanced())
+        return;
+
+    // Only the items that draw all faces of the mesh can use the LODs.
+    // Geometry subsets draw their own ranges of the face index buffer.
+    if (ListItem.IndexBuffer != Mesh.GetFaceIndexBuffer() ||
+        ListItem.StartIndex != Mesh.GetFaceStartIndex() ||
+        ListItem.NumVertices != Mesh.GetNumFaceTriangles() * 3)
+        return;
+
+    const HnLODSelectionData& LODSelection = State.RPState.GetLODSelectionData();
+    const HnMesh::Attributes& MeshAttribs  = Mesh.GetAttributes();
+    if (LODSelection.ViewportHeight <= 0 || !MeshAttribs.HasExtent)
+        return;
+
+    const bool      ApplyTransform = m_RenderParams.Transform != float4x4::Identity();
+    const float4x4& Transform      = ApplyTransform ? (MeshAttribs.Transform * m_RenderParams.Transform) : MeshAttribs.Transform;
+
+    // World-space bounding sphere of the mesh
+    const float3 Center = (MeshAttribs.ExtentMin + MeshAttribs.ExtentMax) * 0.5f;
+    float3       WorldCenter{Transform.m30, Transform.m31, Transform.m32};
+    float        Scale = 0;
+    for (int r = 0; r < 3; ++r)
+    {
+        const float3 Axis{Transform[r][0], Transform[r][1], Transform[r][2]};
+        WorldCenter += Axis * Center[r];
+        Scale = std::max(Scale, length(Axis));
+    }
+    const float Radius = length(MeshAttribs.ExtentMax - MeshAttribs.ExtentMin) * 0.5f * Scale;
+
+    // Clip-space W of the sphere point that is closest to the camera
+    const float4x4& ViewProj = LODSelection.ViewProj;
+    const float3    WAxis{ViewProj.m03, ViewProj.m13, ViewProj.m23};
+    const float     MinW = dot(WorldCenter, WAxis) + ViewProj.m33 - Radius * length(WAxis);
+    if (MinW <= 1e-6f)
+    {
+        // The camera is inside the bounding sphere
+        return;
+    }
+
+    // The number of pixels covered by a unit of the object-space error at the closest point
+    const float3 YAxis{ViewProj.m01, ViewProj.m11, ViewProj.m21};
+    const float  PixelsPerUnit = Scale * length(YAxis) * LODSelection.ViewportHeight * 0.5f / MinW;
+
+    // The LODs are ordered by increasing error, so select the coarsest acceptable one
+    const float ErrorThreshold = State.RenderDelegate.GetMeshLODErrorThreshold();
+    for (auto it = LODs.rbegin(); it != LODs.rend(); ++it)
+    {
+        if (it->Error * PixelsPerUnit <= ErrorThreshold)
+        {
+            StartIndex = it->StartIndex;
+            NumIndices = it->NumIndices;
+            break;
+        }
+    }
+}
+
+bool HnRenderPass::CanMergeDraws(const DrawListItem& Item0, const DrawListItem& Item1)
+{
+    // Items of the same mesh with the same material have identical primitive attributes
+    return (&Item0.DrawItem.GetMesh() == &Item1.DrawItem.GetMesh() &&
+            Item0.DrawItem.GetMaterial() == Item1.DrawItem.GetMaterial() &&
+            Item0.pPSO == Item1.pPSO &&
+            Item0.IndexBuffer != nullptr &&
+            Item0.IndexBuffer == Item1.IndexBuffer &&
+            Item0.VertexBuffers == Item1.VertexBuffers &&
+            Item0.NumVertexBuffers == Item1.NumVertexBuffers &&
+            Item0.NumInstances == Item1.NumInstances &&
+            !Item0.ExpandInstances &&
+            !Item1.ExpandInstances);
+}
+
+void HnRenderPass::SortDrawList()
+{
+    if (m_RenderOrder.size() != m_DrawList.size())
+    {
+        m_RenderOrder.resize(m_DrawList.size());
+        for (Uint32 i = 0; i < m_RenderOrder.size(); ++i)
+            m_RenderOrder[i] = i;
+    }
+
+    // Pointers are replaced with dense IDs so that all bindings fit into the 64-bit key.
+    // IDs that do not fit into their bit fields are clamped, which only makes the order less optimal.
+    struct DenseIdMap
+    {
+        std::unordered_map<const void*, Uint64> Ids;
+
+        Uint64 Get(const void* Ptr, Uint32 NumBits)
+        {
+            const Uint64 Id = Ids.emplace(Ptr, Ids.size()).first->second;
+            return std::min(Id, (Uint64{1} << NumBits) - 1);
+        }
+    };
+    DenseIdMap PSOIds, SRBIds, VertexPageIds, IndexBufferIds, MeshIds;
+
+    constexpr Uint32 PSOBits         = 12;
+    constexpr Uint32 SRBBits         = 16;
+    constexpr Uint32 VertexPageBits  = 12;
+    constexpr Uint32 IndexBufferBits = 8;
+    constexpr Uint32 MeshBits        = 16;
+    static_assert(PSOBits + SRBBits + VertexPageBits + IndexBufferBits + MeshBits == 64, "Sort key bits must add up to 64");
+
+    for (DrawListItem& ListItem : m_DrawList)
+    {
+        const HnMaterial* pMaterial = ListItem.DrawItem.GetMaterial();
+        // All vertex buffers of a mesh are allocated from the same vertex pool page,
+        // so the positions buffer identifies the page.
+        ListItem.SortKey = PSOIds.Get(ListItem.pPSO, PSOBits);
+        ListItem.SortKey = (ListItem.SortKey << SRBBits) | SRBIds.Get(pMaterial != nullptr ? pMaterial->GetSRB() : nullptr, SRBBits);
+        ListItem.SortKey = (ListItem.SortKey << VertexPageBits) | VertexPageIds.Get(ListItem.VertexBuffers[0], VertexPageBits);
+        ListItem.SortKey = (ListItem.SortKey << IndexBufferBits) | IndexBufferIds.Get(ListItem.IndexBuffer, IndexBufferBits);
+        ListItem.SortKey = (ListItem.SortKey << MeshBits) | MeshIds.Get(&ListItem.DrawItem.GetMesh(), MeshBits);
+    }
+
+    // Items with the same key are sorted by the start index, so that adjacent
+    // index ranges of the same mesh can be merged into a single draw.
+    std::sort(m_RenderOrder.begin(), m_RenderOrder.end(),
+              [this](Uint32 i0, Uint32 i1) {
+                  const DrawListItem& Item0 = m_DrawList[i0];
+                  const DrawListItem& Item1 = m_DrawList[i1];
+                  if (Item0.SortKey != Item1.SortKey)
+                      return Item0.SortKey < Item1.SortKey;
+                  return Item0.StartIndex < Item1.StartIndex;
+              });
+
+    m_DrawListStats.Unsorted = CountStateChanges(/*MergeDraws = */ false);
+    m_DrawListStats.Sorted   = CountStateChanges(/*MergeDraws = */ true);
+}
+
+HnRenderPass::DrawListStats::StateChanges HnRenderPass::CountStateChanges(bool MergeDraws) const
+{
+    DrawListStats::StateChanges Changes;
+
+    const DrawListItem* pPrevItem      = nullptr;
+    Uint32              PrevIndicesEnd = 0;
+    for (size_t i = 0; i < m_DrawList.size(); ++i)
+    {
+        // Merged draws are only counted for the sorted order
+        const DrawListItem& ListItem  = m_DrawList[MergeDraws ? m_RenderOrder[i] : i];
+        const HnMaterial*   pMaterial = ListItem.DrawItem.GetMaterial();
+        if (!ListItem || pMaterial == nullptr)
+            continue;
+
+        if (pPrevItem != nullptr && MergeDraws && CanMergeDraws(*pPrevItem, ListItem) && PrevIndicesEnd == ListItem.StartIndex)
+        {
+            PrevIndicesEnd += ListItem.NumVertices;
+            continue;
+        }
+
+        if (pPrevItem == nullptr || pPrevItem->pPSO != ListItem.pPSO)
+            ++Changes.PSO;
+        if (pPrevItem == nullptr || pPrevItem->DrawItem.GetMaterial()->GetSRB() != pMaterial->GetSRB())
+            ++Changes.SRB;
+        if (ListItem.IndexBuffer != nullptr && (pPrevItem == nullptr || pPrevItem->IndexBuffer != ListItem.IndexBuffer))
+            ++Changes.IndexBuffer;
+        if (pPrevItem == nullptr || pPrevItem->VertexBuffers != ListItem.VertexBuffers)
+            ++Changes.VertexBuffers;
+        Changes.Draws += ListItem.ExpandInstances ? ListItem.DrawItem.GetMesh().GetNumInstances() : 1;
+
+        pPrevItem      = &ListItem;
+        PrevIndicesEnd = ListItem.StartIndex + ListItem.NumVertices;
+    }
+
+    return Changes;
+}
+
 } // namespace USD
 
 } // namespace Diligent
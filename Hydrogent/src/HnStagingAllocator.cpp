@@ -0,0 +1,122 @@
+/*
+ *  Copyright 2024 Diligent Graphics LLC
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+
+#include "HnStagingAllocator.hpp"
+
+#include <atomic>
+
+namespace Diligent
+{
+
+namespace USD
+{
+
+// Allocations larger than the block size get their own blocks.
+static constexpr Uint32 StagingArenaBlockSize = 1u << 20u;
+
+// Arenas that grew larger than this size during the last sync release their memory
+// on reset, so that loading a very large mesh does not pin the memory forever.
+static constexpr size_t MaxRetainedArenaSize = size_t{64} << 20u;
+
+// Generations are unique across all allocators, so that a cached arena pointer is never used
+// with another allocator, even if it is created at the address of a destroyed one.
+static Uint64 GetNextStagingArenaGeneration()
+{
+    static std::atomic<Uint64> Generation{0};
+    return ++Generation;
+}
+
+HnStagingAllocator::HnStagingAllocator(IMemoryAllocator& RawAllocator) :
+    m_RawAllocator{RawAllocator},
+    m_Generation{GetNextStagingArenaGeneration()}
+{
+}
+
+HnStagingAllocator::~HnStagingAllocator()
+{
+}
+
+HnStagingAllocator::Arena& HnStagingAllocator::GetThreadArena()
+{
+    struct CachedArena
+    {
+        Uint64 Generation = 0;
+        Arena* pArena     = nullptr;
+    };
+    static thread_local CachedArena ThreadCache;
+
+    // The generation only changes in Reset(), which is not called while threads allocate memory
+    if (ThreadCache.Generation == m_Generation)
+        return *ThreadCache.pArena;
+
+    std::lock_guard<std::mutex> Guard{m_ArenasMtx};
+
+    std::unique_ptr<Arena>& pArena = m_Arenas[std::this_thread::get_id()];
+    if (!pArena)
+        pArena = std::make_unique<Arena>(m_RawAllocator, StagingArenaBlockSize);
+
+    ThreadCache = {m_Generation, pArena.get()};
+    return *pArena;
+}
+
+void* HnStagingAllocator::Allocate(size_t Size, size_t Alignment)
+{
+    if (Size == 0)
+        return nullptr;
+
+    // Arenas are never removed until the reset, so the reference is safe to use
+    // without the lock. Only the calling thread allocates from its arena.
+    Arena& ThreadArena = GetThreadArena();
+    ThreadArena.AllocatedSize += Size;
+    return ThreadArena.Allocator.Allocate(Size, Alignment);
+}
+
+void HnStagingAllocator::Reset()
+{
+    std::lock_guard<std::mutex> Guard{m_ArenasMtx};
+
+    // Arenas may be released below, so invalidate the arena pointers cached by all threads
+    m_Generation = GetNextStagingArenaGeneration();
+    for (auto it = m_Arenas.begin(); it != m_Arenas.end();)
+    {
+        Arena& ThreadArena = *it->second;
+        if (ThreadArena.AllocatedSize > MaxRetainedArenaSize)
+        {
+            it = m_Arenas.erase(it);
+        }
+        else
+        {
+            ThreadArena.Allocator.Discard();
+            ThreadArena.AllocatedSize = 0;
+            ++it;
+        }
+    }
+}
+
+} // namespace USD
+
+} // namespace Diligent
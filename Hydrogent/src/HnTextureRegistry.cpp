@@ -31,8 +31,11 @@
 #include "USD_Renderer.hpp"
 #include "HnTextureIdentifier.hpp"
 #include "GraphicsAccessories.hpp"
+#include "ThreadPool.hpp"
 
 #include <mutex>
+#include <algorithm>
+#include <cmath>
 
 namespace Diligent
 {
@@ -41,21 +44,41 @@ namespace USD
 {
 
 HnTextureRegistry::HnTextureRegistry(IRenderDevice*         pDevice,
-                                     GLTF::ResourceManager* pResourceManager) :
+                                     GLTF::ResourceManager* pResourceManager,
+                                     IThreadPool*           pThreadPool,
+                                     Uint64                 UploadBudget,
+                                     Uint64                 ResidencyBudget) :
     m_pDevice{pDevice},
-    m_pResourceManager{pResourceManager}
+    m_pResourceManager{pResourceManager},
+    m_pThreadPool{pThreadPool},
+    m_UploadBudget{UploadBudget},
+    m_ResidencyBudget{ResidencyBudget}
 {
 }
 
 HnTextureRegistry::~HnTextureRegistry()
 {
+    // Tasks that have not started yet will exit immediately
+    m_StopLoading.store(true);
+
+    std::vector<RefCntAutoPtr<IAsyncTask>> LoadTasks;
+    {
+        std::lock_guard<std::mutex> Lock{m_AsyncLoadsMtx};
+        LoadTasks.reserve(m_LoadTasks.size());
+        for (auto& it : m_LoadTasks)
+            LoadTasks.emplace_back(it.second);
+    }
+
+    for (IAsyncTask* pTask : LoadTasks)
+        pTask->WaitForCompletion();
 }
 
 void HnTextureRegistry::InitializeHandle(IRenderDevice*     pDevice,
                                          IDeviceContext*    pContext,
                                          ITextureLoader*    pLoader,
                                          const SamplerDesc& SamDesc,
-                                         TextureHandle&     Handle)
+                                         TextureHandle&     Handle,
+                                         Uint32             FirstMip)
 {
     if (Handle.pAtlasSuballocation != nullptr)
     {
@@ -94,10 +117,21 @@ void HnTextureRegistry::InitializeHandle(IRenderDevice*     pDevice,
             TexDesc.ArraySize = 1;
 
             TextureData InitData = pLoader->GetTextureData();
+            if (FirstMip > 0)
+            {
+                VERIFY_EXPR(FirstMip < TexDesc.MipLevels && InitData.NumSubresources == TexDesc.MipLevels);
+                // Only create the coarse mip levels of the streamed texture
+                TexDesc.Width  = std::max(TexDesc.Width >> FirstMip, 1u);
+                TexDesc.Height = std::max(TexDesc.Height >> FirstMip, 1u);
+                TexDesc.MipLevels -= FirstMip;
+                InitData.pSubResources += FirstMip;
+                InitData.NumSubresources -= FirstMip;
+            }
             pDevice->CreateTexture(TexDesc, &InitData, &Handle.pTexture);
         }
         else
         {
+            VERIFY(FirstMip == 0, "Only 2D textures can be streamed");
             pLoader->CreateTexture(pDevice, &Handle.pTexture);
         }
         if (!Handle.pTexture)
@@ -115,23 +149,483 @@ void HnTextureRegistry::Commit(IDeviceContext* pContext)
     {
         m_pResourceManager->UpdateTextures(m_pDevice, pContext);
     }
-    std::lock_guard<std::mutex> Lock{m_PendingTexturesMtx};
-    for (auto tex_it : m_PendingTextures)
+
+    {
+        std::lock_guard<std::mutex> Lock{m_PendingTexturesMtx};
+        for (auto tex_it : m_PendingTextures)
+        {
+            InitializeHandle(m_pDevice, pContext, tex_it.second.pLoader, tex_it.second.SamDesc, *tex_it.second.Handle);
+        }
+        m_PendingTextures.clear();
+    }
+
+    if (m_pThreadPool)
+    {
+        CommitLoadedTextures(pContext);
+    }
+
+    if (IsStreamingEnabled())
+    {
+        UpdateResidency(pContext);
+    }
+}
+
+static Uint64 GetTextureDataSize(const TextureDesc& Desc, Uint32 FirstMip = 0)
+{
+    Uint64 Size = 0;
+    for (Uint32 mip = FirstMip; mip < Desc.MipLevels; ++mip)
+        Size += GetMipLevelProperties(Desc, mip).MipSize;
+    return Desc.Type == RESOURCE_DIM_TEX_3D ? Size : Size * Desc.ArraySize;
+}
+
+void HnTextureRegistry::CommitLoadedTextures(IDeviceContext* pContext)
+{
+    std::vector<std::shared_ptr<AsyncLoadInfo>> LoadedTextures;
+    {
+        std::lock_guard<std::mutex> Lock{m_AsyncLoadsMtx};
+        if (m_LoadedTextures.empty())
+            return;
+
+        size_t NumTextures = 0;
+        Uint64 UploadSize  = 0;
+        while (NumTextures < m_LoadedTextures.size())
+        {
+            const AsyncLoadInfo& LoadInfo = *m_LoadedTextures[NumTextures];
+
+            // Textures created by the worker threads have already been uploaded
+            const Uint64 TexDataSize = (LoadInfo.pLoader && !LoadInfo.LoadedData.pTexture) ?
+                GetTextureDataSize(LoadInfo.pLoader->GetTextureDesc(), LoadInfo.FirstMip) :
+                0;
+            // Always commit at least one texture so that textures larger than the budget are not stuck
+            if (m_UploadBudget != 0 && NumTextures > 0 && UploadSize + TexDataSize > m_UploadBudget)
+                break;
+
+            UploadSize += TexDataSize;
+            ++NumTextures;
+        }
+
+        LoadedTextures.assign(m_LoadedTextures.begin(), m_LoadedTextures.begin() + NumTextures);
+        m_LoadedTextures.erase(m_LoadedTextures.begin(), m_LoadedTextures.begin() + NumTextures);
+    }
+
+    // Storage version is only incremented by the thread that calls Commit()
+    const Uint32 NewStorageVersion = m_StorageVersion.load() + 1;
+
+    for (const std::shared_ptr<AsyncLoadInfo>& pLoadInfo : LoadedTextures)
+    {
+        AsyncLoadInfo& LoadInfo = *pLoadInfo;
+        if (LoadInfo.pLoader && !LoadInfo.LoadedData.pTexture)
+        {
+            InitializeHandle(m_pDevice, pContext, LoadInfo.pLoader, LoadInfo.SamDesc, LoadInfo.LoadedData, LoadInfo.FirstMip);
+        }
+
+        // Release the texture data
+        LoadInfo.pLoader.Release();
+
+        TextureHandle& Handle = *LoadInfo.Handle;
+        if (LoadInfo.StreamIn)
+        {
+            auto it = m_StreamedTextures.find(Handle.TextureId);
+            if (it == m_StreamedTextures.end())
+            {
+                UNEXPECTED("Texture ", LoadInfo.FilePath, " is not streamed");
+                continue;
+            }
+
+            StreamedTextureInfo& TexInfo = it->second;
+            VERIFY_EXPR(TexInfo.PendingMip == LoadInfo.FirstMip);
+
+            const Uint64 StreamInSize = GetTextureDataSize(TexInfo.FullDesc, TexInfo.PendingMip) - GetTextureDataSize(TexInfo.FullDesc, TexInfo.ResidentMip);
+            VERIFY_EXPR(m_PendingSize >= StreamInSize && m_NumStreamingTextures > 0);
+            m_PendingSize -= StreamInSize;
+            --m_NumStreamingTextures;
+
+            // If the texture failed to load, the coarser mip levels remain resident
+            if (LoadInfo.LoadedData.pTexture)
+            {
+                Handle.pTexture       = LoadInfo.LoadedData.pTexture;
+                Handle.pSampler       = LoadInfo.LoadedData.pSampler;
+                Handle.StorageVersion = NewStorageVersion;
+
+                TexInfo.ResidentMip = TexInfo.PendingMip;
+                m_ResidentSize += StreamInSize;
+            }
+            TexInfo.PendingMip = ~0u;
+            continue;
+        }
+
+        // Failed textures leave the handle empty, and materials keep using the placeholders
+        Handle.pTexture            = LoadInfo.LoadedData.pTexture;
+        Handle.pSampler            = LoadInfo.LoadedData.pSampler;
+        Handle.pAtlasSuballocation = LoadInfo.LoadedData.pAtlasSuballocation;
+        Handle.StorageVersion      = NewStorageVersion;
+
+        if (LoadInfo.Streamed && Handle.pTexture)
+        {
+            StreamedTextureInfo& TexInfo = m_StreamedTextures[Handle.TextureId];
+
+            TexInfo.FilePath     = LoadInfo.FilePath;
+            TexInfo.CreateLoader = std::move(LoadInfo.CreateLoader);
+            TexInfo.SamDesc      = LoadInfo.SamDesc;
+            TexInfo.Handle       = LoadInfo.Handle;
+            TexInfo.FullDesc     = LoadInfo.FullDesc;
+            TexInfo.ResidentMip  = LoadInfo.FirstMip;
+            TexInfo.TailMip      = LoadInfo.FirstMip;
+            TexInfo.DesiredMip   = LoadInfo.FirstMip;
+
+            m_ResidentSize += GetTextureDataSize(TexInfo.FullDesc, TexInfo.ResidentMip);
+            m_FullSize += GetTextureDataSize(TexInfo.FullDesc);
+        }
+
+        VERIFY_EXPR(m_NumPendingLoads.load() > 0);
+        m_NumPendingLoads.fetch_sub(1);
+    }
+
+    m_StorageVersion.store(NewStorageVersion);
+}
+
+// Returns the most detailed mip level that needs to be resident for the texture
+// to be sampled at roughly one texel per pixel by a mesh that covers the given screen area.
+static Uint32 ComputeDesiredMip(const TextureDesc& Desc, float ScreenArea, Uint32 TailMip)
+{
+    if (ScreenArea <= 0)
+        return TailMip;
+
+    const double NumTexels = static_cast<double>(Desc.Width) * static_cast<double>(Desc.Height);
+    if (ScreenArea >= NumTexels)
+        return 0;
+
+    // Every mip level has four times fewer texels than the previous one
+    const Uint32 Mip = static_cast<Uint32>(std::log2(NumTexels / ScreenArea) * 0.5);
+    return std::min(Mip, TailMip);
+}
+
+void HnTextureRegistry::UpdateResidency(IDeviceContext* pContext)
+{
+    // The number of textures that may be streamed in at the same time.
+    // Every load keeps the entire decoded texture in memory.
+    static constexpr Uint32 MaxStreamingTextures = 4;
+
+    std::vector<StreamedTextureInfo*> StreamInCandidates;
+    std::vector<StreamedTextureInfo*> EvictionCandidates;
+    for (auto& it : m_StreamedTextures)
     {
-        InitializeHandle(m_pDevice, pContext, tex_it.second.pLoader, tex_it.second.SamDesc, *tex_it.second.Handle);
+        StreamedTextureInfo& TexInfo = it.second;
+        if (TexInfo.PendingMip != ~0u)
+            continue;
+
+        // Textures that were not requested in the last frame only need the mip tail
+        TexInfo.DesiredMip = TexInfo.LastRequestFrame == m_FrameNumber ?
+            ComputeDesiredMip(TexInfo.FullDesc, TexInfo.ScreenArea, TexInfo.TailMip) :
+            TexInfo.TailMip;
+
+        if (TexInfo.DesiredMip < TexInfo.ResidentMip)
+            StreamInCandidates.push_back(&TexInfo);
+        else if (TexInfo.DesiredMip > TexInfo.ResidentMip)
+            EvictionCandidates.push_back(&TexInfo);
+    }
+
+    // Textures that cover a larger area of the screen are streamed in first
+    std::sort(StreamInCandidates.begin(), StreamInCandidates.end(),
+              [](const StreamedTextureInfo* lhs, const StreamedTextureInfo* rhs) {
+                  return lhs->ScreenArea > rhs->ScreenArea;
+              });
+
+    // Textures that have not been used for the longest time lose their mip levels first
+    std::sort(EvictionCandidates.begin(), EvictionCandidates.end(),
+              [](const StreamedTextureInfo* lhs, const StreamedTextureInfo* rhs) {
+                  return lhs->LastRequestFrame != rhs->LastRequestFrame ?
+                      lhs->LastRequestFrame < rhs->LastRequestFrame :
+                      lhs->ScreenArea < rhs->ScreenArea;
+              });
+
+    const Uint32 NewStorageVersion = m_StorageVersion.load() + 1;
+
+    bool HandlesUpdated = false;
+    auto evict_it       = EvictionCandidates.begin();
+    // Evicts the mip levels that are not needed until the required size fits into the budget
+    auto FitIntoBudget = [&](Uint64 RequiredSize) {
+        while (m_ResidentSize + m_PendingSize + RequiredSize > m_ResidencyBudget && evict_it != EvictionCandidates.end())
+        {
+            StreamedTextureInfo& TexInfo = **evict_it++;
+            if (EvictMips(pContext, TexInfo, TexInfo.DesiredMip))
+            {
+                TexInfo.Handle->StorageVersion = NewStorageVersion;
+                HandlesUpdated                 = true;
+            }
+        }
+        return m_ResidentSize + m_PendingSize + RequiredSize <= m_ResidencyBudget;
+    };
+
+    // The mip tails of the newly loaded textures may have exceeded the budget
+    FitIntoBudget(0);
+
+    for (StreamedTextureInfo* pTexInfo : StreamInCandidates)
+    {
+        if (m_NumStreamingTextures >= MaxStreamingTextures)
+            break;
+
+        // Stream in the most detailed mip level that fits into the budget
+        const Uint64 ResidentSize = GetTextureDataSize(pTexInfo->FullDesc, pTexInfo->ResidentMip);
+        for (Uint32 Mip = pTexInfo->DesiredMip; Mip < pTexInfo->ResidentMip; ++Mip)
+        {
+            if (FitIntoBudget(GetTextureDataSize(pTexInfo->FullDesc, Mip) - ResidentSize))
+            {
+                StreamIn(*pTexInfo, Mip);
+                break;
+            }
+        }
     }
-    m_PendingTextures.clear();
+
+    if (HandlesUpdated)
+        m_StorageVersion.store(NewStorageVersion);
+
+    ++m_FrameNumber;
+}
+
+bool HnTextureRegistry::StreamIn(StreamedTextureInfo& TexInfo, Uint32 TargetMip)
+{
+    VERIFY_EXPR(TargetMip < TexInfo.ResidentMip && TexInfo.PendingMip == ~0u);
+    if (!TexInfo.CreateLoader)
+        return false;
+
+    auto pLoadInfo          = std::make_shared<AsyncLoadInfo>();
+    pLoadInfo->FilePath     = TexInfo.FilePath;
+    pLoadInfo->CreateLoader = TexInfo.CreateLoader;
+    pLoadInfo->SamDesc      = TexInfo.SamDesc;
+    pLoadInfo->Handle       = TexInfo.Handle;
+    pLoadInfo->Streamed     = true;
+    pLoadInfo->StreamIn     = true;
+    pLoadInfo->FirstMip     = TargetMip;
+    pLoadInfo->FullDesc     = TexInfo.FullDesc;
+
+    TexInfo.PendingMip = TargetMip;
+    m_PendingSize += GetTextureDataSize(TexInfo.FullDesc, TargetMip) - GetTextureDataSize(TexInfo.FullDesc, TexInfo.ResidentMip);
+    ++m_NumStreamingTextures;
+
+    EnqueueLoadTask(std::move(pLoadInfo));
+
+    return true;
+}
+
+bool HnTextureRegistry::EvictMips(IDeviceContext* pContext, StreamedTextureInfo& TexInfo, Uint32 NewResidentMip)
+{
+    VERIFY_EXPR(NewResidentMip > TexInfo.ResidentMip && NewResidentMip <= TexInfo.TailMip && TexInfo.PendingMip == ~0u);
+
+    TextureHandle& Handle = *TexInfo.Handle;
+    if (!Handle.pTexture)
+        return false;
+
+    // The coarser mip levels are copied to a smaller texture on the GPU, so that
+    // the texture does not need to be reloaded.
+    const Uint32 SrcFirstMip = NewResidentMip - TexInfo.ResidentMip;
+
+    TextureDesc TexDesc = Handle.pTexture->GetDesc();
+    TexDesc.Width       = std::max(TexInfo.FullDesc.Width >> NewResidentMip, 1u);
+    TexDesc.Height      = std::max(TexInfo.FullDesc.Height >> NewResidentMip, 1u);
+    TexDesc.MipLevels   = TexInfo.FullDesc.MipLevels - NewResidentMip;
+    TexDesc.Usage       = USAGE_DEFAULT;
+    TexDesc.BindFlags   = BIND_SHADER_RESOURCE;
+    TexDesc.MiscFlags   = MISC_TEXTURE_FLAG_NONE;
+
+    RefCntAutoPtr<ITexture> pTexture;
+    m_pDevice->CreateTexture(TexDesc, nullptr, &pTexture);
+    if (!pTexture)
+    {
+        LOG_ERROR_MESSAGE("Failed to create texture to evict the mip levels of texture ", TexInfo.FilePath);
+        return false;
+    }
+
+    CopyTextureAttribs CopyAttribs{Handle.pTexture, RESOURCE_STATE_TRANSITION_MODE_TRANSITION, pTexture, RESOURCE_STATE_TRANSITION_MODE_TRANSITION};
+    for (Uint32 mip = 0; mip < TexDesc.MipLevels; ++mip)
+    {
+        CopyAttribs.SrcMipLevel = SrcFirstMip + mip;
+        CopyAttribs.DstMipLevel = mip;
+        pContext->CopyTexture(CopyAttribs);
+    }
+    pTexture->GetDefaultView(TEXTURE_VIEW_SHADER_RESOURCE)->SetSampler(Handle.pSampler);
+
+    Handle.pTexture = pTexture;
+
+    const Uint64 EvictedSize = GetTextureDataSize(TexInfo.FullDesc, TexInfo.ResidentMip) - GetTextureDataSize(TexInfo.FullDesc, NewResidentMip);
+    VERIFY_EXPR(m_ResidentSize >= EvictedSize);
+    m_ResidentSize -= EvictedSize;
+    TexInfo.ResidentMip = NewResidentMip;
+
+    return true;
+}
+
+void HnTextureRegistry::AllocateAtlasSpace(const pxr::TfToken& FilePath,
+                                           ITextureLoader*     pLoader,
+                                           TextureHandle&      Handle)
+{
+    VERIFY_EXPR(m_pResourceManager != nullptr);
+
+    const auto& TexDesc   = pLoader->GetTextureDesc();
+    const auto& AtlasDesc = m_pResourceManager->GetAtlasDesc(TexDesc.Format);
+    if (TexDesc.Width <= AtlasDesc.Width && TexDesc.Height <= AtlasDesc.Height)
+    {
+        Handle.pAtlasSuballocation = m_pResourceManager->AllocateTextureSpace(TexDesc.Format, TexDesc.Width, TexDesc.Height);
+        if (!Handle.pAtlasSuballocation)
+        {
+            LOG_ERROR_MESSAGE("Failed to allocate atlas region for texture ", FilePath);
+        }
+    }
+    else
+    {
+        LOG_WARNING_MESSAGE("Texture ", FilePath, " is too large to fit into atlas (", TexDesc.Width, "x", TexDesc.Height, " vs ", AtlasDesc.Width, "x", AtlasDesc.Height, ")");
+    }
+}
+
+// Returns the first mip level of the mip tail that is always resident
+static Uint32 GetMipTailStart(const TextureDesc& Desc)
+{
+    // The largest dimension of the first mip level in the mip tail
+    static constexpr Uint32 MipTailDimension = 256;
+
+    Uint32 Mip = 0;
+    while (Mip + 1 < Desc.MipLevels && std::max(Desc.Width >> Mip, Desc.Height >> Mip) > MipTailDimension)
+        ++Mip;
+    return Mip;
+}
+
+void HnTextureRegistry::LoadTexture(AsyncLoadInfo& LoadInfo)
+{
+    if (m_StopLoading.load())
+        return;
+
+    // Reading and decoding the file is the expensive part
+    LoadInfo.pLoader = LoadInfo.CreateLoader();
+    if (!LoadInfo.pLoader)
+    {
+        LOG_ERROR_MESSAGE("Failed to create texture loader for texture ", LoadInfo.FilePath);
+        return;
+    }
+
+    if (!LoadInfo.StreamIn)
+    {
+        if (m_pResourceManager != nullptr)
+        {
+            AllocateAtlasSpace(LoadInfo.FilePath, LoadInfo.pLoader, LoadInfo.LoadedData);
+        }
+
+        const TextureDesc& TexDesc = LoadInfo.pLoader->GetTextureDesc();
+        if (!LoadInfo.LoadedData.pAtlasSuballocation && IsStreamingEnabled() && TexDesc.Type == RESOURCE_DIM_TEX_2D)
+        {
+            // Only load the mip tail first. The finer mip levels are streamed in by UpdateResidency().
+            LoadInfo.FirstMip = GetMipTailStart(TexDesc);
+            LoadInfo.Streamed = LoadInfo.FirstMip > 0;
+            LoadInfo.FullDesc = TexDesc;
+        }
+
+        // Streamed textures are reloaded when finer mip levels are needed
+        if (!LoadInfo.Streamed)
+            LoadInfo.CreateLoader = nullptr;
+    }
+
+    if (!LoadInfo.LoadedData.pAtlasSuballocation && m_pDevice->GetDeviceInfo().Features.MultithreadedResourceCreation)
+    {
+        InitializeHandle(m_pDevice, nullptr, LoadInfo.pLoader, LoadInfo.SamDesc, LoadInfo.LoadedData, LoadInfo.FirstMip);
+        if (LoadInfo.LoadedData.pTexture)
+        {
+            // The data has been uploaded
+            LoadInfo.pLoader.Release();
+        }
+    }
+}
+
+void HnTextureRegistry::EnqueueLoadTask(std::shared_ptr<AsyncLoadInfo> pLoadInfo)
+{
+    VERIFY_EXPR(m_pThreadPool);
+
+    const Uint32 TextureId = pLoadInfo->Handle->TextureId;
+
+    // Keep the lock until the task is registered so that it can't remove itself first
+    std::lock_guard<std::mutex> Lock{m_AsyncLoadsMtx};
+
+    RefCntAutoPtr<IAsyncTask> pTask = EnqueueAsyncWork(m_pThreadPool,
+                                                       [this, pLoadInfo](Uint32 /*ThreadId*/) {
+                                                           LoadTexture(*pLoadInfo);
+
+                                                           std::lock_guard<std::mutex> Lock{m_AsyncLoadsMtx};
+                                                           m_LoadTasks.erase(pLoadInfo->Handle->TextureId);
+                                                           m_LoadedTextures.emplace_back(pLoadInfo);
+                                                           return ASYNC_TASK_STATUS_COMPLETE;
+                                                       });
+    m_LoadTasks.emplace(TextureId, std::move(pTask));
+}
+
+void HnTextureRegistry::RequestTexture(const TextureHandle& Handle, float ScreenArea)
+{
+    if (!m_StreamedTextures.empty())
+    {
+        auto it = m_StreamedTextures.find(Handle.TextureId);
+        if (it != m_StreamedTextures.end())
+        {
+            StreamedTextureInfo& TexInfo = it->second;
+
+            TexInfo.ScreenArea       = TexInfo.LastRequestFrame == m_FrameNumber ? std::max(TexInfo.ScreenArea, ScreenArea) : ScreenArea;
+            TexInfo.LastRequestFrame = m_FrameNumber;
+        }
+    }
+
+    if (!m_pThreadPool || (m_NumPendingLoads.load() == 0 && m_NumStreamingTextures == 0))
+        return;
+
+    std::lock_guard<std::mutex> Lock{m_AsyncLoadsMtx};
+
+    auto it = m_LoadTasks.find(Handle.TextureId);
+    if (it == m_LoadTasks.end())
+        return;
+
+    // Textures of the meshes that cover a larger area of the screen are loaded first
+    IAsyncTask* pTask = it->second;
+    if (ScreenArea > pTask->GetPriority())
+    {
+        pTask->SetPriority(ScreenArea);
+        m_pThreadPool->ReprioritizeTask(pTask);
+    }
+}
+
+HnTextureRegistry::ResidencyStats HnTextureRegistry::GetResidencyStats() const
+{
+    ResidencyStats Stats;
+    Stats.Budget       = m_ResidencyBudget;
+    Stats.ResidentSize = m_ResidentSize;
+    Stats.FullSize     = m_FullSize;
+    Stats.PendingSize  = m_PendingSize;
+    Stats.TextureCount = static_cast<Uint32>(m_StreamedTextures.size());
+    Stats.PendingCount = m_NumStreamingTextures;
+    return Stats;
 }
 
 HnTextureRegistry::TextureHandleSharedPtr HnTextureRegistry::Allocate(const pxr::TfToken&                            FilePath,
                                                                       const TextureComponentMapping&                 Swizzle,
                                                                       const pxr::HdSamplerParameters&                SamplerParams,
-                                                                      std::function<RefCntAutoPtr<ITextureLoader>()> CreateLoader)
+                                                                      std::function<RefCntAutoPtr<ITextureLoader>()> CreateLoader,
+                                                                      bool                                           AsyncLoad)
 {
     const pxr::TfToken Key{FilePath.GetString() + '.' + GetTextureComponentMappingString(Swizzle)};
     return m_Cache.Get(
         Key,
         [&]() {
+            if (AsyncLoad && m_pThreadPool)
+            {
+                auto TexHandle       = std::make_shared<TextureHandle>();
+                TexHandle->TextureId = m_NextTextureId.fetch_add(1);
+
+                auto pLoadInfo          = std::make_shared<AsyncLoadInfo>();
+                pLoadInfo->FilePath     = FilePath;
+                pLoadInfo->CreateLoader = std::move(CreateLoader);
+                pLoadInfo->SamDesc      = HdSamplerParametersToSamplerDesc(SamplerParams);
+                pLoadInfo->Handle       = TexHandle;
+
+                m_NumPendingLoads.fetch_add(1);
+                EnqueueLoadTask(std::move(pLoadInfo));
+
+                return TexHandle;
+            }
+
             RefCntAutoPtr<ITextureLoader> pLoader = CreateLoader();
             if (!pLoader)
             {
@@ -146,20 +640,7 @@ HnTextureRegistry::TextureHandleSharedPtr HnTextureRegistry::Allocate(const pxr:
             // Try to allocate texture in the atlas first
             if (m_pResourceManager != nullptr)
             {
-                const auto& TexDesc   = pLoader->GetTextureDesc();
-                const auto& AtlasDesc = m_pResourceManager->GetAtlasDesc(TexDesc.Format);
-                if (TexDesc.Width <= AtlasDesc.Width && TexDesc.Height <= AtlasDesc.Height)
-                {
-                    TexHandle->pAtlasSuballocation = m_pResourceManager->AllocateTextureSpace(TexDesc.Format, TexDesc.Width, TexDesc.Height);
-                    if (!TexHandle->pAtlasSuballocation)
-                    {
-                        LOG_ERROR_MESSAGE("Failed to allocate atlas region for texture ", FilePath);
-                    }
-                }
-                else
-                {
-                    LOG_WARNING_MESSAGE("Texture ", FilePath, " is too large to fit into atlas (", TexDesc.Width, "x", TexDesc.Height, " vs ", AtlasDesc.Width, "x", AtlasDesc.Height, ")");
-                }
+                AllocateAtlasSpace(FilePath, pLoader, *TexHandle);
             }
 
             // If texture was not allocated in the atlas (because atlas is disabled or because it does not fit),
@@ -194,8 +675,9 @@ HnTextureRegistry::TextureHandleSharedPtr HnTextureRegistry::Allocate(const HnTe
         return {};
     }
 
+    // The loader may be created by a worker thread, so capture the identifier by value
     return Allocate(TexId.FilePath, TexId.SubtextureId.Swizzle, SamplerParams,
-                    [&TexId, Format]() {
+                    [TexId, Format]() {
                         TextureLoadInfo LoadInfo;
                         LoadInfo.Name   = TexId.FilePath.GetText();
                         LoadInfo.Format = Format;
@@ -207,7 +689,8 @@ HnTextureRegistry::TextureHandleSharedPtr HnTextureRegistry::Allocate(const HnTe
                         LoadInfo.Swizzle          = TexId.SubtextureId.Swizzle;
 
                         return CreateTextureLoaderFromSdfPath(TexId.FilePath.GetText(), LoadInfo);
-                    });
+                    },
+                    /*AsyncLoad = */ true);
 }
 
 Uint32 HnTextureRegistry::GetAtlasVersion() const
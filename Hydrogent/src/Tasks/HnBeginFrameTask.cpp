@@ -269,6 +269,9 @@ void HnBeginFrameTask::Prepare(pxr::HdTaskContext* TaskCtx,
         std::swap(m_DepthBufferId[0], m_DepthBufferId[1]);
     }
 
+    // Culling data is set by HnCullRprimsTask every frame
+    m_RenderPassState->SetCullingData({});
+
     (*TaskCtx)[HnTokens->renderPassState]                = pxr::VtValue{m_RenderPassState};
     (*TaskCtx)[HnRenderResourceTokens->finalColorTarget] = pxr::VtValue{m_FinalColorTargetId};
 
@@ -352,6 +355,8 @@ void HnBeginFrameTask::UpdateFrameConstants(IDeviceContext* pCtx,
         CamAttribs.f4Position    = float4{float3::MakeVector(WorldMatrix[3]), 1};
         CamAttribs.f2Jitter      = Jitter;
 
+        m_RenderPassState->SetLODSelectionData({ViewProj, static_cast<float>(m_FrameBufferHeight)});
+
         if (CamAttribs.mViewT != PrevCamera.mViewT)
         {
             CameraTransformDirty = true;
@@ -379,18 +384,37 @@ void HnBeginFrameTask::UpdateFrameConstants(IDeviceContext* pCtx,
         UNEXPECTED("Camera is null. It should've been set in Prepare()");
     }
 
-    // For now, use the first light that is initialized.
     HnRenderDelegate* RenderDelegate = static_cast<HnRenderDelegate*>(m_RenderIndex->GetRenderDelegate());
-    for (HnLight* Light : RenderDelegate->GetLights())
+    const USD_Renderer& USDRenderer   = *RenderDelegate->GetUSDRenderer();
+    if (USDRenderer.GetPunctualLightsBuffer() != nullptr)
     {
-        if (Light->GetDirection() != float3{})
+        // All lights are applied through the light clusters
+        FrameAttribs.Light = {};
+
+        float ZNear = 0;
+        float ZFar  = 0;
+        if (m_pCamera != nullptr)
         {
-            HLSL::PBRLightAttribs& LightAttribs = FrameAttribs.Light;
+            m_pCamera->GetProjectionMatrix().GetNearFarClipPlanes(ZNear, ZFar, RenderDelegate->GetDevice()->GetDeviceInfo().IsGLDevice());
+            if (ZNear > ZFar)
+                std::swap(ZNear, ZFar);
+        }
+        USDRenderer.SetLightClusterAttribs(FrameAttribs.LightClusters, ZNear, ZFar, RenderDelegate->GetPunctualLightCount());
+    }
+    else
+    {
+        // Use the first light that is initialized.
+        for (HnLight* Light : RenderDelegate->GetLights())
+        {
+            if (Light->GetType() == HnLight::TYPE::DIRECTIONAL && Light->IsVisible() && Light->GetDirection() != float3{})
+            {
+                HLSL::PBRLightAttribs& LightAttribs = FrameAttribs.Light;
 
-            LightAttribs.Direction = Light->GetDirection();
-            LightAttribs.Intensity = Light->GetIntensity();
+                LightAttribs.Direction = Light->GetDirection();
+                LightAttribs.Intensity = Light->GetIntensity();
 
-            break;
+                break;
+            }
         }
     }
 
@@ -420,6 +444,9 @@ void HnBeginFrameTask::UpdateFrameConstants(IDeviceContext* pCtx,
             {pFrameAttrbisCB, RESOURCE_STATE_UNKNOWN, RESOURCE_STATE_CONSTANT_BUFFER, STATE_TRANSITION_FLAG_UPDATE_STATE},
         };
     pCtx->TransitionResourceStates(_countof(Barriers), Barriers);
+
+    // Bin the lights every frame as the camera and the lights may move
+    RenderDelegate->GetUSDRenderer()->BinLights(pCtx, pFrameAttrbisCB);
 }
 
 void HnBeginFrameTask::Execute(pxr::HdTaskContext* TaskCtx)
@@ -0,0 +1,457 @@
+/*
+ *  Copyright 2024 Diligent Graphics LLC
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+#include "Tasks/HnCullRprimsTask.hpp"
+#include "HnRenderDelegate.hpp"
+#include "HnRenderPassState.hpp"
+#include "HnTokens.hpp"
+#include "HnRenderParam.hpp"
+#include "HnShaderSourceFactory.hpp"
+#include "HnMesh.hpp"
+#include "HnTextureRegistry.hpp"
+
+#include "DebugUtilities.hpp"
+#include "GraphicsUtilities.h"
+#include "GraphicsAccessories.hpp"
+#include "GraphicsTypesX.hpp"
+#include "RenderStateCache.hpp"
+#include "ShaderMacroHelper.hpp"
+#include "AdvancedMath.hpp"
+#include "MapHelper.hpp"
+#include "ScopedDebugGroup.hpp"
+
+namespace Diligent
+{
+
+namespace HLSL
+{
+
+#include "Shaders/Common/public/BasicStructures.fxh"
+#include "Shaders/PBR/public/PBR_Structures.fxh"
+#include "Shaders/PBR/private/RenderPBR_Structures.fxh"
+#include "../shaders/HnIndirectDrawStructures.fxh"
+
+} // namespace HLSL
+
+namespace USD
+{
+
+HnCullRprimsTask::HnCullRprimsTask(pxr::HdSceneDelegate* ParamsDelegate, const pxr::SdfPath& Id) :
+    HnTask{Id}
+{
+}
+
+HnCullRprimsTask::~HnCullRprimsTask()
+{
+}
+
+void HnCullRprimsTask::Sync(pxr::HdSceneDelegate* Delegate,
+                            pxr::HdTaskContext*   TaskCtx,
+                            pxr::HdDirtyBits*     DirtyBits)
+{
+    if (*DirtyBits & pxr::HdChangeTracker::DirtyParams)
+    {
+        HnCullRprimsTaskParams Params;
+        if (GetTaskParams(Delegate, Params))
+        {
+            m_Params = Params;
+        }
+    }
+
+    *DirtyBits = pxr::HdChangeTracker::Clean;
+}
+
+void HnCullRprimsTask::Prepare(pxr::HdTaskContext* TaskCtx,
+                               pxr::HdRenderIndex* RenderIndex)
+{
+    m_RenderIndex = RenderIndex;
+}
+
+void HnCullRprimsTask::CullMeshes(const float4x4& ViewProj)
+{
+    HnRenderDelegate* RenderDelegate = static_cast<HnRenderDelegate*>(m_RenderIndex->GetRenderDelegate());
+
+    const bool IsGL           = RenderDelegate->GetDevice()->GetDeviceInfo().IsGLDevice();
+    const bool ApplyTransform = m_Params.Transform != float4x4::Identity();
+
+    std::fill(m_CulledMeshes.begin(), m_CulledMeshes.end(), Uint8{0});
+    for (const HnMesh* pMesh : RenderDelegate->GetMeshes())
+    {
+        const HnMesh::Attributes& Attribs = pMesh->GetAttributes();
+        // The extent of an instanced mesh only covers the prototype
+        if (!Attribs.HasExtent || pMesh->IsInstanced())
+            continue;
+
+        const float4x4 WorldViewProj = ApplyTransform ?
+            Attribs.Transform * m_Params.Transform * ViewProj :
+            Attribs.Transform * ViewProj;
+
+        ViewFrustum Frustum;
+        ExtractViewFrustumPlanesFromMatrix(WorldViewProj, Frustum, IsGL);
+
+        BoundBox Box;
+        Box.Min = Attribs.ExtentMin;
+        Box.Max = Attribs.ExtentMax;
+        if (GetBoxVisibility(Frustum, Box) != BoxVisibility::Invisible)
+            continue;
+
+        const Uint32 UID = pMesh->GetUID();
+        if (UID >= m_CulledMeshes.size())
+            m_CulledMeshes.resize(size_t{UID} + 1, Uint8{0});
+        m_CulledMeshes[UID] = 1;
+    }
+}
+
+// Returns the fraction of the screen covered by the projection of the bounding box
+static float GetScreenCoverage(const float4x4& WorldViewProj, const float3& Min, const float3& Max)
+{
+    float2 NDCMin{+1.f, +1.f};
+    float2 NDCMax{-1.f, -1.f};
+
+    Uint32 NumCornersInFront = 0;
+    for (Uint32 i = 0; i < 8; ++i)
+    {
+        const float3 Corner{
+            (i & 0x01) != 0 ? Max.x : Min.x,
+            (i & 0x02) != 0 ? Max.y : Min.y,
+            (i & 0x04) != 0 ? Max.z : Min.z,
+        };
+        const float4 Pos = float4{Corner, 1} * WorldViewProj;
+        if (Pos.w <= 0)
+            continue;
+
+        ++NumCornersInFront;
+        NDCMin.x = std::min(NDCMin.x, Pos.x / Pos.w);
+        NDCMin.y = std::min(NDCMin.y, Pos.y / Pos.w);
+        NDCMax.x = std::max(NDCMax.x, Pos.x / Pos.w);
+        NDCMax.y = std::max(NDCMax.y, Pos.y / Pos.w);
+    }
+
+    if (NumCornersInFront == 0)
+        return 0;
+    if (NumCornersInFront < 8)
+        return 1; // The box intersects the camera plane
+
+    NDCMin.x = std::max(NDCMin.x, -1.f);
+    NDCMin.y = std::max(NDCMin.y, -1.f);
+    NDCMax.x = std::min(NDCMax.x, +1.f);
+    NDCMax.y = std::min(NDCMax.y, +1.f);
+    if (NDCMax.x <= NDCMin.x || NDCMax.y <= NDCMin.y)
+        return 0;
+
+    // NDC space area is 4
+    return (NDCMax.x - NDCMin.x) * (NDCMax.y - NDCMin.y) * 0.25f;
+}
+
+void HnCullRprimsTask::RequestTextures(const float4x4& ViewProj, float ScreenArea)
+{
+    HnRenderDelegate*  RenderDelegate = static_cast<HnRenderDelegate*>(m_RenderIndex->GetRenderDelegate());
+    HnTextureRegistry& TexRegistry    = RenderDelegate->GetTextureRegistry();
+
+    const bool ApplyTransform = m_Params.Transform != float4x4::Identity();
+    for (HnMesh* pMesh : RenderDelegate->GetMeshes())
+    {
+        if (!pMesh->IsVisible())
+            continue;
+
+        // Textures of the meshes that cover a larger area of the screen are loaded first,
+        // and need finer mip levels to be resident.
+        // Instanced meshes and meshes without the extent are assumed to cover the entire screen.
+        float Coverage = 1;
+
+        const HnMesh::Attributes& Attribs = pMesh->GetAttributes();
+        if (Attribs.HasExtent && !pMesh->IsInstanced())
+        {
+            const float4x4 WorldViewProj = ApplyTransform ?
+                Attribs.Transform * m_Params.Transform * ViewProj :
+                Attribs.Transform * ViewProj;
+
+            Coverage = GetScreenCoverage(WorldViewProj, Attribs.ExtentMin, Attribs.ExtentMax);
+        }
+
+        if (Coverage > 0)
+            pMesh->RequestTextures(TexRegistry, Coverage * ScreenArea);
+    }
+}
+
+bool HnCullRprimsTask::PrepareDepthHierarchy(const TextureDesc& DepthDesc)
+{
+    const Uint32 Width  = std::max(DepthDesc.Width / 2u, 1u);
+    const Uint32 Height = std::max(DepthDesc.Height / 2u, 1u);
+    if (m_DepthHierarchy)
+    {
+        const TextureDesc& HierarchyDesc = m_DepthHierarchy->GetDesc();
+        if (HierarchyDesc.Width == Width && HierarchyDesc.Height == Height)
+            return true;
+
+        m_DepthHierarchy.Release();
+        m_DepthHierarchyMipUAVs.clear();
+    }
+
+    HnRenderDelegate* RenderDelegate = static_cast<HnRenderDelegate*>(m_RenderIndex->GetRenderDelegate());
+    IRenderDevice*    pDevice        = RenderDelegate->GetDevice();
+
+    TextureDesc Desc;
+    Desc.Name      = "Depth hierarchy";
+    Desc.Type      = RESOURCE_DIM_TEX_2D;
+    Desc.Width     = Width;
+    Desc.Height    = Height;
+    Desc.Format    = TEX_FORMAT_R32_FLOAT;
+    Desc.MipLevels = ComputeMipLevelsCount(Width, Height);
+    Desc.BindFlags = BIND_SHADER_RESOURCE | BIND_UNORDERED_ACCESS;
+    pDevice->CreateTexture(Desc, nullptr, &m_DepthHierarchy);
+    if (!m_DepthHierarchy)
+    {
+        UNEXPECTED("Failed to create depth hierarchy texture");
+        return false;
+    }
+
+    m_DepthHierarchyMipUAVs.resize(Desc.MipLevels);
+    for (Uint32 Mip = 0; Mip < Desc.MipLevels; ++Mip)
+    {
+        TextureViewDesc ViewDesc;
+        ViewDesc.ViewType        = TEXTURE_VIEW_UNORDERED_ACCESS;
+        ViewDesc.MostDetailedMip = Mip;
+        ViewDesc.NumMipLevels    = 1;
+        m_DepthHierarchy->CreateView(ViewDesc, &m_DepthHierarchyMipUAVs[Mip]);
+        if (!m_DepthHierarchyMipUAVs[Mip])
+        {
+            UNEXPECTED("Failed to create depth hierarchy mip ", Mip, " UAV");
+            m_DepthHierarchy.Release();
+            m_DepthHierarchyMipUAVs.clear();
+            return false;
+        }
+    }
+
+    return true;
+}
+
+void HnCullRprimsTask::PrepareTechniques()
+{
+    if (m_DownsampleTechs[0] && m_DownsampleTechs[1])
+        return;
+
+    try
+    {
+        HnRenderDelegate* RenderDelegate = static_cast<HnRenderDelegate*>(m_RenderIndex->GetRenderDelegate());
+
+        // RenderDeviceWithCache_E throws exceptions in case of errors
+        RenderDeviceWithCache_E Device{RenderDelegate->GetDevice(), RenderDelegate->GetRenderStateCache()};
+
+        auto pHnFxCompoundSourceFactory = HnShaderSourceFactory::CreateHnFxCompoundFactory();
+
+        for (Uint32 i = 0; i < m_DownsampleTechs.size(); ++i)
+        {
+            DownsampleDepthTech& Tech = m_DownsampleTechs[i];
+            if (Tech)
+                continue;
+
+            const bool FromDepthBuffer = i == 0;
+
+            ShaderMacroHelper Macros;
+            Macros.Add("BUILD_FROM_DEPTH_BUFFER", FromDepthBuffer);
+
+            ShaderCreateInfo ShaderCI;
+            ShaderCI.SourceLanguage             = SHADER_SOURCE_LANGUAGE_HLSL;
+            ShaderCI.pShaderSourceStreamFactory = pHnFxCompoundSourceFactory;
+            ShaderCI.Desc                       = {FromDepthBuffer ? "Build depth hierarchy from depth CS" : "Build depth hierarchy CS", SHADER_TYPE_COMPUTE, true};
+            ShaderCI.EntryPoint                 = "main";
+            ShaderCI.FilePath                   = "HnBuildDepthHierarchy.csh";
+            ShaderCI.Macros                     = Macros;
+
+            RefCntAutoPtr<IShader> pCS = Device.CreateShader(ShaderCI); // Throws an exception in case of error
+
+            PipelineResourceLayoutDescX ResourceLauout;
+            ResourceLauout.SetDefaultVariableType(SHADER_RESOURCE_VARIABLE_TYPE_DYNAMIC);
+
+            ComputePipelineStateCreateInfo PsoCI;
+            PsoCI.PSODesc.Name           = FromDepthBuffer ? "Build depth hierarchy from depth" : "Build depth hierarchy";
+            PsoCI.PSODesc.PipelineType   = PIPELINE_TYPE_COMPUTE;
+            PsoCI.PSODesc.ResourceLayout = ResourceLauout;
+            PsoCI.pCS                    = pCS;
+
+            Tech.PSO = Device.CreateComputePipelineState(PsoCI); // Throws an exception in case of error
+            Tech.PSO->CreateShaderResourceBinding(&Tech.SRB, true);
+            VERIFY_EXPR(Tech.SRB);
+
+            Tech.Vars.Src = Tech.SRB->GetVariableByName(SHADER_TYPE_COMPUTE, FromDepthBuffer ? "g_SrcDepth" : "g_SrcMip");
+            Tech.Vars.Dst = Tech.SRB->GetVariableByName(SHADER_TYPE_COMPUTE, "g_DstMip");
+            VERIFY_EXPR(Tech.Vars);
+        }
+    }
+    catch (const std::runtime_error& err)
+    {
+        LOG_ERROR_MESSAGE("Failed to initialize depth hierarchy techniques: ", err.what());
+        m_TechniquesFailed = true;
+    }
+}
+
+void HnCullRprimsTask::BuildDepthHierarchy(IDeviceContext* pCtx, ITextureView* pDepthSRV)
+{
+    ScopedDebugGroup DebugGroup{pCtx, "Build Depth Hierarchy"};
+
+    const TextureDesc& Desc = m_DepthHierarchy->GetDesc();
+    for (Uint32 Mip = 0; Mip < Desc.MipLevels; ++Mip)
+    {
+        DownsampleDepthTech& Tech = m_DownsampleTechs[Mip == 0 ? 0 : 1];
+        if (Mip == 0)
+        {
+            Tech.Vars.Src->Set(pDepthSRV);
+        }
+        else
+        {
+            Tech.Vars.Src->Set(m_DepthHierarchyMipUAVs[Mip - 1]);
+
+            // Wait until the previous level is written
+            StateTransitionDesc Barrier{m_DepthHierarchy, RESOURCE_STATE_UNORDERED_ACCESS, RESOURCE_STATE_UNORDERED_ACCESS, STATE_TRANSITION_FLAG_UPDATE_STATE};
+            pCtx->TransitionResourceStates(1, &Barrier);
+        }
+        Tech.Vars.Dst->Set(m_DepthHierarchyMipUAVs[Mip]);
+
+        pCtx->SetPipelineState(Tech.PSO);
+        pCtx->CommitShaderResources(Tech.SRB, RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
+
+        const Uint32 MipWidth  = std::max(Desc.Width >> Mip, 1u);
+        const Uint32 MipHeight = std::max(Desc.Height >> Mip, 1u);
+
+        DispatchComputeAttribs DispatchAttribs;
+        DispatchAttribs.ThreadGroupCountX = (MipWidth + HN_DEPTH_HIERARCHY_THREAD_GROUP_SIZE - 1) / HN_DEPTH_HIERARCHY_THREAD_GROUP_SIZE;
+        DispatchAttribs.ThreadGroupCountY = (MipHeight + HN_DEPTH_HIERARCHY_THREAD_GROUP_SIZE - 1) / HN_DEPTH_HIERARCHY_THREAD_GROUP_SIZE;
+        pCtx->DispatchCompute(DispatchAttribs);
+    }
+
+    // The hierarchy is read by the indirect draw arguments shaders
+    StateTransitionDesc Barrier{m_DepthHierarchy, RESOURCE_STATE_UNKNOWN, RESOURCE_STATE_SHADER_RESOURCE, STATE_TRANSITION_FLAG_UPDATE_STATE};
+    pCtx->TransitionResourceStates(1, &Barrier);
+}
+
+void HnCullRprimsTask::Execute(pxr::HdTaskContext* TaskCtx)
+{
+    if (m_RenderIndex == nullptr)
+    {
+        UNEXPECTED("Render index is not initialized");
+        return;
+    }
+
+    std::shared_ptr<HnRenderPassState> RenderPassState = GetRenderPassState(TaskCtx);
+    if (!RenderPassState)
+    {
+        UNEXPECTED("Render pass state is not set in the task context");
+        return;
+    }
+    const HnFramebufferTargets& Targets = RenderPassState->GetFramebufferTargets();
+    if (!Targets)
+    {
+        UNEXPECTED("Frame buffer targets are not initialized");
+        return;
+    }
+
+    // Set by HnBeginFrameTask::Execute()
+    HLSL::PBRFrameAttribs* pFrameAttribs = nullptr;
+    if (!GetTaskContextData(TaskCtx, HnRenderResourceTokens->frameShaderAttribs, pFrameAttribs) || pFrameAttribs == nullptr)
+        return;
+
+    HnRenderDelegate*    RenderDelegate = static_cast<HnRenderDelegate*>(m_RenderIndex->GetRenderDelegate());
+    IRenderDevice*       pDevice        = RenderDelegate->GetDevice();
+    IDeviceContext*      pCtx           = RenderDelegate->GetDeviceContext();
+    const HnRenderParam* pRenderParam   = static_cast<const HnRenderParam*>(RenderDelegate->GetRenderParam());
+    if (pRenderParam == nullptr)
+    {
+        UNEXPECTED("Render param is null");
+        return;
+    }
+
+    const HnTextureRegistry& TexRegistry = RenderDelegate->GetTextureRegistry();
+    if (TexRegistry.GetNumPendingLoads() != 0 || TexRegistry.IsStreamingEnabled())
+    {
+        const TextureDesc& DepthDesc = Targets.DepthDSV->GetTexture()->GetDesc();
+        RequestTextures(pFrameAttribs->Camera.mViewProjT.Transpose(), static_cast<float>(DepthDesc.Width) * static_cast<float>(DepthDesc.Height));
+    }
+
+    // The previous frame depth buffer is only valid if it was rendered by the last frame.
+    ITexture*  pPrevDepth        = Targets.PrevDepthDSV->GetTexture();
+    const bool DepthHistoryValid = m_LastDepthBuffer == pPrevDepth;
+    m_LastDepthBuffer            = Targets.DepthDSV->GetTexture();
+
+    HnCullingData CullingData;
+    if (!pRenderParam->GetUseIndirectDraws())
+    {
+        if (m_Params.FrustumCulling)
+        {
+            CullMeshes(pFrameAttribs->Camera.mViewProjT.Transpose());
+            CullingData.pCulledMeshes = &m_CulledMeshes;
+        }
+    }
+    else if ((m_Params.FrustumCulling || m_Params.OcclusionCulling) &&
+             pDevice->GetDeviceInfo().Features.ComputeShaders &&
+             !m_TechniquesFailed)
+    {
+        ScopedDebugGroup DebugGroup{pCtx, "Cull Rprims"};
+
+        if (!m_CullingAttribsCB)
+        {
+            CreateUniformBuffer(pDevice, sizeof(HLSL::HnCullingAttribs), "Culling attribs CB", &m_CullingAttribsCB);
+            VERIFY(m_CullingAttribsCB, "Failed to create culling attribs CB");
+        }
+
+        const TextureDesc& DepthDesc = pPrevDepth->GetDesc();
+        if (m_CullingAttribsCB && PrepareDepthHierarchy(DepthDesc))
+        {
+            // Occlusion test assumes that closer objects have smaller depth
+            const pxr::HdCompareFunction DepthFunc = RenderPassState->GetDepthFunc();
+
+            bool BuildHierarchy = m_Params.OcclusionCulling && DepthHistoryValid && (DepthFunc == pxr::HdCmpFuncLess || DepthFunc == pxr::HdCmpFuncLEqual);
+            if (BuildHierarchy)
+            {
+                PrepareTechniques();
+                BuildHierarchy = m_DownsampleTechs[0] && m_DownsampleTechs[1];
+            }
+
+            if (BuildHierarchy)
+                BuildDepthHierarchy(pCtx, pPrevDepth->GetDefaultView(TEXTURE_VIEW_SHADER_RESOURCE));
+
+            {
+                MapHelper<HLSL::HnCullingAttribs> CullingAttribs{pCtx, m_CullingAttribsCB, MAP_WRITE, MAP_FLAG_DISCARD};
+                CullingAttribs->Flags = 0;
+                if (m_Params.FrustumCulling)
+                    CullingAttribs->Flags |= HN_CULLING_FLAG_FRUSTUM;
+                if (BuildHierarchy)
+                    CullingAttribs->Flags |= HN_CULLING_FLAG_OCCLUSION;
+                CullingAttribs->DepthHierarchyMipLevels = m_DepthHierarchy->GetDesc().MipLevels;
+                CullingAttribs->DepthBufferSize         = float2{static_cast<float>(DepthDesc.Width), static_cast<float>(DepthDesc.Height)};
+            }
+
+            CullingData.pCullingAttribsCB  = m_CullingAttribsCB;
+            CullingData.pDepthHierarchySRV = m_DepthHierarchy->GetDefaultView(TEXTURE_VIEW_SHADER_RESOURCE);
+        }
+    }
+
+    RenderPassState->SetCullingData(CullingData);
+}
+
+} // namespace USD
+
+} // namespace Diligent
@@ -30,6 +30,7 @@
 #include <array>
 
 #include "Tasks/HnBeginFrameTask.hpp"
+#include "Tasks/HnCullRprimsTask.hpp"
 #include "Tasks/HnRenderRprimsTask.hpp"
 #include "Tasks/HnCopySelectionDepthTask.hpp"
 #include "Tasks/HnSetupSelectionDepthTask.hpp"
@@ -57,6 +58,7 @@ TF_DEFINE_PRIVATE_TOKENS(
     HnTaskManagerTokens,
 
     (beginFrame)
+    (cullRprimsTask)
     (copySelectionDepth)
     (renderEnvMapTask)
     (renderAxesTask)
@@ -143,6 +145,7 @@ HnTaskManager::HnTaskManager(pxr::HdRenderIndex& RenderIndex,
 {
     // Task creation order defines the default task order
     CreateBeginFrameTask();
+    CreateCullRprimsTask();
     CreateRenderRprimsTask(HnMaterialTagTokens->defaultTag,
                            TaskUID_RenderRprimsDefaultSelected,
                            {
@@ -239,6 +242,12 @@ void HnTaskManager::CreateBeginFrameTask()
     CreateTask<HnBeginFrameTask>(HnTaskManagerTokens->beginFrame, TaskUID_BeginFrame, TaskParams);
 }
 
+void HnTaskManager::CreateCullRprimsTask()
+{
+    HnCullRprimsTaskParams TaskParams;
+    CreateTask<HnCullRprimsTask>(HnTaskManagerTokens->cullRprimsTask, TaskUID_CullRprims, TaskParams);
+}
+
 pxr::SdfPath HnTaskManager::GetRenderRprimsTaskId(const pxr::TfToken& MaterialTag, const HnRenderPassParams& RenderPassParams) const
 {
     std::string Id = std::string{"RenderRprimsTask_"} + MaterialTag.GetString();
@@ -296,12 +305,35 @@ void HnTaskManager::SetFrameParams(const HnBeginFrameTaskParams& Params)
     SetTaskParams(TaskUID_BeginFrame, Params);
 }
 
+void HnTaskManager::SetCullRprimsParams(const HnCullRprimsTaskParams& Params)
+{
+    auto cull_rprims_task_it = m_TaskInfo.find(TaskUID{TaskUID_CullRprims});
+    if (cull_rprims_task_it == m_TaskInfo.end())
+        return;
+
+    // Transform is set by SetRenderRprimParams()
+    HnCullRprimsTaskParams CullRprimsParams = Params;
+    CullRprimsParams.Transform              = m_ParamsDelegate.GetParameter<HnCullRprimsTaskParams>(cull_rprims_task_it->second.Id, pxr::HdTokens->params).Transform;
+    SetTaskParams(TaskUID_CullRprims, CullRprimsParams);
+}
+
 void HnTaskManager::SetRenderRprimParams(const HnRenderRprimsTaskParams& Params)
 {
     for (const auto& TaskId : m_RenderTaskIds)
     {
         SetTaskParams(TaskId, Params);
     }
+
+    auto cull_rprims_task_it = m_TaskInfo.find(TaskUID{TaskUID_CullRprims});
+    if (cull_rprims_task_it != m_TaskInfo.end())
+    {
+        HnCullRprimsTaskParams CullRprimsParams = m_ParamsDelegate.GetParameter<HnCullRprimsTaskParams>(cull_rprims_task_it->second.Id, pxr::HdTokens->params);
+        if (CullRprimsParams.Transform != Params.Transform)
+        {
+            CullRprimsParams.Transform = Params.Transform;
+            SetTaskParams(TaskUID_CullRprims, CullRprimsParams);
+        }
+    }
 }
 
 void HnTaskManager::CreatePostProcessTask()
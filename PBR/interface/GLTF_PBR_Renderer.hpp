@@ -42,6 +42,8 @@ namespace HLSL
 struct PBRMaterialBasicAttribs;
 }
 
+struct IThreadPool;
+
 /// Implementation of a GLTF PBR renderer
 class GLTF_PBR_Renderer : public PBR_Renderer
 {
@@ -58,6 +60,18 @@ public:
         TEXTURE_FORMAT DSVFormat = TEX_FORMAT_UNKNOWN;
 
         bool FrontCounterClockwise = false;
+
+        /// Whether to pack the attributes of multiple primitives into the primitive attributes buffer.
+
+        /// When this flag is set, the renderer writes the attributes of all primitives into
+        /// a large buffer that is mapped once and selects the attributes of every draw call
+        /// using the dynamic buffer offset, similar to how Hydrogent render pass does this.
+        /// Otherwise, the buffer is mapped with MAP_FLAG_DISCARD for every primitive.
+        bool PackPrimitiveAttribs = false;
+
+        /// The size of the primitive attributes buffer created by the renderer when
+        /// PackPrimitiveAttribs is true and pPrimitiveAttribsCB is null.
+        Uint32 PackedPrimitiveAttribsBufferSize = 65536;
     };
 
     /// Initializes the renderer
@@ -66,12 +80,76 @@ public:
                       IDeviceContext*    pCtx,
                       const CreateInfo&  CI);
 
+    /// Vertex streams that contain the vertices of the skinned primitives transformed by the joint matrices.
+    ///
+    /// \remarks   The streams are created by CreateSkinnedVertexStreams() and updated once per frame by
+    ///            ComputeSkinning(). When the streams are passed to Render() or RenderParallel() through
+    ///            RenderInfo::pSkinnedStreams, the skinned primitives are rendered as static geometry, so
+    ///            that skinning is not repeated in every pass that renders the model (main view, shadow
+    ///            cascades, etc.).
+    ///
+    ///            The streams are indexed by the vertex index relative to the model base vertex.
+    struct SkinnedVertexStreams
+    {
+        /// Pre-skinned vertex buffers that replace the model vertex buffers in the same slots.
+        /// Only the slots that contain positions, normals or tangents are replaced, other elements are null.
+        std::array<RefCntAutoPtr<IBuffer>, 8> VertexBuffers;
+
+        /// Vertex strides of the model vertex buffers.
+        std::array<Uint32, 8> VertexStrides = {};
+
+        /// Previous-frame skinned positions (float3 per vertex) that are bound to the slot returned by
+        /// GetPrevPositionBufferSlot(). Null if the streams were created without motion vectors.
+        RefCntAutoPtr<IBuffer> PrevPositions;
+
+        /// Indicates whether the primitives of the node with the given index are pre-skinned.
+        /// Nodes whose mesh is shared with other skinned nodes are skinned in the vertex shader.
+        std::vector<bool> PreSkinnedNodes;
+
+        /// Current and previous-frame joint matrices of all skins.
+        RefCntAutoPtr<IBuffer> JointMatrices;
+
+        /// Skinning SRB for every element of VertexBuffers.
+        std::array<RefCntAutoPtr<IShaderResourceBinding>, 8> SRBs;
+
+        /// Locations of the skinned attributes in the model vertex buffers.
+        Uint32 PosSlot       = 0;
+        Uint32 PosOffset     = 0;
+        Uint32 NormalSlot    = ~0u;
+        Uint32 NormalOffset  = 0;
+        Uint32 TangentSlot   = ~0u;
+        Uint32 TangentOffset = 0;
+        Uint32 JointsStride  = 0;
+        Uint32 JointsOffset  = 0;
+        Uint32 WeightsStride = 0;
+        Uint32 WeightsOffset = 0;
+
+        bool IsPreSkinned(const GLTF::Node& Node) const
+        {
+            return Node.Index >= 0 && static_cast<size_t>(Node.Index) < PreSkinnedNodes.size() && PreSkinnedNodes[Node.Index];
+        }
+
+        explicit operator bool() const
+        {
+            return !PreSkinnedNodes.empty();
+        }
+    };
+
     /// Rendering information
     struct RenderInfo
     {
         /// Index of the scene to render
         Uint32 SceneIndex = 0;
 
+        /// Version of the model contents the render lists depend on.
+        ///
+        /// \remarks   The render lists are cached and only rebuilt when the model or the render
+        ///            parameters change (see InvalidateRenderLists()). The application must increment
+        ///            the version when it adds or removes nodes, meshes or primitives, changes the
+        ///            primitive materials, or modifies the material properties that affect the
+        ///            pipeline states, such as the alpha mode or the texture attributes.
+        Uint32 ModelVersion = 0;
+
         /// Model transform matrix
         float4x4 ModelTransform = float4x4::Identity();
 
@@ -96,11 +174,55 @@ public:
         /// Flag indicating which alpha modes to render
         ALPHA_MODE_FLAGS AlphaModes = ALPHA_MODE_FLAG_ALL;
 
+        /// Depth sorting flags
+        enum SORT_FLAGS : Uint32
+        {
+            /// Render primitives in the node order
+            SORT_FLAG_NONE = 0,
+
+            /// Sort alpha-blended primitives back to front
+            SORT_FLAG_BLEND_BACK_TO_FRONT = 1u << 0,
+
+            /// Sort opaque and alpha-masked primitives front to back to maximize early depth test rejection.
+            /// Note that this also prevents batching primitives that use the same pipeline state.
+            SORT_FLAG_OPAQUE_FRONT_TO_BACK = 1u << 1
+        };
+        /// Flags indicating how to sort primitives by their view depth
+        SORT_FLAGS SortFlags = SORT_FLAG_NONE;
+
+        /// Camera view matrix used to compute the view depth of the primitives
+        /// when SortFlags is not SORT_FLAG_NONE.
+        float4x4 ViewMatrix = float4x4::Identity();
+
         DebugViewType DebugView = DebugViewType::None;
 
         PSO_FLAGS Flags = PSO_FLAG_DEFAULT;
 
         bool Wireframe = false;
+
+        /// Depth pass modes
+        enum DEPTH_PASS_MODE : Uint8
+        {
+            /// Render primitives with full shading and the default depth test.
+            DEPTH_PASS_MODE_DEFAULT = 0,
+
+            /// Only render the depth of opaque and alpha-masked primitives
+            /// using the depth-only pipelines (see PBR_Renderer::GetDepthOnlyPSOKey()).
+            /// Render targets are not bound to the pipelines. Alpha-blended primitives are skipped.
+            DEPTH_PASS_MODE_DEPTH_ONLY,
+
+            /// Shade opaque and alpha-masked primitives with the EQUAL depth test and disabled depth writes.
+            /// The depth buffer must contain the depth rendered by the DEPTH_PASS_MODE_DEPTH_ONLY pass with the
+            /// same parameters, so that every pixel is shaded only once regardless of the overdraw.
+            /// Alpha-blended primitives are rendered with the default depth test.
+            DEPTH_PASS_MODE_EQUAL
+        };
+        /// Depth pass mode, see DEPTH_PASS_MODE.
+        DEPTH_PASS_MODE DepthPassMode = DEPTH_PASS_MODE_DEFAULT;
+
+        /// Optional pre-skinned vertex streams of the model (see SkinnedVertexStreams).
+        /// If null, skinning is performed in the vertex shader.
+        const SkinnedVertexStreams* pSkinnedStreams = nullptr;
     };
 
     /// GLTF Model shader resource binding information
@@ -109,9 +231,31 @@ public:
         void Clear()
         {
             MaterialSRB.clear();
+            MaterialTextureIds.clear();
+            MaterialRange.reset();
+            DirtyMaterials.clear();
         }
         /// Shader resource binding for every material
+        ///
+        /// \remarks   In SHADER_TEXTURE_ARRAY_MODE_DYNAMIC mode, all materials share the same SRB.
         std::vector<RefCntAutoPtr<IShaderResourceBinding>> MaterialSRB;
+
+        /// Indices of the material textures in the shader textures array, for every material
+        /// and every texture attribute: MaterialTextureIds[MaterialId * TEXTURE_ATTRIB_ID_COUNT + TextureAttribId].
+        ///
+        /// \remarks   The indices are only used in SHADER_TEXTURE_ARRAY_MODE_DYNAMIC mode and
+        ///            are written to the TextureSlice field of the texture attributes.
+        std::vector<float> MaterialTextureIds;
+
+        /// Range of the model materials in the material buffer, or null if the
+        /// material buffer is disabled (see PBR_Renderer::CreateInfo::MaxMaterialCount).
+        MaterialBufferRangePtr MaterialRange;
+
+        /// Flags indicating the materials that need to be uploaded to the material buffer.
+        ///
+        /// \remarks   All materials are marked dirty when the bindings are created. An application
+        ///            that modifies a material must set its flag so that the renderer re-uploads it.
+        std::vector<bool> DirtyMaterials;
     };
 
     /// GLTF resource cache shader resource binding information
@@ -143,7 +287,122 @@ public:
                 ModelResourceBindings*       pModelBindings,
                 ResourceCacheBindings*       pCacheBindings = nullptr);
 
+    /// Parallel rendering information
+    struct ParallelRenderInfo
+    {
+        /// Deferred contexts to record the rendering commands to.
+        /// Every context records a contiguous range of the draw list, and the
+        /// resulting command lists are executed in order by the immediate context.
+        IDeviceContext* const* ppDeferredContexts = nullptr;
+
+        /// The number of deferred contexts in ppDeferredContexts.
+        Uint32 NumDeferredContexts = 0;
+
+        /// Thread pool to record the command lists in.
+        /// If null, all command lists are recorded by the calling thread.
+        IThreadPool* pThreadPool = nullptr;
+
+        /// The number of render targets to bind in every deferred context.
+        Uint32 NumRenderTargets = 0;
+
+        /// Render target views to bind in every deferred context.
+        ITextureView* const* ppRTVs = nullptr;
+
+        /// Depth-stencil view to bind in every deferred context.
+        ITextureView* pDSV = nullptr;
+
+        /// Optional viewport to set in every deferred context.
+        /// If null, the viewport covering the entire render target is used.
+        const Viewport* pViewport = nullptr;
+
+        /// The minimum number of primitives to record in a single command list.
+        /// Fewer deferred contexts are used if there are not enough primitives.
+        Uint32 MinPrimitivesPerContext = 64;
+    };
+
+    /// Renders a GLTF model by recording the draw list into multiple deferred contexts in parallel.
+
+    /// \param [in] pImmediateCtx  - Immediate context to execute the command lists in.
+    /// \param [in] ParallelInfo   - Parallel rendering information.
+    /// \param [in] GLTFModel      - GLTF model to render.
+    /// \param [in] Transforms     - The model transforms.
+    /// \param [in] PrevTransforms - The model transforms from the previous frame.
+    /// \param [in] RenderParams   - Render parameters.
+    /// \param [in] pModelBindings - The model's shader resource binding information.
+    /// \param [in] pCacheBindings - Shader resource cache binding information, if the
+    ///                              model has been created using the cache.
+    ///
+    /// \remarks   Render targets, vertex and index buffers as well as shader resources must be in
+    ///            correct states, as deferred contexts do not perform state transitions.
+    ///            The primitive attributes and joints buffers must be dynamic: every deferred context
+    ///            maps them with MAP_FLAG_DISCARD, which gives every worker its own range in the
+    ///            dynamic ring buffer.
+    ///
+    ///            The frame attributes buffer bound to the SRBs, on the contrary, must be created with
+    ///            USAGE_DEFAULT and updated with IDeviceContext::UpdateBuffer() in the immediate context
+    ///            before this method is called. A dynamic buffer is only valid in the contexts it has
+    ///            been mapped in in the current frame, and the workers never map the frame attributes.
+    ///
+    ///            Executing command lists resets the immediate context state, so the application
+    ///            must restore render targets, vertex buffers, etc. after this method returns.
+    void RenderParallel(IDeviceContext*              pImmediateCtx,
+                        const ParallelRenderInfo&    ParallelInfo,
+                        const GLTF::Model&           GLTFModel,
+                        const GLTF::ModelTransforms& Transforms,
+                        const GLTF::ModelTransforms* PrevTransforms,
+                        const RenderInfo&            RenderParams,
+                        ModelResourceBindings*       pModelBindings,
+                        ResourceCacheBindings*       pCacheBindings = nullptr);
+
+    /// Invalidates the cached render lists.
+
+    /// \remarks   Render() and RenderParallel() cache the render lists with the resolved pipeline
+    ///            states and only rebuild them when the model address, RenderInfo::ModelVersion
+    ///            or the render parameters change. The model contents are not inspected every frame.
+    ///            The application must call this method when it destroys a model, since a new model may
+    ///            be allocated at the same address, and when it changes the model in a way that is not
+    ///            reflected by RenderInfo::ModelVersion.
+    void InvalidateRenderLists()
+    {
+        m_RenderListsKey = {};
+    }
+
+    /// Creates the vertex streams for the compute skinning pre-pass.
+
+    /// \param [in] GLTFModel            - GLTF model to create the streams for.
+    /// \param [in] ComputeMotionVectors - Whether to also compute the previous-frame positions
+    ///                                    required by PSO_FLAG_COMPUTE_MOTION_VECTORS.
+    ///
+    /// \remarks   The model index buffer and the vertex buffers that contain positions, normals, tangents,
+    ///            joints and weights must be raw buffers with the BIND_SHADER_RESOURCE flag, so that they
+    ///            can be read by the compute shader. If this is not the case, or compute shaders are not
+    ///            supported, the method returns empty streams, and skinning is performed in the vertex shader.
+    SkinnedVertexStreams CreateSkinnedVertexStreams(const GLTF::Model& GLTFModel,
+                                                    bool               ComputeMotionVectors);
+
+    /// Skins the vertices of the model into the pre-skinned vertex streams.
+
+    /// \param [in] pCtx           - Device context to record the compute commands to.
+    /// \param [in] GLTFModel      - GLTF model the streams were created for.
+    /// \param [in] Transforms     - The model transforms.
+    /// \param [in] PrevTransforms - The model transforms from the previous frame.
+    ///                              If null, the current transforms are used.
+    /// \param [in] Streams        - The streams to update.
+    ///
+    /// \remarks   The method should be called once per frame before the model is rendered.
+    ///            It leaves the streams in RESOURCE_STATE_VERTEX_BUFFER state.
+    void ComputeSkinning(IDeviceContext*              pCtx,
+                         const GLTF::Model&           GLTFModel,
+                         const GLTF::ModelTransforms& Transforms,
+                         const GLTF::ModelTransforms* PrevTransforms,
+                         SkinnedVertexStreams&        Streams);
+
     /// Creates resource bindings for a given GLTF model
+
+    /// \remarks   In SHADER_TEXTURE_ARRAY_MODE_DYNAMIC mode, the method creates a single SRB
+    ///            that references all textures of the model in the shader textures array.
+    ///            If the model uses more textures than MaterialTexturesArraySize, the remaining
+    ///            textures are replaced with the default textures.
     ModelResourceBindings CreateResourceBindings(GLTF::Model& GLTFModel,
                                                  IBuffer*     pFrameAttribs);
 
@@ -235,6 +494,12 @@ public:
 
     /// Prepares the renderer for rendering objects.
     /// This method must be called at least once per frame.
+    ///
+    /// \remarks   In JOINTS_BUFFER_MODE_STRUCTURED mode, the method also resets the joint palette.
+    ///            Every model transforms object gets its own palette range by the first Render() or
+    ///            RenderParallel() call that uses it, which is kept until the next call to Begin().
+    ///            Subsequent calls only upload the joint matrices again if they have changed,
+    ///            e.g. when the transforms are updated between a shadow pass and the main pass.
     void Begin(IDeviceContext* pCtx);
 
 
@@ -257,37 +522,283 @@ public:
         size_t          CustomDataSize = 0;
 
         HLSL::PBRMaterialBasicAttribs** pMaterialBasicAttribsDstPtr = nullptr;
+
+        // Index of the first instance transform in the instance transforms buffer.
+        // Only used by PSOs with PSO_FLAG_USE_INSTANCE_TRANSFORMS flag.
+        Uint32 FirstInstance = 0;
+
+        // Index of the first joint matrix in the structured joint palette.
+        // Only used in JOINTS_BUFFER_MODE_STRUCTURED mode.
+        Uint32 FirstJoint = 0;
+
+        // Optional shader texture array indices of the material textures, indexed by TEXTURE_ATTRIB_ID
+        // (see ModelResourceBindings::MaterialTextureIds). If not null, the indices override the
+        // TextureSlice values of the material texture attributes.
+        const float* MaterialTextureIds = nullptr;
+
+        // Index of the material in the material buffer. If not ~0u, the material attributes are
+        // not written to the primitive attributes, and BaseColorFactor is written instead.
+        Uint32 MaterialId = ~0u;
+
+        // Multiplier of the material base color that is used with the material buffer.
+        float4 BaseColorFactor{1, 1, 1, 1};
     };
     static void* WritePBRPrimitiveShaderAttribs(void*                                           pDstShaderAttribs,
                                                 const PBRPrimitiveShaderAttribsData&            AttribsData,
                                                 const std::array<int, TEXTURE_ATTRIB_ID_COUNT>& TextureAttribIndices,
                                                 const GLTF::Material&                           Material);
 
+    /// Writes the material attributes (PBRMaterialShaderInfo) for the given PSO flags.
+    ///
+    /// \param [out] pDstShaderAttribs          - Destination memory.
+    /// \param [in]  PSOFlags                   - PSO flags that define the attributes layout.
+    /// \param [in]  TextureAttribIndices       - Texture attribute indices (see PBR_Renderer::CreateInfo::TextureAttribIndices).
+    /// \param [in]  Material                   - Material to write.
+    /// \param [in]  MaterialTextureIds         - Optional shader texture array indices of the material textures.
+    /// \param [out] ppMaterialBasicAttribsDst  - Optional pointer to the variable that receives the
+    ///                                           address of the written basic attributes.
+    /// \param [in]  AllowMissingAttribs        - Whether the material may not have the attributes of the
+    ///                                           extensions enabled by PSOFlags. Such attributes are zeroed out.
+    ///                                           This is the case for the material buffer layout that is
+    ///                                           shared by all materials.
+    ///
+    /// \return    A pointer to the memory after the last written attribute.
+    static void* WritePBRMaterialShaderAttribs(void*                                           pDstShaderAttribs,
+                                               PSO_FLAGS                                       PSOFlags,
+                                               const std::array<int, TEXTURE_ATTRIB_ID_COUNT>& TextureAttribIndices,
+                                               const GLTF::Material&                           Material,
+                                               const float*                                    MaterialTextureIds        = nullptr,
+                                               HLSL::PBRMaterialBasicAttribs**                 ppMaterialBasicAttribsDst = nullptr,
+                                               bool                                            AllowMissingAttribs       = false);
+
     PSO_FLAGS GetMaterialPSOFlags(const GLTF::Material& Mat) const;
 
 private:
     static ALPHA_MODE GltfAlphaModeToAlphaMode(GLTF::Material::ALPHA_MODE GltfAlphaMode);
 
-private:
-    RenderInfo m_RenderParams;
+    // Calls the handler for every material texture enabled in the renderer settings.
+    // If the material does not use the texture, the default texture is passed to the handler.
+    void ProcessMaterialTextures(GLTF::Model&                                                 Model,
+                                 const GLTF::Material&                                        Material,
+                                 const std::function<void(TEXTURE_ATTRIB_ID, ITextureView*)>& Handler) const;
+
+    // Uploads the dirty materials of the model to the material buffer.
+    void UpdateMaterialBuffer(IDeviceContext*        pCtx,
+                              const GLTF::Model&     GLTFModel,
+                              ModelResourceBindings& Bindings);
+
+    // Creates a single SRB for all materials of the model in SHADER_TEXTURE_ARRAY_MODE_DYNAMIC mode.
+    ModelResourceBindings CreateBindlessResourceBindings(GLTF::Model& GLTFModel,
+                                                         IBuffer*     pFrameAttribs);
 
     struct PrimitiveRenderInfo
     {
         const GLTF::Primitive& Primitive;
         const GLTF::Node&      Node;
 
-        PrimitiveRenderInfo(const GLTF::Primitive& _Primitive,
-                            const GLTF::Node&      _Node) noexcept :
+        // Pipeline state key and pipeline state resolved when the render list is built.
+        const PSOKey          Key;
+        IPipelineState* const pPSO;
+
+        // Pre-skinned vertex streams, or null if the primitive is skinned in the vertex shader or is not skinned.
+        const SkinnedVertexStreams* const pSkinnedStreams;
+
+        PrimitiveRenderInfo(const GLTF::Primitive&      _Primitive,
+                            const GLTF::Node&           _Node,
+                            const PSOKey&               _Key,
+                            IPipelineState*             _pPSO,
+                            const SkinnedVertexStreams* _pSkinnedStreams) noexcept :
             Primitive{_Primitive},
-            Node{_Node}
+            Node{_Node},
+            Key{_Key},
+            pPSO{_pPSO},
+            pSkinnedStreams{_pSkinnedStreams}
         {}
     };
+
+    bool PrepareRenderLists(const GLTF::Model&           GLTFModel,
+                            const GLTF::ModelTransforms& Transforms,
+                            const RenderInfo&            RenderParams,
+                            ModelResourceBindings*       pModelBindings,
+                            ResourceCacheBindings*       pCacheBindings);
+
+    void BuildRenderLists(const GLTF::Model& GLTFModel,
+                          const RenderInfo&  RenderParams);
+
+    // Reorders the render list of the given alpha mode. Order[i] is the index of the primitive
+    // in the current list that is moved to position i.
+    void ApplyRenderListOrder(GLTF::Material::ALPHA_MODE AlphaMode, const std::vector<Uint32>& Order);
+
+    static PSO_FLAGS GetVertexAttribPSOFlags(const GLTF::Model& GLTFModel);
+
+    PSOKey GetPrimitivePSOKey(const GLTF::Material& Material,
+                              PSO_FLAGS             VertexAttribFlags,
+                              const RenderInfo&     RenderParams) const;
+
+    // Location of the joint matrices of one model transforms in the structured joint palette.
+    struct JointPaletteAllocation
+    {
+        // Index of the first joint matrix of every skin in the palette.
+        std::vector<Uint32> SkinFirstJoint;
+
+        // The total number of joints of all skins.
+        Uint32 NumJoints = 0;
+
+        // The current and previous joint matrices in the palette. The transforms may be updated
+        // and rendered again before the next call to Begin() (e.g. by another view), so the
+        // matrices are compared with these copies every time the transforms are rendered.
+        std::vector<Uint8> JointsData;
+        std::vector<Uint8> PrevJointsData;
+    };
+
+    // Writes the joint matrices of all skins to the structured joint palette unless the same
+    // matrices have already been written since the last call to Begin().
+    // Returns null in JOINTS_BUFFER_MODE_UNIFORM mode or if the palette is full.
+    const JointPaletteAllocation* UpdateJointPalette(IDeviceContext*              pCtx,
+                                                     const GLTF::ModelTransforms& Transforms,
+                                                     const GLTF::ModelTransforms& PrevTransforms,
+                                                     bool                         UpdatePrevJoints);
+
+    Uint32 WriteJointTransforms(IDeviceContext*               pCtx,
+                                const GLTF::Node&             Node,
+                                const GLTF::ModelTransforms&  Transforms,
+                                const GLTF::ModelTransforms&  PrevTransforms,
+                                PSO_FLAGS                     PSOFlags,
+                                const JointPaletteAllocation* pJointPalette,
+                                Uint32&                       FirstJoint);
+
+    void* WritePrimitiveAttribs(void*                        pDstAttribs,
+                                const GLTF::Model&           GLTFModel,
+                                const PrimitiveRenderInfo&   PrimRI,
+                                const GLTF::ModelTransforms& Transforms,
+                                const GLTF::ModelTransforms& PrevTransforms,
+                                const RenderInfo&            RenderParams,
+                                PSO_FLAGS                    PSOFlags,
+                                Uint32                       JointCount,
+                                Uint32                       FirstJoint) const;
+
+    static void DrawPrimitiveGeometry(IDeviceContext*        pCtx,
+                                      const GLTF::Model&     GLTFModel,
+                                      const GLTF::Primitive& Primitive,
+                                      bool                   PreSkinned);
+
+    // Binds the model vertex buffers (pStreams == nullptr) or the pre-skinned vertex streams
+    // unless they are already bound (pBoundStreams).
+    void BindVertexStreams(IDeviceContext*                pCtx,
+                           const GLTF::Model&             GLTFModel,
+                           const SkinnedVertexStreams*    pStreams,
+                           const SkinnedVertexStreams*&   pBoundStreams,
+                           RESOURCE_STATE_TRANSITION_MODE StateTransitionMode) const;
+
+    void DrawPrimitive(IDeviceContext*               pCtx,
+                       const GLTF::Model&            GLTFModel,
+                       const PrimitiveRenderInfo&    PrimRI,
+                       const GLTF::ModelTransforms&  Transforms,
+                       const GLTF::ModelTransforms&  PrevTransforms,
+                       const RenderInfo&             RenderParams,
+                       PSO_FLAGS                     PSOFlags,
+                       const JointPaletteAllocation* pJointPalette);
+
+    struct PreparedDrawItem
+    {
+        const PrimitiveRenderInfo* pPrimRI  = nullptr;
+        IPipelineState*            pPSO     = nullptr;
+        IShaderResourceBinding*    pSRB     = nullptr;
+        PSO_FLAGS                  PSOFlags = PSO_FLAG_NONE;
+
+        // Offset of the primitive attributes in the packed primitive attributes buffer.
+        Uint32 AttribsOffset = 0;
+    };
+
+    void RenderPendingDrawItems(IDeviceContext* pCtx, const GLTF::Model& GLTFModel, const SkinnedVertexStreams*& pBoundStreams);
+
+    // Sorts the render list of the given alpha mode by the view depth of the primitive bounding box centers.
+    void SortRenderList(GLTF::Material::ALPHA_MODE   AlphaMode,
+                        const GLTF::ModelTransforms& Transforms,
+                        const RenderInfo&            RenderParams,
+                        bool                         BackToFront);
+
+private:
+    RenderInfo m_RenderParams;
+
+    // Model bindings passed to the last Render/RenderParallel call, or null if the model is rendered from the resource cache.
+    const ModelResourceBindings* m_pModelBindings = nullptr;
+
     std::array<std::vector<PrimitiveRenderInfo>, GLTF::Material::ALPHA_MODE_NUM_MODES> m_RenderLists;
 
+    // Parameters the render lists were built for. The lists are only rebuilt when the parameters change.
+    struct RenderListsKey
+    {
+        const GLTF::Model*           pModel          = nullptr;
+        Uint32                       ModelVersion    = 0;
+        Uint32                       SceneIndex      = 0;
+        RenderInfo::ALPHA_MODE_FLAGS AlphaModes      = RenderInfo::ALPHA_MODE_FLAG_NONE;
+        RenderInfo::SORT_FLAGS       SortFlags       = RenderInfo::SORT_FLAG_NONE;
+        DebugViewType                DebugView       = DebugViewType::None;
+        PSO_FLAGS                    Flags           = PSO_FLAG_NONE;
+        bool                         Wireframe       = false;
+        RenderInfo::DEPTH_PASS_MODE  DepthPassMode   = RenderInfo::DEPTH_PASS_MODE_DEFAULT;
+        const SkinnedVertexStreams*  pSkinnedStreams = nullptr;
+
+        RenderListsKey() noexcept {}
+        RenderListsKey(const GLTF::Model& Model, const RenderInfo& RenderParams) noexcept;
+
+        bool operator==(const RenderListsKey& rhs) const noexcept;
+        bool operator!=(const RenderListsKey& rhs) const noexcept
+        {
+            return !(*this == rhs);
+        }
+    };
+    RenderListsKey m_RenderListsKey;
+
+    struct DepthSortState
+    {
+        // Sorted order of the render list. Empty if the list has been rebuilt since the last sort.
+        // Otherwise, the list is kept in the previous frame order, which is nearly sorted when the
+        // camera moves a little.
+        std::vector<Uint32> Order;
+        std::vector<Uint32> Keys;
+        std::vector<Uint32> TmpOrder;
+    };
+    std::array<DepthSortState, GLTF::Material::ALPHA_MODE_NUM_MODES> m_DepthSortStates;
+
+    std::vector<PrimitiveRenderInfo> m_SortedRenderList;
+
+    // Flattened draw list with pre-resolved pipeline states and SRBs used by RenderParallel.
+    std::vector<PreparedDrawItem> m_ParallelDrawList;
+
+    // Draw items whose attributes have been written to the packed primitive attributes buffer,
+    // but that have not been rendered yet.
+    std::vector<PreparedDrawItem> m_PendingDrawItems;
+
+    bool m_PackPrimitiveAttribs = false;
+
+    // The primitive attributes buffer range bound in the SRBs.
+    Uint32 m_PrimitiveAttribsRange = 0;
+
+    Uint32 m_ConstantBufferOffsetAlignment = 0;
+
     PsoCacheAccessor m_PbrPSOCache;
     PsoCacheAccessor m_WireframePSOCache;
+    PsoCacheAccessor m_DepthOnlyPSOCache;
+    PsoCacheAccessor m_EqualDepthPSOCache;
+
+    RefCntAutoPtr<IPipelineState> m_SkinningPSO;
+    RefCntAutoPtr<IBuffer>        m_SkinningAttribsCB;
+
+    // Joint palette allocations made since the last call to Begin().
+    std::unordered_map<const GLTF::ModelTransforms*, JointPaletteAllocation> m_JointPaletteAllocations;
+
+    // The number of joints allocated in the palette since the last call to Begin().
+    Uint32 m_JointPaletteSize = 0;
+
+    std::vector<Uint8> m_JointPaletteData;
+
+    // Staging memory for the material buffer updates.
+    std::vector<Uint8> m_MaterialBufferData;
 };
 
 DEFINE_FLAG_ENUM_OPERATORS(GLTF_PBR_Renderer::RenderInfo::ALPHA_MODE_FLAGS)
+DEFINE_FLAG_ENUM_OPERATORS(GLTF_PBR_Renderer::RenderInfo::SORT_FLAGS)
 
 } // namespace Diligent
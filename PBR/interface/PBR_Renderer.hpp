@@ -27,8 +27,13 @@
 #pragma once
 
 #include <unordered_map>
+#include <unordered_set>
 #include <functional>
+#include <memory>
 #include <array>
+#include <vector>
+#include <mutex>
+#include <atomic>
 
 #include "../../../DiligentCore/Platforms/Basic/interface/DebugUtilities.hpp"
 #include "../../../DiligentCore/Graphics/GraphicsEngine/interface/DeviceContext.h"
@@ -38,13 +43,19 @@
 #include "../../../DiligentCore/Graphics/GraphicsTools/interface/ShaderMacroHelper.hpp"
 #include "../../../DiligentCore/Common/interface/RefCntAutoPtr.hpp"
 #include "../../../DiligentCore/Common/interface/HashUtils.hpp"
+#include "../../../DiligentCore/Common/interface/BasicMath.hpp"
 
 namespace Diligent
 {
 
+struct IThreadPool;
+struct IAsyncTask;
+
 namespace HLSL
 {
 struct PBRRendererShaderParameters;
+struct PBRPunctualLightAttribs;
+struct PBRLightClusterAttribs;
 } // namespace HLSL
 
 class PBR_Renderer
@@ -101,6 +112,11 @@ public:
 
         /// Shader textures array is used and the indices are provided dynamically at run time
         /// through the TextureSlice field of the corresponding texture attribute.
+        /// Every texture in the array must be a single-slice texture.
+        ///
+        /// \remarks   In this mode, a single SRB that references all textures may be used
+        ///            to render all materials, which eliminates SRB switches between draw calls.
+        ///            The mode requires bindless resources support.
         SHADER_TEXTURE_ARRAY_MODE_DYNAMIC
     };
 
@@ -111,6 +127,17 @@ public:
         /// A pipeline state can use IBL only if this flag is set to true.
         bool EnableIBL = true;
 
+        /// Whether to represent diffuse IBL with L2 spherical harmonics instead of the irradiance cube map.
+        ///
+        /// \remarks    If this flag is true, PrecomputeCubemaps() projects the environment map onto
+        ///             nine RGB spherical harmonics coefficients with a compute shader, and the PBR shader
+        ///             evaluates the coefficients instead of sampling the irradiance cube map.
+        ///             The irradiance cube map is not created in this mode (GetIrradianceCubeSRV() returns null).
+        ///             Use ComputeIrradianceSH() to only update the diffuse IBL when the environment map changes.
+        ///             The mode requires compute shaders. If the device does not support them,
+        ///             the irradiance cube map is used.
+        bool UseIrradianceSH = false;
+
         /// Whether to use enable ambient occlusion.
         /// A pipeline state can use AO only if this flag is set to true.
         bool EnableAO = true;
@@ -205,8 +232,38 @@ public:
         /// The maximum number of joints.
         ///
         /// If set to 0, the animation will be disabled.
+        ///
+        /// \remarks   In JOINTS_BUFFER_MODE_UNIFORM mode, this is the maximum number of joints in one skin.
+        ///            In JOINTS_BUFFER_MODE_STRUCTURED mode, this is the capacity of the joint palette
+        ///            that holds the joints of all skins rendered in one frame.
         Uint32 MaxJointCount = 64;
 
+        /// Joints buffer mode.
+        enum JOINTS_BUFFER_MODE : Uint8
+        {
+            /// Joint matrices of one skin are stored in the constant buffer that is
+            /// updated for every skinned primitive.
+            JOINTS_BUFFER_MODE_UNIFORM = 0,
+
+            /// Joint matrices of all skins are stored in the structured joint palette
+            /// returned by GetJointsBuffer(). The palette contains MaxJointCount current
+            /// joint matrices followed by MaxJointCount previous-frame matrices, and
+            /// is updated once per frame. The joint matrices of the primitive are selected
+            /// by GLTFNodeShaderTransforms.FirstJoint.
+            ///
+            /// \remarks   Structured joint palette requires structured buffer support in vertex shaders.
+            ///            If it is not supported, the renderer falls back to JOINTS_BUFFER_MODE_UNIFORM.
+            JOINTS_BUFFER_MODE_STRUCTURED,
+        };
+        JOINTS_BUFFER_MODE JointsBufferMode = JOINTS_BUFFER_MODE_UNIFORM;
+
+        /// Whether to store joint matrices in the structured joint palette as 3x4 matrices.
+        ///
+        /// \remarks   The last row of the affine joint matrix is not stored, which reduces
+        ///            the palette size and the bandwidth by a quarter.
+        ///            Only used in JOINTS_BUFFER_MODE_STRUCTURED mode.
+        bool PackJointMatrices = false;
+
         /// The number of samples for BRDF LUT creation
         Uint32 NumBRDFSamples = 512;
 
@@ -232,6 +289,9 @@ public:
         ///                     float4 Color   : ATTRIB6; // If PSO_FLAG_USE_VERTEX_COLORS is set
         ///                     float3 Tangent : ATTRIB7; // If PSO_FLAG_USE_VERTEX_TANGENTS is set
         ///                 };
+        ///
+        ///             If PrimitiveArraySize is not zero, the renderer also adds the per-instance
+        ///             primitive index attribute (see PrimitiveArraySize).
         InputLayoutDesc InputLayout;
 
         /// Conversion mode applied to diffuse, specular and emissive textures.
@@ -276,6 +336,77 @@ public:
         ///             into PSO. The client can use the Key.UserValue to identify the shader indices.
         std::function<StaticShaderTextureIdsArrayType(const PSOKey& Key)> GetStaticShaderTextureIds = nullptr;
 
+        /// The size of the primitive attributes array in the cbPrimitiveAttribs buffer.
+        ///
+        /// \remarks    If this value is zero (default), the shaders use a single
+        ///             primitive attributes structure.
+        ///
+        ///             If this value is not zero, the shaders use an array of PrimitiveArraySize
+        ///             attributes, and the primitive index is read from the per-instance attribute
+        ///
+        ///                 uint PrimitiveID : ATTRIB8;
+        ///
+        ///             that is sourced from the buffer returned by GetPrimitiveIdBuffer() bound to the
+        ///             slot returned by GetPrimitiveIdBufferSlot(). The buffer contains consecutive indices,
+        ///             so the primitive is selected by the FirstInstanceLocation of the draw command.
+        ///             This allows rendering multiple primitives with a single indirect draw call.
+        ///
+        ///             The value is clamped so that the array of primitive attributes for all PSO flags
+        ///             fits into the 64 KB constant buffer range.
+        Uint32 PrimitiveArraySize = 0;
+
+        /// The maximum number of instance transforms in the instance transforms buffer.
+        ///
+        /// \remarks    If this value is not zero, the renderer creates the structured buffer
+        ///             returned by GetInstanceTransformsBuffer() that contains 2 * MaxInstanceCount
+        ///             matrices: current instance transforms followed by previous-frame transforms.
+        ///             PSOs created with PSO_FLAG_USE_INSTANCE_TRANSFORMS flag read the transform
+        ///             of instance i from the element
+        ///
+        ///                 GLTFNodeShaderTransforms.FirstInstance + i
+        ///
+        ///             and apply it to the vertex before the node matrix.
+        ///             Instance transforms require structured buffer support in vertex shaders
+        ///             and can't be combined with primitive arrays (see PrimitiveArraySize).
+        ///             If this value is zero (default), instancing is disabled.
+        Uint32 MaxInstanceCount = 0;
+
+        /// The maximum number of materials in the material buffer.
+        ///
+        /// \remarks    If this value is not zero, the renderer creates the structured buffer
+        ///             returned by GetMaterialsBuffer() that keeps the attributes of MaxMaterialCount
+        ///             materials. Materials are uploaded to the buffer once with UpdateMaterials()
+        ///             and are only re-uploaded when they change. Primitive attributes then only
+        ///             contain the node transforms, the material index (GLTFNodeShaderTransforms.MaterialId)
+        ///             and the base color factor multiplier instead of the copy of the material attributes,
+        ///             which substantially reduces the per-draw upload size.
+        ///
+        ///             All materials in the buffer use the same layout that includes the attributes of all
+        ///             features and textures enabled in the renderer settings (see GetMaterialBufferLayoutFlags()).
+        ///             The material buffer requires structured buffer support in pixel shaders.
+        ///             If this value is zero (default), material attributes are written to the primitive attributes.
+        Uint32 MaxMaterialCount = 0;
+
+        /// The maximum number of punctual lights used by clustered lighting.
+        ///
+        /// \remarks    If this value is not zero, the renderer creates the punctual light buffer returned
+        ///             by GetPunctualLightsBuffer() and the light cluster buffer returned by GetLightClustersBuffer().
+        ///             The lights are uploaded with UpdatePunctualLights() and are binned into the clusters
+        ///             of the froxel grid (see LightClusterGridSize) by BinLights(). PSOs created with
+        ///             PSO_FLAG_USE_LIGHT_CLUSTERS flag find the cluster of the pixel and only apply the lights
+        ///             in this cluster in addition to the frame light (PBRFrameAttribs.Light).
+        ///             Clustered lighting requires compute shaders.
+        ///             If this value is zero (default), clustered lighting is disabled.
+        Uint32 MaxLightCount = 0;
+
+        /// The size of the light cluster grid: the number of screen tiles in
+        /// X and Y directions and the number of depth slices.
+        std::array<Uint32, 3> LightClusterGridSize = {16, 9, 24};
+
+        /// The maximum number of lights in one light cluster.
+        /// Lights that do not fit into the cluster are ignored.
+        Uint32 MaxLightsPerCluster = 64;
+
         /// A pointer to the user-provided primitive attribs buffer.
         /// If null, the renderer will allocate the buffer.
         IBuffer* pPrimitiveAttribsCB = nullptr;
@@ -284,6 +415,15 @@ public:
         /// If null, the renderer will allocate the buffer.
         IBuffer* pJointsBuffer = nullptr;
 
+        /// Thread pool to create pipeline states in asynchronously.
+        ///
+        /// \remarks    If the thread pool is provided and the device supports multithreaded resource
+        ///             creation, PsoCacheAccessor::GetAsync() does not block on the creation of the
+        ///             missing pipeline states, and returns the fallback pipeline states instead
+        ///             (see GetFallbackPSOKey()). Otherwise, GetAsync() creates the pipeline states
+        ///             synchronously.
+        IThreadPool* pAsyncPSOThreadPool = nullptr;
+
         /// Texture attribute index info
         std::array<int, TEXTURE_ATTRIB_ID_COUNT> TextureAttribIndices{};
 
@@ -360,13 +500,116 @@ public:
     ITextureView* GetIrradianceCubeSRV() const     { return m_pIrradianceCubeSRV; }
     ITextureView* GetPrefilteredEnvMapSRV() const  { return m_pPrefilteredEnvMapSRV; }
     ITextureView* GetPreintegratedGGX_SRV() const  { return m_pPreintegratedGGX_SRV; }
+    IBuffer*      GetIrradianceSH_CB() const       { return m_IrradianceSHCB; }
     ITextureView* GetWhiteTexSRV() const           { return m_pWhiteTexSRV; }
     ITextureView* GetBlackTexSRV() const           { return m_pBlackTexSRV; }
     ITextureView* GetDefaultNormalMapSRV() const   { return m_pDefaultNormalMapSRV; }
     IBuffer*      GetPBRPrimitiveAttribsCB() const {return m_PBRPrimitiveAttribsCB;}
     IBuffer*      GetJointsBuffer() const          {return m_JointsBuffer;}
+    IBuffer*      GetInstanceTransformsBuffer() const {return m_InstanceTransformsBuffer;}
+    IBuffer*      GetMaterialsBuffer() const       {return m_MaterialsBuffer;}
+    IBuffer*      GetPunctualLightsBuffer() const  {return m_PunctualLightsBuffer;}
+    IBuffer*      GetLightClustersBuffer() const   {return m_LightClustersBuffer;}
+    IBuffer*      GetPrimitiveIdBuffer() const     {return m_PrimitiveIdBuffer;}
+    Uint32        GetPrimitiveIdBufferSlot() const {return m_PrimitiveIdBufferSlot;}
+    Uint32        GetPrevPositionBufferSlot() const {return m_PrevPositionBufferSlot;}
     // clang-format on
 
+    /// Returns the size of one joint matrix in the joints buffer.
+    Uint32 GetJointMatrixSize() const;
+
+    /// Writes joint matrices to the memory in the format of the joints buffer.
+    ///
+    /// \param [out] pDst       - Destination memory that must be large enough to hold
+    ///                           NumJoints * GetJointMatrixSize() bytes.
+    /// \param [in]  pJoints    - Joint matrices.
+    /// \param [in]  NumJoints  - The number of joint matrices.
+    ///
+    /// \return    A pointer to the memory after the last written matrix.
+    void* WriteJointMatrices(void* pDst, const float4x4* pJoints, Uint32 NumJoints) const;
+
+    /// Range of consecutive materials in the material buffer allocated by AllocateMaterials().
+    struct MaterialBufferRange
+    {
+        const Uint32 FirstMaterialId;
+        const Uint32 NumMaterials;
+    };
+    using MaterialBufferRangePtr = std::shared_ptr<const MaterialBufferRange>;
+
+    /// Allocates NumMaterials consecutive materials in the material buffer.
+    ///
+    /// \return    The allocated range, or null if the material buffer is disabled (see CreateInfo::MaxMaterialCount)
+    ///            or there is not enough space in the buffer.
+    ///            The range is released when the last reference to it is destroyed.
+    ///
+    /// \remarks   The method is thread-safe.
+    MaterialBufferRangePtr AllocateMaterials(Uint32 NumMaterials);
+
+    /// Uploads the attributes of NumMaterials consecutive materials to the material buffer.
+    ///
+    /// \param [in] pCtx            - Device context to record the update commands to.
+    /// \param [in] FirstMaterialId - Index of the first material to update.
+    /// \param [in] NumMaterials    - The number of materials to update.
+    /// \param [in] pData           - Material attributes in the material buffer layout,
+    ///                               GetPBRMaterialAttribsSize(GetMaterialBufferLayoutFlags()) bytes per material.
+    ///
+    /// \remarks   The method leaves the buffer in RESOURCE_STATE_SHADER_RESOURCE state.
+    void UpdateMaterials(IDeviceContext* pCtx, Uint32 FirstMaterialId, Uint32 NumMaterials, const void* pData);
+
+    /// Uploads NumLights consecutive punctual lights to the punctual light buffer.
+    ///
+    /// \param [in] pCtx       - Device context to record the update commands to.
+    /// \param [in] FirstLight - Index of the first light to update.
+    /// \param [in] NumLights  - The number of lights to update.
+    ///                          FirstLight + NumLights must not exceed CreateInfo::MaxLightCount.
+    /// \param [in] pLights    - Punctual lights.
+    ///
+    /// \remarks   Lights with zero intensity are not binned into the light clusters.
+    ///            The method leaves the buffer in RESOURCE_STATE_SHADER_RESOURCE state.
+    void UpdatePunctualLights(IDeviceContext* pCtx, Uint32 FirstLight, Uint32 NumLights, const HLSL::PBRPunctualLightAttribs* pLights);
+
+    /// Initializes the light cluster attributes (PBRFrameAttribs.LightClusters).
+    ///
+    /// \param [out] Attribs   - Light cluster attributes.
+    /// \param [in]  ZNear     - Camera near plane distance.
+    /// \param [in]  ZFar      - Camera far plane distance.
+    /// \param [in]  NumLights - The number of lights in the punctual light buffer.
+    void SetLightClusterAttribs(HLSL::PBRLightClusterAttribs& Attribs, float ZNear, float ZFar, Uint32 NumLights) const;
+
+    /// Bins the punctual lights into the light clusters.
+    ///
+    /// \param [in] pCtx          - Device context to record the commands to.
+    /// \param [in] pFrameAttribs - Frame attributes buffer that contains the camera and the light
+    ///                             cluster attributes (see SetLightClusterAttribs()).
+    ///
+    /// \remarks   The lights must be binned every time the lights or the camera change,
+    ///            before the PSOs with PSO_FLAG_USE_LIGHT_CLUSTERS flag are used.
+    ///            The method leaves the light cluster buffer in RESOURCE_STATE_SHADER_RESOURCE state.
+    void BinLights(IDeviceContext* pCtx, IBuffer* pFrameAttribs);
+
+    /// Bins the punctual lights into the light clusters on the CPU.
+    ///
+    /// \param [in]  ViewProj    - Camera view-projection matrix.
+    /// \param [in]  Attribs     - Light cluster attributes.
+    /// \param [in]  pLights     - Punctual lights, Attribs.NumLights elements.
+    /// \param [out] ClusterData - Light clusters in the layout of the light cluster buffer.
+    ///
+    /// \remarks   This is the reference implementation of BinLights() that performs the same
+    ///            intersection tests, and is intended to validate the GPU results.
+    ///            The lights in every cluster are sorted by index, while BinLights()
+    ///            writes them in arbitrary order.
+    void BinLightsReference(const float4x4&                      ViewProj,
+                            const HLSL::PBRLightClusterAttribs&  Attribs,
+                            const HLSL::PBRPunctualLightAttribs* pLights,
+                            std::vector<Uint32>&                 ClusterData) const;
+
+    /// Computes the irradiance spherical harmonics from the environment map.
+    ///
+    /// \remarks   The method is only available when CreateInfo::UseIrradianceSH is true,
+    ///            and is also called by PrecomputeCubemaps().
+    ///            The method leaves the irradiance SH buffer in RESOURCE_STATE_CONSTANT_BUFFER state.
+    void ComputeIrradianceSH(IDeviceContext* pCtx, ITextureView* pEnvironmentMap);
+
     /// Precompute cubemaps used by IBL.
     void PrecomputeCubemaps(IDeviceContext* pCtx,
                             ITextureView*   pEnvironmentMap,
@@ -374,6 +617,39 @@ public:
                             Uint32          NumThetaSamples = 32,
                             bool            OptimizeSamples = true);
 
+    /// Writes the precomputed IBL textures to a cache file.
+    ///
+    /// \param [in] pCtx        - Device context used to read the textures back.
+    /// \param [in] FilePath    - Cache file path.
+    /// \param [in] EnvMapHash  - Hash of the environment map that was passed to PrecomputeCubemaps().
+    ///
+    /// \remarks    The cache contains the preintegrated GGX BRDF, the irradiance cube map
+    ///             (or the irradiance SH coefficients) and the prefiltered environment map.
+    ///             The cache key combines the environment map hash with the sample settings of the last
+    ///             PrecomputeCubemaps() call, so the method must be called after PrecomputeCubemaps().
+    ///             The method waits for the GPU to finish reading the textures back, and is intended
+    ///             to be used by offline tools or at load time.
+    bool SaveIBLCache(IDeviceContext* pCtx, const char* FilePath, Uint64 EnvMapHash);
+
+    /// Loads the IBL textures from the cache file written by SaveIBLCache().
+    ///
+    /// \param [in] pCtx            - Device context used to upload the textures.
+    /// \param [in] FilePath        - Cache file path.
+    /// \param [in] EnvMapHash      - Hash of the environment map.
+    /// \param [in] NumPhiSamples   - Sample settings that would be passed to PrecomputeCubemaps().
+    /// \param [in] NumThetaSamples
+    /// \param [in] OptimizeSamples
+    ///
+    /// \return     true if the textures were loaded from the cache, and false if the file is missing or
+    ///             was written for a different environment map, sample settings or renderer settings.
+    ///             In the latter case, the application should call PrecomputeCubemaps().
+    bool LoadIBLCache(IDeviceContext* pCtx,
+                      const char*     FilePath,
+                      Uint64          EnvMapHash,
+                      Uint32          NumPhiSamples   = 64,
+                      Uint32          NumThetaSamples = 32,
+                      bool            OptimizeSamples = true);
+
     void CreateResourceBinding(IShaderResourceBinding** ppSRB);
 
 #define PSO_FLAG_BIT(Bit) (Uint64{1} << Uint64{Bit})
@@ -423,8 +699,25 @@ public:
         PSO_FLAG_ENABLE_TONE_MAPPING       = PSO_FLAG_BIT(34),
         PSO_FLAG_UNSHADED                  = PSO_FLAG_BIT(35),
         PSO_FLAG_COMPUTE_MOTION_VECTORS    = PSO_FLAG_BIT(36),
+        PSO_FLAG_USE_INSTANCE_TRANSFORMS   = PSO_FLAG_BIT(37),
+
+        // Previous-frame vertex positions are read from the per-vertex attribute
+        //     float3 PrevPos : ATTRIB9;
+        // sourced from the slot returned by GetPrevPositionBufferSlot() instead of
+        // being computed from the previous joint transforms. This is used to render
+        // the vertices that have been skinned by a compute pre-pass.
+        PSO_FLAG_USE_PREV_VERTEX_POSITIONS = PSO_FLAG_BIT(38),
+
+        // Only depth is rendered: opaque primitives are rendered without a pixel shader,
+        // and alpha-masked primitives only read the base color to discard the masked pixels.
+        // The flag should be set through GetDepthOnlyPSOKey() that removes the flags
+        // that do not affect the depth.
+        PSO_FLAG_DEPTH_ONLY = PSO_FLAG_BIT(39),
+
+        // Punctual lights of the pixel light cluster are applied (see CreateInfo::MaxLightCount).
+        PSO_FLAG_USE_LIGHT_CLUSTERS = PSO_FLAG_BIT(40),
 
-        PSO_FLAG_LAST = PSO_FLAG_COMPUTE_MOTION_VECTORS,
+        PSO_FLAG_LAST = PSO_FLAG_USE_LIGHT_CLUSTERS,
 
         PSO_FLAG_FIRST_USER_DEFINED = PSO_FLAG_LAST << 1ull,
 
@@ -553,6 +846,29 @@ public:
             return m_pRenderer->GetPSO(*m_pPsoHashMap, *m_pGraphicsDesc, Key, CreateIfNull);
         }
 
+        /// Returns the PSO for the given key without waiting for it to be created.
+        ///
+        /// \param [in]  Key     - PSO key.
+        /// \param [out] UsedKey - The key of the returned PSO.
+        ///
+        /// \remarks    If the PSO does not exist and asynchronous PSO creation is enabled
+        ///             (see CreateInfo::pAsyncPSOThreadPool), the PSO is queued for creation in the
+        ///             thread pool, and the fallback PSO is returned (see GetFallbackPSOKey()).
+        ///             The fallback PSO is created synchronously if it does not exist.
+        ///             The PSO is returned by subsequent calls once it is created
+        ///             (see GetAsyncPSOVersion()).
+        ///
+        ///             The primitive attributes must be written using the flags of UsedKey.
+        IPipelineState* GetAsync(const PSOKey& Key, PSOKey& UsedKey) const
+        {
+            if (!*this)
+            {
+                UNEXPECTED("Accessor is not initialized");
+                return nullptr;
+            }
+            return m_pRenderer->GetPSOAsync(*m_pPsoHashMap, *m_pGraphicsDesc, Key, UsedKey);
+        }
+
     private:
         friend PBR_Renderer;
         PsoCacheAccessor(PBR_Renderer&               Renderer,
@@ -571,6 +887,66 @@ public:
 
     PsoCacheAccessor GetPsoCacheAccessor(const GraphicsPipelineDesc& GraphicsDesc);
 
+    /// Writes the manifest of all pipeline states created by the renderer to a file.
+    ///
+    /// \remarks    The manifest records the PSO key and the graphics pipeline description
+    ///             of every pipeline state created in this session, including the pipeline
+    ///             states created by ReplayPSOManifest(). Pipeline states that use explicit
+    ///             render passes are not recorded.
+    ///             The manifest is only compatible with the same build of the renderer.
+    bool SavePSOManifest(const char* FilePath) const;
+
+    /// Creates the pipeline states listed in the manifest file written by SavePSOManifest().
+    ///
+    /// \param [in] FilePath    - Manifest file path.
+    /// \param [in] pThreadPool - Thread pool to create the pipeline states in. If null, or if
+    ///                           the device does not support multithreaded resource creation,
+    ///                           the pipeline states are created synchronously by this thread.
+    ///
+    /// \return     The number of pipeline states that are being created.
+    ///
+    /// \remarks    The method is intended to be called at startup before the first frame is rendered,
+    ///             to avoid compiling the pipelines when they are first used.
+    ///             If the renderer uses the render state cache, shaders are compiled through the
+    ///             cache, so that the replay only loads the bytecode when the cache is warm.
+    ///             The time it takes to create all pipeline states is written to the log.
+    ///
+    ///             GetPSO() picks up the pipeline states created by the worker threads, and
+    ///             creates the pipeline states that are not ready yet itself.
+    ///             Note that the worker threads call the GetPSMainSource and GetStaticShaderTextureIds
+    ///             callbacks.
+    Uint32 ReplayPSOManifest(const char* FilePath, IThreadPool* pThreadPool = nullptr);
+
+    /// Waits until all pipeline states replayed by ReplayPSOManifest() or
+    /// queued by PsoCacheAccessor::GetAsync() are created.
+    void WaitForPSOManifestReplay();
+
+    /// Returns the key of the pipeline state that is used while the pipeline state
+    /// for the given key is being created asynchronously.
+    ///
+    /// \remarks    The fallback pipeline state keeps the vertex inputs and shader outputs of the key,
+    ///             but only uses the base color texture and does not use the material extensions and
+    ///             debug views. It is shared by many keys and is thus typically created already.
+    static PSOKey GetFallbackPSOKey(const PSOKey& Key);
+
+    /// Returns the key of the depth-only pipeline state for the given key.
+    ///
+    /// \remarks    The depth-only key only keeps the flags that affect the vertex positions
+    ///             (joints, instance transforms and user-defined flags). Keys with alpha modes other
+    ///             than ALPHA_MODE_OPAQUE also keep the base color texture, vertex colors and texture
+    ///             coordinates, which are needed to discard the pixels of alpha-masked materials.
+    ///             Normals, tangents, material extensions and shader outputs are removed, so that
+    ///             opaque primitives use a position-only vertex layout and no pixel shader.
+    ///
+    ///             Depth-only pipelines are typically created with a graphics pipeline description that
+    ///             has no render targets, and are used to render shadow maps and depth prepasses.
+    ///             The primitive attributes must be written using the flags of the returned key.
+    static PSOKey GetDepthOnlyPSOKey(const PSOKey& Key);
+
+    /// Returns the version that is incremented every time a pipeline state is created asynchronously.
+    /// Users that hold fallback pipeline states should request the pipeline states again when it changes.
+    Uint32 GetAsyncPSOVersion() const { return m_AsyncPSOVersion.load(); }
+
     void InitCommonSRBVars(IShaderResourceBinding* pSRB, IBuffer* pFrameAttribs) const;
     void SetMaterialTexture(IShaderResourceBinding* pSRB, ITextureView* pTexSRV, TEXTURE_ATTRIB_ID TextureId) const;
 
@@ -583,6 +959,12 @@ public:
     /// Returns the PBR primitive attributes shader data size for the given PSO flags.
     Uint32 GetPBRPrimitiveAttribsSize(PSO_FLAGS Flags) const;
 
+    /// Returns the size of the material attributes (PBRMaterialShaderInfo) for the given PSO flags.
+    Uint32 GetPBRMaterialAttribsSize(PSO_FLAGS Flags) const;
+
+    /// Returns the PSO flags that define the layout of the materials in the material buffer.
+    PSO_FLAGS GetMaterialBufferLayoutFlags() const { return m_MaterialBufferLayoutFlags; }
+
     const CreateInfo& GetSettings() const { return m_Settings; }
 
     inline static constexpr PSO_FLAGS GetTextureAttribPSOFlag(TEXTURE_ATTRIB_ID AttribId);
@@ -601,16 +983,53 @@ protected:
                            const PSOKey&               Key,
                            bool                        CreateIfNull);
 
-    static std::string GetVSOutputStruct(PSO_FLAGS PSOFlags, bool UseVkPointSize);
+    IPipelineState* GetPSOAsync(PsoHashMapType&             PsoHashMap,
+                                const GraphicsPipelineDesc& GraphicsDesc,
+                                const PSOKey&               Key,
+                                PSOKey&                     UsedKey);
+
+    static std::string GetVSOutputStruct(PSO_FLAGS PSOFlags, bool UseVkPointSize, bool UsePrimitiveId);
     static std::string GetPSOutputStruct(PSO_FLAGS PSOFlags);
 
 private:
     void PrecomputeBRDF(IDeviceContext* pCtx,
                         Uint32          NumBRDFSamples = 512);
 
+    Uint64 ComputeIBLSettingsHash(Uint32 NumPhiSamples, Uint32 NumThetaSamples, bool OptimizeSamples) const;
+
     void CreatePSO(PsoHashMapType& PsoHashMap, const GraphicsPipelineDesc& GraphicsDesc, const PSOKey& Key);
     void CreateSignature();
 
+    // Removes the flags of the features that are disabled in the renderer settings.
+    PSO_FLAGS GetSupportedPSOFlags(PSO_FLAGS Flags) const;
+
+    // Returns the flags that define the layout of the materials in the material buffer.
+    PSO_FLAGS ComputeMaterialBufferLayoutFlags() const;
+
+    struct PSOManifestEntry
+    {
+        GraphicsPipelineDesc GraphicsDesc;
+        PSOKey               Key;
+
+        bool operator==(const PSOManifestEntry& rhs) const noexcept
+        {
+            return GraphicsDesc == rhs.GraphicsDesc && Key == rhs.Key;
+        }
+
+        struct Hasher
+        {
+            size_t operator()(const PSOManifestEntry& Entry) const noexcept
+            {
+                return ComputeHash(std::hash<GraphicsPipelineDesc>{}(Entry.GraphicsDesc), PSOKey::Hasher{}(Entry.Key));
+            }
+        };
+    };
+    // Queues the creation of the pipeline states for the entry in the thread pool.
+    void EnqueuePSOCreation(const PSOManifestEntry& Entry, IThreadPool* pThreadPool, std::function<void()> OnCreated = nullptr);
+
+    // Moves the pipeline states created by the worker threads to m_PSOs.
+    void CommitAsyncPSOs();
+
 protected:
     const InputLayoutDescX m_InputLayout;
 
@@ -633,21 +1052,75 @@ protected:
     static constexpr Uint32         IrradianceCubeDim    = 64;
     static constexpr Uint32         PrefilteredEnvMapDim = 256;
 
+    static constexpr Uint32 PrefilterEnvMapThreadGroupSize = 8;
+
     RefCntAutoPtr<ITextureView>           m_pIrradianceCubeSRV;
     RefCntAutoPtr<ITextureView>           m_pPrefilteredEnvMapSRV;
     RefCntAutoPtr<IPipelineState>         m_pPrecomputeIrradianceCubePSO;
     RefCntAutoPtr<IPipelineState>         m_pPrefilterEnvMapPSO;
     RefCntAutoPtr<IShaderResourceBinding> m_pPrecomputeIrradianceCubeSRB;
     RefCntAutoPtr<IShaderResourceBinding> m_pPrefilterEnvMapSRB;
+    RefCntAutoPtr<IPipelineState>         m_pPrefilterEnvMapCSPSO;
+    RefCntAutoPtr<IShaderResourceBinding> m_pPrefilterEnvMapCSSRB;
+
+    // Hash of the settings the IBL textures were last precomputed with, zero if they were never computed.
+    Uint64 m_IBLSettingsHash = 0;
+
+    // Irradiance SH coefficients are computed in the structured buffer and copied to the constant buffer
+    RefCntAutoPtr<IBuffer>                m_IrradianceSHBuffer;
+    RefCntAutoPtr<IBuffer>                m_IrradianceSHCB;
+    RefCntAutoPtr<IPipelineState>         m_pComputeIrradianceSHPSO;
+    RefCntAutoPtr<IShaderResourceBinding> m_pComputeIrradianceSHSRB;
 
     RefCntAutoPtr<IBuffer> m_PBRPrimitiveAttribsCB;
     RefCntAutoPtr<IBuffer> m_PrecomputeEnvMapAttribsCB;
     RefCntAutoPtr<IBuffer> m_JointsBuffer;
+    RefCntAutoPtr<IBuffer> m_InstanceTransformsBuffer;
+
+    // Persistent material attributes used when MaxMaterialCount is not zero.
+    RefCntAutoPtr<IBuffer>             m_MaterialsBuffer;
+    PSO_FLAGS                          m_MaterialBufferLayoutFlags = PSO_FLAG_NONE;
+    struct MaterialAllocator;
+    std::shared_ptr<MaterialAllocator> m_MaterialAllocator;
+
+    // Clustered lighting resources used when MaxLightCount is not zero.
+    RefCntAutoPtr<IBuffer>                m_PunctualLightsBuffer;
+    RefCntAutoPtr<IBuffer>                m_LightClustersBuffer;
+    RefCntAutoPtr<IPipelineState>         m_BinLightsPSO;
+    RefCntAutoPtr<IShaderResourceBinding> m_BinLightsSRB;
+
+    // Per-instance primitive indices used when PrimitiveArraySize is not zero.
+    static constexpr Uint32 PrimitiveIdAttribIndex = 8;
+    RefCntAutoPtr<IBuffer>  m_PrimitiveIdBuffer;
+    Uint32                  m_PrimitiveIdBufferSlot = 0;
+
+    // Previous-frame vertex positions used by PSOs with PSO_FLAG_USE_PREV_VERTEX_POSITIONS.
+    static constexpr Uint32 PrevPositionAttribIndex = 9;
+    Uint32                  m_PrevPositionBufferSlot = 0;
 
     RefCntAutoPtr<IPipelineResourceSignature> m_ResourceSignature;
 
     std::unordered_map<GraphicsPipelineDesc, PsoHashMapType> m_PSOs;
 
+    // Pipeline states may be created by the worker threads
+    mutable std::mutex                                             m_PSOManifestMtx;
+    std::unordered_set<PSOManifestEntry, PSOManifestEntry::Hasher> m_PSOManifest;
+
+    // Pipeline states that are being created by the worker threads
+    std::unordered_set<PSOManifestEntry, PSOManifestEntry::Hasher> m_PendingAsyncPSOs;
+    std::vector<RefCntAutoPtr<IAsyncTask>>                         m_AsyncPSOTasks;
+
+    struct AsyncPSOs
+    {
+        PSOManifestEntry Entry;
+        PsoHashMapType   PSOs;
+    };
+    // Pipeline states created by the worker threads that have not been moved to m_PSOs yet
+    std::mutex             m_CreatedAsyncPSOsMtx;
+    std::vector<AsyncPSOs> m_CreatedAsyncPSOs;
+    std::atomic<bool>      m_HasCreatedAsyncPSOs{false};
+    std::atomic<Uint32>    m_AsyncPSOVersion{0};
+
     std::unique_ptr<StaticShaderTextureIdsArrayType> m_StaticShaderTextureIds;
 };
 
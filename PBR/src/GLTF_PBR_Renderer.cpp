@@ -29,11 +29,18 @@
 
 #include <array>
 #include <functional>
+#include <algorithm>
+#include <cstring>
+#include <unordered_map>
 
 #include "BasicMath.hpp"
 #include "MapHelper.hpp"
 #include "GraphicsAccessories.hpp"
 #include "GLTFLoader.hpp"
+#include "GraphicsUtilities.h"
+#include "ThreadPool.hpp"
+#include "Utilities/interface/DiligentFXShaderSourceStreamFactory.hpp"
+#include "Utilities/interface/DepthSort.hpp"
 
 namespace Diligent
 {
@@ -51,6 +58,7 @@ namespace HLSL
 {
 
 #include "Shaders/PBR/public/PBR_Structures.fxh"
+#include "Shaders/PBR/private/SkinningStructures.fxh"
 
 } // namespace HLSL
 
@@ -59,9 +67,15 @@ namespace
 
 struct PBRRendererCreateInfoWrapper
 {
-    PBRRendererCreateInfoWrapper(const PBR_Renderer::CreateInfo& _CI) :
+    PBRRendererCreateInfoWrapper(IRenderDevice* pDevice, const GLTF_PBR_Renderer::CreateInfo& _CI) :
         CI{_CI}
     {
+        if (_CI.PackPrimitiveAttribs && CI.pPrimitiveAttribsCB == nullptr)
+        {
+            CreateUniformBuffer(pDevice, _CI.PackedPrimitiveAttribsBufferSize, "GLTF primitive attribs CB", &pPrimitiveAttribsCB);
+            CI.pPrimitiveAttribsCB = pPrimitiveAttribsCB;
+        }
+
         if (CI.InputLayout.NumElements == 0)
         {
             InputLayout    = GLTF::VertexAttributesToInputLayout(GLTF::DefaultVertexAttributes.data(), GLTF::DefaultVertexAttributes.size());
@@ -87,8 +101,16 @@ struct PBRRendererCreateInfoWrapper
 
         if (_CI.ShaderTexturesArrayMode == PBR_Renderer::SHADER_TEXTURE_ARRAY_MODE_DYNAMIC)
         {
-            UNEXPECTED("Dynamic shader texture arrays are not supported in GLTF renderer");
-            CI.ShaderTexturesArrayMode = PBR_Renderer::SHADER_TEXTURE_ARRAY_MODE_NONE;
+            if (!pDevice->GetDeviceInfo().Features.BindlessResources)
+            {
+                LOG_WARNING_MESSAGE("This device does not support bindless resources. Disabling dynamic shader texture arrays.");
+                CI.ShaderTexturesArrayMode   = PBR_Renderer::SHADER_TEXTURE_ARRAY_MODE_NONE;
+                CI.MaterialTexturesArraySize = 0;
+            }
+            else if (CI.MaterialTexturesArraySize == 0)
+            {
+                CI.MaterialTexturesArraySize = 256;
+            }
         }
     }
 
@@ -99,6 +121,7 @@ struct PBRRendererCreateInfoWrapper
 
     PBR_Renderer::CreateInfo CI;
     InputLayoutDescX         InputLayout;
+    RefCntAutoPtr<IBuffer>   pPrimitiveAttribsCB;
 };
 
 } // namespace
@@ -106,8 +129,27 @@ GLTF_PBR_Renderer::GLTF_PBR_Renderer(IRenderDevice*     pDevice,
                                      IRenderStateCache* pStateCache,
                                      IDeviceContext*    pCtx,
                                      const CreateInfo&  CI) :
-    PBR_Renderer{pDevice, pStateCache, pCtx, PBRRendererCreateInfoWrapper{CI}}
+    PBR_Renderer{pDevice, pStateCache, pCtx, PBRRendererCreateInfoWrapper{pDevice, CI}},
+    m_PackPrimitiveAttribs{CI.PackPrimitiveAttribs},
+    m_PrimitiveAttribsRange{GetPBRPrimitiveAttribsSize(PSO_FLAG_ALL)},
+    m_ConstantBufferOffsetAlignment{pDevice->GetAdapterInfo().Buffer.ConstantBufferOffsetAlignment}
 {
+    if (m_PackPrimitiveAttribs)
+    {
+        const BufferDesc& AttribsBuffDesc = m_PBRPrimitiveAttribsCB->GetDesc();
+        if (AttribsBuffDesc.Usage != USAGE_DYNAMIC)
+        {
+            LOG_WARNING_MESSAGE("Primitive attributes buffer must be dynamic to pack primitive attributes. Packing will be disabled.");
+            m_PackPrimitiveAttribs = false;
+        }
+        else if (AttribsBuffDesc.Size < AlignUp(m_PrimitiveAttribsRange, m_ConstantBufferOffsetAlignment) + m_PrimitiveAttribsRange)
+        {
+            LOG_WARNING_MESSAGE("Primitive attributes buffer size (", AttribsBuffDesc.Size, ") is not large enough to store the attributes of at least two primitives (",
+                                m_PrimitiveAttribsRange, " bytes each). Packing will be disabled.");
+            m_PackPrimitiveAttribs = false;
+        }
+    }
+
     {
         GraphicsPipelineDesc GraphicsDesc;
         GraphicsDesc.NumRenderTargets = CI.NumRenderTargets;
@@ -120,26 +162,35 @@ GLTF_PBR_Renderer::GLTF_PBR_Renderer(IRenderDevice*     pDevice,
 
         m_PbrPSOCache = GetPsoCacheAccessor(GraphicsDesc);
 
+        {
+            // Shading pass after the depth prepass
+            GraphicsPipelineDesc EqualDepthDesc             = GraphicsDesc;
+            EqualDepthDesc.DepthStencilDesc.DepthFunc        = COMPARISON_FUNC_EQUAL;
+            EqualDepthDesc.DepthStencilDesc.DepthWriteEnable = False;
+
+            m_EqualDepthPSOCache = GetPsoCacheAccessor(EqualDepthDesc);
+        }
+
+        {
+            GraphicsPipelineDesc DepthOnlyDesc = GraphicsDesc;
+            DepthOnlyDesc.NumRenderTargets     = 0;
+            for (auto& Fmt : DepthOnlyDesc.RTVFormats)
+                Fmt = TEX_FORMAT_UNKNOWN;
+
+            m_DepthOnlyPSOCache = GetPsoCacheAccessor(DepthOnlyDesc);
+        }
+
         GraphicsDesc.RasterizerDesc.FillMode = FILL_MODE_WIREFRAME;
 
         m_WireframePSOCache = GetPsoCacheAccessor(GraphicsDesc);
     }
 }
 
-void GLTF_PBR_Renderer::InitMaterialSRB(GLTF::Model&            Model,
-                                        GLTF::Material&         Material,
-                                        IBuffer*                pFrameAttribs,
-                                        IShaderResourceBinding* pMaterialSRB)
+void GLTF_PBR_Renderer::ProcessMaterialTextures(GLTF::Model&                                                 Model,
+                                                const GLTF::Material&                                        Material,
+                                                const std::function<void(TEXTURE_ATTRIB_ID, ITextureView*)>& Handler) const
 {
-    if (pMaterialSRB == nullptr)
-    {
-        LOG_ERROR_MESSAGE("Failed to create material SRB");
-        return;
-    }
-
-    InitCommonSRBVars(pMaterialSRB, pFrameAttribs);
-
-    auto SetTexture = [&](TEXTURE_ATTRIB_ID ID, ITextureView* pDefaultTexSRV) //
+    auto ProcessTexture = [&](TEXTURE_ATTRIB_ID ID, ITextureView* pDefaultTexSRV) //
     {
         const int TexAttribId = m_Settings.TextureAttribIndices[ID];
         if (TexAttribId < 0)
@@ -170,56 +221,75 @@ void GLTF_PBR_Renderer::InitMaterialSRB(GLTF::Model&            Model,
         if (pTexSRV == nullptr)
             pTexSRV = pDefaultTexSRV;
 
-        this->SetMaterialTexture(pMaterialSRB, pTexSRV, ID);
+        Handler(ID, pTexSRV);
     };
 
-    SetTexture(TEXTURE_ATTRIB_ID_BASE_COLOR, m_pWhiteTexSRV);
-    SetTexture(TEXTURE_ATTRIB_ID_PHYS_DESC, m_pDefaultPhysDescSRV);
-    SetTexture(TEXTURE_ATTRIB_ID_NORMAL, m_pDefaultNormalMapSRV);
+    ProcessTexture(TEXTURE_ATTRIB_ID_BASE_COLOR, m_pWhiteTexSRV);
+    ProcessTexture(TEXTURE_ATTRIB_ID_PHYS_DESC, m_pDefaultPhysDescSRV);
+    ProcessTexture(TEXTURE_ATTRIB_ID_NORMAL, m_pDefaultNormalMapSRV);
 
     if (m_Settings.EnableAO)
     {
-        SetTexture(TEXTURE_ATTRIB_ID_OCCLUSION, m_pWhiteTexSRV);
+        ProcessTexture(TEXTURE_ATTRIB_ID_OCCLUSION, m_pWhiteTexSRV);
     }
 
     if (m_Settings.EnableEmissive)
     {
-        SetTexture(TEXTURE_ATTRIB_ID_EMISSIVE, m_pWhiteTexSRV);
+        ProcessTexture(TEXTURE_ATTRIB_ID_EMISSIVE, m_pWhiteTexSRV);
     }
 
     if (m_Settings.EnableClearCoat)
     {
-        SetTexture(TEXTURE_ATTRIB_ID_CLEAR_COAT, m_pWhiteTexSRV);
-        SetTexture(TEXTURE_ATTRIB_ID_CLEAR_COAT_ROUGHNESS, m_pWhiteTexSRV);
-        SetTexture(TEXTURE_ATTRIB_ID_CLEAR_COAT_NORMAL, m_pWhiteTexSRV);
+        ProcessTexture(TEXTURE_ATTRIB_ID_CLEAR_COAT, m_pWhiteTexSRV);
+        ProcessTexture(TEXTURE_ATTRIB_ID_CLEAR_COAT_ROUGHNESS, m_pWhiteTexSRV);
+        ProcessTexture(TEXTURE_ATTRIB_ID_CLEAR_COAT_NORMAL, m_pWhiteTexSRV);
     }
 
     if (m_Settings.EnableSheen)
     {
-        SetTexture(TEXTURE_ATTRIB_ID_SHEEN_COLOR, m_pWhiteTexSRV);
-        SetTexture(TEXTURE_ATTRIB_ID_SHEEN_ROUGHNESS, m_pWhiteTexSRV);
+        ProcessTexture(TEXTURE_ATTRIB_ID_SHEEN_COLOR, m_pWhiteTexSRV);
+        ProcessTexture(TEXTURE_ATTRIB_ID_SHEEN_ROUGHNESS, m_pWhiteTexSRV);
     }
 
     if (m_Settings.EnableAnisotropy)
     {
-        SetTexture(TEXTURE_ATTRIB_ID_ANISOTROPY, m_pWhiteTexSRV);
+        ProcessTexture(TEXTURE_ATTRIB_ID_ANISOTROPY, m_pWhiteTexSRV);
     }
 
     if (m_Settings.EnableIridescence)
     {
-        SetTexture(TEXTURE_ATTRIB_ID_IRIDESCENCE, m_pWhiteTexSRV);
-        SetTexture(TEXTURE_ATTRIB_ID_IRIDESCENCE_THICKNESS, m_pWhiteTexSRV);
+        ProcessTexture(TEXTURE_ATTRIB_ID_IRIDESCENCE, m_pWhiteTexSRV);
+        ProcessTexture(TEXTURE_ATTRIB_ID_IRIDESCENCE_THICKNESS, m_pWhiteTexSRV);
     }
 
     if (m_Settings.EnableTransmission)
     {
-        SetTexture(TEXTURE_ATTRIB_ID_TRANSMISSION, m_pWhiteTexSRV);
+        ProcessTexture(TEXTURE_ATTRIB_ID_TRANSMISSION, m_pWhiteTexSRV);
     }
 
     if (m_Settings.EnableVolume)
     {
-        SetTexture(TEXTURE_ATTRIB_ID_THICKNESS, m_pWhiteTexSRV);
+        ProcessTexture(TEXTURE_ATTRIB_ID_THICKNESS, m_pWhiteTexSRV);
+    }
+}
+
+void GLTF_PBR_Renderer::InitMaterialSRB(GLTF::Model&            Model,
+                                        GLTF::Material&         Material,
+                                        IBuffer*                pFrameAttribs,
+                                        IShaderResourceBinding* pMaterialSRB)
+{
+    if (pMaterialSRB == nullptr)
+    {
+        LOG_ERROR_MESSAGE("Failed to create material SRB");
+        return;
     }
+
+    InitCommonSRBVars(pMaterialSRB, pFrameAttribs);
+
+    ProcessMaterialTextures(Model, Material,
+                            [&](TEXTURE_ATTRIB_ID ID, ITextureView* pTexSRV) {
+                                this->SetMaterialTexture(pMaterialSRB, pTexSRV, ID);
+                            });
 }
 
 void GLTF_PBR_Renderer::CreateResourceCacheSRB(IRenderDevice*           pDevice,
@@ -229,6 +299,9 @@ void GLTF_PBR_Renderer::CreateResourceCacheSRB(IRenderDevice*           pDevice,
                                                IShaderResourceBinding** ppCacheSRB)
 {
     DEV_CHECK_ERR(CacheUseInfo.pResourceMgr != nullptr, "Resource manager must not be null");
+    DEV_CHECK_ERR(m_Settings.ShaderTexturesArrayMode != SHADER_TEXTURE_ARRAY_MODE_DYNAMIC,
+                  "Resource cache is not supported in dynamic shader texture array mode. Texture atlases of the cache are already referenced by a single SRB.");
+    DEV_CHECK_ERR(!m_MaterialsBuffer, "Resource cache is not supported with the material buffer: materials are uploaded through the model resource bindings.");
 
     m_ResourceSignature->CreateShaderResourceBinding(ppCacheSRB, true);
     IShaderResourceBinding* const pSRB = *ppCacheSRB;
@@ -300,19 +373,137 @@ GLTF_PBR_Renderer::ModelResourceBindings GLTF_PBR_Renderer::CreateResourceBindin
     IBuffer*     pFrameAttribs)
 {
     ModelResourceBindings ResourceBindings;
-    ResourceBindings.MaterialSRB.resize(GLTFModel.Materials.size());
+    if (m_Settings.ShaderTexturesArrayMode == SHADER_TEXTURE_ARRAY_MODE_DYNAMIC)
+    {
+        ResourceBindings = CreateBindlessResourceBindings(GLTFModel, pFrameAttribs);
+    }
+    else
+    {
+        ResourceBindings.MaterialSRB.resize(GLTFModel.Materials.size());
+        for (size_t mat = 0; mat < GLTFModel.Materials.size(); ++mat)
+        {
+            auto& pMatSRB = ResourceBindings.MaterialSRB[mat];
+            CreateResourceBinding(&pMatSRB);
+            InitMaterialSRB(GLTFModel, GLTFModel.Materials[mat], pFrameAttribs, pMatSRB);
+        }
+    }
+
+    if (m_MaterialsBuffer && !GLTFModel.Materials.empty())
+    {
+        ResourceBindings.MaterialRange = AllocateMaterials(static_cast<Uint32>(GLTFModel.Materials.size()));
+        ResourceBindings.DirtyMaterials.assign(GLTFModel.Materials.size(), true);
+    }
+
+    return ResourceBindings;
+}
+
+GLTF_PBR_Renderer::ModelResourceBindings GLTF_PBR_Renderer::CreateBindlessResourceBindings(
+    GLTF::Model& GLTFModel,
+    IBuffer*     pFrameAttribs)
+{
+    VERIFY_EXPR(m_Settings.ShaderTexturesArrayMode == SHADER_TEXTURE_ARRAY_MODE_DYNAMIC);
+
+    const Uint32 TexturesArraySize = m_Settings.MaterialTexturesArraySize;
+
+    ModelResourceBindings ResourceBindings;
+    ResourceBindings.MaterialTextureIds.resize(GLTFModel.Materials.size() * TEXTURE_ATTRIB_ID_COUNT, 0.f);
+
+    // Texture views to bind to "g_MaterialTextures"
+    std::vector<RefCntAutoPtr<ITextureView>> TexArray;
+    TexArray.reserve(TexturesArraySize);
+
+    // Every texture is added to the array only once, even if it is used by multiple materials.
+    std::unordered_map<const ITexture*, Uint32> TextureIds;
+
+    auto AllocateTextureId = [&](ITextureView* pTexSRV) -> Int32 {
+        if (pTexSRV == nullptr)
+            return -1;
+
+        auto it = TextureIds.find(pTexSRV->GetTexture());
+        if (it != TextureIds.end())
+            return static_cast<Int32>(it->second);
+
+        if (TexArray.size() >= TexturesArraySize)
+            return -1;
+
+        const Uint32 TexId = static_cast<Uint32>(TexArray.size());
+        TexArray.emplace_back(pTexSRV);
+        TextureIds.emplace(pTexSRV->GetTexture(), TexId);
+        return static_cast<Int32>(TexId);
+    };
+
+    // Default textures always go first so that they are available when the array overflows.
+    std::array<Int32, TEXTURE_ATTRIB_ID_COUNT> DefaultTextureIds;
+    DefaultTextureIds.fill(AllocateTextureId(m_pWhiteTexSRV));
+    DefaultTextureIds[TEXTURE_ATTRIB_ID_PHYS_DESC] = AllocateTextureId(m_pDefaultPhysDescSRV);
+    DefaultTextureIds[TEXTURE_ATTRIB_ID_NORMAL]    = AllocateTextureId(m_pDefaultNormalMapSRV);
+
+    bool ArrayOverflow = false;
     for (size_t mat = 0; mat < GLTFModel.Materials.size(); ++mat)
     {
-        auto& pMatSRB = ResourceBindings.MaterialSRB[mat];
-        CreateResourceBinding(&pMatSRB);
-        InitMaterialSRB(GLTFModel, GLTFModel.Materials[mat], pFrameAttribs, pMatSRB);
+        float* MatTextureIds = &ResourceBindings.MaterialTextureIds[mat * TEXTURE_ATTRIB_ID_COUNT];
+        ProcessMaterialTextures(GLTFModel, GLTFModel.Materials[mat],
+                                [&](TEXTURE_ATTRIB_ID ID, ITextureView* pTexSRV) {
+                                    Int32 TexId = AllocateTextureId(pTexSRV);
+                                    if (TexId < 0)
+                                    {
+                                        ArrayOverflow = ArrayOverflow || pTexSRV != nullptr;
+                                        TexId         = std::max(DefaultTextureIds[ID], 0);
+                                    }
+                                    MatTextureIds[ID] = static_cast<float>(TexId);
+                                });
+    }
+
+    if (ArrayOverflow)
+    {
+        LOG_WARNING_MESSAGE("The model uses more than ", TexturesArraySize, " textures. Some textures will be replaced with the default textures. "
+                            "Increase MaterialTexturesArraySize to fit all textures.");
+    }
+
+    if (TexArray.empty())
+    {
+        LOG_ERROR_MESSAGE("The model does not have any textures to bind to the shader textures array");
+        return ResourceBindings;
+    }
+
+    RefCntAutoPtr<IShaderResourceBinding> pSRB;
+    CreateResourceBinding(&pSRB);
+    if (!pSRB)
+    {
+        LOG_ERROR_MESSAGE("Failed to create material SRB");
+        return ResourceBindings;
+    }
+
+    InitCommonSRBVars(pSRB, pFrameAttribs);
+
+    if (IShaderResourceVariable* pVar = pSRB->GetVariableByName(SHADER_TYPE_PIXEL, "g_MaterialTextures"))
+    {
+        // All array elements must be initialized, so set the unused ones to the first texture.
+        std::vector<IDeviceObject*> TextureViews(TexturesArraySize, TexArray[0].RawPtr());
+        for (size_t i = 0; i < TexArray.size(); ++i)
+            TextureViews[i] = TexArray[i].RawPtr();
+
+        pVar->SetArray(TextureViews.data(), 0, TexturesArraySize);
+    }
+    else
+    {
+        UNEXPECTED("Failed to find 'g_MaterialTextures' variable in the shader resource binding");
     }
+
+    // All materials share the same SRB, so the render loop never switches the SRBs
+    ResourceBindings.MaterialSRB.resize(GLTFModel.Materials.size(), pSRB);
+
     return ResourceBindings;
 }
 
 void GLTF_PBR_Renderer::Begin(IDeviceContext* pCtx)
 {
-    if (m_JointsBuffer)
+    if (m_Settings.JointsBufferMode == CreateInfo::JOINTS_BUFFER_MODE_STRUCTURED)
+    {
+        m_JointPaletteAllocations.clear();
+        m_JointPaletteSize = 0;
+    }
+    else if (m_JointsBuffer)
     {
         // In next-gen backends, dynamic buffers must be mapped before the first use in every frame
         MapHelper<float4x4> pJoints{pCtx, m_JointsBuffer, MAP_WRITE, MAP_FLAG_DISCARD};
@@ -364,6 +555,376 @@ void GLTF_PBR_Renderer::Begin(IRenderDevice*         pDevice,
     pCtx->SetIndexBuffer(pIndexBuffer, 0, RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
 }
 
+GLTF_PBR_Renderer::SkinnedVertexStreams GLTF_PBR_Renderer::CreateSkinnedVertexStreams(const GLTF::Model& GLTFModel,
+                                                                                     bool               ComputeMotionVectors)
+{
+    SkinnedVertexStreams Streams;
+
+    if (!m_Device.GetDeviceInfo().Features.ComputeShaders)
+    {
+        LOG_WARNING_MESSAGE("Compute skinning requires compute shaders that are not supported by this device. Skinning will be performed in the vertex shader.");
+        return Streams;
+    }
+
+    InputLayoutDescX InputLayout{m_InputLayout};
+    InputLayout.ResolveAutoOffsetsAndStrides();
+
+    // The input layout is created from the model vertex attributes (see GLTF::VertexAttributesToInputLayout),
+    // so the input index of an attribute is its index in the model attributes.
+    auto FindLayoutElement = [&](const char* AttribName) -> const LayoutElement* {
+        for (Uint32 i = 0; i < GLTFModel.GetNumVertexAttributes(); ++i)
+        {
+            const auto& Attrib = GLTFModel.GetVertexAttribute(i);
+            if (!GLTFModel.IsVertexAttributeEnabled(i) || Attrib.Name == nullptr || strcmp(Attrib.Name, AttribName) != 0)
+                continue;
+
+            for (Uint32 elem = 0; elem < InputLayout.GetNumElements(); ++elem)
+            {
+                if (InputLayout[elem].InputIndex == i)
+                    return &InputLayout[elem];
+            }
+            return nullptr;
+        }
+        return nullptr;
+    };
+
+    const LayoutElement* pPosElem     = FindLayoutElement(GLTF::PositionAttributeName);
+    const LayoutElement* pNormalElem  = FindLayoutElement(GLTF::NormalAttributeName);
+    const LayoutElement* pJointsElem  = FindLayoutElement(GLTF::JointsAttributeName);
+    const LayoutElement* pWeightsElem = FindLayoutElement(GLTF::WeightsAttributeName);
+    const LayoutElement* pTangentElem = FindLayoutElement(GLTF::TangentAttributeName);
+    if (pPosElem == nullptr || pJointsElem == nullptr || pWeightsElem == nullptr)
+    {
+        LOG_WARNING_MESSAGE("The input layout does not contain positions, joints or weights. Skinning will be performed in the vertex shader.");
+        return Streams;
+    }
+    if (pJointsElem->ValueType != VT_FLOAT32 || pWeightsElem->ValueType != VT_FLOAT32)
+    {
+        LOG_WARNING_MESSAGE("Compute skinning requires 32-bit float joints and weights. Skinning will be performed in the vertex shader.");
+        return Streams;
+    }
+
+    const Uint32 NumVBs = static_cast<Uint32>(GLTFModel.GetVertexBufferCount());
+    VERIFY_EXPR(NumVBs <= Streams.VertexBuffers.size());
+
+    auto IsRawShaderResource = [](IBuffer* pBuffer) {
+        if (pBuffer == nullptr)
+            return false;
+        const BufferDesc& Desc = pBuffer->GetDesc();
+        return Desc.Mode == BUFFER_MODE_RAW && (Desc.BindFlags & BIND_SHADER_RESOURCE) != 0;
+    };
+
+    std::array<bool, 8> IsSkinnedSlot = {};
+    for (const LayoutElement* pElem : {pPosElem, pNormalElem, pTangentElem})
+    {
+        if (pElem != nullptr && pElem->BufferSlot < NumVBs)
+            IsSkinnedSlot[pElem->BufferSlot] = true;
+    }
+
+    for (const LayoutElement* pElem : {pPosElem, pNormalElem, pTangentElem, pJointsElem, pWeightsElem})
+    {
+        if (pElem == nullptr)
+            continue;
+        if (pElem->BufferSlot >= NumVBs || !IsRawShaderResource(GLTFModel.GetVertexBuffer(pElem->BufferSlot)))
+        {
+            LOG_WARNING_MESSAGE("Compute skinning requires the model vertex buffers to be raw buffers with the BIND_SHADER_RESOURCE flag. "
+                                "Skinning will be performed in the vertex shader.");
+            return Streams;
+        }
+    }
+    if (GLTFModel.GetIndexBuffer() != nullptr && !IsRawShaderResource(GLTFModel.GetIndexBuffer()))
+    {
+        LOG_WARNING_MESSAGE("Compute skinning requires the model index buffer to be a raw buffer with the BIND_SHADER_RESOURCE flag. "
+                            "Skinning will be performed in the vertex shader.");
+        return Streams;
+    }
+
+    if (!m_SkinningPSO)
+    {
+        ShaderCreateInfo ShaderCI;
+        ShaderCI.SourceLanguage             = SHADER_SOURCE_LANGUAGE_HLSL;
+        ShaderCI.pShaderSourceStreamFactory = &DiligentFXShaderSourceStreamFactory::GetInstance();
+        ShaderCI.Desc                       = {"Skin vertices CS", SHADER_TYPE_COMPUTE, true};
+        ShaderCI.EntryPoint                 = "main";
+        ShaderCI.FilePath                   = "SkinVertices.csh";
+
+        RefCntAutoPtr<IShader> pCS = m_Device.CreateShader(ShaderCI);
+        if (!pCS)
+        {
+            LOG_ERROR_MESSAGE("Failed to create skinning compute shader");
+            return Streams;
+        }
+
+        PipelineResourceLayoutDescX ResourceLayout;
+        ResourceLayout
+            .SetDefaultVariableType(SHADER_RESOURCE_VARIABLE_TYPE_MUTABLE)
+            .AddVariable(SHADER_TYPE_COMPUTE, "cbSkinningAttribs", SHADER_RESOURCE_VARIABLE_TYPE_STATIC)
+            .AddVariable(SHADER_TYPE_COMPUTE, "g_JointMatrices", SHADER_RESOURCE_VARIABLE_TYPE_DYNAMIC);
+
+        ComputePipelineStateCreateInfo PsoCI;
+        PsoCI.PSODesc.Name           = "Skin vertices PSO";
+        PsoCI.PSODesc.PipelineType   = PIPELINE_TYPE_COMPUTE;
+        PsoCI.PSODesc.ResourceLayout = ResourceLayout;
+        PsoCI.pCS                    = pCS;
+
+        m_SkinningPSO = m_Device.CreateComputePipelineState(PsoCI);
+        if (!m_SkinningPSO)
+        {
+            LOG_ERROR_MESSAGE("Failed to create skinning PSO");
+            return Streams;
+        }
+
+        BufferDesc CBDesc;
+        CBDesc.Name           = "Skinning attribs CB";
+        CBDesc.Size           = sizeof(HLSL::SkinningAttribs);
+        CBDesc.Usage          = USAGE_DYNAMIC;
+        CBDesc.BindFlags      = BIND_UNIFORM_BUFFER;
+        CBDesc.CPUAccessFlags = CPU_ACCESS_WRITE;
+        m_SkinningAttribsCB   = m_Device.CreateBuffer(CBDesc);
+        if (!m_SkinningAttribsCB)
+        {
+            LOG_ERROR_MESSAGE("Failed to create skinning attribs buffer");
+            m_SkinningPSO.Release();
+            return Streams;
+        }
+        m_SkinningPSO->GetStaticVariableByName(SHADER_TYPE_COMPUTE, "cbSkinningAttribs")->Set(m_SkinningAttribsCB);
+    }
+
+    // Every mesh vertex is skinned with the joint matrices of a single node, so meshes that are
+    // shared by several skinned nodes are skinned in the vertex shader.
+    std::unordered_map<const GLTF::Mesh*, Uint32> SkinnedMeshUseCount;
+    for (const GLTF::Node& Node : GLTFModel.Nodes)
+    {
+        if (Node.pMesh != nullptr && Node.SkinTransformsIndex >= 0)
+            ++SkinnedMeshUseCount[Node.pMesh];
+    }
+    if (SkinnedMeshUseCount.empty())
+        return Streams;
+
+    Streams.PreSkinnedNodes.resize(GLTFModel.Nodes.size());
+    for (const GLTF::Node& Node : GLTFModel.Nodes)
+    {
+        if (Node.pMesh != nullptr && Node.SkinTransformsIndex >= 0 && SkinnedMeshUseCount[Node.pMesh] == 1)
+            Streams.PreSkinnedNodes[Node.Index] = true;
+    }
+
+    // Vertices of all primitives are stored consecutively starting at the model base vertex
+    Uint32 NumVertices = 0;
+    for (const GLTF::Mesh& Mesh : GLTFModel.Meshes)
+    {
+        for (const GLTF::Primitive& Primitive : Mesh.Primitives)
+            NumVertices += Primitive.VertexCount;
+    }
+    if (NumVertices == 0)
+    {
+        Streams.PreSkinnedNodes.clear();
+        return Streams;
+    }
+
+    for (Uint32 i = 0; i < InputLayout.GetNumElements(); ++i)
+    {
+        const LayoutElement& Elem = InputLayout[i];
+        if (Elem.BufferSlot < NumVBs)
+            Streams.VertexStrides[Elem.BufferSlot] = Elem.Stride;
+    }
+
+    BufferDesc StreamDesc;
+    StreamDesc.Usage     = USAGE_DEFAULT;
+    StreamDesc.BindFlags = BIND_VERTEX_BUFFER | BIND_UNORDERED_ACCESS;
+    StreamDesc.Mode      = BUFFER_MODE_RAW;
+    for (Uint32 Slot = 0; Slot < NumVBs; ++Slot)
+    {
+        if (!IsSkinnedSlot[Slot])
+            continue;
+
+        VERIFY(Streams.VertexStrides[Slot] % 4 == 0, "Vertex stride must be a multiple of 4");
+        StreamDesc.Name             = "Skinned vertex stream";
+        StreamDesc.Size             = Uint64{NumVertices} * Streams.VertexStrides[Slot];
+        Streams.VertexBuffers[Slot] = m_Device.CreateBuffer(StreamDesc);
+        if (!Streams.VertexBuffers[Slot])
+        {
+            LOG_ERROR_MESSAGE("Failed to create skinned vertex stream");
+            return SkinnedVertexStreams{};
+        }
+    }
+
+    if (ComputeMotionVectors)
+    {
+        StreamDesc.Name       = "Skinned previous positions";
+        StreamDesc.Size       = Uint64{NumVertices} * sizeof(float3);
+        Streams.PrevPositions = m_Device.CreateBuffer(StreamDesc);
+        if (!Streams.PrevPositions)
+        {
+            LOG_ERROR_MESSAGE("Failed to create skinned previous positions buffer");
+            return SkinnedVertexStreams{};
+        }
+    }
+
+    auto GetSRV = [](IBuffer* pBuffer) {
+        return pBuffer->GetDefaultView(BUFFER_VIEW_SHADER_RESOURCE);
+    };
+    IBuffer* const pIndexBuffer = GLTFModel.GetIndexBuffer();
+    for (Uint32 Slot = 0; Slot < NumVBs; ++Slot)
+    {
+        IBuffer* pDstVB = Streams.VertexBuffers[Slot];
+        if (pDstVB == nullptr)
+            continue;
+
+        IBuffer* pSrcVB = GLTFModel.GetVertexBuffer(Slot);
+
+        RefCntAutoPtr<IShaderResourceBinding>& pSRB = Streams.SRBs[Slot];
+        m_SkinningPSO->CreateShaderResourceBinding(&pSRB, true);
+        VERIFY_EXPR(pSRB);
+        // Bind the source buffer in place of the index buffer that is not read for non-indexed primitives
+        pSRB->GetVariableByName(SHADER_TYPE_COMPUTE, "g_Indices")->Set(GetSRV(pIndexBuffer != nullptr ? pIndexBuffer : pSrcVB));
+        pSRB->GetVariableByName(SHADER_TYPE_COMPUTE, "g_SrcVertices")->Set(GetSRV(pSrcVB));
+        pSRB->GetVariableByName(SHADER_TYPE_COMPUTE, "g_SrcJoints")->Set(GetSRV(GLTFModel.GetVertexBuffer(pJointsElem->BufferSlot)));
+        pSRB->GetVariableByName(SHADER_TYPE_COMPUTE, "g_SrcWeights")->Set(GetSRV(GLTFModel.GetVertexBuffer(pWeightsElem->BufferSlot)));
+        pSRB->GetVariableByName(SHADER_TYPE_COMPUTE, "g_DstVertices")->Set(pDstVB->GetDefaultView(BUFFER_VIEW_UNORDERED_ACCESS));
+        // Previous positions are only written by the stream that contains positions
+        IBuffer* pDstPrevPositions = Streams.PrevPositions ? Streams.PrevPositions.RawPtr() : pDstVB;
+        pSRB->GetVariableByName(SHADER_TYPE_COMPUTE, "g_DstPrevPositions")->Set(pDstPrevPositions->GetDefaultView(BUFFER_VIEW_UNORDERED_ACCESS));
+    }
+
+    Streams.PosSlot       = pPosElem->BufferSlot;
+    Streams.PosOffset     = pPosElem->RelativeOffset;
+    Streams.NormalSlot    = pNormalElem != nullptr ? pNormalElem->BufferSlot : ~0u;
+    Streams.NormalOffset  = pNormalElem != nullptr ? pNormalElem->RelativeOffset : 0;
+    Streams.TangentSlot   = pTangentElem != nullptr ? pTangentElem->BufferSlot : ~0u;
+    Streams.TangentOffset = pTangentElem != nullptr ? pTangentElem->RelativeOffset : 0;
+    Streams.JointsStride  = pJointsElem->Stride;
+    Streams.JointsOffset  = pJointsElem->RelativeOffset;
+    Streams.WeightsStride = pWeightsElem->Stride;
+    Streams.WeightsOffset = pWeightsElem->RelativeOffset;
+
+    return Streams;
+}
+
+void GLTF_PBR_Renderer::ComputeSkinning(IDeviceContext*              pCtx,
+                                        const GLTF::Model&           GLTFModel,
+                                        const GLTF::ModelTransforms& Transforms,
+                                        const GLTF::ModelTransforms* PrevTransforms,
+                                        SkinnedVertexStreams&        Streams)
+{
+    if (!Streams || !m_SkinningPSO)
+        return;
+
+    if (PrevTransforms == nullptr)
+        PrevTransforms = &Transforms;
+    VERIFY_EXPR(PrevTransforms->Skins.size() == Transforms.Skins.size());
+
+    // Current-frame joint matrices of all skins are followed by the previous-frame matrices
+    std::vector<Uint32> SkinFirstJoint(Transforms.Skins.size());
+    Uint32              NumJoints = 0;
+    for (size_t i = 0; i < Transforms.Skins.size(); ++i)
+    {
+        SkinFirstJoint[i] = NumJoints;
+        NumJoints += static_cast<Uint32>(Transforms.Skins[i].JointMatrices.size());
+    }
+    if (NumJoints == 0)
+        return;
+
+    const Uint64 JointMatricesSize = Uint64{NumJoints} * 2 * sizeof(float4x4);
+    if (!Streams.JointMatrices || Streams.JointMatrices->GetDesc().Size < JointMatricesSize)
+    {
+        BufferDesc Desc;
+        Desc.Name              = "Skinning joint matrices";
+        Desc.Usage             = USAGE_DEFAULT;
+        Desc.BindFlags         = BIND_SHADER_RESOURCE;
+        Desc.Mode              = BUFFER_MODE_STRUCTURED;
+        Desc.ElementByteStride = sizeof(float4x4);
+        Desc.Size              = JointMatricesSize;
+
+        Streams.JointMatrices = m_Device.CreateBuffer(Desc);
+        if (!Streams.JointMatrices)
+        {
+            LOG_ERROR_MESSAGE("Failed to create skinning joint matrices buffer");
+            return;
+        }
+    }
+
+    for (size_t i = 0; i < Transforms.Skins.size(); ++i)
+    {
+        const auto& JointMatrices     = Transforms.Skins[i].JointMatrices;
+        const auto& PrevJointMatrices = PrevTransforms->Skins[i].JointMatrices;
+        VERIFY_EXPR(PrevJointMatrices.size() == JointMatrices.size());
+        if (JointMatrices.empty())
+            continue;
+
+        const Uint64 Size = JointMatrices.size() * sizeof(float4x4);
+        pCtx->UpdateBuffer(Streams.JointMatrices, Uint64{SkinFirstJoint[i]} * sizeof(float4x4), Size, JointMatrices.data(), RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
+        pCtx->UpdateBuffer(Streams.JointMatrices, Uint64{NumJoints + SkinFirstJoint[i]} * sizeof(float4x4), Size, PrevJointMatrices.data(), RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
+    }
+
+    IBufferView* const pJointMatricesSRV = Streams.JointMatrices->GetDefaultView(BUFFER_VIEW_SHADER_RESOURCE);
+
+    pCtx->SetPipelineState(m_SkinningPSO);
+    const Uint32 FirstIndexLocation = GLTFModel.GetFirstIndexLocation();
+    const Uint32 BaseVertex         = GLTFModel.GetBaseVertex();
+    for (Uint32 Slot = 0; Slot < Streams.VertexBuffers.size(); ++Slot)
+    {
+        IShaderResourceBinding* pSRB = Streams.SRBs[Slot];
+        if (pSRB == nullptr)
+            continue;
+
+        pSRB->GetVariableByName(SHADER_TYPE_COMPUTE, "g_JointMatrices")->Set(pJointMatricesSRV);
+        pCtx->CommitShaderResources(pSRB, RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
+
+        for (const GLTF::Node& Node : GLTFModel.Nodes)
+        {
+            if (!Streams.IsPreSkinned(Node) || Node.SkinTransformsIndex >= static_cast<int>(Transforms.Skins.size()))
+                continue;
+
+            for (const GLTF::Primitive& Primitive : Node.pMesh->Primitives)
+            {
+                const Uint32 NumVertices = Primitive.HasIndices() ? Primitive.IndexCount : Primitive.VertexCount;
+                if (NumVertices == 0)
+                    continue;
+
+                {
+                    MapHelper<HLSL::SkinningAttribs> Attribs{pCtx, m_SkinningAttribsCB, MAP_WRITE, MAP_FLAG_DISCARD};
+                    Attribs->FirstIndex         = Primitive.HasIndices() ? FirstIndexLocation + Primitive.FirstIndex : SKINNING_INVALID_OFFSET;
+                    Attribs->NumVertices        = NumVertices;
+                    Attribs->BaseVertex         = BaseVertex;
+                    Attribs->FirstJoint         = SkinFirstJoint[Node.SkinTransformsIndex];
+                    Attribs->PrevFirstJoint     = NumJoints + SkinFirstJoint[Node.SkinTransformsIndex];
+                    Attribs->VertexStride       = Streams.VertexStrides[Slot];
+                    Attribs->PosOffset          = Slot == Streams.PosSlot ? Streams.PosOffset : SKINNING_INVALID_OFFSET;
+                    Attribs->NormalOffset       = Slot == Streams.NormalSlot ? Streams.NormalOffset : SKINNING_INVALID_OFFSET;
+                    Attribs->TangentOffset      = Slot == Streams.TangentSlot ? Streams.TangentOffset : SKINNING_INVALID_OFFSET;
+                    Attribs->JointsStride       = Streams.JointsStride;
+                    Attribs->JointsOffset       = Streams.JointsOffset;
+                    Attribs->WeightsStride      = Streams.WeightsStride;
+                    Attribs->WeightsOffset      = Streams.WeightsOffset;
+                    Attribs->WritePrevPositions = (Slot == Streams.PosSlot && Streams.PrevPositions) ? 1 : 0;
+                }
+
+                DispatchComputeAttribs DispatchAttrs{(NumVertices + SKINNING_THREAD_GROUP_SIZE - 1) / SKINNING_THREAD_GROUP_SIZE};
+                pCtx->DispatchCompute(DispatchAttrs);
+            }
+        }
+    }
+
+    // Return the streams and the model buffers that were read by the compute shader to the
+    // vertex and index buffer states, so that they can be used by deferred contexts.
+    std::vector<StateTransitionDesc> Barriers;
+    for (Uint32 Slot = 0; Slot < Streams.VertexBuffers.size(); ++Slot)
+    {
+        if (Streams.VertexBuffers[Slot])
+            Barriers.emplace_back(Streams.VertexBuffers[Slot], RESOURCE_STATE_UNKNOWN, RESOURCE_STATE_VERTEX_BUFFER, STATE_TRANSITION_FLAG_UPDATE_STATE);
+    }
+    for (Uint32 i = 0; i < GLTFModel.GetVertexBufferCount(); ++i)
+    {
+        if (IBuffer* pVB = GLTFModel.GetVertexBuffer(i))
+            Barriers.emplace_back(pVB, RESOURCE_STATE_UNKNOWN, RESOURCE_STATE_VERTEX_BUFFER, STATE_TRANSITION_FLAG_UPDATE_STATE);
+    }
+    if (IBuffer* pIndexBuffer = GLTFModel.GetIndexBuffer())
+        Barriers.emplace_back(pIndexBuffer, RESOURCE_STATE_UNKNOWN, RESOURCE_STATE_INDEX_BUFFER, STATE_TRANSITION_FLAG_UPDATE_STATE);
+    if (Streams.PrevPositions)
+        Barriers.emplace_back(Streams.PrevPositions, RESOURCE_STATE_UNKNOWN, RESOURCE_STATE_VERTEX_BUFFER, STATE_TRANSITION_FLAG_UPDATE_STATE);
+    pCtx->TransitionResourceStates(static_cast<Uint32>(Barriers.size()), Barriers.data());
+}
+
 GLTF_PBR_Renderer::PSO_FLAGS GLTF_PBR_Renderer::GetMaterialPSOFlags(const GLTF::Material& Mat) const
 {
     // Color, normal and physical descriptor maps are always enabled
@@ -437,50 +998,10 @@ GLTF_PBR_Renderer::PSO_FLAGS GLTF_PBR_Renderer::GetMaterialPSOFlags(const GLTF::
 }
 
 
-void GLTF_PBR_Renderer::Render(IDeviceContext*              pCtx,
-                               const GLTF::Model&           GLTFModel,
-                               const GLTF::ModelTransforms& Transforms,
-                               const GLTF::ModelTransforms* PrevTransforms,
-                               const RenderInfo&            RenderParams,
-                               ModelResourceBindings*       pModelBindings,
-                               ResourceCacheBindings*       pCacheBindings)
+GLTF_PBR_Renderer::PSO_FLAGS GLTF_PBR_Renderer::GetVertexAttribPSOFlags(const GLTF::Model& GLTFModel)
 {
-    DEV_CHECK_ERR((pModelBindings != nullptr) ^ (pCacheBindings != nullptr), "Either model bindings or cache bindings must not be null");
-    DEV_CHECK_ERR(pModelBindings == nullptr || pModelBindings->MaterialSRB.size() == GLTFModel.Materials.size(),
-                  "The number of material shader resource bindings is not consistent with the number of materials");
-
-    if (!GLTFModel.CompatibleWithTransforms(Transforms))
-    {
-        DEV_ERROR("Model transforms are incompatible with the model");
-        return;
-    }
-    if (RenderParams.SceneIndex >= GLTFModel.Scenes.size())
-    {
-        DEV_ERROR("Invalid scene index ", RenderParams.SceneIndex);
-        return;
-    }
-    const auto& Scene = GLTFModel.Scenes[RenderParams.SceneIndex];
-
-    m_RenderParams = RenderParams;
-
-    if (pModelBindings != nullptr)
-    {
-        std::array<IBuffer*, 8> pVBs;
-
-        const auto NumVBs = static_cast<Uint32>(GLTFModel.GetVertexBufferCount());
-        VERIFY_EXPR(NumVBs <= pVBs.size());
-        for (Uint32 i = 0; i < NumVBs; ++i)
-            pVBs[i] = GLTFModel.GetVertexBuffer(i);
-        pCtx->SetVertexBuffers(0, NumVBs, pVBs.data(), nullptr, RESOURCE_STATE_TRANSITION_MODE_TRANSITION, SET_VERTEX_BUFFERS_FLAG_RESET);
-
-        if (auto* pIndexBuffer = GLTFModel.GetIndexBuffer())
-        {
-            pCtx->SetIndexBuffer(pIndexBuffer, 0, RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
-        }
-    }
-
-    auto VertexAttribFlags = PSO_FLAG_NONE;
-    for (Uint32 i = 0; i < GLTFModel.GetNumVertexAttributes(); ++i)
+    auto VertexAttribFlags = PSO_FLAG_NONE;
+    for (Uint32 i = 0; i < GLTFModel.GetNumVertexAttributes(); ++i)
     {
         if (!GLTFModel.IsVertexAttributeEnabled(i))
             continue;
@@ -500,16 +1021,102 @@ void GLTF_PBR_Renderer::Render(IDeviceContext*              pCtx,
         else if (strcmp(Attrib.Name, GLTF::TangentAttributeName) == 0)
             VertexAttribFlags |= PSO_FLAG_USE_VERTEX_TANGENTS;
     }
+    return VertexAttribFlags;
+}
 
+bool GLTF_PBR_Renderer::PrepareRenderLists(const GLTF::Model&           GLTFModel,
+                                           const GLTF::ModelTransforms& Transforms,
+                                           const RenderInfo&            RenderParams,
+                                           ModelResourceBindings*       pModelBindings,
+                                           ResourceCacheBindings*       pCacheBindings)
+{
+    DEV_CHECK_ERR((pModelBindings != nullptr) ^ (pCacheBindings != nullptr), "Either model bindings or cache bindings must not be null");
+    DEV_CHECK_ERR(pModelBindings == nullptr || pModelBindings->MaterialSRB.size() == GLTFModel.Materials.size(),
+                  "The number of material shader resource bindings is not consistent with the number of materials");
+
+    if (!GLTFModel.CompatibleWithTransforms(Transforms))
+    {
+        DEV_ERROR("Model transforms are incompatible with the model");
+        return false;
+    }
+    if (RenderParams.SceneIndex >= GLTFModel.Scenes.size())
+    {
+        DEV_ERROR("Invalid scene index ", RenderParams.SceneIndex);
+        return false;
+    }
+
+    m_RenderParams   = RenderParams;
+    m_pModelBindings = pModelBindings;
+
+    const RenderListsKey ListsKey{GLTFModel, RenderParams};
+    if (ListsKey != m_RenderListsKey)
+    {
+        BuildRenderLists(GLTFModel, RenderParams);
+        m_RenderListsKey = ListsKey;
+    }
+
+    if (RenderParams.SortFlags & RenderInfo::SORT_FLAG_OPAQUE_FRONT_TO_BACK)
+    {
+        SortRenderList(GLTF::Material::ALPHA_MODE_OPAQUE, Transforms, RenderParams, /*BackToFront = */ false);
+        SortRenderList(GLTF::Material::ALPHA_MODE_MASK, Transforms, RenderParams, /*BackToFront = */ false);
+    }
+    if (RenderParams.SortFlags & RenderInfo::SORT_FLAG_BLEND_BACK_TO_FRONT)
+    {
+        SortRenderList(GLTF::Material::ALPHA_MODE_BLEND, Transforms, RenderParams, /*BackToFront = */ true);
+    }
+
+    return true;
+}
+
+GLTF_PBR_Renderer::RenderListsKey::RenderListsKey(const GLTF::Model& Model, const RenderInfo& RenderParams) noexcept :
+    pModel{&Model},
+    ModelVersion{RenderParams.ModelVersion},
+    SceneIndex{RenderParams.SceneIndex},
+    AlphaModes{RenderParams.AlphaModes},
+    SortFlags{RenderParams.SortFlags},
+    DebugView{RenderParams.DebugView},
+    Flags{RenderParams.Flags},
+    Wireframe{RenderParams.Wireframe},
+    DepthPassMode{RenderParams.DepthPassMode},
+    pSkinnedStreams{RenderParams.pSkinnedStreams}
+{
+}
+
+bool GLTF_PBR_Renderer::RenderListsKey::operator==(const RenderListsKey& rhs) const noexcept
+{
+    // clang-format off
+    return pModel          == rhs.pModel          &&
+           ModelVersion    == rhs.ModelVersion    &&
+           SceneIndex      == rhs.SceneIndex      &&
+           AlphaModes      == rhs.AlphaModes      &&
+           SortFlags       == rhs.SortFlags       &&
+           DebugView       == rhs.DebugView       &&
+           Flags           == rhs.Flags           &&
+           Wireframe       == rhs.Wireframe       &&
+           DepthPassMode   == rhs.DepthPassMode   &&
+           pSkinnedStreams == rhs.pSkinnedStreams;
+    // clang-format on
+}
+
+void GLTF_PBR_Renderer::BuildRenderLists(const GLTF::Model& GLTFModel,
+                                         const RenderInfo&  RenderParams)
+{
     for (auto& List : m_RenderLists)
         List.clear();
+    for (auto& SortState : m_DepthSortStates)
+        SortState.Order.clear();
 
+    const auto  VertexAttribFlags = GetVertexAttribPSOFlags(GLTFModel);
+    const auto& Scene             = GLTFModel.Scenes[RenderParams.SceneIndex];
+    const auto* pSkinnedStreams   = RenderParams.pSkinnedStreams;
     for (const auto* pNode : Scene.LinearNodes)
     {
         VERIFY_EXPR(pNode != nullptr);
         if (pNode->pMesh == nullptr)
             continue;
 
+        const bool PreSkinned = pSkinnedStreams != nullptr && pSkinnedStreams->IsPreSkinned(*pNode);
+
         for (const auto& primitive : pNode->pMesh->Primitives)
         {
             if (primitive.VertexCount == 0 && primitive.IndexCount == 0)
@@ -520,170 +1127,853 @@ void GLTF_PBR_Renderer::Render(IDeviceContext*              pCtx,
             if ((RenderParams.AlphaModes & (1u << AlphaMode)) == 0)
                 continue;
 
-            m_RenderLists[AlphaMode].emplace_back(primitive, *pNode);
+            // Alpha-blended primitives do not write depth
+            if (RenderParams.DepthPassMode == RenderInfo::DEPTH_PASS_MODE_DEPTH_ONLY && AlphaMode == GLTF::Material::ALPHA_MODE_BLEND)
+                continue;
+
+            PSOKey Key = GetPrimitivePSOKey(Material, VertexAttribFlags, RenderParams);
+            if (PreSkinned)
+            {
+                // Pre-skinned vertices are rendered as static geometry
+                PSO_FLAGS PSOFlags = Key.GetFlags() & ~PSO_FLAG_USE_JOINTS;
+                if ((PSOFlags & PSO_FLAG_COMPUTE_MOTION_VECTORS) != 0 && pSkinnedStreams->PrevPositions)
+                    PSOFlags |= PSO_FLAG_USE_PREV_VERTEX_POSITIONS;
+                Key = PSOKey{PSOFlags, Key};
+            }
+
+            PsoCacheAccessor* pPsoCache = RenderParams.Wireframe ? &m_WireframePSOCache : &m_PbrPSOCache;
+            if (RenderParams.DepthPassMode == RenderInfo::DEPTH_PASS_MODE_DEPTH_ONLY)
+            {
+                Key       = GetDepthOnlyPSOKey(Key);
+                pPsoCache = &m_DepthOnlyPSOCache;
+            }
+            else if (RenderParams.DepthPassMode == RenderInfo::DEPTH_PASS_MODE_EQUAL && AlphaMode != GLTF::Material::ALPHA_MODE_BLEND && !RenderParams.Wireframe)
+            {
+                pPsoCache = &m_EqualDepthPSOCache;
+            }
+
+            IPipelineState* pPSO = pPsoCache->Get(Key, true);
+            VERIFY_EXPR(pPSO != nullptr);
+            m_RenderLists[AlphaMode].emplace_back(primitive, *pNode, Key, pPSO, PreSkinned ? pSkinnedStreams : nullptr);
+        }
+    }
+
+    if ((RenderParams.SortFlags & RenderInfo::SORT_FLAG_OPAQUE_FRONT_TO_BACK) == 0)
+    {
+        // Sort opaque and alpha-masked primitives by the pipeline state, then by the material
+        // to minimize state changes. Every material has its own SRB in the model bindings, so
+        // this also groups primitives by the SRB.
+        // Transparent primitives are rendered in the node order or sorted by depth.
+        std::vector<Uint32> Order;
+        for (auto AlphaMode : {GLTF::Material::ALPHA_MODE_OPAQUE, GLTF::Material::ALPHA_MODE_MASK})
+        {
+            const std::vector<PrimitiveRenderInfo>& RenderList = m_RenderLists[AlphaMode];
+
+            Order.resize(RenderList.size());
+            for (Uint32 i = 0; i < Order.size(); ++i)
+                Order[i] = i;
+            std::stable_sort(Order.begin(), Order.end(),
+                             [&RenderList](Uint32 i0, Uint32 i1) {
+                                 const PrimitiveRenderInfo& PrimRI0 = RenderList[i0];
+                                 const PrimitiveRenderInfo& PrimRI1 = RenderList[i1];
+                                 if (PrimRI0.pPSO != PrimRI1.pPSO)
+                                     return PrimRI0.pPSO < PrimRI1.pPSO;
+                                 return PrimRI0.Primitive.MaterialId < PrimRI1.Primitive.MaterialId;
+                             });
+            ApplyRenderListOrder(AlphaMode, Order);
+        }
+    }
+}
+
+void GLTF_PBR_Renderer::ApplyRenderListOrder(GLTF::Material::ALPHA_MODE AlphaMode, const std::vector<Uint32>& Order)
+{
+    std::vector<PrimitiveRenderInfo>& RenderList = m_RenderLists[AlphaMode];
+    VERIFY_EXPR(Order.size() == RenderList.size());
+
+    // Primitive render info objects can't be assigned, so build the sorted list and swap it with the render list.
+    m_SortedRenderList.clear();
+    m_SortedRenderList.reserve(RenderList.size());
+    for (Uint32 Idx : Order)
+        m_SortedRenderList.emplace_back(RenderList[Idx]);
+    RenderList.swap(m_SortedRenderList);
+}
+
+void GLTF_PBR_Renderer::SortRenderList(GLTF::Material::ALPHA_MODE   AlphaMode,
+                                       const GLTF::ModelTransforms& Transforms,
+                                       const RenderInfo&            RenderParams,
+                                       bool                         BackToFront)
+{
+    std::vector<PrimitiveRenderInfo>& RenderList = m_RenderLists[AlphaMode];
+    DepthSortState&                   SortState  = m_DepthSortStates[AlphaMode];
+
+    const Uint32 NumPrimitives = static_cast<Uint32>(RenderList.size());
+    if (NumPrimitives < 2)
+        return;
+
+    // Only the Z component of the view-space position is needed
+    const float4x4 ModelView = RenderParams.ModelTransform * RenderParams.ViewMatrix;
+    const float3   ViewZ{ModelView.m02, ModelView.m12, ModelView.m22};
+    const float    ViewZOffset = ModelView.m32;
+
+    SortState.Keys.resize(NumPrimitives);
+    for (Uint32 i = 0; i < NumPrimitives; ++i)
+    {
+        const PrimitiveRenderInfo& PrimRI = RenderList[i];
+        const BoundBox&            BB     = PrimRI.Primitive.BB;
+
+        const float3 Center = (BB.Min + BB.Max) * 0.5f * Transforms.NodeGlobalMatrices[PrimRI.Node.Index];
+        const Uint32 Key    = DepthToSortKey(dot(Center, ViewZ) + ViewZOffset);
+
+        SortState.Keys[i] = BackToFront ? ~Key : Key;
+    }
+
+    // Unless the list has been rebuilt, it is kept in the previous frame order. When the camera moves
+    // a little, this order is nearly sorted and the insertion sort only needs a few moves. Otherwise,
+    // fall back to the radix sort.
+    bool Sorted = false;
+    if (SortState.Order.size() == NumPrimitives)
+    {
+        for (Uint32 i = 0; i < NumPrimitives; ++i)
+            SortState.Order[i] = i;
+        Sorted = InsertionSortByKey(SortState.Order, SortState.Keys, size_t{NumPrimitives} * 4);
+    }
+    if (!Sorted)
+    {
+        RadixSortByKey(SortState.Order, SortState.Keys, SortState.TmpOrder);
+    }
+
+    ApplyRenderListOrder(AlphaMode, SortState.Order);
+}
+
+GLTF_PBR_Renderer::PSOKey GLTF_PBR_Renderer::GetPrimitivePSOKey(const GLTF::Material& Material,
+                                                                PSO_FLAGS             VertexAttribFlags,
+                                                                const RenderInfo&     RenderParams) const
+{
+    auto PSOFlags = VertexAttribFlags | GetMaterialPSOFlags(Material);
+
+    // These flags will be filtered out by RenderParams.Flags
+    PSOFlags |= PSO_FLAG_USE_TEXTURE_ATLAS |
+        PSO_FLAG_ENABLE_TEXCOORD_TRANSFORM |
+        PSO_FLAG_CONVERT_OUTPUT_TO_SRGB |
+        PSO_FLAG_ENABLE_TONE_MAPPING |
+        PSO_FLAG_COMPUTE_MOTION_VECTORS |
+        PSO_FLAG_USE_LIGHT_CLUSTERS;
+
+    PSOFlags &= RenderParams.Flags;
+
+    if (RenderParams.Wireframe)
+        PSOFlags |= PSO_FLAG_UNSHADED;
+
+    const auto AlphaMode = static_cast<GLTF::Material::ALPHA_MODE>(Material.Attribs.AlphaMode);
+    return PSOKey{PSOFlags, GltfAlphaModeToAlphaMode(AlphaMode), Material.DoubleSided, RenderParams.DebugView};
+}
+
+const GLTF_PBR_Renderer::JointPaletteAllocation* GLTF_PBR_Renderer::UpdateJointPalette(IDeviceContext*              pCtx,
+                                                                                         const GLTF::ModelTransforms& Transforms,
+                                                                                         const GLTF::ModelTransforms& PrevTransforms,
+                                                                                         bool                         UpdatePrevJoints)
+{
+    if (m_Settings.JointsBufferMode != CreateInfo::JOINTS_BUFFER_MODE_STRUCTURED || !m_JointsBuffer || Transforms.Skins.empty())
+        return nullptr;
+
+    // Writes the joint matrices to the palette if they differ from the ones that have been written to it
+    auto WriteJoints = [&](const GLTF::ModelTransforms& SrcTransforms, Uint32 FirstJoint, Uint32 NumJoints, std::vector<Uint8>& WrittenData) {
+        const Uint32 JointMatrixSize = GetJointMatrixSize();
+        m_JointPaletteData.resize(size_t{NumJoints} * JointMatrixSize);
+
+        void* pDst = m_JointPaletteData.data();
+        for (const auto& Skin : SrcTransforms.Skins)
+            pDst = WriteJointMatrices(pDst, Skin.JointMatrices.data(), static_cast<Uint32>(Skin.JointMatrices.size()));
+        VERIFY_EXPR(pDst == m_JointPaletteData.data() + m_JointPaletteData.size());
+
+        if (WrittenData == m_JointPaletteData)
+            return;
+
+        pCtx->UpdateBuffer(m_JointsBuffer, Uint64{FirstJoint} * JointMatrixSize, m_JointPaletteData.size(), m_JointPaletteData.data(), RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
+        WrittenData.swap(m_JointPaletteData);
+    };
+
+    Uint32 NumJoints = 0;
+    for (const auto& Skin : Transforms.Skins)
+        NumJoints += static_cast<Uint32>(Skin.JointMatrices.size());
+    if (NumJoints == 0)
+        return nullptr;
+
+    auto it = m_JointPaletteAllocations.find(&Transforms);
+    if (it != m_JointPaletteAllocations.end() && it->second.NumJoints != NumJoints)
+    {
+        // The transforms object has been reused for a different model. The old range is
+        // not reused, but is released by the next call to Begin().
+        m_JointPaletteAllocations.erase(it);
+        it = m_JointPaletteAllocations.end();
+    }
+
+    if (it == m_JointPaletteAllocations.end())
+    {
+        JointPaletteAllocation Allocation;
+        Allocation.SkinFirstJoint.resize(Transforms.Skins.size());
+        Allocation.NumJoints = NumJoints;
+
+        Uint32 FirstJoint = m_JointPaletteSize;
+        for (size_t i = 0; i < Transforms.Skins.size(); ++i)
+        {
+            Allocation.SkinFirstJoint[i] = FirstJoint;
+            FirstJoint += static_cast<Uint32>(Transforms.Skins[i].JointMatrices.size());
+        }
+
+        if (m_JointPaletteSize + NumJoints > m_Settings.MaxJointCount)
+        {
+            LOG_WARNING_MESSAGE("The joint palette does not have enough space for ", NumJoints, " joints (", m_JointPaletteSize, " of ", m_Settings.MaxJointCount,
+                                " joints are used). Increase MaxJointCount when initializing the renderer.");
+            return nullptr;
         }
+
+        m_JointPaletteSize += NumJoints;
+
+        it = m_JointPaletteAllocations.emplace(&Transforms, std::move(Allocation)).first;
+    }
+
+    JointPaletteAllocation& Allocation = it->second;
+    WriteJoints(Transforms, Allocation.SkinFirstJoint[0], NumJoints, Allocation.JointsData);
+    if (UpdatePrevJoints)
+    {
+        VERIFY_EXPR(PrevTransforms.Skins.size() == Transforms.Skins.size());
+        Uint32 NumPrevJoints = 0;
+        for (const auto& Skin : PrevTransforms.Skins)
+            NumPrevJoints += static_cast<Uint32>(Skin.JointMatrices.size());
+        VERIFY_EXPR(NumPrevJoints == NumJoints);
+        WriteJoints(PrevTransforms, m_Settings.MaxJointCount + Allocation.SkinFirstJoint[0], NumPrevJoints, Allocation.PrevJointsData);
+    }
+
+    StateTransitionDesc Barrier{m_JointsBuffer, RESOURCE_STATE_UNKNOWN, RESOURCE_STATE_SHADER_RESOURCE, STATE_TRANSITION_FLAG_UPDATE_STATE};
+    pCtx->TransitionResourceStates(1, &Barrier);
+
+    return &Allocation;
+}
+
+Uint32 GLTF_PBR_Renderer::WriteJointTransforms(IDeviceContext*               pCtx,
+                                               const GLTF::Node&             Node,
+                                               const GLTF::ModelTransforms&  Transforms,
+                                               const GLTF::ModelTransforms&  PrevTransforms,
+                                               PSO_FLAGS                     PSOFlags,
+                                               const JointPaletteAllocation* pJointPalette,
+                                               Uint32&                       FirstJoint)
+{
+    FirstJoint = 0;
+    if (Node.SkinTransformsIndex < 0 || Node.SkinTransformsIndex >= static_cast<int>(Transforms.Skins.size()))
+        return 0;
+
+    const auto& JointMatrices = Transforms.Skins[Node.SkinTransformsIndex].JointMatrices;
+
+    if (m_Settings.JointsBufferMode == CreateInfo::JOINTS_BUFFER_MODE_STRUCTURED)
+    {
+        // Joint matrices have been written to the palette by UpdateJointPalette()
+        if (pJointPalette == nullptr)
+            return 0;
+
+        FirstJoint = pJointPalette->SkinFirstJoint[Node.SkinTransformsIndex];
+        return static_cast<Uint32>(JointMatrices.size());
     }
 
+    size_t JointCount = JointMatrices.size();
+    if (JointCount > m_Settings.MaxJointCount)
+    {
+        LOG_WARNING_MESSAGE("The number of joints in the mesh (", JointCount, ") exceeds the maximum number (", m_Settings.MaxJointCount,
+                            ") reserved in the buffer. Increase MaxJointCount when initializing the renderer.");
+        JointCount = m_Settings.MaxJointCount;
+    }
+
+    if (JointCount != 0)
+    {
+        MapHelper<float4x4> pJoints{pCtx, m_JointsBuffer, MAP_WRITE, MAP_FLAG_DISCARD};
+        memcpy(pJoints, JointMatrices.data(), JointCount * sizeof(float4x4));
+        if ((PSOFlags & PSO_FLAG_COMPUTE_MOTION_VECTORS) != 0)
+        {
+            const auto& PrevJointMatrices = PrevTransforms.Skins[Node.SkinTransformsIndex].JointMatrices;
+            memcpy(pJoints + m_Settings.MaxJointCount, PrevJointMatrices.data(), JointCount * sizeof(float4x4));
+        }
+    }
+
+    return static_cast<Uint32>(JointCount);
+}
+
+void* GLTF_PBR_Renderer::WritePrimitiveAttribs(void*                        pDstAttribs,
+                                               const GLTF::Model&           GLTFModel,
+                                               const PrimitiveRenderInfo&   PrimRI,
+                                               const GLTF::ModelTransforms& Transforms,
+                                               const GLTF::ModelTransforms& PrevTransforms,
+                                               const RenderInfo&            RenderParams,
+                                               PSO_FLAGS                    PSOFlags,
+                                               Uint32                       JointCount,
+                                               Uint32                       FirstJoint) const
+{
+    static_assert(static_cast<PBR_WORKFLOW>(GLTF::Material::PBR_WORKFLOW_METALL_ROUGH) == PBR_WORKFLOW_METALL_ROUGH, "GLTF::Material::PBR_WORKFLOW_METALL_ROUGH != PBR_WORKFLOW_METALL_ROUGH");
+    static_assert(static_cast<PBR_WORKFLOW>(GLTF::Material::PBR_WORKFLOW_SPEC_GLOSS) == PBR_WORKFLOW_SPEC_GLOSS, "GLTF::Material::PBR_WORKFLOW_SPEC_GLOSS != PBR_WORKFLOW_SPEC_GLOSS");
+    static_assert(static_cast<PBR_WORKFLOW>(GLTF::Material::PBR_WORKFLOW_UNLIT) == PBR_WORKFLOW_UNLIT, "GLTF::Material::PBR_WORKFLOW_UNLIT != PBR_WORKFLOW_UNLIT");
+
+    const auto& Node                 = PrimRI.Node;
+    const auto& material             = GLTFModel.Materials[PrimRI.Primitive.MaterialId];
+    const auto& NodeGlobalMatrix     = Transforms.NodeGlobalMatrices[Node.Index];
+    const auto& PrevNodeGlobalMatrix = PrevTransforms.NodeGlobalMatrices[Node.Index];
+
+    const float4x4  NodeTransform     = NodeGlobalMatrix * RenderParams.ModelTransform;
+    const float4x4& PrevNodeTransform = (PSOFlags & PSO_FLAG_COMPUTE_MOTION_VECTORS) != 0 ?
+        PrevNodeGlobalMatrix * RenderParams.ModelTransform :
+        NodeTransform;
+
+    PBRPrimitiveShaderAttribsData AttribsData{
+        PSOFlags,
+        &NodeTransform,
+        &PrevNodeTransform,
+        JointCount,
+    };
+    AttribsData.FirstJoint = FirstJoint;
+    if (m_pModelBindings != nullptr && !m_pModelBindings->MaterialTextureIds.empty())
+    {
+        VERIFY_EXPR(m_pModelBindings->MaterialTextureIds.size() == GLTFModel.Materials.size() * TEXTURE_ATTRIB_ID_COUNT);
+        AttribsData.MaterialTextureIds = &m_pModelBindings->MaterialTextureIds[PrimRI.Primitive.MaterialId * TEXTURE_ATTRIB_ID_COUNT];
+    }
+    if (m_MaterialsBuffer)
+    {
+        // If the materials could not be allocated, the error has been reported by AllocateMaterials(),
+        // and all primitives use the first material in the buffer.
+        AttribsData.MaterialId = 0;
+        if (m_pModelBindings != nullptr && m_pModelBindings->MaterialRange)
+        {
+            VERIFY_EXPR(PrimRI.Primitive.MaterialId < m_pModelBindings->MaterialRange->NumMaterials);
+            AttribsData.MaterialId = m_pModelBindings->MaterialRange->FirstMaterialId + PrimRI.Primitive.MaterialId;
+        }
+    }
+    return WritePBRPrimitiveShaderAttribs(pDstAttribs, AttribsData, m_Settings.TextureAttribIndices, material);
+}
+
+void GLTF_PBR_Renderer::DrawPrimitiveGeometry(IDeviceContext*        pCtx,
+                                              const GLTF::Model&     GLTFModel,
+                                              const GLTF::Primitive& Primitive,
+                                              bool                   PreSkinned)
+{
+    // Pre-skinned vertex streams are indexed relative to the model base vertex
     const auto FirstIndexLocation = GLTFModel.GetFirstIndexLocation();
-    const auto BaseVertex         = GLTFModel.GetBaseVertex();
+    const auto BaseVertex         = PreSkinned ? 0 : GLTFModel.GetBaseVertex();
+    if (Primitive.HasIndices())
+    {
+        DrawIndexedAttribs drawAttrs{Primitive.IndexCount, VT_UINT32, DRAW_FLAG_VERIFY_ALL};
+        drawAttrs.FirstIndexLocation = FirstIndexLocation + Primitive.FirstIndex;
+        drawAttrs.BaseVertex         = BaseVertex;
+        pCtx->DrawIndexed(drawAttrs);
+    }
+    else
+    {
+        DrawAttribs drawAttrs{Primitive.VertexCount, DRAW_FLAG_VERIFY_ALL};
+        drawAttrs.StartVertexLocation = BaseVertex;
+        pCtx->Draw(drawAttrs);
+    }
+}
+
+void GLTF_PBR_Renderer::BindVertexStreams(IDeviceContext*                pCtx,
+                                          const GLTF::Model&             GLTFModel,
+                                          const SkinnedVertexStreams*    pStreams,
+                                          const SkinnedVertexStreams*&   pBoundStreams,
+                                          RESOURCE_STATE_TRANSITION_MODE StateTransitionMode) const
+{
+    if (pStreams == pBoundStreams)
+        return;
+
+    std::array<IBuffer*, 8> pVBs;
+    std::array<Uint64, 8>   Offsets = {};
+
+    const auto NumVBs = static_cast<Uint32>(GLTFModel.GetVertexBufferCount());
+    VERIFY_EXPR(NumVBs <= pVBs.size());
+    for (Uint32 i = 0; i < NumVBs; ++i)
+    {
+        pVBs[i] = GLTFModel.GetVertexBuffer(i);
+        if (pStreams != nullptr)
+        {
+            if (pStreams->VertexBuffers[i])
+            {
+                pVBs[i] = pStreams->VertexBuffers[i];
+            }
+            else
+            {
+                // Draw commands that use the streams don't apply the model base vertex,
+                // so apply it to the remaining model vertex buffers.
+                Offsets[i] = Uint64{GLTFModel.GetBaseVertex()} * pStreams->VertexStrides[i];
+            }
+        }
+    }
+    pCtx->SetVertexBuffers(0, NumVBs, pVBs.data(), Offsets.data(), StateTransitionMode, SET_VERTEX_BUFFERS_FLAG_NONE);
+
+    if (pStreams != nullptr && pStreams->PrevPositions)
+    {
+        IBuffer* pPrevPositions = pStreams->PrevPositions;
+        pCtx->SetVertexBuffers(GetPrevPositionBufferSlot(), 1, &pPrevPositions, nullptr, StateTransitionMode, SET_VERTEX_BUFFERS_FLAG_NONE);
+    }
+
+    pBoundStreams = pStreams;
+}
+
+void GLTF_PBR_Renderer::DrawPrimitive(IDeviceContext*               pCtx,
+                                      const GLTF::Model&            GLTFModel,
+                                      const PrimitiveRenderInfo&    PrimRI,
+                                      const GLTF::ModelTransforms&  Transforms,
+                                      const GLTF::ModelTransforms&  PrevTransforms,
+                                      const RenderInfo&             RenderParams,
+                                      PSO_FLAGS                     PSOFlags,
+                                      const JointPaletteAllocation* pJointPalette)
+{
+    Uint32       FirstJoint = 0;
+    const Uint32 JointCount = PrimRI.pSkinnedStreams == nullptr ?
+        WriteJointTransforms(pCtx, PrimRI.Node, Transforms, PrevTransforms, PSOFlags, pJointPalette, FirstJoint) :
+        0;
+
+    {
+        void* pAttribsData = nullptr;
+        pCtx->MapBuffer(m_PBRPrimitiveAttribsCB, MAP_WRITE, MAP_FLAG_DISCARD, pAttribsData);
+        if (pAttribsData != nullptr)
+        {
+            auto* pEndPtr = WritePrimitiveAttribs(pAttribsData, GLTFModel, PrimRI, Transforms, PrevTransforms, RenderParams, PSOFlags, JointCount, FirstJoint);
 
-    const std::array<GLTF::Material::ALPHA_MODE, 3> AlphaModes //
+            VERIFY(reinterpret_cast<uint8_t*>(pEndPtr) <= static_cast<uint8_t*>(pAttribsData) + m_PBRPrimitiveAttribsCB->GetDesc().Size,
+                   "Not enough space in the buffer to store primitive attributes");
+
+            pCtx->UnmapBuffer(m_PBRPrimitiveAttribsCB, MAP_WRITE);
+        }
+        else
+        {
+            UNEXPECTED("Unable to map the buffer");
+        }
+    }
+
+    DrawPrimitiveGeometry(pCtx, GLTFModel, PrimRI.Primitive, PrimRI.pSkinnedStreams != nullptr);
+}
+
+void GLTF_PBR_Renderer::RenderPendingDrawItems(IDeviceContext* pCtx, const GLTF::Model& GLTFModel, const SkinnedVertexStreams*& pBoundStreams)
+{
+    IPipelineState*          pCurrPSO    = nullptr;
+    IShaderResourceBinding*  pCurrSRB    = nullptr;
+    IShaderResourceVariable* pAttribsVar = nullptr;
+    for (const auto& Item : m_PendingDrawItems)
+    {
+        if (pCurrPSO != Item.pPSO)
         {
-            GLTF::Material::ALPHA_MODE_OPAQUE, // Opaque primitives - first
-            GLTF::Material::ALPHA_MODE_MASK,   // Alpha-masked primitives - second
-            GLTF::Material::ALPHA_MODE_BLEND,  // Transparent primitives - last (TODO: depth sorting)
-        };
+            pCurrPSO = Item.pPSO;
+            pCtx->SetPipelineState(pCurrPSO);
+        }
+
+        if (pCurrSRB != Item.pSRB)
+        {
+            pCurrSRB    = Item.pSRB;
+            pAttribsVar = pCurrSRB->GetVariableByName(SHADER_TYPE_PIXEL, "cbPrimitiveAttribs");
+            VERIFY(pAttribsVar != nullptr, "Failed to find 'cbPrimitiveAttribs' variable in the shader resource binding");
+            if (pAttribsVar != nullptr)
+                pAttribsVar->SetBufferOffset(Item.AttribsOffset);
+            pCtx->CommitShaderResources(pCurrSRB, RESOURCE_STATE_TRANSITION_MODE_VERIFY);
+        }
+        else if (pAttribsVar != nullptr)
+        {
+            // Dynamic buffer offsets are applied by the draw command, so there is no need to
+            // commit the SRB again.
+            pAttribsVar->SetBufferOffset(Item.AttribsOffset);
+        }
+
+        BindVertexStreams(pCtx, GLTFModel, Item.pPrimRI->pSkinnedStreams, pBoundStreams, RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
+        DrawPrimitiveGeometry(pCtx, GLTFModel, Item.pPrimRI->Primitive, Item.pPrimRI->pSkinnedStreams != nullptr);
+    }
+    m_PendingDrawItems.clear();
+}
+
+static constexpr std::array<GLTF::Material::ALPHA_MODE, 3> RenderListAlphaModes //
+    {
+        GLTF::Material::ALPHA_MODE_OPAQUE, // Opaque primitives - first
+        GLTF::Material::ALPHA_MODE_MASK,   // Alpha-masked primitives - second
+        GLTF::Material::ALPHA_MODE_BLEND,  // Transparent primitives - last (see RenderInfo::SORT_FLAG_BLEND_BACK_TO_FRONT)
+    };
+
+void GLTF_PBR_Renderer::Render(IDeviceContext*              pCtx,
+                               const GLTF::Model&           GLTFModel,
+                               const GLTF::ModelTransforms& Transforms,
+                               const GLTF::ModelTransforms* PrevTransforms,
+                               const RenderInfo&            RenderParams,
+                               ModelResourceBindings*       pModelBindings,
+                               ResourceCacheBindings*       pCacheBindings)
+{
+    if (!PrepareRenderLists(GLTFModel, Transforms, RenderParams, pModelBindings, pCacheBindings))
+        return;
+
+    if (pModelBindings != nullptr)
+    {
+        std::array<IBuffer*, 8> pVBs;
+
+        const auto NumVBs = static_cast<Uint32>(GLTFModel.GetVertexBufferCount());
+        VERIFY_EXPR(NumVBs <= pVBs.size());
+        for (Uint32 i = 0; i < NumVBs; ++i)
+            pVBs[i] = GLTFModel.GetVertexBuffer(i);
+        pCtx->SetVertexBuffers(0, NumVBs, pVBs.data(), nullptr, RESOURCE_STATE_TRANSITION_MODE_TRANSITION, SET_VERTEX_BUFFERS_FLAG_RESET);
+
+        if (auto* pIndexBuffer = GLTFModel.GetIndexBuffer())
+        {
+            pCtx->SetIndexBuffer(pIndexBuffer, 0, RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
+        }
+    }
 
     IPipelineState*         pCurrPSO = nullptr;
     IShaderResourceBinding* pCurrSRB = nullptr;
     PSOKey                  CurrPsoKey;
 
+    // Pre-skinned vertex streams that are currently bound in place of the model vertex buffers
+    const SkinnedVertexStreams* pBoundStreams = nullptr;
+
     if (PrevTransforms == nullptr)
         PrevTransforms = &Transforms;
 
-    for (auto AlphaMode : AlphaModes)
+    const JointPaletteAllocation* pJointPalette =
+        UpdateJointPalette(pCtx, Transforms, *PrevTransforms, (RenderParams.Flags & PSO_FLAG_COMPUTE_MOTION_VECTORS) != 0);
+
+    if (pModelBindings != nullptr)
+        UpdateMaterialBuffer(pCtx, GLTFModel, *pModelBindings);
+
+    // Packed primitive attributes state
+    const Uint32 AttribsBufferSize  = static_cast<Uint32>(m_PBRPrimitiveAttribsCB->GetDesc().Size);
+    void*        pMappedAttribsData = nullptr;
+    Uint32       CurrAttribsOffset  = 0;
+    // Joint transforms in the uniform joints buffer are not packed, so only one skinned primitive
+    // may be pending at a time. The structured joint palette contains the joints of all skins.
+    bool PendingSkinnedPrimitive = false;
+
+    auto FlushPendingDraws = [&]() {
+        if (pMappedAttribsData != nullptr)
+        {
+            pCtx->UnmapBuffer(m_PBRPrimitiveAttribsCB, MAP_WRITE);
+            pMappedAttribsData = nullptr;
+        }
+        RenderPendingDrawItems(pCtx, GLTFModel, pBoundStreams);
+        CurrAttribsOffset       = 0;
+        PendingSkinnedPrimitive = false;
+    };
+
+    m_PendingDrawItems.clear();
+    for (auto AlphaMode : RenderListAlphaModes)
     {
         const auto& RenderList = m_RenderLists[AlphaMode];
         for (const auto& PrimRI : RenderList)
         {
-            const auto& Node                 = PrimRI.Node;
-            const auto& primitive            = PrimRI.Primitive;
-            const auto& material             = GLTFModel.Materials[primitive.MaterialId];
-            const auto& NodeGlobalMatrix     = Transforms.NodeGlobalMatrices[Node.Index];
-            const auto& PrevNodeGlobalMatrix = PrevTransforms->NodeGlobalMatrices[Node.Index];
+            const auto& primitive = PrimRI.Primitive;
 
-            auto PSOFlags = VertexAttribFlags | GetMaterialPSOFlags(material);
-
-            // These flags will be filtered out by RenderParams.Flags
-            PSOFlags |= PSO_FLAG_USE_TEXTURE_ATLAS |
-                PSO_FLAG_ENABLE_TEXCOORD_TRANSFORM |
-                PSO_FLAG_CONVERT_OUTPUT_TO_SRGB |
-                PSO_FLAG_ENABLE_TONE_MAPPING |
-                PSO_FLAG_COMPUTE_MOTION_VECTORS;
-
-            PSOFlags &= RenderParams.Flags;
-
-            if (RenderParams.Wireframe)
-                PSOFlags |= PSO_FLAG_UNSHADED;
-
-            const PSOKey NewKey{PSOFlags, GltfAlphaModeToAlphaMode(AlphaMode), material.DoubleSided, RenderParams.DebugView};
+            const PSOKey& NewKey = PrimRI.Key;
             if (NewKey != CurrPsoKey)
             {
                 CurrPsoKey = NewKey;
                 pCurrPSO   = nullptr;
             }
 
-            if (pCurrPSO == nullptr)
+            IShaderResourceBinding* pSRB = nullptr;
+            if (pModelBindings != nullptr)
             {
-                pCurrPSO = (RenderParams.Wireframe ? m_WireframePSOCache : m_PbrPSOCache).Get(NewKey, true);
-                VERIFY_EXPR(pCurrPSO != nullptr);
-                pCtx->SetPipelineState(pCurrPSO);
+                VERIFY(primitive.MaterialId < pModelBindings->MaterialSRB.size(),
+                       "Material index is out of bounds. This most likely indicates that shader resources were initialized for a different model.");
+
+                pSRB = pModelBindings->MaterialSRB[primitive.MaterialId];
+                DEV_CHECK_ERR(pSRB != nullptr, "Unable to find SRB for GLTF material.");
             }
             else
             {
-                VERIFY_EXPR(pCurrPSO == (RenderParams.Wireframe ? m_WireframePSOCache : m_PbrPSOCache).Get(NewKey, false));
+                VERIFY_EXPR(pCacheBindings != nullptr);
+                pSRB = pCacheBindings->pSRB;
             }
 
-            if (pModelBindings != nullptr)
+            if (!m_PackPrimitiveAttribs)
             {
-                VERIFY(primitive.MaterialId < pModelBindings->MaterialSRB.size(),
-                       "Material index is out of bounds. This most likely indicates that shader resources were initialized for a different model.");
+                if (pCurrPSO == nullptr)
+                {
+                    pCurrPSO = PrimRI.pPSO;
+                    VERIFY_EXPR(pCurrPSO != nullptr);
+                    pCtx->SetPipelineState(pCurrPSO);
+                }
+                else
+                {
+                    VERIFY_EXPR(pCurrPSO == PrimRI.pPSO);
+                }
 
-                IShaderResourceBinding* const pSRB = pModelBindings->MaterialSRB[primitive.MaterialId];
-                DEV_CHECK_ERR(pSRB != nullptr, "Unable to find SRB for GLTF material.");
                 if (pCurrSRB != pSRB)
                 {
                     pCurrSRB = pSRB;
                     pCtx->CommitShaderResources(pSRB, RESOURCE_STATE_TRANSITION_MODE_VERIFY);
                 }
+
+                BindVertexStreams(pCtx, GLTFModel, PrimRI.pSkinnedStreams, pBoundStreams, RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
+                DrawPrimitive(pCtx, GLTFModel, PrimRI, Transforms, *PrevTransforms, RenderParams, CurrPsoKey.GetFlags(), pJointPalette);
+                continue;
             }
-            else
+
+            if (pCurrPSO == nullptr)
             {
-                VERIFY_EXPR(pCacheBindings != nullptr);
-                if (pCurrSRB != pCacheBindings->pSRB)
-                {
-                    pCurrSRB = pCacheBindings->pSRB;
-                    pCtx->CommitShaderResources(pCurrSRB, RESOURCE_STATE_TRANSITION_MODE_VERIFY);
-                }
+                pCurrPSO = PrimRI.pPSO;
+                VERIFY_EXPR(pCurrPSO != nullptr);
             }
 
-            size_t JointCount = 0;
-            if (Node.SkinTransformsIndex >= 0 && Node.SkinTransformsIndex < static_cast<int>(Transforms.Skins.size()))
+            // Note that the actual attribs size may be smaller than the range, but we need
+            // to check for the entire range to avoid errors.
+            if (CurrAttribsOffset + m_PrimitiveAttribsRange > AttribsBufferSize)
             {
-                const auto& JointMatrices = Transforms.Skins[Node.SkinTransformsIndex].JointMatrices;
+                // The buffer is full. Render the pending items and start filling the buffer from the beginning.
+                FlushPendingDraws();
+            }
 
-                JointCount = JointMatrices.size();
-                if (JointCount > m_Settings.MaxJointCount)
-                {
-                    LOG_WARNING_MESSAGE("The number of joints in the mesh (", JointCount, ") exceeds the maximum number (", m_Settings.MaxJointCount,
-                                        ") reserved in the buffer. Increase MaxJointCount when initializing the renderer.");
-                    JointCount = m_Settings.MaxJointCount;
-                }
+            Uint32 JointCount = 0;
+            Uint32 FirstJoint = 0;
+            if (PrimRI.Node.SkinTransformsIndex >= 0 && PrimRI.pSkinnedStreams == nullptr)
+            {
+                if (PendingSkinnedPrimitive)
+                    FlushPendingDraws();
+                JointCount              = WriteJointTransforms(pCtx, PrimRI.Node, Transforms, *PrevTransforms, CurrPsoKey.GetFlags(), pJointPalette, FirstJoint);
+                PendingSkinnedPrimitive = JointCount > 0 && m_Settings.JointsBufferMode != CreateInfo::JOINTS_BUFFER_MODE_STRUCTURED;
+            }
 
-                if (JointCount != 0)
+            if (pMappedAttribsData == nullptr)
+            {
+                pCtx->MapBuffer(m_PBRPrimitiveAttribsCB, MAP_WRITE, MAP_FLAG_DISCARD, pMappedAttribsData);
+                if (pMappedAttribsData == nullptr)
                 {
-                    MapHelper<float4x4> pJoints{pCtx, m_JointsBuffer, MAP_WRITE, MAP_FLAG_DISCARD};
-                    memcpy(pJoints, JointMatrices.data(), JointCount * sizeof(float4x4));
-                    if ((CurrPsoKey.GetFlags() & PSO_FLAG_COMPUTE_MOTION_VECTORS) != 0)
-                    {
-                        const auto& PrevJointMatrices = PrevTransforms->Skins[Node.SkinTransformsIndex].JointMatrices;
-                        memcpy(pJoints + m_Settings.MaxJointCount, PrevJointMatrices.data(), JointCount * sizeof(float4x4));
-                    }
+                    UNEXPECTED("Failed to map the primitive attributes buffer");
+                    break;
                 }
             }
 
+            void* pEndPtr = WritePrimitiveAttribs(static_cast<Uint8*>(pMappedAttribsData) + CurrAttribsOffset, GLTFModel, PrimRI,
+                                                  Transforms, *PrevTransforms, RenderParams, CurrPsoKey.GetFlags(), JointCount, FirstJoint);
+
+            const Uint32 AttribsSize = static_cast<Uint32>(static_cast<Uint8*>(pEndPtr) - static_cast<Uint8*>(pMappedAttribsData)) - CurrAttribsOffset;
+            VERIFY(AttribsSize <= m_PrimitiveAttribsRange, "Primitive attributes size exceeds the range bound in the SRB");
+
+            PreparedDrawItem Item;
+            Item.pPrimRI       = &PrimRI;
+            Item.pPSO          = pCurrPSO;
+            Item.pSRB          = pSRB;
+            Item.PSOFlags      = CurrPsoKey.GetFlags();
+            Item.AttribsOffset = CurrAttribsOffset;
+            m_PendingDrawItems.push_back(Item);
+
+            CurrAttribsOffset += AlignUp(AttribsSize, m_ConstantBufferOffsetAlignment);
+        }
+    }
+
+    if (!m_PendingDrawItems.empty())
+    {
+        FlushPendingDraws();
+    }
+
+    // Restore the model vertex buffers
+    BindVertexStreams(pCtx, GLTFModel, nullptr, pBoundStreams, RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
+}
+
+void GLTF_PBR_Renderer::RenderParallel(IDeviceContext*              pImmediateCtx,
+                                       const ParallelRenderInfo&    ParallelInfo,
+                                       const GLTF::Model&           GLTFModel,
+                                       const GLTF::ModelTransforms& Transforms,
+                                       const GLTF::ModelTransforms* PrevTransforms,
+                                       const RenderInfo&            RenderParams,
+                                       ModelResourceBindings*       pModelBindings,
+                                       ResourceCacheBindings*       pCacheBindings)
+{
+    DEV_CHECK_ERR(pImmediateCtx != nullptr && !pImmediateCtx->GetDesc().IsDeferred, "Immediate context must not be null");
+    DEV_CHECK_ERR(ParallelInfo.NumDeferredContexts == 0 || ParallelInfo.ppDeferredContexts != nullptr, "Deferred contexts must not be null");
+    DEV_CHECK_ERR(m_PBRPrimitiveAttribsCB->GetDesc().Usage == USAGE_DYNAMIC, "Primitive attributes buffer must be dynamic to be used in deferred contexts");
+    DEV_CHECK_ERR(!m_JointsBuffer || m_Settings.JointsBufferMode == CreateInfo::JOINTS_BUFFER_MODE_STRUCTURED || m_JointsBuffer->GetDesc().Usage == USAGE_DYNAMIC,
+                  "Uniform joints buffer must be dynamic to be used in deferred contexts");
+
+    if (ParallelInfo.NumDeferredContexts == 0)
+    {
+        Render(pImmediateCtx, GLTFModel, Transforms, PrevTransforms, RenderParams, pModelBindings, pCacheBindings);
+        return;
+    }
+
+    if (!PrepareRenderLists(GLTFModel, Transforms, RenderParams, pModelBindings, pCacheBindings))
+        return;
+
+    if (PrevTransforms == nullptr)
+        PrevTransforms = &Transforms;
+
+    // The joint palette is shared by all contexts, so update it in the immediate context
+    const JointPaletteAllocation* pJointPalette =
+        UpdateJointPalette(pImmediateCtx, Transforms, *PrevTransforms, (RenderParams.Flags & PSO_FLAG_COMPUTE_MOTION_VECTORS) != 0);
+
+    // The material buffer is also shared by all contexts
+    if (pModelBindings != nullptr)
+        UpdateMaterialBuffer(pImmediateCtx, GLTFModel, *pModelBindings);
+
+    // Resolve SRBs in the calling thread. Pipeline states are resolved when the render lists are built:
+    // the PSO cache is not thread-safe, and new pipelines may need to be created.
+    m_ParallelDrawList.clear();
+    for (auto AlphaMode : RenderListAlphaModes)
+    {
+        for (const auto& PrimRI : m_RenderLists[AlphaMode])
+        {
+            const auto& primitive = PrimRI.Primitive;
+
+            PreparedDrawItem Item;
+            Item.pPrimRI  = &PrimRI;
+            Item.pPSO     = PrimRI.pPSO;
+            Item.PSOFlags = PrimRI.Key.GetFlags();
+            if (pModelBindings != nullptr)
             {
-                void* pAttribsData = nullptr;
-                pCtx->MapBuffer(m_PBRPrimitiveAttribsCB, MAP_WRITE, MAP_FLAG_DISCARD, pAttribsData);
-                if (pAttribsData != nullptr)
-                {
-                    static_assert(static_cast<PBR_WORKFLOW>(GLTF::Material::PBR_WORKFLOW_METALL_ROUGH) == PBR_WORKFLOW_METALL_ROUGH, "GLTF::Material::PBR_WORKFLOW_METALL_ROUGH != PBR_WORKFLOW_METALL_ROUGH");
-                    static_assert(static_cast<PBR_WORKFLOW>(GLTF::Material::PBR_WORKFLOW_SPEC_GLOSS) == PBR_WORKFLOW_SPEC_GLOSS, "GLTF::Material::PBR_WORKFLOW_SPEC_GLOSS != PBR_WORKFLOW_SPEC_GLOSS");
-                    static_assert(static_cast<PBR_WORKFLOW>(GLTF::Material::PBR_WORKFLOW_UNLIT) == PBR_WORKFLOW_UNLIT, "GLTF::Material::PBR_WORKFLOW_UNLIT != PBR_WORKFLOW_UNLIT");
-
-                    const float4x4  NodeTransform     = NodeGlobalMatrix * RenderParams.ModelTransform;
-                    const float4x4& PrevNodeTransform = (CurrPsoKey.GetFlags() & PSO_FLAG_COMPUTE_MOTION_VECTORS) != 0 ?
-                        PrevNodeGlobalMatrix * RenderParams.ModelTransform :
-                        NodeTransform;
-
-                    PBRPrimitiveShaderAttribsData AttribsData{
-                        CurrPsoKey.GetFlags(),
-                        &NodeTransform,
-                        &PrevNodeTransform,
-                        static_cast<Uint32>(JointCount),
-                    };
-                    auto* pEndPtr = WritePBRPrimitiveShaderAttribs(pAttribsData, AttribsData, m_Settings.TextureAttribIndices, material);
-
-                    VERIFY(reinterpret_cast<uint8_t*>(pEndPtr) <= static_cast<uint8_t*>(pAttribsData) + m_PBRPrimitiveAttribsCB->GetDesc().Size,
-                           "Not enough space in the buffer to store primitive attributes");
-
-                    pCtx->UnmapBuffer(m_PBRPrimitiveAttribsCB, MAP_WRITE);
-                }
-                else
+                VERIFY(primitive.MaterialId < pModelBindings->MaterialSRB.size(),
+                       "Material index is out of bounds. This most likely indicates that shader resources were initialized for a different model.");
+                Item.pSRB = pModelBindings->MaterialSRB[primitive.MaterialId];
+            }
+            else
+            {
+                VERIFY_EXPR(pCacheBindings != nullptr);
+                Item.pSRB = pCacheBindings->pSRB;
+            }
+            DEV_CHECK_ERR(Item.pPSO != nullptr && Item.pSRB != nullptr, "Failed to resolve pipeline state or SRB for the primitive");
+#ifdef DILIGENT_DEVELOPMENT
+            if (Item.pSRB != nullptr && (m_ParallelDrawList.empty() || m_ParallelDrawList.back().pSRB != Item.pSRB))
+            {
+                if (auto* pVar = Item.pSRB->GetVariableByName(SHADER_TYPE_VERTEX, "cbFrameAttribs"))
                 {
-                    UNEXPECTED("Unable to map the buffer");
+                    RefCntAutoPtr<IBuffer> pFrameAttribs{pVar->Get(), IID_Buffer};
+                    DEV_CHECK_ERR(!pFrameAttribs || pFrameAttribs->GetDesc().Usage != USAGE_DYNAMIC,
+                                  "Frame attributes buffer must not be dynamic to be used in deferred contexts: dynamic buffers "
+                                  "must be mapped in every context they are used in, while the frame attributes are only written "
+                                  "by the application in the immediate context. Use USAGE_DEFAULT and update the buffer with UpdateBuffer().");
                 }
             }
+#endif
+            if (m_PackPrimitiveAttribs && Item.pSRB != nullptr)
+            {
+                // Deferred contexts map the buffer with MAP_FLAG_DISCARD for every primitive, so reset
+                // the offset that may have been set by Render(). SRBs can't be modified by the workers.
+                if (auto* pVar = Item.pSRB->GetVariableByName(SHADER_TYPE_PIXEL, "cbPrimitiveAttribs"))
+                    pVar->SetBufferOffset(0);
+            }
+            m_ParallelDrawList.push_back(Item);
+        }
+    }
 
-            if (primitive.HasIndices())
+    if (m_ParallelDrawList.empty())
+        return;
+
+    std::array<IBuffer*, 8> pVBs;
+
+    const auto NumVBs = static_cast<Uint32>(GLTFModel.GetVertexBufferCount());
+    VERIFY_EXPR(NumVBs <= pVBs.size());
+    for (Uint32 i = 0; i < NumVBs; ++i)
+        pVBs[i] = GLTFModel.GetVertexBuffer(i);
+    IBuffer* const pIndexBuffer = GLTFModel.GetIndexBuffer();
+
+    // Deferred contexts can't transition resources, so do this in the immediate context.
+    {
+        std::vector<StateTransitionDesc> Barriers;
+        for (Uint32 i = 0; i < NumVBs; ++i)
+        {
+            if (pVBs[i] != nullptr)
+                Barriers.emplace_back(pVBs[i], RESOURCE_STATE_UNKNOWN, RESOURCE_STATE_VERTEX_BUFFER, STATE_TRANSITION_FLAG_UPDATE_STATE);
+        }
+        if (pIndexBuffer != nullptr)
+            Barriers.emplace_back(pIndexBuffer, RESOURCE_STATE_UNKNOWN, RESOURCE_STATE_INDEX_BUFFER, STATE_TRANSITION_FLAG_UPDATE_STATE);
+        if (const auto* pStreams = RenderParams.pSkinnedStreams)
+        {
+            for (IBuffer* pStreamVB : pStreams->VertexBuffers)
             {
-                DrawIndexedAttribs drawAttrs{primitive.IndexCount, VT_UINT32, DRAW_FLAG_VERIFY_ALL};
-                drawAttrs.FirstIndexLocation = FirstIndexLocation + primitive.FirstIndex;
-                drawAttrs.BaseVertex         = BaseVertex;
-                pCtx->DrawIndexed(drawAttrs);
+                if (pStreamVB != nullptr)
+                    Barriers.emplace_back(pStreamVB, RESOURCE_STATE_UNKNOWN, RESOURCE_STATE_VERTEX_BUFFER, STATE_TRANSITION_FLAG_UPDATE_STATE);
             }
-            else
+            if (pStreams->PrevPositions)
+                Barriers.emplace_back(pStreams->PrevPositions, RESOURCE_STATE_UNKNOWN, RESOURCE_STATE_VERTEX_BUFFER, STATE_TRANSITION_FLAG_UPDATE_STATE);
+        }
+        if (!Barriers.empty())
+            pImmediateCtx->TransitionResourceStates(static_cast<Uint32>(Barriers.size()), Barriers.data());
+    }
+
+    const Uint32 NumItems       = static_cast<Uint32>(m_ParallelDrawList.size());
+    const Uint32 MinItemsPerCtx = std::max(ParallelInfo.MinPrimitivesPerContext, 1u);
+    const Uint32 NumContexts    = std::min(ParallelInfo.NumDeferredContexts, (NumItems + MinItemsPerCtx - 1) / MinItemsPerCtx);
+    const Uint32 ItemsPerCtx    = (NumItems + NumContexts - 1) / NumContexts;
+    const Uint32 ImmediateCtxId = pImmediateCtx->GetDesc().ContextId;
+
+    std::vector<RefCntAutoPtr<ICommandList>> CommandLists(NumContexts);
+
+    auto RecordCommandList = [&](Uint32 CtxIdx) {
+        IDeviceContext* pCtx = ParallelInfo.ppDeferredContexts[CtxIdx];
+        VERIFY_EXPR(pCtx != nullptr && pCtx->GetDesc().IsDeferred);
+
+        pCtx->Begin(ImmediateCtxId);
+        pCtx->SetRenderTargets(ParallelInfo.NumRenderTargets, ParallelInfo.ppRTVs, ParallelInfo.pDSV, RESOURCE_STATE_TRANSITION_MODE_VERIFY);
+        if (ParallelInfo.pViewport != nullptr)
+            pCtx->SetViewports(1, ParallelInfo.pViewport, 0, 0);
+
+        pCtx->SetVertexBuffers(0, NumVBs, pVBs.data(), nullptr, RESOURCE_STATE_TRANSITION_MODE_VERIFY, SET_VERTEX_BUFFERS_FLAG_RESET);
+        if (pIndexBuffer != nullptr)
+            pCtx->SetIndexBuffer(pIndexBuffer, 0, RESOURCE_STATE_TRANSITION_MODE_VERIFY);
+
+        if (m_JointsBuffer && m_Settings.JointsBufferMode == CreateInfo::JOINTS_BUFFER_MODE_UNIFORM)
+        {
+            // Dynamic buffers must be mapped before the first use in every context
+            MapHelper<float4x4> pJoints{pCtx, m_JointsBuffer, MAP_WRITE, MAP_FLAG_DISCARD};
+        }
+
+        IPipelineState*             pCurrPSO      = nullptr;
+        IShaderResourceBinding*     pCurrSRB      = nullptr;
+        const SkinnedVertexStreams* pBoundStreams = nullptr;
+
+        const Uint32 FirstItem = CtxIdx * ItemsPerCtx;
+        const Uint32 EndItem   = std::min(FirstItem + ItemsPerCtx, NumItems);
+        for (Uint32 i = FirstItem; i < EndItem; ++i)
+        {
+            const auto& Item = m_ParallelDrawList[i];
+            if (pCurrPSO != Item.pPSO)
             {
-                DrawAttribs drawAttrs{primitive.VertexCount, DRAW_FLAG_VERIFY_ALL};
-                drawAttrs.StartVertexLocation = BaseVertex;
-                pCtx->Draw(drawAttrs);
+                pCurrPSO = Item.pPSO;
+                pCtx->SetPipelineState(pCurrPSO);
             }
+            if (pCurrSRB != Item.pSRB)
+            {
+                pCurrSRB = Item.pSRB;
+                pCtx->CommitShaderResources(pCurrSRB, RESOURCE_STATE_TRANSITION_MODE_VERIFY);
+            }
+            BindVertexStreams(pCtx, GLTFModel, Item.pPrimRI->pSkinnedStreams, pBoundStreams, RESOURCE_STATE_TRANSITION_MODE_VERIFY);
+            DrawPrimitive(pCtx, GLTFModel, *Item.pPrimRI, Transforms, *PrevTransforms, RenderParams, Item.PSOFlags, pJointPalette);
+        }
+
+        pCtx->FinishCommandList(&CommandLists[CtxIdx]);
+    };
+
+    if (ParallelInfo.pThreadPool != nullptr && NumContexts > 1)
+    {
+        std::vector<RefCntAutoPtr<IAsyncTask>> Tasks;
+        Tasks.reserve(NumContexts - 1);
+        for (Uint32 CtxIdx = 1; CtxIdx < NumContexts; ++CtxIdx)
+        {
+            Tasks.emplace_back(EnqueueAsyncWork(ParallelInfo.pThreadPool,
+                                                [&RecordCommandList, CtxIdx](Uint32 /*ThreadId*/) {
+                                                    RecordCommandList(CtxIdx);
+                                                    return ASYNC_TASK_STATUS_COMPLETE;
+                                                }));
         }
+
+        // Record the first command list in this thread while the workers record the rest
+        RecordCommandList(0);
+
+        for (auto& pTask : Tasks)
+            pTask->WaitForCompletion();
+    }
+    else
+    {
+        for (Uint32 CtxIdx = 0; CtxIdx < NumContexts; ++CtxIdx)
+            RecordCommandList(CtxIdx);
     }
+
+    std::vector<ICommandList*> pCmdLists(NumContexts);
+    for (Uint32 i = 0; i < NumContexts; ++i)
+        pCmdLists[i] = CommandLists[i];
+    pImmediateCtx->ExecuteCommandLists(NumContexts, pCmdLists.data());
+
+    for (Uint32 i = 0; i < NumContexts; ++i)
+        ParallelInfo.ppDeferredContexts[i]->FinishFrame();
 }
 
 template <typename ShaderStructType, typename HostStructType>
-Uint8* WriteShaderAttribs(Uint8* pDstPtr, HostStructType* pSrc, const char* DebugName)
+Uint8* WriteShaderAttribs(Uint8* pDstPtr, HostStructType* pSrc, const char* DebugName, bool AllowMissing = false)
 {
     static_assert(sizeof(ShaderStructType) == sizeof(HostStructType), "Size of HLSL and C++ structures must be the same");
     if (pSrc != nullptr)
@@ -692,7 +1982,8 @@ Uint8* WriteShaderAttribs(Uint8* pDstPtr, HostStructType* pSrc, const char* Debu
     }
     else
     {
-        UNEXPECTED("Shader attribute ", DebugName, " is not initialized in the material");
+        if (!AllowMissing)
+            UNEXPECTED("Shader attribute ", DebugName, " is not initialized in the material");
         memset(pDstPtr, 0, sizeof(ShaderStructType));
     }
     static_assert(sizeof(ShaderStructType) % 16 == 0, "Size structure must be a multiple of 16");
@@ -710,20 +2001,14 @@ void* GLTF_PBR_Renderer::WritePBRPrimitiveShaderAttribs(void*
     //struct PBRPrimitiveAttribs
     //{
     //    GLTFNodeShaderTransforms Transforms;
-    //    float4x4                 PrevNodeMatrix; // #if ENABLE_MOTION_VECTORS
-    //    struct PBRMaterialShaderInfo
-    //    {
-    //        PBRMaterialBasicAttribs        Basic;
-    //        PBRMaterialSheenAttribs        Sheen;        // #if ENABLE_SHEEN
-    //        PBRMaterialAnisotropyAttribs   Anisotropy;   // #if ENABLE_ANISOTROPY
-    //        PBRMaterialIridescenceAttribs  Iridescence;  // #if ENABLE_IRIDESCENCE
-    //        PBRMaterialTransmissionAttribs Transmission; // #if ENABLE_TRANSMISSION
-    //        PBRMaterialVolumeAttribs       Volume;       // #if ENABLE_VOLUME
-    //        PBRMaterialTextureAttribs Textures[PBR_NUM_TEXTURE_ATTRIBUTES];
-    //    } Material;
-    //    float4 CustomData;
+    //    float4x4                 PrevNodeMatrix;  // #if ENABLE_MOTION_VECTORS
+    //    float4                   BaseColorFactor; // #if USE_MATERIAL_BUFFER
+    //    PBRMaterialShaderInfo    Material;        // #if !USE_MATERIAL_BUFFER
+    //    float4                   CustomData;
     //};
 
+    const bool UseMaterialBuffer = AttribsData.MaterialId != ~0u;
+
     Uint8* pDstPtr = reinterpret_cast<Uint8*>(pDstShaderAttribs);
 
     {
@@ -736,7 +2021,10 @@ void* GLTF_PBR_Renderer::WritePBRPrimitiveShaderAttribs(void*
         {
             UNEXPECTED("Node matrix must not be null");
         }
-        pDstTransforms->JointCount = static_cast<int>(AttribsData.JointCount);
+        pDstTransforms->JointCount    = static_cast<int>(AttribsData.JointCount);
+        pDstTransforms->FirstInstance = static_cast<int>(AttribsData.FirstInstance);
+        pDstTransforms->FirstJoint    = static_cast<int>(AttribsData.FirstJoint);
+        pDstTransforms->MaterialId    = UseMaterialBuffer ? static_cast<int>(AttribsData.MaterialId) : 0;
 
         static_assert(sizeof(HLSL::GLTFNodeShaderTransforms) % 16 == 0, "Size of HLSL::GLTFNodeShaderTransforms must be a multiple of 16");
         pDstPtr += sizeof(HLSL::GLTFNodeShaderTransforms);
@@ -755,33 +2043,79 @@ void* GLTF_PBR_Renderer::WritePBRPrimitiveShaderAttribs(void*
         pDstPtr += sizeof(float4x4);
     }
 
-    if (AttribsData.pMaterialBasicAttribsDstPtr != nullptr)
-        *AttribsData.pMaterialBasicAttribsDstPtr = reinterpret_cast<HLSL::PBRMaterialBasicAttribs*>(pDstPtr);
+    if (UseMaterialBuffer)
+    {
+        memcpy(pDstPtr, &AttribsData.BaseColorFactor, sizeof(float4));
+        pDstPtr += sizeof(float4);
+    }
+    else
+    {
+        pDstPtr = static_cast<Uint8*>(WritePBRMaterialShaderAttribs(pDstPtr, AttribsData.PSOFlags, TextureAttribIndices, Material,
+                                                                    AttribsData.MaterialTextureIds, AttribsData.pMaterialBasicAttribsDstPtr));
+    }
+
+    {
+        if (AttribsData.CustomData != nullptr)
+        {
+            VERIFY_EXPR(AttribsData.CustomDataSize > 0);
+            memcpy(pDstPtr, AttribsData.CustomData, AttribsData.CustomDataSize);
+        }
+        pDstPtr += AttribsData.CustomDataSize;
+    }
+
+    return pDstPtr;
+}
+
+void* GLTF_PBR_Renderer::WritePBRMaterialShaderAttribs(void*                                           pDstShaderAttribs,
+                                                       PSO_FLAGS                                       PSOFlags,
+                                                       const std::array<int, TEXTURE_ATTRIB_ID_COUNT>& TextureAttribIndices,
+                                                       const GLTF::Material&                           Material,
+                                                       const float*                                    MaterialTextureIds,
+                                                       HLSL::PBRMaterialBasicAttribs**                 ppMaterialBasicAttribsDst,
+                                                       bool                                            AllowMissingAttribs)
+{
+    // When adding new members, don't forget to update PBR_Renderer::GetPBRMaterialAttribsSize!
+
+    //struct PBRMaterialShaderInfo
+    //{
+    //    PBRMaterialBasicAttribs        Basic;
+    //    PBRMaterialSheenAttribs        Sheen;        // #if ENABLE_SHEEN
+    //    PBRMaterialAnisotropyAttribs   Anisotropy;   // #if ENABLE_ANISOTROPY
+    //    PBRMaterialIridescenceAttribs  Iridescence;  // #if ENABLE_IRIDESCENCE
+    //    PBRMaterialTransmissionAttribs Transmission; // #if ENABLE_TRANSMISSION
+    //    PBRMaterialVolumeAttribs       Volume;       // #if ENABLE_VOLUME
+    //    PBRMaterialTextureAttribs Textures[PBR_NUM_TEXTURE_ATTRIBUTES];
+    //};
+
+    Uint8* pDstPtr = reinterpret_cast<Uint8*>(pDstShaderAttribs);
+
+    if (ppMaterialBasicAttribsDst != nullptr)
+        *ppMaterialBasicAttribsDst = reinterpret_cast<HLSL::PBRMaterialBasicAttribs*>(pDstPtr);
     pDstPtr = WriteShaderAttribs<HLSL::PBRMaterialBasicAttribs>(pDstPtr, &Material.Attribs, "Basic Attribs");
 
-    if (AttribsData.PSOFlags & PSO_FLAG_ENABLE_SHEEN)
+    if (PSOFlags & PSO_FLAG_ENABLE_SHEEN)
     {
-        pDstPtr = WriteShaderAttribs<HLSL::PBRMaterialSheenAttribs>(pDstPtr, Material.Sheen.get(), "Sheen Attribs");
+        pDstPtr = WriteShaderAttribs<HLSL::PBRMaterialSheenAttribs>(pDstPtr, Material.Sheen.get(), "Sheen Attribs", AllowMissingAttribs);
     }
 
-    if (AttribsData.PSOFlags & PSO_FLAG_ENABLE_ANISOTROPY)
+    if (PSOFlags & PSO_FLAG_ENABLE_ANISOTROPY)
     {
-        pDstPtr = WriteShaderAttribs<HLSL::PBRMaterialAnisotropyAttribs>(pDstPtr, Material.Anisotropy.get(), "Anisotropy Attribs");
+        pDstPtr = WriteShaderAttribs<HLSL::PBRMaterialAnisotropyAttribs>(pDstPtr, Material.Anisotropy.get(), "Anisotropy Attribs", AllowMissingAttribs);
     }
 
-    if (AttribsData.PSOFlags & PSO_FLAG_ENABLE_IRIDESCENCE)
+    if (PSOFlags & PSO_FLAG_ENABLE_IRIDESCENCE)
     {
-        pDstPtr = WriteShaderAttribs<HLSL::PBRMaterialIridescenceAttribs>(pDstPtr, Material.Iridescence.get(), "Iridescence Attribs");
+        pDstPtr = WriteShaderAttribs<HLSL::PBRMaterialIridescenceAttribs>(pDstPtr, Material.Iridescence.get(), "Iridescence Attribs", AllowMissingAttribs);
     }
 
-    if (AttribsData.PSOFlags & PSO_FLAG_ENABLE_TRANSMISSION)
+    if (PSOFlags & PSO_FLAG_ENABLE_TRANSMISSION)
     {
-        pDstPtr = WriteShaderAttribs<HLSL::PBRMaterialTransmissionAttribs>(pDstPtr, Material.Transmission.get(), "Transmission Attribs");
+        pDstPtr = WriteShaderAttribs<HLSL::PBRMaterialTransmissionAttribs>(pDstPtr, Material.Transmission.get(), "Transmission Attribs", AllowMissingAttribs);
     }
 
-    if (AttribsData.PSOFlags & PSO_FLAG_ENABLE_VOLUME)
+    if (PSOFlags & PSO_FLAG_ENABLE_VOLUME)
     {
-        pDstPtr = WriteShaderAttribs<HLSL::PBRMaterialVolumeAttribs>(pDstPtr, Material.Volume.get(), "Volume Attribs");
+        pDstPtr = WriteShaderAttribs<HLSL::PBRMaterialVolumeAttribs>(pDstPtr, Material.Volume.get(), "Volume Attribs", AllowMissingAttribs);
     }
 
     {
@@ -789,7 +2123,7 @@ void* GLTF_PBR_Renderer::WritePBRPrimitiveShaderAttribs(void*
         static_assert(sizeof(HLSL::PBRMaterialTextureAttribs) % 16 == 0, "Size of HLSL::PBRMaterialTextureAttribs must be a multiple of 16");
 
         Uint32 NumTextureAttribs = 0;
-        ProcessTexturAttribs(AttribsData.PSOFlags, [&](int CurrIndex, PBR_Renderer::TEXTURE_ATTRIB_ID AttribId) //
+        ProcessTexturAttribs(PSOFlags, [&](int CurrIndex, PBR_Renderer::TEXTURE_ATTRIB_ID AttribId) //
                              {
                                  const int SrcAttribIndex = TextureAttribIndices[AttribId];
                                  if (SrcAttribIndex < 0)
@@ -801,22 +2135,60 @@ void* GLTF_PBR_Renderer::WritePBRPrimitiveShaderAttribs(void*
                                  static_assert(sizeof(HLSL::PBRMaterialTextureAttribs) == sizeof(GLTF::Material::TextureShaderAttribs),
                                                "The sizeof(HLSL::PBRMaterialTextureAttribs) is inconsistent with sizeof(GLTF::Material::TextureShaderAttribs)");
                                  memcpy(pDstTextures + CurrIndex, &Material.GetTextureAttrib(SrcAttribIndex), sizeof(HLSL::PBRMaterialTextureAttribs));
+                                 if (MaterialTextureIds != nullptr)
+                                     pDstTextures[CurrIndex].TextureSlice = MaterialTextureIds[AttribId];
                                  ++NumTextureAttribs;
                              });
 
         pDstPtr = reinterpret_cast<Uint8*>(pDstTextures + NumTextureAttribs);
     }
 
+    return pDstPtr;
+}
+
+void GLTF_PBR_Renderer::UpdateMaterialBuffer(IDeviceContext*        pCtx,
+                                             const GLTF::Model&     GLTFModel,
+                                             ModelResourceBindings& Bindings)
+{
+    if (!Bindings.MaterialRange)
+        return;
+
+    const Uint32 NumMaterials = static_cast<Uint32>(GLTFModel.Materials.size());
+    VERIFY_EXPR(Bindings.MaterialRange->NumMaterials == NumMaterials && Bindings.DirtyMaterials.size() == NumMaterials);
+
+    const PSO_FLAGS LayoutFlags  = GetMaterialBufferLayoutFlags();
+    const Uint32    MaterialSize = GetPBRMaterialAttribsSize(LayoutFlags);
+
+    // Upload every run of consecutive dirty materials with a single update
+    for (Uint32 mat = 0; mat < NumMaterials;)
     {
-        if (AttribsData.CustomData != nullptr)
+        if (!Bindings.DirtyMaterials[mat])
         {
-            VERIFY_EXPR(AttribsData.CustomDataSize > 0);
-            memcpy(pDstPtr, AttribsData.CustomData, AttribsData.CustomDataSize);
+            ++mat;
+            continue;
         }
-        pDstPtr += AttribsData.CustomDataSize;
-    }
 
-    return pDstPtr;
+        const Uint32 FirstMat = mat;
+        while (mat < NumMaterials && Bindings.DirtyMaterials[mat])
+            ++mat;
+
+        m_MaterialBufferData.resize(size_t{mat - FirstMat} * MaterialSize);
+        for (Uint32 i = FirstMat; i < mat; ++i)
+        {
+            const float* MaterialTextureIds = !Bindings.MaterialTextureIds.empty() ?
+                &Bindings.MaterialTextureIds[i * TEXTURE_ATTRIB_ID_COUNT] :
+                nullptr;
+
+            Uint8* pDst = &m_MaterialBufferData[size_t{i - FirstMat} * MaterialSize];
+            Uint8* pEnd = static_cast<Uint8*>(WritePBRMaterialShaderAttribs(pDst, LayoutFlags, m_Settings.TextureAttribIndices, GLTFModel.Materials[i], MaterialTextureIds, nullptr, true));
+            VERIFY(pEnd - pDst == MaterialSize, "The size of the written material attributes is inconsistent with GetPBRMaterialAttribsSize()");
+            (void)pEnd;
+
+            Bindings.DirtyMaterials[i] = false;
+        }
+
+        UpdateMaterials(pCtx, Bindings.MaterialRange->FirstMaterialId + FirstMat, mat - FirstMat, m_MaterialBufferData.data());
+    }
 }
 
 } // namespace Diligent
@@ -28,6 +28,10 @@
 
 #include <array>
 #include <vector>
+#include <cstring>
+#include <algorithm>
+#include <cmath>
+#include <cfloat>
 
 #include "RenderStateCache.hpp"
 #include "GraphicsUtilities.h"
@@ -39,6 +43,11 @@
 #include "TextureUtilities.h"
 #include "Utilities/interface/DiligentFXShaderSourceStreamFactory.hpp"
 #include "ShaderSourceFactoryUtils.hpp"
+#include "FileWrapper.hpp"
+#include "ThreadPool.hpp"
+#include "Timer.hpp"
+#include "VariableSizeAllocationsManager.hpp"
+#include "DefaultRawMemoryAllocator.hpp"
 
 namespace Diligent
 {
@@ -67,7 +76,7 @@ PBR_Renderer::PSOKey::PSOKey(PSO_FLAGS     _Flags,
     {
         AlphaMode = ALPHA_MODE_OPAQUE;
 
-        constexpr auto SupportedUnshadedFlags = PSO_FLAG_USE_JOINTS | PSO_FLAG_ALL_USER_DEFINED | PSO_FLAG_UNSHADED;
+        constexpr auto SupportedUnshadedFlags = PSO_FLAG_USE_JOINTS | PSO_FLAG_USE_INSTANCE_TRANSFORMS | PSO_FLAG_ALL_USER_DEFINED | PSO_FLAG_UNSHADED;
         Flags &= SupportedUnshadedFlags;
 
         DebugView = DebugViewType::None;
@@ -134,6 +143,16 @@ PBR_Renderer::PBR_Renderer(IRenderDevice*     pDevice,
     m_PBRPrimitiveAttribsCB{CI.pPrimitiveAttribsCB},
     m_JointsBuffer{CI.pJointsBuffer}
 {
+    if (m_Settings.UseIrradianceSH && !m_Device.GetDeviceInfo().Features.ComputeShaders)
+    {
+        LOG_WARNING_MESSAGE("Irradiance spherical harmonics require compute shaders that are not supported by this device. Irradiance cube map will be used.");
+        m_Settings.UseIrradianceSH = false;
+    }
+    if (!m_Settings.EnableIBL)
+    {
+        m_Settings.UseIrradianceSH = false;
+    }
+
     if (m_Settings.EnableIBL)
     {
         PrecomputeBRDF(pCtx, m_Settings.NumBRDFSamples);
@@ -149,13 +168,49 @@ PBR_Renderer::PBR_Renderer(IRenderDevice*     pDevice,
         TexDesc.ArraySize = 6;
         TexDesc.MipLevels = 0;
 
-        auto IrradainceCubeTex = m_Device.CreateTexture(TexDesc);
-        m_pIrradianceCubeSRV   = IrradainceCubeTex->GetDefaultView(TEXTURE_VIEW_SHADER_RESOURCE);
+        if (m_Settings.UseIrradianceSH)
+        {
+            BufferDesc BuffDesc;
+            BuffDesc.Name              = "Irradiance SH buffer for PBR renderer";
+            BuffDesc.Size              = sizeof(HLSL::PBRIrradianceSHAttribs);
+            BuffDesc.Usage             = USAGE_DEFAULT;
+            BuffDesc.BindFlags         = BIND_UNORDERED_ACCESS;
+            BuffDesc.Mode              = BUFFER_MODE_STRUCTURED;
+            BuffDesc.ElementByteStride = sizeof(float4);
+            m_IrradianceSHBuffer       = m_Device.CreateBuffer(BuffDesc);
+
+            // Irradiance is black until the coefficients are computed
+            const HLSL::PBRIrradianceSHAttribs ZeroSH{};
+            BufferData                         InitData{&ZeroSH, sizeof(ZeroSH)};
+
+            BuffDesc.Name              = "Irradiance SH constant buffer for PBR renderer";
+            BuffDesc.BindFlags         = BIND_UNIFORM_BUFFER;
+            BuffDesc.Mode              = BUFFER_MODE_UNDEFINED;
+            BuffDesc.ElementByteStride = 0;
+            m_IrradianceSHCB           = m_Device.CreateBuffer(BuffDesc, &InitData);
+
+            StateTransitionDesc Barriers[] =
+                {
+                    {m_IrradianceSHBuffer, RESOURCE_STATE_UNKNOWN, RESOURCE_STATE_UNORDERED_ACCESS, STATE_TRANSITION_FLAG_UPDATE_STATE},
+                    {m_IrradianceSHCB, RESOURCE_STATE_UNKNOWN, RESOURCE_STATE_CONSTANT_BUFFER, STATE_TRANSITION_FLAG_UPDATE_STATE},
+                };
+            pCtx->TransitionResourceStates(_countof(Barriers), Barriers);
+        }
+        else
+        {
+            auto IrradainceCubeTex = m_Device.CreateTexture(TexDesc);
+            m_pIrradianceCubeSRV   = IrradainceCubeTex->GetDefaultView(TEXTURE_VIEW_SHADER_RESOURCE);
+        }
 
         TexDesc.Name   = "Prefiltered environment map for PBR renderer";
         TexDesc.Width  = PrefilteredEnvMapDim;
         TexDesc.Height = PrefilteredEnvMapDim;
         TexDesc.Format = PrefilteredEnvMapFmt;
+        if (m_Device.GetDeviceInfo().Features.ComputeShaders)
+        {
+            // All faces of one mip level are prefiltered by a single compute dispatch
+            TexDesc.BindFlags |= BIND_UNORDERED_ACCESS;
+        }
 
         auto PrefilteredEnvMapTex = m_Device.CreateTexture(TexDesc);
         m_pPrefilteredEnvMapSRV   = PrefilteredEnvMapTex->GetDefaultView(TEXTURE_VIEW_SHADER_RESOURCE);
@@ -265,35 +320,241 @@ PBR_Renderer::PBR_Renderer(IRenderDevice*     pDevice,
         }
     }
 
+    if (m_Settings.JointsBufferMode == CreateInfo::JOINTS_BUFFER_MODE_STRUCTURED && !m_Device.GetDeviceInfo().Features.ComputeShaders)
+    {
+        LOG_WARNING_MESSAGE("Structured joint palette requires structured buffer support that is not available on this device. Uniform joints buffer will be used.");
+        m_Settings.JointsBufferMode = CreateInfo::JOINTS_BUFFER_MODE_UNIFORM;
+        // Current and previous transforms must fit into the 64 KB constant buffer range
+        m_Settings.MaxJointCount = std::min(m_Settings.MaxJointCount, static_cast<Uint32>(65536 / (sizeof(float4x4) * 2)));
+    }
+    if (m_Settings.JointsBufferMode != CreateInfo::JOINTS_BUFFER_MODE_STRUCTURED)
+    {
+        m_Settings.PackJointMatrices = false;
+    }
+
+    if (m_Settings.MaxInstanceCount > 0 && !m_Device.GetDeviceInfo().Features.ComputeShaders)
+    {
+        LOG_WARNING_MESSAGE("Instance transforms require structured buffer support that is not available on this device. Instancing will be disabled.");
+        m_Settings.MaxInstanceCount = 0;
+    }
+    if (m_Settings.MaxInstanceCount > 0 && m_Settings.PrimitiveArraySize > 0)
+    {
+        LOG_WARNING_MESSAGE("Instance transforms can't be used with primitive arrays as the instance location selects the primitive. Instancing will be disabled.");
+        m_Settings.MaxInstanceCount = 0;
+    }
+
+    if (m_Settings.MaxMaterialCount > 0 && !m_Device.GetDeviceInfo().Features.ComputeShaders)
+    {
+        LOG_WARNING_MESSAGE("Material buffer requires structured buffer support that is not available on this device. Material attributes will be written to the primitive attributes.");
+        m_Settings.MaxMaterialCount = 0;
+    }
+    if (m_Settings.MaxMaterialCount > 0)
+    {
+        // Primitive attributes size depends on the material buffer layout, so it must be defined first
+        m_MaterialBufferLayoutFlags = ComputeMaterialBufferLayoutFlags();
+    }
+
+    if (m_Settings.MaxLightCount > 0 && !m_Device.GetDeviceInfo().Features.ComputeShaders)
+    {
+        LOG_WARNING_MESSAGE("Clustered lighting requires compute shaders that are not supported by this device. Clustered lighting will be disabled.");
+        m_Settings.MaxLightCount = 0;
+    }
+    if (m_Settings.MaxLightCount > 0)
+    {
+        for (Uint32& GridSize : m_Settings.LightClusterGridSize)
+            GridSize = std::max(GridSize, 1u);
+        m_Settings.MaxLightsPerCluster = std::max(m_Settings.MaxLightsPerCluster, 1u);
+    }
+
+    if (m_Settings.PrimitiveArraySize > 0)
+    {
+        // The entire array must fit into the 64 KB constant buffer range
+        const Uint32 MaxPrimitiveArraySize = 65536 / GetPBRPrimitiveAttribsSize(PSO_FLAG_ALL);
+        if (m_Settings.PrimitiveArraySize > MaxPrimitiveArraySize)
+        {
+            LOG_WARNING_MESSAGE("Primitive array size (", m_Settings.PrimitiveArraySize, ") exceeds the maximum size (", MaxPrimitiveArraySize,
+                                ") that fits into the constant buffer range. The size will be clamped.");
+            m_Settings.PrimitiveArraySize = MaxPrimitiveArraySize;
+        }
+
+        for (Uint32 i = 0; i < m_InputLayout.GetNumElements(); ++i)
+        {
+            DEV_CHECK_ERR(m_InputLayout[i].InputIndex != PrimitiveIdAttribIndex, "Input index ", PrimitiveIdAttribIndex, " is reserved for the primitive ID attribute");
+            m_PrimitiveIdBufferSlot = std::max(m_PrimitiveIdBufferSlot, m_InputLayout[i].BufferSlot + 1);
+        }
+
+        std::vector<Uint32> PrimitiveIds(m_Settings.PrimitiveArraySize);
+        for (Uint32 i = 0; i < PrimitiveIds.size(); ++i)
+            PrimitiveIds[i] = i;
+
+        BufferDesc Desc;
+        Desc.Name      = "PBR primitive ID buffer";
+        Desc.Size      = sizeof(Uint32) * PrimitiveIds.size();
+        Desc.BindFlags = BIND_VERTEX_BUFFER;
+        Desc.Usage     = USAGE_IMMUTABLE;
+
+        BufferData InitData{PrimitiveIds.data(), Desc.Size};
+        pDevice->CreateBuffer(Desc, &InitData, &m_PrimitiveIdBuffer);
+        VERIFY_EXPR(m_PrimitiveIdBuffer);
+    }
+
+    for (Uint32 i = 0; i < m_InputLayout.GetNumElements(); ++i)
+    {
+        DEV_CHECK_ERR(m_InputLayout[i].InputIndex != PrevPositionAttribIndex, "Input index ", PrevPositionAttribIndex, " is reserved for the previous vertex position attribute");
+        m_PrevPositionBufferSlot = std::max(m_PrevPositionBufferSlot, m_InputLayout[i].BufferSlot + 1);
+    }
+    if (m_Settings.PrimitiveArraySize > 0)
+    {
+        m_PrevPositionBufferSlot = std::max(m_PrevPositionBufferSlot, m_PrimitiveIdBufferSlot + 1);
+    }
+
     {
         if (!m_PBRPrimitiveAttribsCB)
         {
-            CreateUniformBuffer(pDevice, GetPBRPrimitiveAttribsSize(PSO_FLAG_ALL), "PBR primitive attribs CB", &m_PBRPrimitiveAttribsCB);
+            CreateUniformBuffer(pDevice, GetPBRPrimitiveAttribsSize(PSO_FLAG_ALL) * std::max(m_Settings.PrimitiveArraySize, 1u), "PBR primitive attribs CB", &m_PBRPrimitiveAttribsCB);
         }
         if (m_Settings.MaxJointCount > 0)
         {
-            const size_t JointsBufferSize = sizeof(float4x4) * m_Settings.MaxJointCount * 2; // Current and previous transforms
+            const size_t JointsBufferSize = size_t{GetJointMatrixSize()} * m_Settings.MaxJointCount * 2; // Current and previous transforms
             if (!m_JointsBuffer)
             {
-                CreateUniformBuffer(pDevice, static_cast<Uint32>(JointsBufferSize), "PBR joint transforms", &m_JointsBuffer);
+                if (m_Settings.JointsBufferMode == CreateInfo::JOINTS_BUFFER_MODE_STRUCTURED)
+                {
+                    BufferDesc Desc;
+                    Desc.Name              = "PBR joint palette";
+                    Desc.Size              = JointsBufferSize;
+                    Desc.BindFlags         = BIND_SHADER_RESOURCE;
+                    Desc.Usage             = USAGE_DEFAULT;
+                    Desc.Mode              = BUFFER_MODE_STRUCTURED;
+                    Desc.ElementByteStride = m_Settings.PackJointMatrices ? sizeof(float4) : sizeof(float4x4);
+                    pDevice->CreateBuffer(Desc, nullptr, &m_JointsBuffer);
+                    VERIFY_EXPR(m_JointsBuffer);
+                }
+                else
+                {
+                    CreateUniformBuffer(pDevice, static_cast<Uint32>(JointsBufferSize), "PBR joint transforms", &m_JointsBuffer);
+                }
             }
             else
             {
                 DEV_CHECK_ERR(m_JointsBuffer->GetDesc().Size >= JointsBufferSize, "PBR joint transforms buffer is too small to hold ", m_Settings.MaxJointCount, " joints.");
+                DEV_CHECK_ERR((m_JointsBuffer->GetDesc().Mode == BUFFER_MODE_STRUCTURED) == (m_Settings.JointsBufferMode == CreateInfo::JOINTS_BUFFER_MODE_STRUCTURED),
+                              "Joint palette must be a structured buffer, and uniform joints buffer must not be");
             }
         }
+        if (m_Settings.MaxInstanceCount > 0)
+        {
+            BufferDesc Desc;
+            Desc.Name              = "PBR instance transforms";
+            Desc.Size              = sizeof(float4x4) * m_Settings.MaxInstanceCount * 2; // Current and previous transforms
+            Desc.BindFlags         = BIND_SHADER_RESOURCE;
+            Desc.Usage             = USAGE_DEFAULT;
+            Desc.Mode              = BUFFER_MODE_STRUCTURED;
+            Desc.ElementByteStride = sizeof(float4x4);
+            pDevice->CreateBuffer(Desc, nullptr, &m_InstanceTransformsBuffer);
+            VERIFY_EXPR(m_InstanceTransformsBuffer);
+        }
+        if (m_Settings.MaxMaterialCount > 0)
+        {
+            BufferDesc Desc;
+            Desc.Name              = "PBR materials buffer";
+            Desc.ElementByteStride = GetPBRMaterialAttribsSize(m_MaterialBufferLayoutFlags);
+            Desc.Size              = Uint64{Desc.ElementByteStride} * m_Settings.MaxMaterialCount;
+            Desc.BindFlags         = BIND_SHADER_RESOURCE;
+            Desc.Usage             = USAGE_DEFAULT;
+            Desc.Mode              = BUFFER_MODE_STRUCTURED;
+            pDevice->CreateBuffer(Desc, nullptr, &m_MaterialsBuffer);
+            VERIFY_EXPR(m_MaterialsBuffer);
+
+            m_MaterialAllocator = std::make_shared<MaterialAllocator>(m_Settings.MaxMaterialCount);
+        }
+        if (m_Settings.MaxLightCount > 0)
+        {
+            BufferDesc Desc;
+            Desc.Name              = "PBR punctual lights buffer";
+            Desc.ElementByteStride = sizeof(HLSL::PBRPunctualLightAttribs);
+            Desc.Size              = Uint64{Desc.ElementByteStride} * m_Settings.MaxLightCount;
+            Desc.BindFlags         = BIND_SHADER_RESOURCE;
+            Desc.Usage             = USAGE_DEFAULT;
+            Desc.Mode              = BUFFER_MODE_STRUCTURED;
+            pDevice->CreateBuffer(Desc, nullptr, &m_PunctualLightsBuffer);
+            VERIFY_EXPR(m_PunctualLightsBuffer);
+
+            const std::array<Uint32, 3>& GridSize = m_Settings.LightClusterGridSize;
+
+            // Light count followed by the light indices for every cluster
+            Desc.Name              = "PBR light clusters buffer";
+            Desc.ElementByteStride = sizeof(Uint32);
+            Desc.Size              = Uint64{GridSize[0]} * GridSize[1] * GridSize[2] * (m_Settings.MaxLightsPerCluster + 1) * sizeof(Uint32);
+            Desc.BindFlags         = BIND_SHADER_RESOURCE | BIND_UNORDERED_ACCESS;
+            pDevice->CreateBuffer(Desc, nullptr, &m_LightClustersBuffer);
+            VERIFY_EXPR(m_LightClustersBuffer);
+        }
         std::vector<StateTransitionDesc> Barriers;
         Barriers.emplace_back(m_PBRPrimitiveAttribsCB, RESOURCE_STATE_UNKNOWN, RESOURCE_STATE_CONSTANT_BUFFER, STATE_TRANSITION_FLAG_UPDATE_STATE);
         if (m_JointsBuffer)
-            Barriers.emplace_back(m_JointsBuffer, RESOURCE_STATE_UNKNOWN, RESOURCE_STATE_CONSTANT_BUFFER, STATE_TRANSITION_FLAG_UPDATE_STATE);
+        {
+            const RESOURCE_STATE JointsBufferState = m_Settings.JointsBufferMode == CreateInfo::JOINTS_BUFFER_MODE_STRUCTURED ?
+                RESOURCE_STATE_SHADER_RESOURCE :
+                RESOURCE_STATE_CONSTANT_BUFFER;
+            Barriers.emplace_back(m_JointsBuffer, RESOURCE_STATE_UNKNOWN, JointsBufferState, STATE_TRANSITION_FLAG_UPDATE_STATE);
+        }
+        if (m_InstanceTransformsBuffer)
+            Barriers.emplace_back(m_InstanceTransformsBuffer, RESOURCE_STATE_UNKNOWN, RESOURCE_STATE_SHADER_RESOURCE, STATE_TRANSITION_FLAG_UPDATE_STATE);
+        if (m_MaterialsBuffer)
+            Barriers.emplace_back(m_MaterialsBuffer, RESOURCE_STATE_UNKNOWN, RESOURCE_STATE_SHADER_RESOURCE, STATE_TRANSITION_FLAG_UPDATE_STATE);
+        if (m_PunctualLightsBuffer)
+            Barriers.emplace_back(m_PunctualLightsBuffer, RESOURCE_STATE_UNKNOWN, RESOURCE_STATE_SHADER_RESOURCE, STATE_TRANSITION_FLAG_UPDATE_STATE);
+        if (m_LightClustersBuffer)
+            Barriers.emplace_back(m_LightClustersBuffer, RESOURCE_STATE_UNKNOWN, RESOURCE_STATE_SHADER_RESOURCE, STATE_TRANSITION_FLAG_UPDATE_STATE);
+        if (m_PrimitiveIdBuffer)
+            Barriers.emplace_back(m_PrimitiveIdBuffer, RESOURCE_STATE_UNKNOWN, RESOURCE_STATE_VERTEX_BUFFER, STATE_TRANSITION_FLAG_UPDATE_STATE);
         pCtx->TransitionResourceStates(static_cast<Uint32>(Barriers.size()), Barriers.data());
     }
 
+    if (m_Settings.MaxLightCount > 0)
+    {
+        ShaderCreateInfo ShaderCI;
+        ShaderCI.SourceLanguage             = SHADER_SOURCE_LANGUAGE_HLSL;
+        ShaderCI.pShaderSourceStreamFactory = &DiligentFXShaderSourceStreamFactory::GetInstance();
+        ShaderCI.Desc                       = {"Bin lights CS", SHADER_TYPE_COMPUTE, true};
+        ShaderCI.EntryPoint                 = "main";
+        ShaderCI.FilePath                   = "BinLights.csh";
+
+        RefCntAutoPtr<IShader> pCS = m_Device.CreateShader(ShaderCI);
+
+        PipelineResourceLayoutDescX ResourceLayout;
+        ResourceLayout
+            .SetDefaultVariableType(SHADER_RESOURCE_VARIABLE_TYPE_STATIC)
+            .AddVariable(SHADER_TYPE_COMPUTE, "cbFrameAttribs", SHADER_RESOURCE_VARIABLE_TYPE_DYNAMIC);
+
+        ComputePipelineStateCreateInfo PsoCI;
+        PsoCI.PSODesc.Name           = "Bin lights PSO";
+        PsoCI.PSODesc.PipelineType   = PIPELINE_TYPE_COMPUTE;
+        PsoCI.PSODesc.ResourceLayout = ResourceLayout;
+        PsoCI.pCS                    = pCS;
+
+        m_BinLightsPSO = m_Device.CreateComputePipelineState(PsoCI);
+        if (m_BinLightsPSO)
+        {
+            m_BinLightsPSO->GetStaticVariableByName(SHADER_TYPE_COMPUTE, "g_PunctualLights")->Set(m_PunctualLightsBuffer->GetDefaultView(BUFFER_VIEW_SHADER_RESOURCE));
+            m_BinLightsPSO->GetStaticVariableByName(SHADER_TYPE_COMPUTE, "g_LightClusters")->Set(m_LightClustersBuffer->GetDefaultView(BUFFER_VIEW_UNORDERED_ACCESS));
+            m_BinLightsPSO->CreateShaderResourceBinding(&m_BinLightsSRB, true);
+        }
+        else
+        {
+            LOG_ERROR_MESSAGE("Failed to create light binning PSO");
+        }
+    }
+
     CreateSignature();
 }
 
 PBR_Renderer::~PBR_Renderer()
 {
+    // Asynchronous PSO creation tasks access the renderer
+    for (IAsyncTask* pTask : m_AsyncPSOTasks)
+        pTask->WaitForCompletion();
 }
 
 void PBR_Renderer::PrecomputeBRDF(IDeviceContext* pCtx,
@@ -374,6 +635,57 @@ void PBR_Renderer::PrecomputeBRDF(IDeviceContext* pCtx,
     pCtx->TransitionResourceStates(_countof(Barriers), Barriers);
 }
 
+void PBR_Renderer::ComputeIrradianceSH(IDeviceContext* pCtx, ITextureView* pEnvironmentMap)
+{
+    if (!m_Settings.UseIrradianceSH)
+    {
+        LOG_WARNING_MESSAGE("Irradiance spherical harmonics are disabled");
+        return;
+    }
+
+    if (!m_pComputeIrradianceSHPSO)
+    {
+        ShaderCreateInfo ShaderCI;
+        ShaderCI.SourceLanguage             = SHADER_SOURCE_LANGUAGE_HLSL;
+        ShaderCI.pShaderSourceStreamFactory = &DiligentFXShaderSourceStreamFactory::GetInstance();
+        ShaderCI.Desc                       = {"Compute irradiance SH CS", SHADER_TYPE_COMPUTE, true};
+        ShaderCI.EntryPoint                 = "main";
+        ShaderCI.FilePath                   = "ComputeIrradianceSH.csh";
+
+        RefCntAutoPtr<IShader> pCS = m_Device.CreateShader(ShaderCI);
+
+        PipelineResourceLayoutDescX ResourceLayout;
+        ResourceLayout
+            .SetDefaultVariableType(SHADER_RESOURCE_VARIABLE_TYPE_STATIC)
+            .AddVariable(SHADER_TYPE_COMPUTE, "g_EnvironmentMap", SHADER_RESOURCE_VARIABLE_TYPE_DYNAMIC)
+            .AddImmutableSampler(SHADER_TYPE_COMPUTE, "g_EnvironmentMap", Sam_LinearClamp);
+
+        ComputePipelineStateCreateInfo PSOCreateInfo;
+        PSOCreateInfo.PSODesc.Name           = "Compute irradiance SH PSO";
+        PSOCreateInfo.PSODesc.PipelineType   = PIPELINE_TYPE_COMPUTE;
+        PSOCreateInfo.PSODesc.ResourceLayout = ResourceLayout;
+        PSOCreateInfo.pCS                    = pCS;
+
+        m_pComputeIrradianceSHPSO = m_Device.CreateComputePipelineState(PSOCreateInfo);
+        m_pComputeIrradianceSHPSO->GetStaticVariableByName(SHADER_TYPE_COMPUTE, "g_SHCoeffs")->Set(m_IrradianceSHBuffer->GetDefaultView(BUFFER_VIEW_UNORDERED_ACCESS));
+        m_pComputeIrradianceSHPSO->CreateShaderResourceBinding(&m_pComputeIrradianceSHSRB, true);
+    }
+
+    pCtx->SetPipelineState(m_pComputeIrradianceSHPSO);
+    m_pComputeIrradianceSHSRB->GetVariableByName(SHADER_TYPE_COMPUTE, "g_EnvironmentMap")->Set(pEnvironmentMap);
+    pCtx->CommitShaderResources(m_pComputeIrradianceSHSRB, RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
+
+    // The whole environment map is reduced by a single thread group
+    DispatchComputeAttribs DispatchAttrs{1, 1, 1};
+    pCtx->DispatchCompute(DispatchAttrs);
+
+    pCtx->CopyBuffer(m_IrradianceSHBuffer, 0, RESOURCE_STATE_TRANSITION_MODE_TRANSITION,
+                     m_IrradianceSHCB, 0, sizeof(HLSL::PBRIrradianceSHAttribs), RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
+
+    StateTransitionDesc Barrier{m_IrradianceSHCB, RESOURCE_STATE_UNKNOWN, RESOURCE_STATE_CONSTANT_BUFFER, STATE_TRANSITION_FLAG_UPDATE_STATE};
+    pCtx->TransitionResourceStates(1, &Barrier);
+}
+
 void PBR_Renderer::PrecomputeCubemaps(IDeviceContext* pCtx,
                                       ITextureView*   pEnvironmentMap,
                                       Uint32          NumPhiSamples,
@@ -401,7 +713,7 @@ void PBR_Renderer::PrecomputeCubemaps(IDeviceContext* pCtx,
         CreateUniformBuffer(m_Device, sizeof(PrecomputeEnvMapAttribs), "Precompute env map attribs CB", &m_PrecomputeEnvMapAttribsCB);
     }
 
-    if (!m_pPrecomputeIrradianceCubePSO)
+    if (!m_Settings.UseIrradianceSH && !m_pPrecomputeIrradianceCubePSO)
     {
         ShaderCreateInfo ShaderCI;
         ShaderCI.SourceLanguage             = SHADER_SOURCE_LANGUAGE_HLSL;
@@ -458,7 +770,43 @@ void PBR_Renderer::PrecomputeCubemaps(IDeviceContext* pCtx,
         m_pPrecomputeIrradianceCubePSO->CreateShaderResourceBinding(&m_pPrecomputeIrradianceCubeSRB, true);
     }
 
-    if (!m_pPrefilterEnvMapPSO)
+    const bool UseComputePrefilter = m_Device.GetDeviceInfo().Features.ComputeShaders;
+    if (UseComputePrefilter && !m_pPrefilterEnvMapCSPSO)
+    {
+        ShaderCreateInfo ShaderCI;
+        ShaderCI.SourceLanguage             = SHADER_SOURCE_LANGUAGE_HLSL;
+        ShaderCI.pShaderSourceStreamFactory = &DiligentFXShaderSourceStreamFactory::GetInstance();
+
+        ShaderMacroHelper Macros;
+        Macros.AddShaderMacro("OPTIMIZE_SAMPLES", OptimizeSamples ? 1 : 0);
+        Macros.AddShaderMacro("THREAD_GROUP_SIZE", static_cast<int>(PrefilterEnvMapThreadGroupSize));
+        ShaderCI.Macros = Macros;
+
+        ShaderCI.Desc       = {"Prefilter environment map CS", SHADER_TYPE_COMPUTE, true};
+        ShaderCI.EntryPoint = "main";
+        ShaderCI.FilePath   = "PrefilterEnvMap.csh";
+
+        RefCntAutoPtr<IShader> pCS = m_Device.CreateShader(ShaderCI);
+
+        PipelineResourceLayoutDescX ResourceLayout;
+        ResourceLayout
+            .SetDefaultVariableType(SHADER_RESOURCE_VARIABLE_TYPE_STATIC)
+            .AddVariable(SHADER_TYPE_COMPUTE, "g_EnvironmentMap", SHADER_RESOURCE_VARIABLE_TYPE_DYNAMIC)
+            .AddVariable(SHADER_TYPE_COMPUTE, "g_PrefilteredEnvMap", SHADER_RESOURCE_VARIABLE_TYPE_DYNAMIC)
+            .AddImmutableSampler(SHADER_TYPE_COMPUTE, "g_EnvironmentMap", Sam_LinearClamp);
+
+        ComputePipelineStateCreateInfo PSOCreateInfo;
+        PSOCreateInfo.PSODesc.Name           = "Prefilter environment map compute PSO";
+        PSOCreateInfo.PSODesc.PipelineType   = PIPELINE_TYPE_COMPUTE;
+        PSOCreateInfo.PSODesc.ResourceLayout = ResourceLayout;
+        PSOCreateInfo.pCS                    = pCS;
+
+        m_pPrefilterEnvMapCSPSO = m_Device.CreateComputePipelineState(PSOCreateInfo);
+        m_pPrefilterEnvMapCSPSO->GetStaticVariableByName(SHADER_TYPE_COMPUTE, "FilterAttribs")->Set(m_PrecomputeEnvMapAttribsCB);
+        m_pPrefilterEnvMapCSPSO->CreateShaderResourceBinding(&m_pPrefilterEnvMapCSSRB, true);
+    }
+
+    if (!UseComputePrefilter && !m_pPrefilterEnvMapPSO)
     {
         ShaderCreateInfo ShaderCI;
         ShaderCI.SourceLanguage             = SHADER_SOURCE_LANGUAGE_HLSL;
@@ -529,177 +877,580 @@ void PBR_Renderer::PrecomputeCubemaps(IDeviceContext* pCtx,
     };
     // clang-format on
 
-    pCtx->SetPipelineState(m_pPrecomputeIrradianceCubePSO);
-    m_pPrecomputeIrradianceCubeSRB->GetVariableByName(SHADER_TYPE_PIXEL, "g_EnvironmentMap")->Set(pEnvironmentMap);
-    pCtx->CommitShaderResources(m_pPrecomputeIrradianceCubeSRB, RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
-    auto*       pIrradianceCube    = m_pIrradianceCubeSRV->GetTexture();
-    const auto& IrradianceCubeDesc = pIrradianceCube->GetDesc();
-    for (Uint32 mip = 0; mip < IrradianceCubeDesc.MipLevels; ++mip)
-    {
-        for (Uint32 face = 0; face < 6; ++face)
-        {
-            TextureViewDesc RTVDesc{"RTV for irradiance cube texture", TEXTURE_VIEW_RENDER_TARGET, RESOURCE_DIM_TEX_2D_ARRAY};
-            RTVDesc.MostDetailedMip = mip;
-            RTVDesc.FirstArraySlice = face;
-            RTVDesc.NumArraySlices  = 1;
-            RefCntAutoPtr<ITextureView> pRTV;
-            pIrradianceCube->CreateView(RTVDesc, &pRTV);
-            ITextureView* ppRTVs[] = {pRTV};
-            pCtx->SetRenderTargets(_countof(ppRTVs), ppRTVs, nullptr, RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
+    if (m_Settings.UseIrradianceSH)
+    {
+        ComputeIrradianceSH(pCtx, pEnvironmentMap);
+    }
+    else
+    {
+        pCtx->SetPipelineState(m_pPrecomputeIrradianceCubePSO);
+        m_pPrecomputeIrradianceCubeSRB->GetVariableByName(SHADER_TYPE_PIXEL, "g_EnvironmentMap")->Set(pEnvironmentMap);
+        pCtx->CommitShaderResources(m_pPrecomputeIrradianceCubeSRB, RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
+        auto*       pIrradianceCube    = m_pIrradianceCubeSRV->GetTexture();
+        const auto& IrradianceCubeDesc = pIrradianceCube->GetDesc();
+        for (Uint32 mip = 0; mip < IrradianceCubeDesc.MipLevels; ++mip)
+        {
+            for (Uint32 face = 0; face < 6; ++face)
             {
-                MapHelper<PrecomputeEnvMapAttribs> Attribs{pCtx, m_PrecomputeEnvMapAttribsCB, MAP_WRITE, MAP_FLAG_DISCARD};
-                Attribs->Rotation = Matrices[face];
+                TextureViewDesc RTVDesc{"RTV for irradiance cube texture", TEXTURE_VIEW_RENDER_TARGET, RESOURCE_DIM_TEX_2D_ARRAY};
+                RTVDesc.MostDetailedMip = mip;
+                RTVDesc.FirstArraySlice = face;
+                RTVDesc.NumArraySlices  = 1;
+                RefCntAutoPtr<ITextureView> pRTV;
+                pIrradianceCube->CreateView(RTVDesc, &pRTV);
+                ITextureView* ppRTVs[] = {pRTV};
+                pCtx->SetRenderTargets(_countof(ppRTVs), ppRTVs, nullptr, RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
+                {
+                    MapHelper<PrecomputeEnvMapAttribs> Attribs{pCtx, m_PrecomputeEnvMapAttribsCB, MAP_WRITE, MAP_FLAG_DISCARD};
+                    Attribs->Rotation = Matrices[face];
+                }
+                DrawAttribs drawAttrs(4, DRAW_FLAG_VERIFY_ALL);
+                pCtx->Draw(drawAttrs);
             }
-            DrawAttribs drawAttrs(4, DRAW_FLAG_VERIFY_ALL);
-            pCtx->Draw(drawAttrs);
         }
     }
 
-    pCtx->SetPipelineState(m_pPrefilterEnvMapPSO);
-    m_pPrefilterEnvMapSRB->GetVariableByName(SHADER_TYPE_PIXEL, "g_EnvironmentMap")->Set(pEnvironmentMap);
-    pCtx->CommitShaderResources(m_pPrefilterEnvMapSRB, RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
     auto*       pPrefilteredEnvMap    = m_pPrefilteredEnvMapSRV->GetTexture();
     const auto& PrefilteredEnvMapDesc = pPrefilteredEnvMap->GetDesc();
-    for (Uint32 mip = 0; mip < PrefilteredEnvMapDesc.MipLevels; ++mip)
+    if (UseComputePrefilter)
     {
-        for (Uint32 face = 0; face < 6; ++face)
+        pCtx->SetPipelineState(m_pPrefilterEnvMapCSPSO);
+        m_pPrefilterEnvMapCSSRB->GetVariableByName(SHADER_TYPE_COMPUTE, "g_EnvironmentMap")->Set(pEnvironmentMap);
+        IShaderResourceVariable* pDstVar = m_pPrefilterEnvMapCSSRB->GetVariableByName(SHADER_TYPE_COMPUTE, "g_PrefilteredEnvMap");
+        for (Uint32 mip = 0; mip < PrefilteredEnvMapDesc.MipLevels; ++mip)
         {
-            TextureViewDesc RTVDesc{"RTV for prefiltered env map cube texture", TEXTURE_VIEW_RENDER_TARGET, RESOURCE_DIM_TEX_2D_ARRAY};
-            RTVDesc.MostDetailedMip = mip;
-            RTVDesc.FirstArraySlice = face;
-            RTVDesc.NumArraySlices  = 1;
-            RefCntAutoPtr<ITextureView> pRTV;
-            pPrefilteredEnvMap->CreateView(RTVDesc, &pRTV);
-            ITextureView* ppRTVs[] = {pRTV};
-            pCtx->SetRenderTargets(_countof(ppRTVs), ppRTVs, nullptr, RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
+            TextureViewDesc UAVDesc{"UAV for prefiltered env map cube texture", TEXTURE_VIEW_UNORDERED_ACCESS, RESOURCE_DIM_TEX_2D_ARRAY};
+            UAVDesc.MostDetailedMip = mip;
+            UAVDesc.NumMipLevels    = 1;
+            UAVDesc.FirstArraySlice = 0;
+            UAVDesc.NumArraySlices  = 6;
+            RefCntAutoPtr<ITextureView> pUAV;
+            pPrefilteredEnvMap->CreateView(UAVDesc, &pUAV);
+            pDstVar->Set(pUAV, SET_SHADER_RESOURCE_FLAG_ALLOW_OVERWRITE);
 
             {
                 MapHelper<PrecomputeEnvMapAttribs> Attribs{pCtx, m_PrecomputeEnvMapAttribsCB, MAP_WRITE, MAP_FLAG_DISCARD};
-                Attribs->Rotation   = Matrices[face];
+                Attribs->Rotation   = float4x4::Identity();
                 Attribs->Roughness  = static_cast<float>(mip) / static_cast<float>(PrefilteredEnvMapDesc.MipLevels - 1);
                 Attribs->EnvMapDim  = static_cast<float>(PrefilteredEnvMapDesc.Width);
                 Attribs->NumSamples = 256;
             }
+            pCtx->CommitShaderResources(m_pPrefilterEnvMapCSSRB, RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
+
+            const Uint32           MipDim = std::max(PrefilteredEnvMapDesc.Width >> mip, 1u);
+            DispatchComputeAttribs DispatchAttrs{
+                (MipDim + PrefilterEnvMapThreadGroupSize - 1) / PrefilterEnvMapThreadGroupSize,
+                (MipDim + PrefilterEnvMapThreadGroupSize - 1) / PrefilterEnvMapThreadGroupSize,
+                6,
+            };
+            pCtx->DispatchCompute(DispatchAttrs);
+        }
+    }
+    else
+    {
+        pCtx->SetPipelineState(m_pPrefilterEnvMapPSO);
+        m_pPrefilterEnvMapSRB->GetVariableByName(SHADER_TYPE_PIXEL, "g_EnvironmentMap")->Set(pEnvironmentMap);
+        pCtx->CommitShaderResources(m_pPrefilterEnvMapSRB, RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
+        for (Uint32 mip = 0; mip < PrefilteredEnvMapDesc.MipLevels; ++mip)
+        {
+            for (Uint32 face = 0; face < 6; ++face)
+            {
+                TextureViewDesc RTVDesc{"RTV for prefiltered env map cube texture", TEXTURE_VIEW_RENDER_TARGET, RESOURCE_DIM_TEX_2D_ARRAY};
+                RTVDesc.MostDetailedMip = mip;
+                RTVDesc.FirstArraySlice = face;
+                RTVDesc.NumArraySlices  = 1;
+                RefCntAutoPtr<ITextureView> pRTV;
+                pPrefilteredEnvMap->CreateView(RTVDesc, &pRTV);
+                ITextureView* ppRTVs[] = {pRTV};
+                pCtx->SetRenderTargets(_countof(ppRTVs), ppRTVs, nullptr, RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
+
+                {
+                    MapHelper<PrecomputeEnvMapAttribs> Attribs{pCtx, m_PrecomputeEnvMapAttribsCB, MAP_WRITE, MAP_FLAG_DISCARD};
+                    Attribs->Rotation   = Matrices[face];
+                    Attribs->Roughness  = static_cast<float>(mip) / static_cast<float>(PrefilteredEnvMapDesc.MipLevels - 1);
+                    Attribs->EnvMapDim  = static_cast<float>(PrefilteredEnvMapDesc.Width);
+                    Attribs->NumSamples = 256;
+                }
 
-            DrawAttribs drawAttrs(4, DRAW_FLAG_VERIFY_ALL);
-            pCtx->Draw(drawAttrs);
+                DrawAttribs drawAttrs(4, DRAW_FLAG_VERIFY_ALL);
+                pCtx->Draw(drawAttrs);
+            }
         }
     }
 
-    // clang-format off
-    StateTransitionDesc Barriers[] = 
-    {
-        {m_pPrefilteredEnvMapSRV->GetTexture(), RESOURCE_STATE_UNKNOWN, RESOURCE_STATE_SHADER_RESOURCE, STATE_TRANSITION_FLAG_UPDATE_STATE},
-        {m_pIrradianceCubeSRV->GetTexture(),    RESOURCE_STATE_UNKNOWN, RESOURCE_STATE_SHADER_RESOURCE, STATE_TRANSITION_FLAG_UPDATE_STATE}
-    };
-    // clang-format on
-    pCtx->TransitionResourceStates(_countof(Barriers), Barriers);
+    StateTransitionDesc Barriers[] =
+        {
+            {m_pPrefilteredEnvMapSRV->GetTexture(), RESOURCE_STATE_UNKNOWN, RESOURCE_STATE_SHADER_RESOURCE, STATE_TRANSITION_FLAG_UPDATE_STATE},
+            {m_pIrradianceCubeSRV ? m_pIrradianceCubeSRV->GetTexture() : nullptr, RESOURCE_STATE_UNKNOWN, RESOURCE_STATE_SHADER_RESOURCE, STATE_TRANSITION_FLAG_UPDATE_STATE},
+        };
+    pCtx->TransitionResourceStates(m_pIrradianceCubeSRV ? 2 : 1, Barriers);
+
+    m_IBLSettingsHash = ComputeIBLSettingsHash(NumPhiSamples, NumThetaSamples, OptimizeSamples);
 
     // To avoid crashes on some low-end Android devices
     pCtx->Flush();
 }
 
+namespace
+{
 
-void PBR_Renderer::InitCommonSRBVars(IShaderResourceBinding* pSRB, IBuffer* pFrameAttribs) const
+constexpr Uint32 IBLCacheMagic   = 0x4C424949; // "IIBL"
+constexpr Uint32 IBLCacheVersion = 1;
+
+struct IBLCacheHeader
 {
-    if (pSRB == nullptr)
+    Uint32 Magic   = IBLCacheMagic;
+    Uint32 Version = IBLCacheVersion;
+    Uint64 Key     = 0;
+};
+
+Uint32 GetTexelSize(TEXTURE_FORMAT Fmt)
+{
+    const TextureFormatAttribs& FmtAttribs = GetTextureFormatAttribs(Fmt);
+    return Uint32{FmtAttribs.ComponentSize} * Uint32{FmtAttribs.NumComponents};
+}
+
+// Returns the size of all subresources of the texture packed without row padding
+size_t GetPackedTextureDataSize(const TextureDesc& Desc)
+{
+    const Uint32 TexelSize = GetTexelSize(Desc.Format);
+
+    size_t Size = 0;
+    for (Uint32 mip = 0; mip < Desc.MipLevels; ++mip)
+        Size += size_t{std::max(Desc.Width >> mip, 1u)} * std::max(Desc.Height >> mip, 1u) * TexelSize;
+    return Size * Desc.ArraySize;
+}
+
+} // namespace
+
+Uint64 PBR_Renderer::ComputeIBLSettingsHash(Uint32 NumPhiSamples, Uint32 NumThetaSamples, bool OptimizeSamples) const
+{
+    return ComputeHash(NumPhiSamples, NumThetaSamples, OptimizeSamples,
+                       m_Settings.NumBRDFSamples, m_Settings.UseIrradianceSH,
+                       BRDF_LUT_Dim, IrradianceCubeDim, PrefilteredEnvMapDim,
+                       static_cast<Uint32>(IrradianceCubeFmt), static_cast<Uint32>(PrefilteredEnvMapFmt));
+}
+
+bool PBR_Renderer::SaveIBLCache(IDeviceContext* pCtx, const char* FilePath, Uint64 EnvMapHash)
+{
+    if (!m_Settings.EnableIBL)
     {
-        UNEXPECTED("SRB must not be null");
-        return;
+        LOG_WARNING_MESSAGE("IBL is disabled, so there is nothing to save to the IBL cache");
+        return false;
     }
-
-    if (auto* pVar = pSRB->GetVariableByName(SHADER_TYPE_PIXEL, "cbPrimitiveAttribs"))
+    if (m_IBLSettingsHash == 0)
     {
-        if (pVar->Get() == nullptr)
-            pVar->Set(m_PBRPrimitiveAttribsCB);
+        LOG_WARNING_MESSAGE("IBL cube maps have not been precomputed. Call PrecomputeCubemaps() before saving the IBL cache.");
+        return false;
     }
 
-    if (m_Settings.MaxJointCount > 0)
+    ITexture* pTextures[] = {
+        m_pPreintegratedGGX_SRV->GetTexture(),
+        m_pIrradianceCubeSRV ? m_pIrradianceCubeSRV->GetTexture() : nullptr,
+        m_pPrefilteredEnvMapSRV->GetTexture(),
+    };
+
+    // Copy all textures to the staging textures first, so that the context is only idled once
+    RefCntAutoPtr<ITexture> pStagingTextures[_countof(pTextures)];
+    for (size_t i = 0; i < _countof(pTextures); ++i)
     {
-        if (auto* pVar = pSRB->GetVariableByName(SHADER_TYPE_VERTEX, "cbJointTransforms"))
+        ITexture* pTex = pTextures[i];
+        if (pTex == nullptr)
+            continue;
+
+        const TextureDesc& Desc = pTex->GetDesc();
+
+        TextureDesc StagingDesc    = Desc;
+        StagingDesc.Name           = "IBL cache staging texture";
+        StagingDesc.Type           = Desc.Type == RESOURCE_DIM_TEX_CUBE ? RESOURCE_DIM_TEX_2D_ARRAY : Desc.Type;
+        StagingDesc.Usage          = USAGE_STAGING;
+        StagingDesc.BindFlags      = BIND_NONE;
+        StagingDesc.CPUAccessFlags = CPU_ACCESS_READ;
+        StagingDesc.MiscFlags      = MISC_TEXTURE_FLAG_NONE;
+        pStagingTextures[i]        = m_Device.CreateTexture(StagingDesc);
+
+        for (Uint32 slice = 0; slice < Desc.ArraySize; ++slice)
         {
-            if (pVar->Get() == nullptr)
-                pVar->Set(m_JointsBuffer);
+            for (Uint32 mip = 0; mip < Desc.MipLevels; ++mip)
+            {
+                CopyTextureAttribs CopyAttribs{pTex, RESOURCE_STATE_TRANSITION_MODE_TRANSITION, pStagingTextures[i], RESOURCE_STATE_TRANSITION_MODE_TRANSITION};
+                CopyAttribs.SrcMipLevel = mip;
+                CopyAttribs.SrcSlice    = slice;
+                CopyAttribs.DstMipLevel = mip;
+                CopyAttribs.DstSlice    = slice;
+                pCtx->CopyTexture(CopyAttribs);
+            }
         }
     }
 
-    if (pFrameAttribs != nullptr)
-    {
-        if (auto* pVar = pSRB->GetVariableByName(SHADER_TYPE_VERTEX, "cbFrameAttribs"))
-            pVar->Set(pFrameAttribs);
-    }
-
-    if (m_Settings.EnableIBL)
+    RefCntAutoPtr<IBuffer> pStagingSHBuffer;
+    if (m_IrradianceSHCB)
     {
-        if (auto* pIrradianceMapPSVar = pSRB->GetVariableByName(SHADER_TYPE_PIXEL, "g_IrradianceMap"))
-            pIrradianceMapPSVar->Set(m_pIrradianceCubeSRV);
+        BufferDesc BuffDesc;
+        BuffDesc.Name           = "IBL cache staging SH buffer";
+        BuffDesc.Size           = sizeof(HLSL::PBRIrradianceSHAttribs);
+        BuffDesc.Usage          = USAGE_STAGING;
+        BuffDesc.CPUAccessFlags = CPU_ACCESS_READ;
+        pStagingSHBuffer        = m_Device.CreateBuffer(BuffDesc);
 
-        if (auto* pPrefilteredEnvMap = pSRB->GetVariableByName(SHADER_TYPE_PIXEL, "g_PrefilteredEnvMap"))
-            pPrefilteredEnvMap->Set(m_pPrefilteredEnvMapSRV);
+        pCtx->CopyBuffer(m_IrradianceSHCB, 0, RESOURCE_STATE_TRANSITION_MODE_TRANSITION,
+                         pStagingSHBuffer, 0, sizeof(HLSL::PBRIrradianceSHAttribs), RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
     }
-}
 
-void PBR_Renderer::SetMaterialTexture(IShaderResourceBinding* pSRB, ITextureView* pTexSRV, TEXTURE_ATTRIB_ID TextureId) const
-{
-    if (m_Settings.ShaderTexturesArrayMode == SHADER_TEXTURE_ARRAY_MODE_NONE)
-    {
-        const std::string TextureName = GetTextureShaderName(TextureId);
-        if (IShaderResourceVariable* pTexVar = pSRB->GetVariableByName(SHADER_TYPE_PIXEL, TextureName.c_str()))
+    StateTransitionDesc Barriers[] =
         {
-            pTexVar->Set(pTexSRV);
-        }
-    }
-    else if (m_Settings.ShaderTexturesArrayMode == SHADER_TEXTURE_ARRAY_MODE_STATIC)
+            {pTextures[0], RESOURCE_STATE_UNKNOWN, RESOURCE_STATE_SHADER_RESOURCE, STATE_TRANSITION_FLAG_UPDATE_STATE},
+            {pTextures[2], RESOURCE_STATE_UNKNOWN, RESOURCE_STATE_SHADER_RESOURCE, STATE_TRANSITION_FLAG_UPDATE_STATE},
+            {pTextures[1] != nullptr ? static_cast<IDeviceObject*>(pTextures[1]) : m_IrradianceSHCB.RawPtr(), RESOURCE_STATE_UNKNOWN,
+             pTextures[1] != nullptr ? RESOURCE_STATE_SHADER_RESOURCE : RESOURCE_STATE_CONSTANT_BUFFER, STATE_TRANSITION_FLAG_UPDATE_STATE},
+        };
+    pCtx->TransitionResourceStates(_countof(Barriers), Barriers);
+
+    pCtx->WaitForIdle();
+
+    IBLCacheHeader Header;
+    Header.Key = ComputeHash(EnvMapHash, m_IBLSettingsHash, IBLCacheVersion);
+
+    std::vector<Uint8> Data(sizeof(Header));
+    memcpy(Data.data(), &Header, sizeof(Header));
+    for (size_t i = 0; i < _countof(pTextures); ++i)
     {
-        if (m_StaticShaderTextureIds)
+        ITexture* pStagingTex = pStagingTextures[i];
+        if (pStagingTex == nullptr)
+            continue;
+
+        const TextureDesc& Desc      = pStagingTex->GetDesc();
+        const Uint32       TexelSize = GetTexelSize(Desc.Format);
+
+        size_t Offset = Data.size();
+        Data.resize(Offset + GetPackedTextureDataSize(Desc));
+        for (Uint32 slice = 0; slice < Desc.ArraySize; ++slice)
         {
-            const auto TextureIdx = (*m_StaticShaderTextureIds)[TextureId];
-            if (TextureIdx == InvalidMaterialTextureId)
+            for (Uint32 mip = 0; mip < Desc.MipLevels; ++mip)
             {
-                UNEXPECTED("Texture is not initialized");
-                return;
-            }
+                const Uint32 MipWidth  = std::max(Desc.Width >> mip, 1u);
+                const Uint32 MipHeight = std::max(Desc.Height >> mip, 1u);
+                const size_t RowSize   = size_t{MipWidth} * TexelSize;
 
-            if (IShaderResourceVariable* pMatTexturesVar = pSRB->GetVariableByName(SHADER_TYPE_PIXEL, "g_MaterialTextures"))
-            {
-                IDeviceObject* pObj[] = {pTexSRV};
-                pMatTexturesVar->SetArray(pObj, TextureIdx, 1);
+                MappedTextureSubresource MappedData;
+                pCtx->MapTextureSubresource(pStagingTex, mip, slice, MAP_READ, MAP_FLAG_DO_NOT_WAIT, nullptr, MappedData);
+                if (MappedData.pData == nullptr)
+                {
+                    LOG_ERROR_MESSAGE("Failed to map the IBL cache staging texture");
+                    return false;
+                }
+                for (Uint32 row = 0; row < MipHeight; ++row)
+                {
+                    memcpy(&Data[Offset], static_cast<const Uint8*>(MappedData.pData) + size_t{row} * MappedData.Stride, RowSize);
+                    Offset += RowSize;
+                }
+                pCtx->UnmapTextureSubresource(pStagingTex, mip, slice);
             }
         }
-        else
+    }
+
+    if (pStagingSHBuffer)
+    {
+        MapHelper<Uint8> SHData{pCtx, pStagingSHBuffer, MAP_READ, MAP_FLAG_DO_NOT_WAIT};
+        if (SHData == nullptr)
         {
-            UNEXPECTED("Static material texture indices are not initialized, which indicates that the client uses a custom GetStaticShaderTextureIds function. "
-                       "In this case it is expected that the client binds the textures.");
+            LOG_ERROR_MESSAGE("Failed to map the IBL cache staging SH buffer");
+            return false;
         }
+        Data.insert(Data.end(), static_cast<const Uint8*>(SHData), static_cast<const Uint8*>(SHData) + sizeof(HLSL::PBRIrradianceSHAttribs));
     }
-    else if (m_Settings.ShaderTexturesArrayMode == SHADER_TEXTURE_ARRAY_MODE_DYNAMIC)
+
+    FileWrapper File{FilePath, EFileAccessMode::Overwrite};
+    if (!File)
     {
-        UNEXPECTED("This method should not be called when shader textures array mode is dynamic.");
+        LOG_ERROR_MESSAGE("Failed to open IBL cache file ", FilePath, " for writing");
+        return false;
     }
-    else
+
+    if (!File->Write(Data.data(), Data.size()))
     {
-        UNEXPECTED("Unexpected shader textures array mode");
+        LOG_ERROR_MESSAGE("Failed to write IBL cache file ", FilePath);
+        return false;
     }
+
+    return true;
 }
 
-void PBR_Renderer::CreateSignature()
+bool PBR_Renderer::LoadIBLCache(IDeviceContext* pCtx,
+                                const char*     FilePath,
+                                Uint64          EnvMapHash,
+                                Uint32          NumPhiSamples,
+                                Uint32          NumThetaSamples,
+                                bool            OptimizeSamples)
 {
-    VERIFY(!m_ResourceSignature, "Resource signature has already been created");
-
-    PipelineResourceSignatureDescX SignatureDesc{"PBR Renderer Resource Signature"};
-    SignatureDesc
-        .SetUseCombinedTextureSamplers(m_Device.GetDeviceInfo().IsGLDevice())
-        .AddResource(SHADER_TYPE_VS_PS, "cbFrameAttribs", SHADER_RESOURCE_TYPE_CONSTANT_BUFFER, SHADER_RESOURCE_VARIABLE_TYPE_MUTABLE)
-        .AddResource(SHADER_TYPE_VS_PS, "cbPrimitiveAttribs", SHADER_RESOURCE_TYPE_CONSTANT_BUFFER, SHADER_RESOURCE_VARIABLE_TYPE_MUTABLE);
+    if (!m_Settings.EnableIBL)
+    {
+        LOG_WARNING_MESSAGE("IBL is disabled, so loading the IBL cache will have no effect");
+        return false;
+    }
 
-    if (m_Settings.MaxJointCount > 0)
-        SignatureDesc.AddResource(SHADER_TYPE_VERTEX, "cbJointTransforms", SHADER_RESOURCE_TYPE_CONSTANT_BUFFER, SHADER_RESOURCE_VARIABLE_TYPE_MUTABLE);
+    FileWrapper File{FilePath, EFileAccessMode::Read};
+    if (!File)
+        return false;
 
-    std::unordered_set<std::string> Samplers;
-    if (!m_Device.GetDeviceInfo().IsGLDevice())
+    std::vector<Uint8> Data(File->GetSize());
+    if (Data.size() < sizeof(IBLCacheHeader) || !File->Read(Data.data(), Data.size()))
     {
-        SignatureDesc.AddImmutableSampler(SHADER_TYPE_PIXEL, "g_LinearClampSampler", Sam_LinearClamp);
-        Samplers.emplace("g_LinearClampSampler");
+        LOG_ERROR_MESSAGE("Failed to read IBL cache file ", FilePath);
+        return false;
+    }
+
+    IBLCacheHeader Header;
+    memcpy(&Header, Data.data(), sizeof(Header));
+    if (Header.Magic != IBLCacheMagic)
+    {
+        LOG_ERROR_MESSAGE(FilePath, " is not a valid IBL cache file");
+        return false;
+    }
+
+    const Uint64 SettingsHash = ComputeIBLSettingsHash(NumPhiSamples, NumThetaSamples, OptimizeSamples);
+    if (Header.Version != IBLCacheVersion || Header.Key != ComputeHash(EnvMapHash, SettingsHash, IBLCacheVersion))
+    {
+        // The cache was written for a different environment map or different settings
+        return false;
+    }
+
+    ITexture* pTextures[] = {
+        m_pPreintegratedGGX_SRV->GetTexture(),
+        m_pIrradianceCubeSRV ? m_pIrradianceCubeSRV->GetTexture() : nullptr,
+        m_pPrefilteredEnvMapSRV->GetTexture(),
+    };
+
+    size_t ExpectedSize = sizeof(Header);
+    for (ITexture* pTex : pTextures)
+    {
+        if (pTex != nullptr)
+            ExpectedSize += GetPackedTextureDataSize(pTex->GetDesc());
+    }
+    if (m_IrradianceSHCB)
+        ExpectedSize += sizeof(HLSL::PBRIrradianceSHAttribs);
+    if (Data.size() != ExpectedSize)
+    {
+        LOG_ERROR_MESSAGE("IBL cache file ", FilePath, " is corrupted");
+        return false;
+    }
+
+    size_t Offset = sizeof(Header);
+    for (ITexture* pTex : pTextures)
+    {
+        if (pTex == nullptr)
+            continue;
+
+        const TextureDesc& Desc      = pTex->GetDesc();
+        const Uint32       TexelSize = GetTexelSize(Desc.Format);
+        for (Uint32 slice = 0; slice < Desc.ArraySize; ++slice)
+        {
+            for (Uint32 mip = 0; mip < Desc.MipLevels; ++mip)
+            {
+                const Uint32 MipWidth  = std::max(Desc.Width >> mip, 1u);
+                const Uint32 MipHeight = std::max(Desc.Height >> mip, 1u);
+                const Uint64 RowSize   = Uint64{MipWidth} * TexelSize;
+
+                const Box         UpdateBox{0, MipWidth, 0, MipHeight};
+                TextureSubResData SubresData{&Data[Offset], RowSize};
+                pCtx->UpdateTexture(pTex, mip, slice, UpdateBox, SubresData, RESOURCE_STATE_TRANSITION_MODE_NONE, RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
+                Offset += static_cast<size_t>(RowSize * MipHeight);
+            }
+        }
+    }
+
+    if (m_IrradianceSHCB)
+    {
+        pCtx->UpdateBuffer(m_IrradianceSHCB, 0, sizeof(HLSL::PBRIrradianceSHAttribs), &Data[Offset], RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
+        Offset += sizeof(HLSL::PBRIrradianceSHAttribs);
+    }
+    VERIFY_EXPR(Offset == Data.size());
+
+    StateTransitionDesc Barriers[] =
+        {
+            {pTextures[0], RESOURCE_STATE_UNKNOWN, RESOURCE_STATE_SHADER_RESOURCE, STATE_TRANSITION_FLAG_UPDATE_STATE},
+            {pTextures[2], RESOURCE_STATE_UNKNOWN, RESOURCE_STATE_SHADER_RESOURCE, STATE_TRANSITION_FLAG_UPDATE_STATE},
+            {pTextures[1] != nullptr ? static_cast<IDeviceObject*>(pTextures[1]) : m_IrradianceSHCB.RawPtr(), RESOURCE_STATE_UNKNOWN,
+             pTextures[1] != nullptr ? RESOURCE_STATE_SHADER_RESOURCE : RESOURCE_STATE_CONSTANT_BUFFER, STATE_TRANSITION_FLAG_UPDATE_STATE},
+        };
+    pCtx->TransitionResourceStates(_countof(Barriers), Barriers);
+
+    m_IBLSettingsHash = SettingsHash;
+
+    return true;
+}
+
+
+void PBR_Renderer::InitCommonSRBVars(IShaderResourceBinding* pSRB, IBuffer* pFrameAttribs) const
+{
+    if (pSRB == nullptr)
+    {
+        UNEXPECTED("SRB must not be null");
+        return;
+    }
+
+    if (auto* pVar = pSRB->GetVariableByName(SHADER_TYPE_PIXEL, "cbPrimitiveAttribs"))
+    {
+        if (pVar->Get() == nullptr)
+        {
+            const Uint32 AttribsSize = GetPBRPrimitiveAttribsSize(PSO_FLAG_ALL) * std::max(m_Settings.PrimitiveArraySize, 1u);
+            if (m_PBRPrimitiveAttribsCB->GetDesc().Size > AttribsSize)
+            {
+                // The buffer fits multiple primitives. Bind the range of a single primitive (or primitive
+                // array), the attribs of the current primitive are selected by the buffer offset.
+                pVar->SetBufferRange(m_PBRPrimitiveAttribsCB, 0, AttribsSize);
+            }
+            else
+            {
+                pVar->Set(m_PBRPrimitiveAttribsCB);
+            }
+        }
+    }
+
+    if (m_Settings.MaxJointCount > 0)
+    {
+        if (m_Settings.JointsBufferMode == CreateInfo::JOINTS_BUFFER_MODE_STRUCTURED)
+        {
+            if (auto* pVar = pSRB->GetVariableByName(SHADER_TYPE_VERTEX, "g_JointPalette"))
+            {
+                if (pVar->Get() == nullptr)
+                    pVar->Set(m_JointsBuffer->GetDefaultView(BUFFER_VIEW_SHADER_RESOURCE));
+            }
+        }
+        else if (auto* pVar = pSRB->GetVariableByName(SHADER_TYPE_VERTEX, "cbJointTransforms"))
+        {
+            if (pVar->Get() == nullptr)
+                pVar->Set(m_JointsBuffer);
+        }
+    }
+
+    if (m_InstanceTransformsBuffer)
+    {
+        if (auto* pVar = pSRB->GetVariableByName(SHADER_TYPE_VERTEX, "g_InstanceTransforms"))
+        {
+            if (pVar->Get() == nullptr)
+                pVar->Set(m_InstanceTransformsBuffer->GetDefaultView(BUFFER_VIEW_SHADER_RESOURCE));
+        }
+    }
+
+    if (m_MaterialsBuffer)
+    {
+        if (auto* pVar = pSRB->GetVariableByName(SHADER_TYPE_PIXEL, "g_Materials"))
+        {
+            if (pVar->Get() == nullptr)
+                pVar->Set(m_MaterialsBuffer->GetDefaultView(BUFFER_VIEW_SHADER_RESOURCE));
+        }
+    }
+
+    if (m_PunctualLightsBuffer)
+    {
+        if (auto* pVar = pSRB->GetVariableByName(SHADER_TYPE_PIXEL, "g_PunctualLights"))
+        {
+            if (pVar->Get() == nullptr)
+                pVar->Set(m_PunctualLightsBuffer->GetDefaultView(BUFFER_VIEW_SHADER_RESOURCE));
+        }
+        if (auto* pVar = pSRB->GetVariableByName(SHADER_TYPE_PIXEL, "g_LightClusters"))
+        {
+            if (pVar->Get() == nullptr)
+                pVar->Set(m_LightClustersBuffer->GetDefaultView(BUFFER_VIEW_SHADER_RESOURCE));
+        }
+    }
+
+    if (pFrameAttribs != nullptr)
+    {
+        if (auto* pVar = pSRB->GetVariableByName(SHADER_TYPE_VERTEX, "cbFrameAttribs"))
+            pVar->Set(pFrameAttribs);
+    }
+
+    if (m_Settings.EnableIBL)
+    {
+        if (auto* pIrradianceMapPSVar = pSRB->GetVariableByName(SHADER_TYPE_PIXEL, "g_IrradianceMap"))
+            pIrradianceMapPSVar->Set(m_pIrradianceCubeSRV);
+
+        if (auto* pPrefilteredEnvMap = pSRB->GetVariableByName(SHADER_TYPE_PIXEL, "g_PrefilteredEnvMap"))
+            pPrefilteredEnvMap->Set(m_pPrefilteredEnvMapSRV);
+    }
+}
+
+void PBR_Renderer::SetMaterialTexture(IShaderResourceBinding* pSRB, ITextureView* pTexSRV, TEXTURE_ATTRIB_ID TextureId) const
+{
+    if (m_Settings.ShaderTexturesArrayMode == SHADER_TEXTURE_ARRAY_MODE_NONE)
+    {
+        const std::string TextureName = GetTextureShaderName(TextureId);
+        if (IShaderResourceVariable* pTexVar = pSRB->GetVariableByName(SHADER_TYPE_PIXEL, TextureName.c_str()))
+        {
+            pTexVar->Set(pTexSRV);
+        }
+    }
+    else if (m_Settings.ShaderTexturesArrayMode == SHADER_TEXTURE_ARRAY_MODE_STATIC)
+    {
+        if (m_StaticShaderTextureIds)
+        {
+            const auto TextureIdx = (*m_StaticShaderTextureIds)[TextureId];
+            if (TextureIdx == InvalidMaterialTextureId)
+            {
+                UNEXPECTED("Texture is not initialized");
+                return;
+            }
+
+            if (IShaderResourceVariable* pMatTexturesVar = pSRB->GetVariableByName(SHADER_TYPE_PIXEL, "g_MaterialTextures"))
+            {
+                IDeviceObject* pObj[] = {pTexSRV};
+                pMatTexturesVar->SetArray(pObj, TextureIdx, 1);
+            }
+        }
+        else
+        {
+            UNEXPECTED("Static material texture indices are not initialized, which indicates that the client uses a custom GetStaticShaderTextureIds function. "
+                       "In this case it is expected that the client binds the textures.");
+        }
+    }
+    else if (m_Settings.ShaderTexturesArrayMode == SHADER_TEXTURE_ARRAY_MODE_DYNAMIC)
+    {
+        UNEXPECTED("This method should not be called when shader textures array mode is dynamic.");
+    }
+    else
+    {
+        UNEXPECTED("Unexpected shader textures array mode");
+    }
+}
+
+void PBR_Renderer::CreateSignature()
+{
+    VERIFY(!m_ResourceSignature, "Resource signature has already been created");
+
+    PipelineResourceSignatureDescX SignatureDesc{"PBR Renderer Resource Signature"};
+    SignatureDesc
+        .SetUseCombinedTextureSamplers(m_Device.GetDeviceInfo().IsGLDevice())
+        .AddResource(SHADER_TYPE_VS_PS, "cbFrameAttribs", SHADER_RESOURCE_TYPE_CONSTANT_BUFFER, SHADER_RESOURCE_VARIABLE_TYPE_MUTABLE)
+        .AddResource(SHADER_TYPE_VS_PS, "cbPrimitiveAttribs", SHADER_RESOURCE_TYPE_CONSTANT_BUFFER, SHADER_RESOURCE_VARIABLE_TYPE_MUTABLE);
+
+    if (m_Settings.MaxJointCount > 0)
+    {
+        if (m_Settings.JointsBufferMode == CreateInfo::JOINTS_BUFFER_MODE_STRUCTURED)
+            SignatureDesc.AddResource(SHADER_TYPE_VERTEX, "g_JointPalette", SHADER_RESOURCE_TYPE_BUFFER_SRV, SHADER_RESOURCE_VARIABLE_TYPE_MUTABLE);
+        else
+            SignatureDesc.AddResource(SHADER_TYPE_VERTEX, "cbJointTransforms", SHADER_RESOURCE_TYPE_CONSTANT_BUFFER, SHADER_RESOURCE_VARIABLE_TYPE_MUTABLE);
+    }
+
+    if (m_Settings.MaxInstanceCount > 0)
+        SignatureDesc.AddResource(SHADER_TYPE_VERTEX, "g_InstanceTransforms", SHADER_RESOURCE_TYPE_BUFFER_SRV, SHADER_RESOURCE_VARIABLE_TYPE_MUTABLE);
+
+    if (m_Settings.MaxMaterialCount > 0)
+        SignatureDesc.AddResource(SHADER_TYPE_PIXEL, "g_Materials", SHADER_RESOURCE_TYPE_BUFFER_SRV, SHADER_RESOURCE_VARIABLE_TYPE_MUTABLE);
+
+    if (m_Settings.MaxLightCount > 0)
+    {
+        SignatureDesc
+            .AddResource(SHADER_TYPE_PIXEL, "g_PunctualLights", SHADER_RESOURCE_TYPE_BUFFER_SRV, SHADER_RESOURCE_VARIABLE_TYPE_MUTABLE)
+            .AddResource(SHADER_TYPE_PIXEL, "g_LightClusters", SHADER_RESOURCE_TYPE_BUFFER_SRV, SHADER_RESOURCE_VARIABLE_TYPE_MUTABLE);
+    }
+
+    std::unordered_set<std::string> Samplers;
+    if (!m_Device.GetDeviceInfo().IsGLDevice())
+    {
+        SignatureDesc.AddImmutableSampler(SHADER_TYPE_PIXEL, "g_LinearClampSampler", Sam_LinearClamp);
+        Samplers.emplace("g_LinearClampSampler");
     }
 
     auto& MaterialTexturesArraySize = m_Settings.MaterialTexturesArraySize;
@@ -829,7 +1580,10 @@ void PBR_Renderer::CreateSignature()
     if (m_Settings.EnableIBL)
     {
         AddTextureAndSampler("g_PreintegratedGGX", Sam_LinearClamp, "g_LinearClampSampler", SHADER_RESOURCE_VARIABLE_TYPE_STATIC);
-        AddTextureAndSampler("g_IrradianceMap", Sam_LinearClamp, "g_LinearClampSampler");
+        if (m_Settings.UseIrradianceSH)
+            SignatureDesc.AddResource(SHADER_TYPE_PIXEL, "cbIrradianceSH", SHADER_RESOURCE_TYPE_CONSTANT_BUFFER, SHADER_RESOURCE_VARIABLE_TYPE_STATIC);
+        else
+            AddTextureAndSampler("g_IrradianceMap", Sam_LinearClamp, "g_LinearClampSampler");
         AddTextureAndSampler("g_PrefilteredEnvMap", Sam_LinearClamp, "g_LinearClampSampler");
 
         if (m_Settings.EnableSheen)
@@ -848,6 +1602,10 @@ void PBR_Renderer::CreateSignature()
     if (m_Settings.EnableIBL)
     {
         m_ResourceSignature->GetStaticVariableByName(SHADER_TYPE_PIXEL, "g_PreintegratedGGX")->Set(m_pPreintegratedGGX_SRV);
+        if (m_Settings.UseIrradianceSH)
+        {
+            m_ResourceSignature->GetStaticVariableByName(SHADER_TYPE_PIXEL, "cbIrradianceSH")->Set(m_IrradianceSHCB);
+        }
         if (m_Settings.EnableSheen)
         {
             m_ResourceSignature->GetStaticVariableByName(SHADER_TYPE_PIXEL, "g_PreintegratedCharlie")->Set(m_pPreintegratedCharlie_SRV);
@@ -864,6 +1622,8 @@ ShaderMacroHelper PBR_Renderer::DefineMacros(const PSOKey& Key) const
 {
     ShaderMacroHelper Macros;
     Macros.Add("MAX_JOINT_COUNT", static_cast<int>(m_Settings.MaxJointCount));
+    Macros.Add("PRIMITIVE_ARRAY_SIZE", static_cast<int>(m_Settings.PrimitiveArraySize));
+    Macros.Add("MAX_INSTANCE_COUNT", static_cast<int>(m_Settings.MaxInstanceCount));
     Macros.Add("TONE_MAPPING_MODE", "TONE_MAPPING_MODE_UNCHARTED2");
 
     Macros.Add("PBR_WORKFLOW_METALLIC_ROUGHNESS", static_cast<int>(PBR_WORKFLOW_METALL_ROUGH));
@@ -876,6 +1636,7 @@ ShaderMacroHelper PBR_Renderer::DefineMacros(const PSOKey& Key) const
 
     Macros.Add("USE_IBL_ENV_MAP_LOD", true);
     Macros.Add("USE_HDR_IBL_CUBEMAPS", true);
+    Macros.Add("USE_IRRADIANCE_SH", m_Settings.UseIrradianceSH);
     Macros.Add("USE_SEPARATE_METALLIC_ROUGHNESS_TEXTURES", m_Settings.UseSeparateMetallicRoughnessTextures);
 
     static_assert(static_cast<int>(DebugViewType::NumDebugViews) == 33, "Did you add debug view? You may need to handle it here.");
@@ -918,7 +1679,7 @@ ShaderMacroHelper PBR_Renderer::DefineMacros(const PSOKey& Key) const
 
     const PSO_FLAGS PSOFlags = Key.GetFlags();
 
-    static_assert(PSO_FLAG_LAST == PSO_FLAG_BIT(36), "Did you add new PSO Flag? You may need to handle it here.");
+    static_assert(PSO_FLAG_LAST == PSO_FLAG_BIT(40), "Did you add new PSO Flag? You may need to handle it here.");
 #define ADD_PSO_FLAG_MACRO(Flag) Macros.Add(#Flag, (PSOFlags & PSO_FLAG_##Flag) != PSO_FLAG_NONE)
     ADD_PSO_FLAG_MACRO(USE_COLOR_MAP);
     ADD_PSO_FLAG_MACRO(USE_NORMAL_MAP);
@@ -961,12 +1722,34 @@ ShaderMacroHelper PBR_Renderer::DefineMacros(const PSOKey& Key) const
     ADD_PSO_FLAG_MACRO(ENABLE_TONE_MAPPING);
     ADD_PSO_FLAG_MACRO(UNSHADED);
     ADD_PSO_FLAG_MACRO(COMPUTE_MOTION_VECTORS);
+    ADD_PSO_FLAG_MACRO(USE_INSTANCE_TRANSFORMS);
+    ADD_PSO_FLAG_MACRO(USE_PREV_VERTEX_POSITIONS);
+    ADD_PSO_FLAG_MACRO(DEPTH_ONLY);
+    ADD_PSO_FLAG_MACRO(USE_LIGHT_CLUSTERS);
 #undef ADD_PSO_FLAG_MACRO
 
     Macros.Add("TEX_COLOR_CONVERSION_MODE_NONE", CreateInfo::TEX_COLOR_CONVERSION_MODE_NONE);
     Macros.Add("TEX_COLOR_CONVERSION_MODE_SRGB_TO_LINEAR", CreateInfo::TEX_COLOR_CONVERSION_MODE_SRGB_TO_LINEAR);
     Macros.Add("TEX_COLOR_CONVERSION_MODE", m_Settings.TexColorConversionMode);
 
+    Macros.Add("JOINTS_BUFFER_MODE_UNIFORM", static_cast<int>(CreateInfo::JOINTS_BUFFER_MODE_UNIFORM));
+    Macros.Add("JOINTS_BUFFER_MODE_STRUCTURED", static_cast<int>(CreateInfo::JOINTS_BUFFER_MODE_STRUCTURED));
+    Macros.Add("JOINTS_BUFFER_MODE", static_cast<int>(m_Settings.JointsBufferMode));
+    Macros.Add("PACK_JOINT_MATRICES", m_Settings.PackJointMatrices);
+
+    // When materials are stored in the buffer, all PSOs must use the same material layout
+    const bool      UseMaterialBuffer = m_Settings.MaxMaterialCount > 0;
+    const PSO_FLAGS MaterialFlags     = UseMaterialBuffer ? m_MaterialBufferLayoutFlags : PSOFlags;
+    Macros.Add("USE_MATERIAL_BUFFER", UseMaterialBuffer);
+    if (UseMaterialBuffer)
+    {
+        Macros.Add("MATERIAL_HAS_SHEEN_ATTRIBS", (MaterialFlags & PSO_FLAG_ENABLE_SHEEN) != PSO_FLAG_NONE);
+        Macros.Add("MATERIAL_HAS_ANISOTROPY_ATTRIBS", (MaterialFlags & PSO_FLAG_ENABLE_ANISOTROPY) != PSO_FLAG_NONE);
+        Macros.Add("MATERIAL_HAS_IRIDESCENCE_ATTRIBS", (MaterialFlags & PSO_FLAG_ENABLE_IRIDESCENCE) != PSO_FLAG_NONE);
+        Macros.Add("MATERIAL_HAS_TRANSMISSION_ATTRIBS", (MaterialFlags & PSO_FLAG_ENABLE_TRANSMISSION) != PSO_FLAG_NONE);
+        Macros.Add("MATERIAL_HAS_VOLUME_ATTRIBS", (MaterialFlags & PSO_FLAG_ENABLE_VOLUME) != PSO_FLAG_NONE);
+    }
+
     StaticShaderTextureIdsArrayType MaterialTextureIds;
     MaterialTextureIds.fill(decltype(PBR_Renderer::InvalidMaterialTextureId){InvalidMaterialTextureId});
     if (m_Settings.ShaderTexturesArrayMode == SHADER_TEXTURE_ARRAY_MODE_STATIC)
@@ -978,7 +1761,7 @@ ShaderMacroHelper PBR_Renderer::DefineMacros(const PSOKey& Key) const
 
     // Tightly pack these attributes that are used by the shader
     int MaxIndex = -1;
-    ProcessTexturAttribs(PSOFlags, [&](int CurrIndex, PBR_Renderer::TEXTURE_ATTRIB_ID AttribId) //
+    ProcessTexturAttribs(MaterialFlags, [&](int CurrIndex, PBR_Renderer::TEXTURE_ATTRIB_ID AttribId) //
                          {
                              if (m_Settings.TextureAttribIndices[AttribId] >= 0)
                              {
@@ -992,7 +1775,8 @@ ShaderMacroHelper PBR_Renderer::DefineMacros(const PSOKey& Key) const
                              VERIFY_EXPR(CurrIndex == MaxIndex + 1);
                              MaxIndex = std::max(MaxIndex, CurrIndex);
 
-                             if (m_Settings.ShaderTexturesArrayMode == SHADER_TEXTURE_ARRAY_MODE_STATIC)
+                             const bool IsTextureUsed = (PSOFlags & GetTextureAttribPSOFlag(AttribId)) != PSO_FLAG_NONE;
+                             if (m_Settings.ShaderTexturesArrayMode == SHADER_TEXTURE_ARRAY_MODE_STATIC && IsTextureUsed)
                              {
                                  if (MaterialTextureIds[AttribId] != InvalidMaterialTextureId)
                                  {
@@ -1056,6 +1840,16 @@ void PBR_Renderer::GetVSInputStructAndLayout(PSO_FLAGS         PSOFlags,
         };
 
     InputLayout = m_Settings.InputLayout;
+    if (m_Settings.PrimitiveArraySize > 0)
+    {
+        // Primitive index is read from the buffer that contains consecutive indices and
+        // is selected by the first instance location.
+        InputLayout.Add(PrimitiveIdAttribIndex, m_PrimitiveIdBufferSlot, 1u, VT_UINT32, False, INPUT_ELEMENT_FREQUENCY_PER_INSTANCE);
+    }
+    if (PSOFlags & PSO_FLAG_USE_PREV_VERTEX_POSITIONS)
+    {
+        InputLayout.Add(PrevPositionAttribIndex, m_PrevPositionBufferSlot, 3u, VT_FLOAT32, False);
+    }
     InputLayout.ResolveAutoOffsetsAndStrides();
 
     std::stringstream ss;
@@ -1101,12 +1895,27 @@ void PBR_Renderer::GetVSInputStructAndLayout(PSO_FLAGS         PSOFlags,
         }
     }
 
+    if (m_Settings.PrimitiveArraySize > 0)
+    {
+        ss << "    " << std::setw(7) << "uint" << std::setw(10) << "PrimitiveID" << ": ATTRIB" << PrimitiveIdAttribIndex << ";" << std::endl;
+    }
+
+    if (PSOFlags & PSO_FLAG_USE_PREV_VERTEX_POSITIONS)
+    {
+        ss << "    " << std::setw(7) << "float" << 3 << std::setw(9) << "PrevPos" << ": ATTRIB" << PrevPositionAttribIndex << ";" << std::endl;
+    }
+
+    if (PSOFlags & PSO_FLAG_USE_INSTANCE_TRANSFORMS)
+    {
+        ss << "    " << std::setw(7) << "uint" << std::setw(10) << "InstanceID" << ": SV_InstanceID;" << std::endl;
+    }
+
     ss << "};" << std::endl;
 
     VSInputStruct = ss.str();
 }
 
-std::string PBR_Renderer::GetVSOutputStruct(PSO_FLAGS PSOFlags, bool UseVkPointSize)
+std::string PBR_Renderer::GetVSOutputStruct(PSO_FLAGS PSOFlags, bool UseVkPointSize, bool UsePrimitiveId)
 {
     // struct VSOutput
     // {
@@ -1118,6 +1927,7 @@ std::string PBR_Renderer::GetVSOutputStruct(PSO_FLAGS PSOFlags, bool UseVkPointS
     //     float2 UV1         : UV1;
     //     float3 Tangent     : TANGENT;
     //     float4 PrevClipPos : PREV_CLIP_POS;
+    //     uint   PrimitiveID : PRIMITIVE_ID;
     // };
 
     std::stringstream ss;
@@ -1149,6 +1959,10 @@ std::string PBR_Renderer::GetVSOutputStruct(PSO_FLAGS PSOFlags, bool UseVkPointS
     {
         ss << "    float4 PrevClipPos : PREV_CLIP_POS;" << std::endl;
     }
+    if (UsePrimitiveId)
+    {
+        ss << "    nointerpolation uint PrimitiveID : PRIMITIVE_ID;" << std::endl;
+    }
     if (UseVkPointSize)
     {
         ss << "    [[vk::builtin(\"PointSize\")]] float PointSize : PSIZE;" << std::endl;
@@ -1200,18 +2014,23 @@ void PBR_Renderer::CreatePSO(PsoHashMapType& PsoHashMap, const GraphicsPipelineD
     PipelineStateDesc&              PSODesc          = PSOCreateInfo.PSODesc;
     GraphicsPipelineDesc&           GraphicsPipeline = PSOCreateInfo.GraphicsPipeline;
 
-    const auto PSOFlags   = Key.GetFlags();
-    const auto IsUnshaded = (PSOFlags & PSO_FLAG_UNSHADED) != 0;
+    const auto PSOFlags    = Key.GetFlags();
+    const auto IsUnshaded  = (PSOFlags & PSO_FLAG_UNSHADED) != 0;
+    const auto IsDepthOnly = (PSOFlags & PSO_FLAG_DEPTH_ONLY) != 0;
 
     InputLayoutDescX InputLayout;
     std::string      VSInputStruct;
     GetVSInputStructAndLayout(PSOFlags, VSInputStruct, InputLayout);
 
     const bool UseVkPointSize = GraphicsDesc.PrimitiveTopology == PRIMITIVE_TOPOLOGY_POINT_LIST && m_Device.GetDeviceInfo().IsVulkanDevice();
-    const auto VSOutputStruct = GetVSOutputStruct(PSOFlags, UseVkPointSize);
+    const auto VSOutputStruct = GetVSOutputStruct(PSOFlags, UseVkPointSize, m_Settings.PrimitiveArraySize > 0);
 
     CreateInfo::PSMainSourceInfo PSMainSource;
-    if (m_Settings.GetPSMainSource)
+    if (IsDepthOnly)
+    {
+        // Depth-only pixel shader has no outputs
+    }
+    else if (m_Settings.GetPSMainSource)
     {
         PSMainSource = m_Settings.GetPSMainSource(PSOFlags);
     }
@@ -1255,6 +2074,20 @@ void PBR_Renderer::CreatePSO(PsoHashMapType& PsoHashMap, const GraphicsPipelineD
     }
 
     RefCntAutoPtr<IShader> pPS;
+    if (IsDepthOnly)
+    {
+        // Opaque primitives do not need a pixel shader to render depth.
+        // OpenGL requires a fragment shader in every program though.
+        if (Key.GetAlphaMode() != ALPHA_MODE_OPAQUE || m_Device.GetDeviceInfo().IsGLDevice())
+        {
+            ShaderCI.Desc       = {"Depth-only PS", SHADER_TYPE_PIXEL, UseCombinedSamplers};
+            ShaderCI.EntryPoint = "main";
+            ShaderCI.FilePath   = "RenderDepthOnly.psh";
+
+            pPS = m_Device.CreateShader(ShaderCI);
+        }
+    }
+    else
     {
         ShaderCI.Desc       = {!IsUnshaded ? "PBR PS" : "Unshaded PS", SHADER_TYPE_PIXEL, UseCombinedSamplers};
         ShaderCI.EntryPoint = "main";
@@ -1273,9 +2106,17 @@ void PBR_Renderer::CreatePSO(PsoHashMapType& PsoHashMap, const GraphicsPipelineD
     PSOCreateInfo.pVS = pVS;
     PSOCreateInfo.pPS = pPS;
 
-    for (auto AlphaMode : {ALPHA_MODE_OPAQUE, ALPHA_MODE_BLEND})
+    // Depth-only pipelines for opaque and alpha-tested primitives use different shaders,
+    // so only the pipelines for the alpha mode of the key are created.
+    std::vector<ALPHA_MODE> AlphaModes;
+    if (IsDepthOnly)
+        AlphaModes = {Key.GetAlphaMode()};
+    else
+        AlphaModes = {ALPHA_MODE_OPAQUE, ALPHA_MODE_BLEND};
+
+    for (auto AlphaMode : AlphaModes)
     {
-        if (AlphaMode == ALPHA_MODE_OPAQUE)
+        if (AlphaMode != ALPHA_MODE_BLEND || IsDepthOnly)
         {
             PSOCreateInfo.GraphicsPipeline.BlendDesc = BS_Default;
         }
@@ -1296,8 +2137,8 @@ void PBR_Renderer::CreatePSO(PsoHashMapType& PsoHashMap, const GraphicsPipelineD
 
         for (auto CullMode : {CULL_MODE_BACK, CULL_MODE_NONE})
         {
-            std::string PSOName{!IsUnshaded ? "PBR PSO" : "Unshaded PSO"};
-            PSOName += (AlphaMode == ALPHA_MODE_OPAQUE ? " - opaque" : " - blend");
+            std::string PSOName{IsDepthOnly ? "Depth-only PSO" : (!IsUnshaded ? "PBR PSO" : "Unshaded PSO")};
+            PSOName += (AlphaMode == ALPHA_MODE_OPAQUE ? " - opaque" : (AlphaMode == ALPHA_MODE_MASK ? " - mask" : " - blend"));
             PSOName += (CullMode == CULL_MODE_BACK ? " - backface culling" : " - no culling");
             PSODesc.Name = PSOName.c_str();
 
@@ -1306,13 +2147,289 @@ void PBR_Renderer::CreatePSO(PsoHashMapType& PsoHashMap, const GraphicsPipelineD
             auto       PSO                           = m_Device.CreateGraphicsPipelineState(PSOCreateInfo);
 
             PsoHashMap[{PSOFlags, AlphaMode, DoubleSided, Key}] = PSO;
-            if (AlphaMode == ALPHA_MODE_OPAQUE)
+            if (AlphaMode == ALPHA_MODE_OPAQUE && !IsDepthOnly)
             {
                 // Mask and opaque use the same PSO
                 PsoHashMap[{PSOFlags, ALPHA_MODE_MASK, DoubleSided, Key}] = PSO;
             }
         }
     }
+
+    if (GraphicsDesc.pRenderPass == nullptr)
+    {
+        // All alpha modes and cull modes are created for the same key
+        std::lock_guard<std::mutex> Lock{m_PSOManifestMtx};
+        m_PSOManifest.emplace(PSOManifestEntry{GraphicsDesc, PSOKey{PSOFlags, IsDepthOnly ? Key.GetAlphaMode() : ALPHA_MODE_OPAQUE, false, Key}});
+    }
+}
+
+Uint32 PBR_Renderer::GetJointMatrixSize() const
+{
+    return m_Settings.PackJointMatrices ? sizeof(float4) * 3 : sizeof(float4x4);
+}
+
+void* PBR_Renderer::WriteJointMatrices(void* pDst, const float4x4* pJoints, Uint32 NumJoints) const
+{
+    if (!m_Settings.PackJointMatrices)
+    {
+        memcpy(pDst, pJoints, sizeof(float4x4) * NumJoints);
+        return static_cast<float4x4*>(pDst) + NumJoints;
+    }
+
+    // Shaders read matrices in column-major order, so every row of the shader matrix is
+    // a column of the host matrix. The last row (0, 0, 0, 1) of the affine matrix is not stored.
+    float4* pDstRows = static_cast<float4*>(pDst);
+    for (Uint32 i = 0; i < NumJoints; ++i)
+    {
+        const float4x4& Joint = pJoints[i];
+        for (int r = 0; r < 3; ++r)
+            *(pDstRows++) = float4{Joint.m[0][r], Joint.m[1][r], Joint.m[2][r], Joint.m[3][r]};
+    }
+    return pDstRows;
+}
+
+struct PBR_Renderer::MaterialAllocator
+{
+    explicit MaterialAllocator(Uint32 MaxMaterialCount) :
+        Mgr{MaxMaterialCount, DefaultRawMemoryAllocator::GetAllocator()}
+    {}
+
+    std::mutex                     Mtx;
+    VariableSizeAllocationsManager Mgr;
+};
+
+PBR_Renderer::MaterialBufferRangePtr PBR_Renderer::AllocateMaterials(Uint32 NumMaterials)
+{
+    if (!m_MaterialAllocator || NumMaterials == 0)
+        return {};
+
+    VariableSizeAllocationsManager::Allocation Alloc;
+    {
+        std::lock_guard<std::mutex> Guard{m_MaterialAllocator->Mtx};
+        Alloc = m_MaterialAllocator->Mgr.Allocate(NumMaterials, 1);
+    }
+    if (!Alloc.IsValid())
+    {
+        LOG_ERROR_MESSAGE("Failed to allocate ", NumMaterials, " materials in the material buffer. Increase MaxMaterialCount.");
+        return {};
+    }
+
+    // The range may outlive the renderer, so the deleter only keeps a weak reference to the allocator.
+    std::weak_ptr<MaterialAllocator> wpAllocator = m_MaterialAllocator;
+    return MaterialBufferRangePtr{
+        new MaterialBufferRange{static_cast<Uint32>(Alloc.UnalignedOffset), NumMaterials},
+        [wpAllocator, Alloc](const MaterialBufferRange* pRange) mutable {
+            if (auto pAllocator = wpAllocator.lock())
+            {
+                std::lock_guard<std::mutex> Guard{pAllocator->Mtx};
+                pAllocator->Mgr.Free(std::move(Alloc));
+            }
+            delete pRange;
+        },
+    };
+}
+
+void PBR_Renderer::UpdateMaterials(IDeviceContext* pCtx, Uint32 FirstMaterialId, Uint32 NumMaterials, const void* pData)
+{
+    if (!m_MaterialsBuffer || NumMaterials == 0)
+        return;
+
+    const Uint32 Stride = m_MaterialsBuffer->GetDesc().ElementByteStride;
+    DEV_CHECK_ERR(FirstMaterialId + NumMaterials <= m_Settings.MaxMaterialCount, "Material range is out of bounds");
+
+    pCtx->UpdateBuffer(m_MaterialsBuffer, Uint64{FirstMaterialId} * Stride, Uint64{NumMaterials} * Stride, pData, RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
+
+    StateTransitionDesc Barrier{m_MaterialsBuffer, RESOURCE_STATE_UNKNOWN, RESOURCE_STATE_SHADER_RESOURCE, STATE_TRANSITION_FLAG_UPDATE_STATE};
+    pCtx->TransitionResourceStates(1, &Barrier);
+}
+
+void PBR_Renderer::UpdatePunctualLights(IDeviceContext* pCtx, Uint32 FirstLight, Uint32 NumLights, const HLSL::PBRPunctualLightAttribs* pLights)
+{
+    if (!m_PunctualLightsBuffer || NumLights == 0)
+        return;
+
+    DEV_CHECK_ERR(FirstLight + NumLights <= m_Settings.MaxLightCount, "Light range is out of bounds");
+    if (FirstLight >= m_Settings.MaxLightCount)
+        return;
+    NumLights = std::min(NumLights, m_Settings.MaxLightCount - FirstLight);
+
+    constexpr Uint64 Stride = sizeof(HLSL::PBRPunctualLightAttribs);
+    pCtx->UpdateBuffer(m_PunctualLightsBuffer, FirstLight * Stride, NumLights * Stride, pLights, RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
+
+    StateTransitionDesc Barrier{m_PunctualLightsBuffer, RESOURCE_STATE_UNKNOWN, RESOURCE_STATE_SHADER_RESOURCE, STATE_TRANSITION_FLAG_UPDATE_STATE};
+    pCtx->TransitionResourceStates(1, &Barrier);
+}
+
+void PBR_Renderer::SetLightClusterAttribs(HLSL::PBRLightClusterAttribs& Attribs, float ZNear, float ZFar, Uint32 NumLights) const
+{
+    const std::array<Uint32, 3>& GridSize = m_Settings.LightClusterGridSize;
+
+    Attribs.GridSizeX           = GridSize[0];
+    Attribs.GridSizeY           = GridSize[1];
+    Attribs.GridSizeZ           = GridSize[2];
+    Attribs.NumLights           = std::min(NumLights, m_Settings.MaxLightCount);
+    Attribs.MaxLightsPerCluster = m_Settings.MaxLightsPerCluster;
+
+    // Slice = log(Depth / ZNear) / log(ZFar / ZNear) * GridSizeZ
+    ZNear = std::max(ZNear, 1e-6f);
+    ZFar  = std::max(ZFar, ZNear * 1.001f);
+
+    Attribs.ZSliceScale = static_cast<float>(GridSize[2]) / std::log(ZFar / ZNear);
+    Attribs.ZSliceBias  = -std::log(ZNear) * Attribs.ZSliceScale;
+}
+
+void PBR_Renderer::BinLights(IDeviceContext* pCtx, IBuffer* pFrameAttribs)
+{
+    if (!m_BinLightsSRB)
+        return;
+
+    if (pFrameAttribs == nullptr)
+    {
+        UNEXPECTED("Frame attributes buffer must not be null");
+        return;
+    }
+
+    m_BinLightsSRB->GetVariableByName(SHADER_TYPE_COMPUTE, "cbFrameAttribs")->Set(pFrameAttribs);
+
+    pCtx->SetPipelineState(m_BinLightsPSO);
+    pCtx->CommitShaderResources(m_BinLightsSRB, RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
+
+    const std::array<Uint32, 3>& GridSize = m_Settings.LightClusterGridSize;
+
+    // One thread group per cluster
+    DispatchComputeAttribs DispatchAttrs{GridSize[0], GridSize[1], GridSize[2]};
+    pCtx->DispatchCompute(DispatchAttrs);
+
+    StateTransitionDesc Barrier{m_LightClustersBuffer, RESOURCE_STATE_UNKNOWN, RESOURCE_STATE_SHADER_RESOURCE, STATE_TRANSITION_FLAG_UPDATE_STATE};
+    pCtx->TransitionResourceStates(1, &Barrier);
+}
+
+void PBR_Renderer::BinLightsReference(const float4x4&                      ViewProj,
+                                      const HLSL::PBRLightClusterAttribs&  Attribs,
+                                      const HLSL::PBRPunctualLightAttribs* pLights,
+                                      std::vector<Uint32>&                 ClusterData) const
+{
+    const Uint32 NumClusters = Attribs.GridSizeX * Attribs.GridSizeY * Attribs.GridSizeZ;
+    const Uint32 ClusterSize = Attribs.MaxLightsPerCluster + 1;
+    ClusterData.assign(size_t{NumClusters} * ClusterSize, 0);
+
+    // Columns of the view-projection matrix compute the clip-space coordinates
+    float4 ViewProjCols[4];
+    for (Uint32 c = 0; c < 4; ++c)
+        ViewProjCols[c] = float4{ViewProj.m[0][c], ViewProj.m[1][c], ViewProj.m[2][c], ViewProj.m[3][c]};
+
+    const float DepthScale = length(float3{ViewProjCols[3].x, ViewProjCols[3].y, ViewProjCols[3].z});
+
+    auto GetPlaneDistance = [](const float4& Plane, const float3& Pos) {
+        return dot(float4{Pos, 1}, Plane) / length(float3{Plane.x, Plane.y, Plane.z});
+    };
+
+    // Texture V axis points up in normalized device coordinates on OpenGL and down on other backends
+    const float NDCYSign = m_Device.GetDeviceInfo().IsGLDevice() ? 1.f : -1.f;
+
+    for (Uint32 z = 0; z < Attribs.GridSizeZ; ++z)
+    {
+        const float MinDepth = z > 0 ?
+            std::exp((static_cast<float>(z) - Attribs.ZSliceBias) / Attribs.ZSliceScale) :
+            -FLT_MAX;
+        const float MaxDepth = z + 1 < Attribs.GridSizeZ ?
+            std::exp((static_cast<float>(z + 1) - Attribs.ZSliceBias) / Attribs.ZSliceScale) :
+            +FLT_MAX;
+
+        for (Uint32 y = 0; y < Attribs.GridSizeY; ++y)
+        {
+            const float NDCY0   = NDCYSign * (static_cast<float>(y) / Attribs.GridSizeY * 2.f - 1.f);
+            const float NDCY1   = NDCYSign * (static_cast<float>(y + 1) / Attribs.GridSizeY * 2.f - 1.f);
+            const float MinNDCY = std::min(NDCY0, NDCY1);
+            const float MaxNDCY = std::max(NDCY0, NDCY1);
+
+            for (Uint32 x = 0; x < Attribs.GridSizeX; ++x)
+            {
+                const float MinNDCX = static_cast<float>(x) / Attribs.GridSizeX * 2.f - 1.f;
+                const float MaxNDCX = static_cast<float>(x + 1) / Attribs.GridSizeX * 2.f - 1.f;
+
+                const float4 Planes[] = {
+                    ViewProjCols[0] - ViewProjCols[3] * MinNDCX,
+                    ViewProjCols[3] * MaxNDCX - ViewProjCols[0],
+                    ViewProjCols[1] - ViewProjCols[3] * MinNDCY,
+                    ViewProjCols[3] * MaxNDCY - ViewProjCols[1],
+                };
+
+                Uint32* pCluster  = &ClusterData[((size_t{z} * Attribs.GridSizeY + y) * Attribs.GridSizeX + x) * ClusterSize];
+                Uint32& NumLights = pCluster[0];
+                for (Uint32 LightIdx = 0; LightIdx < Attribs.NumLights && NumLights < Attribs.MaxLightsPerCluster; ++LightIdx)
+                {
+                    const HLSL::PBRPunctualLightAttribs& Light = pLights[LightIdx];
+
+                    if (Light.Intensity.r == 0 && Light.Intensity.g == 0 && Light.Intensity.b == 0)
+                        continue;
+
+                    const float Range = Light.PosAndRange.w;
+                    if (static_cast<int>(Light.DirAndType.w) != PBR_LIGHT_TYPE_DIRECTIONAL && Range > 0)
+                    {
+                        const float3 Pos{Light.PosAndRange.x, Light.PosAndRange.y, Light.PosAndRange.z};
+                        const float  Depth = dot(float4{Pos, 1}, ViewProjCols[3]);
+
+                        if (Depth + Range * DepthScale < MinDepth || Depth - Range * DepthScale > MaxDepth)
+                            continue;
+
+                        bool Intersect = true;
+                        for (const float4& Plane : Planes)
+                        {
+                            if (GetPlaneDistance(Plane, Pos) < -Range)
+                            {
+                                Intersect = false;
+                                break;
+                            }
+                        }
+                        if (!Intersect)
+                            continue;
+                    }
+
+                    pCluster[1 + NumLights++] = LightIdx;
+                }
+            }
+        }
+    }
+}
+
+PBR_Renderer::PSO_FLAGS PBR_Renderer::ComputeMaterialBufferLayoutFlags() const
+{
+    // All materials in the buffer share the same layout, so it must include
+    // all extensions and textures that any PSO may use.
+    PSO_FLAGS Flags =
+        PSO_FLAG_USE_COLOR_MAP |
+        PSO_FLAG_USE_NORMAL_MAP;
+
+    if (m_Settings.UseSeparateMetallicRoughnessTextures)
+        Flags |= PSO_FLAG_USE_METALLIC_MAP | PSO_FLAG_USE_ROUGHNESS_MAP;
+    else
+        Flags |= PSO_FLAG_USE_PHYS_DESC_MAP;
+
+    if (m_Settings.EnableAO)
+        Flags |= PSO_FLAG_USE_AO_MAP;
+    if (m_Settings.EnableEmissive)
+        Flags |= PSO_FLAG_USE_EMISSIVE_MAP;
+    if (m_Settings.EnableClearCoat)
+        Flags |= PSO_FLAG_ENABLE_CLEAR_COAT | PSO_FLAG_USE_CLEAR_COAT_MAP | PSO_FLAG_USE_CLEAR_COAT_ROUGHNESS_MAP | PSO_FLAG_USE_CLEAR_COAT_NORMAL_MAP;
+    if (m_Settings.EnableSheen)
+        Flags |= PSO_FLAG_ENABLE_SHEEN | PSO_FLAG_USE_SHEEN_COLOR_MAP | PSO_FLAG_USE_SHEEN_ROUGHNESS_MAP;
+    if (m_Settings.EnableAnisotropy)
+        Flags |= PSO_FLAG_ENABLE_ANISOTROPY | PSO_FLAG_USE_ANISOTROPY_MAP;
+    if (m_Settings.EnableIridescence)
+        Flags |= PSO_FLAG_ENABLE_IRIDESCENCE | PSO_FLAG_USE_IRIDESCENCE_MAP | PSO_FLAG_USE_IRIDESCENCE_THICKNESS_MAP;
+    if (m_Settings.EnableTransmission)
+        Flags |= PSO_FLAG_ENABLE_TRANSMISSION | PSO_FLAG_USE_TRANSMISSION_MAP;
+    if (m_Settings.EnableVolume)
+        Flags |= PSO_FLAG_ENABLE_VOLUME | PSO_FLAG_USE_THICKNESS_MAP;
+
+    for (Uint32 i = 0; i < TEXTURE_ATTRIB_ID_COUNT; ++i)
+    {
+        if (m_Settings.TextureAttribIndices[i] < 0)
+            Flags &= ~GetTextureAttribPSOFlag(static_cast<TEXTURE_ATTRIB_ID>(i));
+    }
+
+    return Flags;
 }
 
 void PBR_Renderer::CreateResourceBinding(IShaderResourceBinding** ppSRB)
@@ -1330,12 +2447,8 @@ PBR_Renderer::PsoCacheAccessor PBR_Renderer::GetPsoCacheAccessor(const GraphicsP
     return {*this, it->second, it->first};
 }
 
-IPipelineState* PBR_Renderer::GetPSO(PsoHashMapType&             PsoHashMap,
-                                     const GraphicsPipelineDesc& GraphicsDesc,
-                                     const PSOKey&               Key,
-                                     bool                        CreateIfNull)
+PBR_Renderer::PSO_FLAGS PBR_Renderer::GetSupportedPSOFlags(PSO_FLAGS Flags) const
 {
-    auto Flags = Key.GetFlags();
     if (!m_Settings.EnableIBL)
     {
         Flags &= ~PSO_FLAG_USE_IBL;
@@ -1377,13 +2490,17 @@ IPipelineState* PBR_Renderer::GetPSO(PsoHashMapType&             PsoHashMap,
     {
         Flags &= ~PSO_FLAG_USE_JOINTS;
     }
-    if (m_Settings.UseSeparateMetallicRoughnessTextures)
+    if (m_Settings.MaxInstanceCount == 0)
     {
-        DEV_CHECK_ERR((Flags & PSO_FLAG_USE_PHYS_DESC_MAP) == 0, "Physical descriptor map is not enabled");
+        Flags &= ~PSO_FLAG_USE_INSTANCE_TRANSFORMS;
     }
-    else
+    if (m_Settings.MaxLightCount == 0)
     {
-        DEV_CHECK_ERR((Flags & (PSO_FLAG_USE_METALLIC_MAP | PSO_FLAG_USE_ROUGHNESS_MAP)) == 0, "Separate metallic and roughness maps are not enaled");
+        Flags &= ~PSO_FLAG_USE_LIGHT_CLUSTERS;
+    }
+    if ((Flags & PSO_FLAG_COMPUTE_MOTION_VECTORS) == 0)
+    {
+        Flags &= ~PSO_FLAG_USE_PREV_VERTEX_POSITIONS;
     }
     if ((Flags & (PSO_FLAG_USE_TEXCOORD0 | PSO_FLAG_USE_TEXCOORD1)) == 0)
     {
@@ -1409,10 +2526,46 @@ IPipelineState* PBR_Renderer::GetPSO(PsoHashMapType&             PsoHashMap,
     {
         Flags &= ~PSO_FLAG_USE_THICKNESS_MAP;
     }
+    if (m_Settings.MaxMaterialCount > 0)
+    {
+        // Shaders can only use the textures that are present in the material buffer layout
+        for (Uint32 i = 0; i < TEXTURE_ATTRIB_ID_COUNT; ++i)
+        {
+            const PSO_FLAGS TexFlag = GetTextureAttribPSOFlag(static_cast<TEXTURE_ATTRIB_ID>(i));
+            if ((m_MaterialBufferLayoutFlags & TexFlag) == 0)
+                Flags &= ~TexFlag;
+        }
+    }
+
+    return Flags;
+}
+
+IPipelineState* PBR_Renderer::GetPSO(PsoHashMapType&             PsoHashMap,
+                                     const GraphicsPipelineDesc& GraphicsDesc,
+                                     const PSOKey&               Key,
+                                     bool                        CreateIfNull)
+{
+    const PSO_FLAGS Flags = GetSupportedPSOFlags(Key.GetFlags());
+    if (m_Settings.UseSeparateMetallicRoughnessTextures)
+    {
+        DEV_CHECK_ERR((Flags & PSO_FLAG_USE_PHYS_DESC_MAP) == 0, "Physical descriptor map is not enabled");
+    }
+    else
+    {
+        DEV_CHECK_ERR((Flags & (PSO_FLAG_USE_METALLIC_MAP | PSO_FLAG_USE_ROUGHNESS_MAP)) == 0, "Separate metallic and roughness maps are not enaled");
+    }
 
-    const PSOKey UpdatedKey{Flags, Key};
+    const PSOKey UpdatedKey = (Flags & PSO_FLAG_DEPTH_ONLY) != 0 ?
+        GetDepthOnlyPSOKey(PSOKey{Flags, Key}) :
+        PSOKey{Flags, Key};
 
     auto it = PsoHashMap.find(UpdatedKey);
+    if (it == PsoHashMap.end() && m_HasCreatedAsyncPSOs.load())
+    {
+        // The pipeline may have been created by a worker thread
+        CommitAsyncPSOs();
+        it = PsoHashMap.find(UpdatedKey);
+    }
     if (it == PsoHashMap.end())
     {
         if (CreateIfNull)
@@ -1426,6 +2579,316 @@ IPipelineState* PBR_Renderer::GetPSO(PsoHashMapType&             PsoHashMap,
     return it != PsoHashMap.end() ? it->second.RawPtr() : nullptr;
 }
 
+namespace
+{
+
+constexpr Uint32 PSOManifestMagic   = 0x4D4F5350; // "PSOM"
+constexpr Uint32 PSOManifestVersion = 2;
+
+struct PSOManifestHeader
+{
+    Uint32 Magic            = PSOManifestMagic;
+    Uint32 Version          = PSOManifestVersion;
+    Uint32 GraphicsDescSize = sizeof(GraphicsPipelineDesc);
+    Uint32 NumEntries       = 0;
+};
+
+// Graphics pipeline description is stored as is with the pointers reset,
+// so the manifest is only compatible with the same build.
+struct PSOManifestEntryData
+{
+    GraphicsPipelineDesc GraphicsDesc;
+
+    Uint64 Flags     = 0;
+    Uint64 UserValue = 0;
+    Uint8  DebugView = 0;
+};
+
+} // namespace
+
+bool PBR_Renderer::SavePSOManifest(const char* FilePath) const
+{
+    std::vector<Uint8> Data;
+    {
+        std::lock_guard<std::mutex> Lock{m_PSOManifestMtx};
+
+        PSOManifestHeader Header;
+        Header.NumEntries = static_cast<Uint32>(m_PSOManifest.size());
+
+        Data.resize(sizeof(Header) + sizeof(PSOManifestEntryData) * m_PSOManifest.size());
+        memcpy(Data.data(), &Header, sizeof(Header));
+
+        Uint8* pDst = Data.data() + sizeof(Header);
+        for (const PSOManifestEntry& Entry : m_PSOManifest)
+        {
+            PSOManifestEntryData EntryData;
+            EntryData.GraphicsDesc             = Entry.GraphicsDesc;
+            EntryData.GraphicsDesc.InputLayout = {};
+            EntryData.GraphicsDesc.pRenderPass = nullptr;
+            EntryData.Flags                    = static_cast<Uint64>(Entry.Key.GetFlags());
+            EntryData.UserValue                = Entry.Key.GetUserValue();
+            EntryData.DebugView                = static_cast<Uint8>(Entry.Key.GetDebugView());
+
+            memcpy(pDst, &EntryData, sizeof(EntryData));
+            pDst += sizeof(EntryData);
+        }
+    }
+
+    FileWrapper File{FilePath, EFileAccessMode::Overwrite};
+    if (!File)
+    {
+        LOG_ERROR_MESSAGE("Failed to open PSO manifest file ", FilePath, " for writing");
+        return false;
+    }
+
+    if (!File->Write(Data.data(), Data.size()))
+    {
+        LOG_ERROR_MESSAGE("Failed to write PSO manifest file ", FilePath);
+        return false;
+    }
+
+    return true;
+}
+
+static bool ReadPSOManifest(const char* FilePath, std::vector<PSOManifestEntryData>& Entries)
+{
+    FileWrapper File{FilePath, EFileAccessMode::Read};
+    if (!File)
+    {
+        LOG_WARNING_MESSAGE("Failed to open PSO manifest file ", FilePath);
+        return false;
+    }
+
+    std::vector<Uint8> Data(File->GetSize());
+    if (Data.size() < sizeof(PSOManifestHeader) || !File->Read(Data.data(), Data.size()))
+    {
+        LOG_ERROR_MESSAGE("Failed to read PSO manifest file ", FilePath);
+        return false;
+    }
+
+    PSOManifestHeader Header;
+    memcpy(&Header, Data.data(), sizeof(Header));
+    if (Header.Magic != PSOManifestMagic)
+    {
+        LOG_ERROR_MESSAGE(FilePath, " is not a valid PSO manifest file");
+        return false;
+    }
+    if (Header.Version != PSOManifestVersion || Header.GraphicsDescSize != sizeof(GraphicsPipelineDesc))
+    {
+        LOG_WARNING_MESSAGE("PSO manifest file ", FilePath, " was written by an incompatible version of the renderer and is ignored");
+        return false;
+    }
+    if (Data.size() != sizeof(Header) + sizeof(PSOManifestEntryData) * Header.NumEntries)
+    {
+        LOG_ERROR_MESSAGE("PSO manifest file ", FilePath, " is corrupted");
+        return false;
+    }
+
+    Entries.resize(Header.NumEntries);
+    if (Header.NumEntries > 0)
+        memcpy(Entries.data(), Data.data() + sizeof(Header), sizeof(PSOManifestEntryData) * Header.NumEntries);
+
+    return true;
+}
+
+Uint32 PBR_Renderer::ReplayPSOManifest(const char* FilePath, IThreadPool* pThreadPool)
+{
+    std::vector<PSOManifestEntryData> EntriesData;
+    if (!ReadPSOManifest(FilePath, EntriesData))
+        return 0;
+
+    std::vector<PSOManifestEntry> Entries;
+    Entries.reserve(EntriesData.size());
+    for (PSOManifestEntryData& EntryData : EntriesData)
+    {
+        EntryData.GraphicsDesc.InputLayout = {};
+        EntryData.GraphicsDesc.pRenderPass = nullptr;
+
+        const PSO_FLAGS Flags = static_cast<PSO_FLAGS>(EntryData.Flags);
+        const PSOKey    Key{Flags, ALPHA_MODE_OPAQUE, false, static_cast<DebugViewType>(EntryData.DebugView), EntryData.UserValue};
+
+        // Skip the pipelines that use the features disabled in the current settings
+        if (GetSupportedPSOFlags(Flags) != Flags || Key.GetFlags() != Flags)
+            continue;
+
+        // Skip the pipelines that have already been created or queued
+        auto psos_it = m_PSOs.find(EntryData.GraphicsDesc);
+        if (psos_it != m_PSOs.end() && psos_it->second.find(Key) != psos_it->second.end())
+            continue;
+        if (m_PendingAsyncPSOs.find(PSOManifestEntry{EntryData.GraphicsDesc, Key}) != m_PendingAsyncPSOs.end())
+            continue;
+
+        Entries.emplace_back(PSOManifestEntry{EntryData.GraphicsDesc, Key});
+    }
+
+    const Uint32 NumPSOs = static_cast<Uint32>(Entries.size());
+    if (NumPSOs == 0)
+        return 0;
+
+    auto pTimer = std::make_shared<Timer>();
+
+    if (pThreadPool != nullptr && m_Device.GetDeviceInfo().Features.MultithreadedResourceCreation)
+    {
+        auto pNumRemaining = std::make_shared<std::atomic<Uint32>>(NumPSOs);
+        for (const PSOManifestEntry& Entry : Entries)
+        {
+            EnqueuePSOCreation(Entry, pThreadPool,
+                               [pTimer, pNumRemaining, NumPSOs]() {
+                                   if (pNumRemaining->fetch_sub(1) == 1)
+                                   {
+                                       LOG_INFO_MESSAGE("Created ", NumPSOs, " pipeline states from the manifest in ", pTimer->GetElapsedTime() * 1000.0, " ms");
+                                   }
+                               });
+        }
+    }
+    else
+    {
+        for (const PSOManifestEntry& Entry : Entries)
+        {
+            CreatePSO(m_PSOs[Entry.GraphicsDesc], Entry.GraphicsDesc, Entry.Key);
+        }
+        LOG_INFO_MESSAGE("Created ", NumPSOs, " pipeline states from the manifest in ", pTimer->GetElapsedTime() * 1000.0, " ms");
+    }
+
+    return NumPSOs;
+}
+
+void PBR_Renderer::WaitForPSOManifestReplay()
+{
+    for (IAsyncTask* pTask : m_AsyncPSOTasks)
+        pTask->WaitForCompletion();
+    m_AsyncPSOTasks.clear();
+
+    CommitAsyncPSOs();
+}
+
+void PBR_Renderer::EnqueuePSOCreation(const PSOManifestEntry& Entry, IThreadPool* pThreadPool, std::function<void()> OnCreated)
+{
+    VERIFY_EXPR(pThreadPool != nullptr);
+    if (!m_PendingAsyncPSOs.emplace(Entry).second)
+        return; // Already queued
+
+    m_AsyncPSOTasks.emplace_back(
+        EnqueueAsyncWork(pThreadPool,
+                         [this, Entry, OnCreated = std::move(OnCreated)](Uint32 /*ThreadId*/) {
+                             AsyncPSOs Created{Entry, {}};
+                             CreatePSO(Created.PSOs, Created.Entry.GraphicsDesc, Created.Entry.Key);
+                             {
+                                 std::lock_guard<std::mutex> Lock{m_CreatedAsyncPSOsMtx};
+                                 m_CreatedAsyncPSOs.emplace_back(std::move(Created));
+                                 m_HasCreatedAsyncPSOs.store(true);
+                             }
+                             m_AsyncPSOVersion.fetch_add(1);
+
+                             if (OnCreated)
+                                 OnCreated();
+                             return ASYNC_TASK_STATUS_COMPLETE;
+                         }));
+}
+
+void PBR_Renderer::CommitAsyncPSOs()
+{
+    std::vector<AsyncPSOs> Created;
+    {
+        std::lock_guard<std::mutex> Lock{m_CreatedAsyncPSOsMtx};
+        Created.swap(m_CreatedAsyncPSOs);
+        m_HasCreatedAsyncPSOs.store(false);
+    }
+
+    for (AsyncPSOs& PSOs : Created)
+    {
+        // Keep the pipelines that have been created by GetPSO() in the meantime
+        PsoHashMapType& PsoHashMap = m_PSOs[PSOs.Entry.GraphicsDesc];
+        for (auto& it : PSOs.PSOs)
+            PsoHashMap.emplace(it.first, std::move(it.second));
+
+        m_PendingAsyncPSOs.erase(PSOs.Entry);
+    }
+
+    m_AsyncPSOTasks.erase(std::remove_if(m_AsyncPSOTasks.begin(), m_AsyncPSOTasks.end(),
+                                         [](const RefCntAutoPtr<IAsyncTask>& pTask) {
+                                             return pTask->IsFinished();
+                                         }),
+                          m_AsyncPSOTasks.end());
+}
+
+PBR_Renderer::PSOKey PBR_Renderer::GetFallbackPSOKey(const PSOKey& Key)
+{
+    // Material textures and extensions are the most expensive part of the shaders to compile.
+    // Vertex inputs and outputs must be preserved to match the geometry and render targets.
+    constexpr PSO_FLAGS FallbackFlags =
+        PSO_FLAG_VERTEX_ATTRIBS |
+        PSO_FLAG_USE_COLOR_MAP |
+        PSO_FLAG_USE_IBL |
+        PSO_FLAG_USE_TEXTURE_ATLAS |
+        PSO_FLAG_ENABLE_TEXCOORD_TRANSFORM |
+        PSO_FLAG_CONVERT_OUTPUT_TO_SRGB |
+        PSO_FLAG_ENABLE_CUSTOM_DATA_OUTPUT |
+        PSO_FLAG_ENABLE_TONE_MAPPING |
+        PSO_FLAG_UNSHADED |
+        PSO_FLAG_COMPUTE_MOTION_VECTORS |
+        PSO_FLAG_USE_INSTANCE_TRANSFORMS |
+        PSO_FLAG_USE_PREV_VERTEX_POSITIONS |
+        PSO_FLAG_DEPTH_ONLY |
+        PSO_FLAG_USE_LIGHT_CLUSTERS |
+        PSO_FLAG_ALL_USER_DEFINED;
+
+    return PSOKey{Key.GetFlags() & FallbackFlags, Key.GetAlphaMode(), Key.IsDoubleSided(), DebugViewType::None, Key.GetUserValue()};
+}
+
+PBR_Renderer::PSOKey PBR_Renderer::GetDepthOnlyPSOKey(const PSOKey& Key)
+{
+    // Flags that affect the vertex positions
+    constexpr PSO_FLAGS PositionFlags =
+        PSO_FLAG_USE_JOINTS |
+        PSO_FLAG_USE_INSTANCE_TRANSFORMS |
+        PSO_FLAG_ALL_USER_DEFINED;
+
+    // Flags that are needed to compute the alpha of alpha-masked materials.
+    // Both texture coordinate sets are kept as the base color texture may use either of them.
+    constexpr PSO_FLAGS AlphaFlags =
+        PSO_FLAG_USE_COLOR_MAP |
+        PSO_FLAG_USE_VERTEX_COLORS |
+        PSO_FLAG_USE_TEXCOORD0 |
+        PSO_FLAG_USE_TEXCOORD1 |
+        PSO_FLAG_USE_TEXTURE_ATLAS |
+        PSO_FLAG_ENABLE_TEXCOORD_TRANSFORM;
+
+    PSO_FLAGS Flags = Key.GetFlags() & PositionFlags;
+    if (Key.GetAlphaMode() != ALPHA_MODE_OPAQUE)
+        Flags |= Key.GetFlags() & AlphaFlags;
+
+    return PSOKey{Flags | PSO_FLAG_DEPTH_ONLY, Key.GetAlphaMode(), Key.IsDoubleSided(), DebugViewType::None, Key.GetUserValue()};
+}
+
+IPipelineState* PBR_Renderer::GetPSOAsync(PsoHashMapType&             PsoHashMap,
+                                          const GraphicsPipelineDesc& GraphicsDesc,
+                                          const PSOKey&               Key,
+                                          PSOKey&                     UsedKey)
+{
+    UsedKey = Key;
+    if (IPipelineState* pPSO = GetPSO(PsoHashMap, GraphicsDesc, Key, false))
+        return pPSO;
+
+    IThreadPool* pThreadPool = m_Settings.pAsyncPSOThreadPool;
+    if (pThreadPool == nullptr || !m_Device.GetDeviceInfo().Features.MultithreadedResourceCreation)
+        return GetPSO(PsoHashMap, GraphicsDesc, Key, true);
+
+    const PSOKey SupportedKey{GetSupportedPSOFlags(Key.GetFlags()), Key};
+    const PSOKey FallbackKey = GetFallbackPSOKey(Key);
+    if (PSOKey{GetSupportedPSOFlags(FallbackKey.GetFlags()), FallbackKey} == SupportedKey)
+    {
+        // There is no cheaper pipeline to use instead
+        return GetPSO(PsoHashMap, GraphicsDesc, Key, true);
+    }
+
+    // All alpha modes and cull modes are created for the same key
+    EnqueuePSOCreation(PSOManifestEntry{GraphicsDesc, PSOKey{SupportedKey.GetFlags(), ALPHA_MODE_OPAQUE, false, SupportedKey}}, pThreadPool);
+
+    UsedKey = FallbackKey;
+    return GetPSO(PsoHashMap, GraphicsDesc, FallbackKey, true);
+}
+
 void PBR_Renderer::SetInternalShaderParameters(HLSL::PBRRendererShaderParameters& Renderer)
 {
     Renderer.PrefilteredCubeLastMip = m_Settings.EnableIBL ? static_cast<float>(m_pPrefilteredEnvMapSRV->GetTexture()->GetDesc().MipLevels - 1) : 0.f;
@@ -1437,17 +2900,28 @@ Uint32 PBR_Renderer::GetPBRPrimitiveAttribsSize(PSO_FLAGS Flags) const
     //{
     //    GLTFNodeShaderTransforms Transforms;
     //    float4x4                 PrevNodeMatrix; // #if ENABLE_MOTION_VECTORS
-    //    struct PBRMaterialShaderInfo
-    //    {
-    //        PBRMaterialBasicAttribs        Basic;
-    //        PBRMaterialSheenAttribs        Sheen;        // #if ENABLE_SHEEN
-    //        PBRMaterialAnisotropyAttribs   Anisotropy;   // #if ENABLE_ANISOTROPY
-    //        PBRMaterialIridescenceAttribs  Iridescence;  // #if ENABLE_IRIDESCENCE
-    //        PBRMaterialTransmissionAttribs Transmission; // #if ENABLE_TRANSMISSION
-    //        PBRMaterialVolumeAttribs       Volume;       // #if ENABLE_VOLUME
-    //        PBRMaterialTextureAttribs Textures[PBR_NUM_TEXTURE_ATTRIBUTES];
-    //    } Material;
-    //    float4 CustomData;
+    //    float4                   BaseColorFactor; // #if USE_MATERIAL_BUFFER
+    //    PBRMaterialShaderInfo    Material;        // #if !USE_MATERIAL_BUFFER
+    //    float4                   CustomData;
+    //};
+
+    return (sizeof(HLSL::GLTFNodeShaderTransforms) +
+            ((Flags & PSO_FLAG_COMPUTE_MOTION_VECTORS) ? sizeof(float4x4) : 0) +
+            (m_Settings.MaxMaterialCount > 0 ? sizeof(float4) : GetPBRMaterialAttribsSize(Flags)) +
+            sizeof(float4));
+}
+
+Uint32 PBR_Renderer::GetPBRMaterialAttribsSize(PSO_FLAGS Flags) const
+{
+    //struct PBRMaterialShaderInfo
+    //{
+    //    PBRMaterialBasicAttribs        Basic;
+    //    PBRMaterialSheenAttribs        Sheen;        // #if ENABLE_SHEEN
+    //    PBRMaterialAnisotropyAttribs   Anisotropy;   // #if ENABLE_ANISOTROPY
+    //    PBRMaterialIridescenceAttribs  Iridescence;  // #if ENABLE_IRIDESCENCE
+    //    PBRMaterialTransmissionAttribs Transmission; // #if ENABLE_TRANSMISSION
+    //    PBRMaterialVolumeAttribs       Volume;       // #if ENABLE_VOLUME
+    //    PBRMaterialTextureAttribs Textures[PBR_NUM_TEXTURE_ATTRIBUTES];
     //};
 
     Uint32 NumTextureAttribs = 0;
@@ -1460,16 +2934,13 @@ Uint32 PBR_Renderer::GetPBRPrimitiveAttribsSize(PSO_FLAGS Flags) const
                              }
                          });
 
-    return (sizeof(HLSL::GLTFNodeShaderTransforms) +
-            ((Flags & PSO_FLAG_COMPUTE_MOTION_VECTORS) ? sizeof(float4x4) : 0) +
-            sizeof(HLSL::PBRMaterialBasicAttribs) +
+    return (sizeof(HLSL::PBRMaterialBasicAttribs) +
             ((Flags & PSO_FLAG_ENABLE_SHEEN) ? sizeof(HLSL::PBRMaterialSheenAttribs) : 0) +
             ((Flags & PSO_FLAG_ENABLE_ANISOTROPY) ? sizeof(HLSL::PBRMaterialAnisotropyAttribs) : 0) +
             ((Flags & PSO_FLAG_ENABLE_IRIDESCENCE) ? sizeof(HLSL::PBRMaterialIridescenceAttribs) : 0) +
             ((Flags & PSO_FLAG_ENABLE_TRANSMISSION) ? sizeof(HLSL::PBRMaterialTransmissionAttribs) : 0) +
             ((Flags & PSO_FLAG_ENABLE_VOLUME) ? sizeof(HLSL::PBRMaterialVolumeAttribs) : 0) +
-            sizeof(HLSL::PBRMaterialTextureAttribs) * NumTextureAttribs +
-            sizeof(float4));
+            sizeof(HLSL::PBRMaterialTextureAttribs) * NumTextureAttribs);
 }
 
 } // namespace Diligent
@@ -0,0 +1,65 @@
+/*
+ *  Copyright 2024 Diligent Graphics LLC
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+#pragma once
+
+#include "PBR_Renderer.hpp"
+#include "GraphicsUtilities.h"
+
+namespace Diligent
+{
+
+namespace HLSL
+{
+
+#include "Shaders/Common/public/BasicStructures.fxh"
+#include "Shaders/PBR/public/PBR_Structures.fxh"
+#include "Shaders/PBR/private/RenderPBR_Structures.fxh"
+
+} // namespace HLSL
+
+namespace Testing
+{
+
+/// Writes the camera view-projection matrix to the frame attributes and creates
+/// the frame attributes constant buffer initialized with them.
+///
+/// \remarks    The buffer is created with USAGE_DEFAULT, so that it can be used by deferred contexts.
+inline RefCntAutoPtr<IBuffer> CreateFrameAttribsBuffer(IRenderDevice*         pDevice,
+                                                       const float4x4&        ViewProj,
+                                                       HLSL::PBRFrameAttribs& FrameAttribs)
+{
+    FrameAttribs.Camera.mViewProjT = ViewProj.Transpose();
+
+    RefCntAutoPtr<IBuffer> pFrameAttribsCB;
+    CreateUniformBuffer(pDevice, sizeof(FrameAttribs), "Frame attribs CB", &pFrameAttribsCB,
+                        USAGE_DEFAULT, BIND_UNIFORM_BUFFER, CPU_ACCESS_NONE, &FrameAttribs);
+    return pFrameAttribsCB;
+}
+
+} // namespace Testing
+
+} // namespace Diligent
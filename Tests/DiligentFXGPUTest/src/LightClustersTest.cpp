@@ -0,0 +1,229 @@
+/*
+ *  Copyright 2024 Diligent Graphics LLC
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+#include <algorithm>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include "GPUTestingEnvironment.hpp"
+#include "PBRTestHelpers.hpp"
+#include "MapHelper.hpp"
+#include "Timer.hpp"
+
+#include "gtest/gtest.h"
+
+using namespace Diligent;
+using namespace Diligent::Testing;
+
+namespace
+{
+
+constexpr float  ZNear         = 0.1f;
+constexpr float  ZFar          = 100.f;
+constexpr Uint32 MaxLightCount = 10000;
+
+// Generates point and spot lights scattered in front of the camera that looks along the Z axis.
+std::vector<HLSL::PBRPunctualLightAttribs> GenerateLights(Uint32 NumLights, Uint32 Seed)
+{
+    std::mt19937                          Gen{Seed};
+    std::uniform_real_distribution<float> XYDistr{-40.f, 40.f};
+    std::uniform_real_distribution<float> ZDistr{-5.f, ZFar + 5.f};
+    std::uniform_real_distribution<float> RangeDistr{0.5f, 8.f};
+
+    std::vector<HLSL::PBRPunctualLightAttribs> Lights(NumLights);
+    for (Uint32 i = 0; i < NumLights; ++i)
+    {
+        HLSL::PBRPunctualLightAttribs& Light = Lights[i];
+
+        const int Type = i % 2 == 0 ? PBR_LIGHT_TYPE_POINT : PBR_LIGHT_TYPE_SPOT;
+
+        Light.PosAndRange = float4{XYDistr(Gen), XYDistr(Gen), ZDistr(Gen), RangeDistr(Gen)};
+        Light.DirAndType  = float4{0, 0, 1, static_cast<float>(Type)};
+        // Every 16th light is disabled
+        Light.Intensity        = i % 16 == 15 ? float4{0, 0, 0, 0} : float4{1, 1, 1, 1};
+        Light.SpotAngleAttribs = float4{1, 0, 0, 0};
+    }
+    return Lights;
+}
+
+class LightClustersTest : public ::testing::Test
+{
+protected:
+    static void SetUpTestSuite()
+    {
+        GPUTestingEnvironment* pEnv    = GPUTestingEnvironment::GetInstance();
+        IRenderDevice*         pDevice = pEnv->GetDevice();
+        if (!pDevice->GetDeviceInfo().Features.ComputeShaders)
+            return;
+
+        PBR_Renderer::CreateInfo RendererCI;
+        RendererCI.EnableIBL     = false;
+        RendererCI.MaxLightCount = MaxLightCount;
+
+        Renderer = std::make_unique<PBR_Renderer>(pDevice, nullptr, pEnv->GetDeviceContext(), RendererCI);
+
+        const BufferDesc& ClustersDesc = Renderer->GetLightClustersBuffer()->GetDesc();
+
+        BufferDesc StagingDesc;
+        StagingDesc.Name           = "Light clusters staging buffer";
+        StagingDesc.Size           = ClustersDesc.Size;
+        StagingDesc.Usage          = USAGE_STAGING;
+        StagingDesc.CPUAccessFlags = CPU_ACCESS_READ;
+        pDevice->CreateBuffer(StagingDesc, nullptr, &pStagingBuffer);
+    }
+
+    static void TearDownTestSuite()
+    {
+        Renderer.reset();
+        pStagingBuffer.Release();
+        GPUTestingEnvironment::GetInstance()->Reset();
+    }
+
+    void SetUp() override
+    {
+        if (!Renderer)
+            GTEST_SKIP() << "Clustered lighting requires compute shaders";
+    }
+
+    // Sets up the camera and the lights, and returns the frame attributes buffer.
+    static RefCntAutoPtr<IBuffer> PrepareLights(const std::vector<HLSL::PBRPunctualLightAttribs>& Lights,
+                                                float4x4&                                         ViewProj,
+                                                HLSL::PBRFrameAttribs&                            FrameAttribs)
+    {
+        GPUTestingEnvironment* pEnv    = GPUTestingEnvironment::GetInstance();
+        IRenderDevice*         pDevice = pEnv->GetDevice();
+        IDeviceContext*        pCtx    = pEnv->GetDeviceContext();
+
+        const Uint32 NumLights = static_cast<Uint32>(Lights.size());
+
+        // The camera is at the origin and looks along the Z axis
+        ViewProj = float4x4::Projection(PI_F / 3.f, 16.f / 9.f, ZNear, ZFar, pDevice->GetDeviceInfo().IsGLDevice());
+
+        FrameAttribs = {};
+        Renderer->SetLightClusterAttribs(FrameAttribs.LightClusters, ZNear, ZFar, NumLights);
+        Renderer->UpdatePunctualLights(pCtx, 0, NumLights, Lights.data());
+
+        return CreateFrameAttribsBuffer(pDevice, ViewProj, FrameAttribs);
+    }
+
+    static std::unique_ptr<PBR_Renderer> Renderer;
+    static RefCntAutoPtr<IBuffer>        pStagingBuffer;
+};
+
+std::unique_ptr<PBR_Renderer> LightClustersTest::Renderer;
+RefCntAutoPtr<IBuffer>        LightClustersTest::pStagingBuffer;
+
+TEST_F(LightClustersTest, CompareWithReference)
+{
+    GPUTestingEnvironment* pEnv = GPUTestingEnvironment::GetInstance();
+    IDeviceContext*        pCtx = pEnv->GetDeviceContext();
+
+    for (Uint32 NumLights : {1u, 100u, 1000u, 10000u})
+    {
+        const std::vector<HLSL::PBRPunctualLightAttribs> Lights = GenerateLights(NumLights, NumLights);
+
+        float4x4               ViewProj;
+        HLSL::PBRFrameAttribs  FrameAttribs;
+        RefCntAutoPtr<IBuffer> pFrameAttribsCB = PrepareLights(Lights, ViewProj, FrameAttribs);
+        ASSERT_TRUE(pFrameAttribsCB);
+
+        Renderer->BinLights(pCtx, pFrameAttribsCB);
+
+        IBuffer* pClustersBuffer = Renderer->GetLightClustersBuffer();
+        pCtx->CopyBuffer(pClustersBuffer, 0, RESOURCE_STATE_TRANSITION_MODE_TRANSITION,
+                         pStagingBuffer, 0, pClustersBuffer->GetDesc().Size, RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
+        pCtx->WaitForIdle();
+
+        std::vector<Uint32> RefClusters;
+        Renderer->BinLightsReference(ViewProj, FrameAttribs.LightClusters, Lights.data(), RefClusters);
+
+        const HLSL::PBRLightClusterAttribs& Attribs = FrameAttribs.LightClusters;
+
+        const Uint32 NumClusters = Attribs.GridSizeX * Attribs.GridSizeY * Attribs.GridSizeZ;
+        const Uint32 ClusterSize = Attribs.MaxLightsPerCluster + 1;
+        ASSERT_LE(RefClusters.size() * sizeof(Uint32), pClustersBuffer->GetDesc().Size);
+
+        MapHelper<Uint32> GPUClusters{pCtx, pStagingBuffer, MAP_READ, MAP_FLAG_DO_NOT_WAIT};
+        const Uint32*     pGPUClusters = GPUClusters;
+        ASSERT_NE(pGPUClusters, nullptr);
+
+        Uint32 NumBinnedLights = 0;
+        for (Uint32 Cluster = 0; Cluster < NumClusters; ++Cluster)
+        {
+            const Uint32* pRefCluster = &RefClusters[size_t{Cluster} * ClusterSize];
+            const Uint32* pGPUCluster = &pGPUClusters[size_t{Cluster} * ClusterSize];
+
+            const Uint32 NumRefLights = pRefCluster[0];
+            const Uint32 NumGPULights = pGPUCluster[0];
+            ASSERT_EQ(NumGPULights, NumRefLights) << "Cluster " << Cluster << ", " << NumLights << " lights";
+            NumBinnedLights += NumRefLights;
+
+            // When the cluster is full, the GPU keeps an arbitrary subset of the lights
+            if (NumRefLights == Attribs.MaxLightsPerCluster)
+                continue;
+
+            // The GPU writes the lights in arbitrary order, while the reference lists are sorted by index
+            std::vector<Uint32> GPULights{pGPUCluster + 1, pGPUCluster + 1 + NumGPULights};
+            std::sort(GPULights.begin(), GPULights.end());
+            ASSERT_TRUE(std::equal(GPULights.begin(), GPULights.end(), pRefCluster + 1))
+                << "Cluster " << Cluster << ", " << NumLights << " lights";
+        }
+        if (NumLights > 1)
+            EXPECT_GT(NumBinnedLights, 0u) << "No lights are binned. The test does not exercise the intersection tests.";
+    }
+}
+
+TEST_F(LightClustersTest, BinLightsPerformance)
+{
+    GPUTestingEnvironment* pEnv = GPUTestingEnvironment::GetInstance();
+    IDeviceContext*        pCtx = pEnv->GetDeviceContext();
+
+    constexpr Uint32 NumIterations = 100;
+    for (Uint32 NumLights : {1u, 100u, 1000u, 10000u})
+    {
+        const std::vector<HLSL::PBRPunctualLightAttribs> Lights = GenerateLights(NumLights, NumLights);
+
+        float4x4               ViewProj;
+        HLSL::PBRFrameAttribs  FrameAttribs;
+        RefCntAutoPtr<IBuffer> pFrameAttribsCB = PrepareLights(Lights, ViewProj, FrameAttribs);
+        ASSERT_TRUE(pFrameAttribsCB);
+
+        // Warm up
+        Renderer->BinLights(pCtx, pFrameAttribsCB);
+        pCtx->WaitForIdle();
+
+        Timer T;
+        for (Uint32 i = 0; i < NumIterations; ++i)
+            Renderer->BinLights(pCtx, pFrameAttribsCB);
+        pCtx->WaitForIdle();
+        const double Time = T.GetElapsedTime();
+
+        LOG_INFO_MESSAGE("BinLights, ", NumLights, " lights: ", Time / NumIterations * 1000.0, " ms per pass");
+    }
+}
+
+} // namespace
@@ -0,0 +1,150 @@
+/*
+ *  Copyright 2024 Diligent Graphics LLC
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+#include <vector>
+
+#include "GPUTestingEnvironment.hpp"
+#include "PBR_Renderer.hpp"
+#include "RenderStateCache.h"
+#include "ArchiverFactoryLoader.h"
+#include "ThreadPool.hpp"
+#include "Timer.hpp"
+
+#include "gtest/gtest.h"
+
+using namespace Diligent;
+using namespace Diligent::Testing;
+
+namespace
+{
+
+using PSO_FLAGS = PBR_Renderer::PSO_FLAGS;
+
+// Returns the keys of all combinations of the default material textures.
+std::vector<PBR_Renderer::PSOKey> GetTestPSOKeys()
+{
+    const PSO_FLAGS TextureFlags[] = {
+        PBR_Renderer::PSO_FLAG_USE_COLOR_MAP,
+        PBR_Renderer::PSO_FLAG_USE_NORMAL_MAP,
+        PBR_Renderer::PSO_FLAG_USE_PHYS_DESC_MAP,
+        PBR_Renderer::PSO_FLAG_USE_EMISSIVE_MAP,
+    };
+    constexpr Uint32 NumTextureFlags = _countof(TextureFlags);
+
+    std::vector<PBR_Renderer::PSOKey> Keys;
+    for (Uint32 Mask = 0; Mask < (1u << NumTextureFlags); ++Mask)
+    {
+        PSO_FLAGS Flags = PBR_Renderer::PSO_FLAG_USE_VERTEX_NORMALS | PBR_Renderer::PSO_FLAG_USE_TEXCOORD0;
+        for (Uint32 i = 0; i < NumTextureFlags; ++i)
+        {
+            if (Mask & (1u << i))
+                Flags |= TextureFlags[i];
+        }
+        Keys.emplace_back(Flags, /*DoubleSided = */ false);
+    }
+    return Keys;
+}
+
+// Replays the manifest in the new renderer that uses the given render state cache,
+// and returns the time it takes to create all pipeline states.
+double ReplayManifest(const char* ManifestPath, IRenderStateCache* pStateCache, IThreadPool* pThreadPool, Uint32& NumPSOs)
+{
+    GPUTestingEnvironment* pEnv = GPUTestingEnvironment::GetInstance();
+
+    PBR_Renderer::CreateInfo RendererCI;
+    RendererCI.EnableIBL = false;
+    PBR_Renderer Renderer{pEnv->GetDevice(), pStateCache, pEnv->GetDeviceContext(), RendererCI};
+
+    Timer T;
+    NumPSOs = Renderer.ReplayPSOManifest(ManifestPath, pThreadPool);
+    Renderer.WaitForPSOManifestReplay();
+    return T.GetElapsedTime();
+}
+
+// Measures the startup time of the pipeline states replayed from the manifest
+// with an empty and with a populated render state cache.
+TEST(PBR_RendererTest, PSOManifestReplay)
+{
+    GPUTestingEnvironment* pEnv    = GPUTestingEnvironment::GetInstance();
+    IRenderDevice*         pDevice = pEnv->GetDevice();
+
+    GPUTestingEnvironment::ScopedReset EnvironmentAutoReset;
+
+    IArchiverFactory* pArchiverFactory = LoadAndGetArchiverFactory();
+    if (pArchiverFactory == nullptr)
+        GTEST_SKIP() << "Archiver factory is not available";
+
+    constexpr char ManifestPath[] = "PSOManifestTest.manifest";
+
+    GraphicsPipelineDesc GraphicsDesc;
+    GraphicsDesc.NumRenderTargets  = 1;
+    GraphicsDesc.RTVFormats[0]     = TEX_FORMAT_RGBA8_UNORM;
+    GraphicsDesc.DSVFormat         = TEX_FORMAT_D32_FLOAT;
+    GraphicsDesc.PrimitiveTopology = PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+
+    const std::vector<PBR_Renderer::PSOKey> Keys = GetTestPSOKeys();
+
+    // Record the manifest
+    {
+        PBR_Renderer::CreateInfo RendererCI;
+        RendererCI.EnableIBL = false;
+        PBR_Renderer Renderer{pDevice, nullptr, pEnv->GetDeviceContext(), RendererCI};
+
+        PBR_Renderer::PsoCacheAccessor PSOCache = Renderer.GetPsoCacheAccessor(GraphicsDesc);
+        for (const PBR_Renderer::PSOKey& Key : Keys)
+            ASSERT_NE(PSOCache.Get(Key, true), nullptr);
+
+        ASSERT_TRUE(Renderer.SavePSOManifest(ManifestPath));
+    }
+
+    RefCntAutoPtr<IThreadPool> pThreadPool = CreateThreadPool(ThreadPoolCreateInfo{4});
+    ASSERT_TRUE(pThreadPool);
+
+    RenderStateCacheCreateInfo CacheCI;
+    CacheCI.pDevice          = pDevice;
+    CacheCI.pArchiverFactory = pArchiverFactory;
+
+    RefCntAutoPtr<IRenderStateCache> pStateCache;
+    CreateRenderStateCache(CacheCI, &pStateCache);
+    ASSERT_TRUE(pStateCache);
+
+    // The first replay compiles the shaders and stores them in the cache
+    Uint32       NumColdPSOs = 0;
+    const double ColdTime    = ReplayManifest(ManifestPath, pStateCache, pThreadPool, NumColdPSOs);
+
+    // The second replay uses the new renderer, but loads the shaders from the populated cache
+    Uint32       NumWarmPSOs = 0;
+    const double WarmTime    = ReplayManifest(ManifestPath, pStateCache, pThreadPool, NumWarmPSOs);
+
+    EXPECT_GT(NumColdPSOs, 0u);
+    EXPECT_EQ(NumColdPSOs, NumWarmPSOs);
+
+    LOG_INFO_MESSAGE("Replayed ", NumColdPSOs, " pipeline states from the manifest:\n",
+                     "    Empty render state cache:     ", ColdTime * 1000.0, " ms\n",
+                     "    Populated render state cache: ", WarmTime * 1000.0, " ms");
+}
+
+} // namespace
@@ -0,0 +1,211 @@
+/*
+ *  Copyright 2024 Diligent Graphics LLC
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+#include <cmath>
+#include <fstream>
+#include <sstream>
+#include <vector>
+
+#include "GPUTestingEnvironment.hpp"
+#include "PBRTestHelpers.hpp"
+#include "GLTF_PBR_Renderer.hpp"
+#include "ThreadPool.hpp"
+#include "Timer.hpp"
+
+#include "gtest/gtest.h"
+
+using namespace Diligent;
+using namespace Diligent::Testing;
+
+namespace
+{
+
+// Writes the glTF model that contains NumNodes nodes arranged in a grid, and the binary
+// buffer file that is placed in the working directory.
+// All nodes reference the same single-triangle mesh, so every node is one draw call.
+bool WriteGridModel(const char* FilePath, const char* BinFileName, Uint32 NumNodes)
+{
+    const float    Positions[] = {0, 0, 0, 1, 0, 0, 0, 1, 0};
+    const float    Normals[]   = {0, 0, -1, 0, 0, -1, 0, 0, -1};
+    const Uint32   Indices[]   = {0, 1, 2};
+    constexpr auto PosSize     = sizeof(Positions);
+    constexpr auto NormSize    = sizeof(Normals);
+    constexpr auto IndSize     = sizeof(Indices);
+
+    {
+        std::ofstream BinFile{BinFileName, std::ios::binary};
+        if (!BinFile)
+            return false;
+        BinFile.write(reinterpret_cast<const char*>(Positions), PosSize);
+        BinFile.write(reinterpret_cast<const char*>(Normals), NormSize);
+        BinFile.write(reinterpret_cast<const char*>(Indices), IndSize);
+    }
+
+    const Uint32 GridSize = static_cast<Uint32>(std::ceil(std::sqrt(static_cast<float>(NumNodes))));
+
+    std::stringstream ss;
+    ss << "{\"asset\":{\"version\":\"2.0\"},\"scene\":0,\"scenes\":[{\"nodes\":[";
+    for (Uint32 i = 0; i < NumNodes; ++i)
+        ss << (i > 0 ? "," : "") << i;
+    ss << "]}],\"nodes\":[";
+    for (Uint32 i = 0; i < NumNodes; ++i)
+    {
+        ss << (i > 0 ? "," : "")
+           << "{\"mesh\":0,\"translation\":[" << static_cast<float>(i % GridSize) * 1.5f << "," << static_cast<float>(i / GridSize) * 1.5f << ",0]}";
+    }
+    ss << "],\"meshes\":[{\"primitives\":[{\"attributes\":{\"POSITION\":0,\"NORMAL\":1},\"indices\":2,\"material\":0}]}],"
+       << "\"materials\":[{\"pbrMetallicRoughness\":{\"baseColorFactor\":[1,1,1,1]}}],"
+       << "\"buffers\":[{\"byteLength\":" << PosSize + NormSize + IndSize << ",\"uri\":\"" << BinFileName << "\"}],"
+       << "\"bufferViews\":["
+       << "{\"buffer\":0,\"byteOffset\":0,\"byteLength\":" << PosSize << "},"
+       << "{\"buffer\":0,\"byteOffset\":" << PosSize << ",\"byteLength\":" << NormSize << "},"
+       << "{\"buffer\":0,\"byteOffset\":" << PosSize + NormSize << ",\"byteLength\":" << IndSize << "}],"
+       << "\"accessors\":["
+       << "{\"bufferView\":0,\"componentType\":5126,\"count\":3,\"type\":\"VEC3\",\"min\":[0,0,0],\"max\":[1,1,0]},"
+       << "{\"bufferView\":1,\"componentType\":5126,\"count\":3,\"type\":\"VEC3\"},"
+       << "{\"bufferView\":2,\"componentType\":5125,\"count\":3,\"type\":\"SCALAR\"}]}";
+
+    std::ofstream File{FilePath};
+    if (!File)
+        return false;
+    File << ss.str();
+    return true;
+}
+
+RefCntAutoPtr<ITexture> CreateRenderTarget(IRenderDevice* pDevice, TEXTURE_FORMAT Format, BIND_FLAGS BindFlags, const char* Name)
+{
+    TextureDesc TexDesc;
+    TexDesc.Name      = Name;
+    TexDesc.Type      = RESOURCE_DIM_TEX_2D;
+    TexDesc.Width     = 512;
+    TexDesc.Height    = 512;
+    TexDesc.Format    = Format;
+    TexDesc.BindFlags = BindFlags;
+
+    RefCntAutoPtr<ITexture> pTexture;
+    pDevice->CreateTexture(TexDesc, nullptr, &pTexture);
+    return pTexture;
+}
+
+// Measures the CPU time it takes to record and submit the draw calls of a model with many
+// primitives with Render() and with RenderParallel() for different numbers of worker threads.
+TEST(GLTF_PBR_RendererTest, RenderParallelPerformance)
+{
+    GPUTestingEnvironment* pEnv    = GPUTestingEnvironment::GetInstance();
+    IRenderDevice*         pDevice = pEnv->GetDevice();
+    IDeviceContext*        pCtx    = pEnv->GetDeviceContext();
+
+    const Uint32 NumDeferredContexts = static_cast<Uint32>(pEnv->GetNumDeferredContexts());
+    if (NumDeferredContexts == 0)
+        GTEST_SKIP() << "Deferred contexts are not supported by this device";
+
+    GPUTestingEnvironment::ScopedReset EnvironmentAutoReset;
+
+    constexpr Uint32 NumPrimitives = 20000;
+    constexpr Uint32 NumFrames     = 10;
+
+    ASSERT_TRUE(WriteGridModel("RenderParallelTest.gltf", "RenderParallelTest.bin", NumPrimitives));
+
+    GLTF::ModelCreateInfo ModelCI;
+    ModelCI.FileName = "RenderParallelTest.gltf";
+    GLTF::Model Model{pDevice, pCtx, ModelCI};
+    ASSERT_EQ(Model.Scenes.size(), 1u);
+
+    GLTF::ModelTransforms Transforms;
+    Model.ComputeTransforms(0, Transforms);
+
+    RefCntAutoPtr<ITexture> pColorTarget = CreateRenderTarget(pDevice, TEX_FORMAT_RGBA8_UNORM, BIND_RENDER_TARGET, "Color target");
+    RefCntAutoPtr<ITexture> pDepthTarget = CreateRenderTarget(pDevice, TEX_FORMAT_D32_FLOAT, BIND_DEPTH_STENCIL, "Depth target");
+    ASSERT_TRUE(pColorTarget && pDepthTarget);
+
+    GLTF_PBR_Renderer::CreateInfo RendererCI;
+    RendererCI.NumRenderTargets = 1;
+    RendererCI.RTVFormats[0]    = TEX_FORMAT_RGBA8_UNORM;
+    RendererCI.DSVFormat        = TEX_FORMAT_D32_FLOAT;
+    RendererCI.EnableIBL        = false;
+    GLTF_PBR_Renderer Renderer{pDevice, nullptr, pCtx, RendererCI};
+
+    const float4x4 ViewProj = float4x4::Translation(-100, -100, 200) *
+        float4x4::Projection(PI_F / 3.f, 1.f, 1.f, 1000.f, pDevice->GetDeviceInfo().IsGLDevice());
+
+    HLSL::PBRFrameAttribs  FrameAttribs{};
+    RefCntAutoPtr<IBuffer> pFrameAttribsCB = CreateFrameAttribsBuffer(pDevice, ViewProj, FrameAttribs);
+    ASSERT_TRUE(pFrameAttribsCB);
+
+    GLTF_PBR_Renderer::ModelResourceBindings Bindings = Renderer.CreateResourceBindings(Model, pFrameAttribsCB);
+
+    GLTF_PBR_Renderer::RenderInfo RenderParams;
+
+    ITextureView* pRTV = pColorTarget->GetDefaultView(TEXTURE_VIEW_RENDER_TARGET);
+    ITextureView* pDSV = pDepthTarget->GetDefaultView(TEXTURE_VIEW_DEPTH_STENCIL);
+
+    std::vector<IDeviceContext*> DeferredContexts(NumDeferredContexts);
+    for (Uint32 i = 0; i < NumDeferredContexts; ++i)
+        DeferredContexts[i] = pEnv->GetDeferredContext(i);
+
+    RefCntAutoPtr<IThreadPool> pThreadPool = CreateThreadPool(ThreadPoolCreateInfo{NumDeferredContexts});
+    ASSERT_TRUE(pThreadPool);
+
+    // Zero workers use Render() in the immediate context
+    std::vector<Uint32> WorkerCounts{0};
+    for (Uint32 NumWorkers = 1; NumWorkers < NumDeferredContexts; NumWorkers *= 2)
+        WorkerCounts.push_back(NumWorkers);
+    WorkerCounts.push_back(NumDeferredContexts);
+
+    for (Uint32 NumWorkers : WorkerCounts)
+    {
+        GLTF_PBR_Renderer::ParallelRenderInfo ParallelInfo;
+        ParallelInfo.ppDeferredContexts  = DeferredContexts.data();
+        ParallelInfo.NumDeferredContexts = NumWorkers;
+        ParallelInfo.pThreadPool         = pThreadPool;
+        ParallelInfo.NumRenderTargets    = 1;
+        ParallelInfo.ppRTVs              = &pRTV;
+        ParallelInfo.pDSV                = pDSV;
+
+        double TotalTime = 0;
+        // The first frame builds the render lists and creates the pipeline states
+        for (Uint32 Frame = 0; Frame <= NumFrames; ++Frame)
+        {
+            Renderer.Begin(pCtx);
+            pCtx->SetRenderTargets(1, &pRTV, pDSV, RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
+
+            Timer T;
+            Renderer.RenderParallel(pCtx, ParallelInfo, Model, Transforms, nullptr, RenderParams, &Bindings);
+            pCtx->Flush();
+            if (Frame > 0)
+                TotalTime += T.GetElapsedTime();
+
+            pCtx->FinishFrame();
+            pCtx->WaitForIdle();
+        }
+
+        const double TimePerFrameMs = TotalTime / NumFrames * 1000.0;
+        LOG_INFO_MESSAGE("RenderParallel, ", NumWorkers, " workers: ", TimePerFrameMs, " ms per frame, ",
+                         NumPrimitives / TimePerFrameMs, " draws/ms");
+    }
+}
+
+} // namespace
@@ -0,0 +1,249 @@
+/*
+ *  Copyright 2024 Diligent Graphics LLC
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+#include <random>
+#include <vector>
+
+#include "Utilities/interface/DepthSort.hpp"
+#include "DebugUtilities.hpp"
+#include "Timer.hpp"
+
+#include "gtest/gtest.h"
+
+using namespace Diligent;
+
+namespace
+{
+
+// Generates random depths with negative, zero and duplicate values.
+std::vector<float> GenerateDepths(size_t Count, Uint32 Seed)
+{
+    std::mt19937                          Gen{Seed};
+    std::uniform_real_distribution<float> Distr{-1000.f, 1000.f};
+    std::uniform_int_distribution<int>    KindDistr{0, 9};
+
+    std::vector<float> Depths(Count);
+    for (size_t i = 0; i < Count; ++i)
+    {
+        switch (KindDistr(Gen))
+        {
+            case 0: Depths[i] = 0.f; break;
+            case 1: Depths[i] = i > 0 ? Depths[i - 1] : 1.f; break;
+            // Adding zero turns the negative zero into the positive zero that compares equal to it
+            case 2: Depths[i] = std::round(Distr(Gen)) + 0.f; break;
+            default: Depths[i] = Distr(Gen);
+        }
+    }
+    return Depths;
+}
+
+std::vector<Uint32> GetSortKeys(const std::vector<float>& Depths, bool BackToFront)
+{
+    std::vector<Uint32> Keys(Depths.size());
+    for (size_t i = 0; i < Depths.size(); ++i)
+    {
+        const Uint32 Key = DepthToSortKey(Depths[i]);
+        Keys[i]          = BackToFront ? ~Key : Key;
+    }
+    return Keys;
+}
+
+// Returns the reference order of the depths that is computed with std::stable_sort.
+std::vector<Uint32> GetReferenceOrder(const std::vector<float>& Depths, bool BackToFront)
+{
+    std::vector<Uint32> Order(Depths.size());
+    std::iota(Order.begin(), Order.end(), 0u);
+    std::stable_sort(Order.begin(), Order.end(), [&](Uint32 lhs, Uint32 rhs) {
+        return BackToFront ? Depths[lhs] > Depths[rhs] : Depths[lhs] < Depths[rhs];
+    });
+    return Order;
+}
+
+TEST(DepthSortTest, DepthToSortKey)
+{
+    const std::vector<float> Depths = {-1e30f, -1000.f, -1.f, -1e-30f, -0.f, 0.f, 1e-30f, 1.f, 1000.f, 1e30f};
+    for (size_t i = 1; i < Depths.size(); ++i)
+    {
+        EXPECT_LT(DepthToSortKey(Depths[i - 1]), DepthToSortKey(Depths[i])) << Depths[i - 1] << " vs " << Depths[i];
+    }
+
+    const std::vector<float> RandomDepths = GenerateDepths(10000, 0);
+    for (size_t i = 1; i < RandomDepths.size(); ++i)
+    {
+        const float d0 = RandomDepths[i - 1];
+        const float d1 = RandomDepths[i];
+        EXPECT_EQ(d0 < d1, DepthToSortKey(d0) < DepthToSortKey(d1)) << d0 << " vs " << d1;
+        EXPECT_EQ(d0 == d1, DepthToSortKey(d0) == DepthToSortKey(d1)) << d0 << " vs " << d1;
+    }
+}
+
+TEST(DepthSortTest, RadixSort)
+{
+    std::vector<Uint32> Order;
+    std::vector<Uint32> TmpOrder;
+
+    // Empty and single-element lists
+    RadixSortByKey(Order, {}, TmpOrder);
+    EXPECT_TRUE(Order.empty());
+    RadixSortByKey(Order, {DepthToSortKey(1.f)}, TmpOrder);
+    EXPECT_EQ(Order, std::vector<Uint32>{0});
+
+    for (size_t Count : {2, 3, 17, 256, 1000, 65537})
+    {
+        for (bool BackToFront : {false, true})
+        {
+            const std::vector<float> Depths = GenerateDepths(Count, static_cast<Uint32>(Count));
+
+            RadixSortByKey(Order, GetSortKeys(Depths, BackToFront), TmpOrder);
+            EXPECT_EQ(Order, GetReferenceOrder(Depths, BackToFront)) << Count << " depths, back to front: " << BackToFront;
+        }
+    }
+
+    // All keys are equal
+    {
+        const std::vector<float> Depths(100, -5.f);
+        RadixSortByKey(Order, GetSortKeys(Depths, false), TmpOrder);
+        EXPECT_EQ(Order, GetReferenceOrder(Depths, false));
+    }
+}
+
+TEST(DepthSortTest, InsertionSort)
+{
+    for (size_t Count : {0, 1, 2, 3, 17, 1000})
+    {
+        for (bool BackToFront : {false, true})
+        {
+            const std::vector<float>  Depths = GenerateDepths(Count, static_cast<Uint32>(Count));
+            const std::vector<Uint32> Keys   = GetSortKeys(Depths, BackToFront);
+
+            std::vector<Uint32> Order(Count);
+            std::iota(Order.begin(), Order.end(), 0u);
+            EXPECT_TRUE(InsertionSortByKey(Order, Keys, Count * Count));
+            EXPECT_EQ(Order, GetReferenceOrder(Depths, BackToFront)) << Count << " depths, back to front: " << BackToFront;
+        }
+    }
+
+    // The sort gives up when it exceeds the number of moves, but leaves a valid permutation
+    {
+        const std::vector<float>  Depths = GenerateDepths(1000, 1);
+        const std::vector<Uint32> Keys   = GetSortKeys(Depths, false);
+
+        std::vector<Uint32> Order(Depths.size());
+        std::iota(Order.begin(), Order.end(), 0u);
+        EXPECT_FALSE(InsertionSortByKey(Order, Keys, Depths.size()));
+
+        std::vector<Uint32> SortedOrder = Order;
+        std::sort(SortedOrder.begin(), SortedOrder.end());
+        for (Uint32 i = 0; i < SortedOrder.size(); ++i)
+            ASSERT_EQ(SortedOrder[i], i);
+    }
+}
+
+// Simulates a small camera move: every depth changes by a small random amount.
+void PerturbDepths(std::vector<float>& Depths, std::mt19937& Gen)
+{
+    std::uniform_real_distribution<float> Distr{-0.01f, 0.01f};
+    for (float& Depth : Depths)
+        Depth += Distr(Gen);
+}
+
+TEST(DepthSortTest, Performance)
+{
+    constexpr size_t NumPrimitives = 100000;
+    constexpr Uint32 NumFrames     = 100;
+
+    std::mt19937                          Gen{0};
+    std::uniform_real_distribution<float> Distr{-1000.f, 1000.f};
+
+    std::vector<float> Depths(NumPrimitives);
+    for (float& Depth : Depths)
+        Depth = Distr(Gen);
+
+    std::vector<Uint32> Order;
+    std::vector<Uint32> TmpOrder;
+    std::vector<Uint32> Keys(NumPrimitives);
+
+    double RadixSortTime     = 0;
+    double InsertionSortTime = 0;
+    double StableSortTime    = 0;
+    Uint32 NumInsertionSorts = 0;
+    for (Uint32 Frame = 0; Frame < NumFrames; ++Frame)
+    {
+        // The renderer keeps the list in the previous frame order, so the keys are
+        // computed in this order and the insertion sort starts from the identity.
+        std::vector<float> FrameDepths(NumPrimitives);
+        for (size_t i = 0; i < NumPrimitives; ++i)
+            FrameDepths[i] = Depths[Order.empty() ? i : Order[i]];
+        Depths.swap(FrameDepths);
+        PerturbDepths(Depths, Gen);
+        for (size_t i = 0; i < NumPrimitives; ++i)
+            Keys[i] = DepthToSortKey(Depths[i]);
+
+        std::vector<Uint32> InsertionOrder(NumPrimitives);
+        std::iota(InsertionOrder.begin(), InsertionOrder.end(), 0u);
+        bool InsertionSorted = false;
+        {
+            Timer T;
+            InsertionSorted = InsertionSortByKey(InsertionOrder, Keys, NumPrimitives * 4);
+            InsertionSortTime += T.GetElapsedTime();
+        }
+
+        {
+            Timer T;
+            RadixSortByKey(Order, Keys, TmpOrder);
+            RadixSortTime += T.GetElapsedTime();
+        }
+
+        if (InsertionSorted)
+        {
+            ASSERT_EQ(InsertionOrder, Order);
+            ++NumInsertionSorts;
+        }
+
+        {
+            std::vector<Uint32> StableOrder(NumPrimitives);
+            std::iota(StableOrder.begin(), StableOrder.end(), 0u);
+
+            Timer T;
+            std::stable_sort(StableOrder.begin(), StableOrder.end(), [&Keys](Uint32 lhs, Uint32 rhs) {
+                return Keys[lhs] < Keys[rhs];
+            });
+            StableSortTime += T.GetElapsedTime();
+
+            ASSERT_EQ(Order, StableOrder);
+        }
+    }
+
+    LOG_INFO_MESSAGE("Depth sort of ", NumPrimitives, " primitives:\n",
+                     "    Radix sort:     ", RadixSortTime / NumFrames * 1000.0, " ms\n",
+                     "    Insertion sort: ", InsertionSortTime / NumFrames * 1000.0, " ms (", NumInsertionSorts, " of ", NumFrames, " frames sorted)\n",
+                     "    std::stable_sort: ", StableSortTime / NumFrames * 1000.0, " ms");
+}
+
+} // namespace
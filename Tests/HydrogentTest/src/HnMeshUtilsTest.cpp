@@ -0,0 +1,305 @@
+/*
+ *  Copyright 2024 Diligent Graphics LLC
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+
+#include "HnMeshUtils.hpp"
+#include "DebugUtilities.hpp"
+#include "Timer.hpp"
+
+#include "pxr/imaging/hd/meshUtil.h"
+#include "pxr/imaging/hd/smoothNormals.h"
+#include "pxr/imaging/hd/tokens.h"
+#include "pxr/imaging/hd/vertexAdjacency.h"
+
+#include "gtest/gtest.h"
+
+using namespace Diligent;
+using namespace Diligent::USD;
+
+namespace
+{
+
+enum class FaceMode
+{
+    // Triangles only
+    Triangles,
+    // Quads only
+    Quads,
+    // Triangles and quads
+    TrianglesAndQuads,
+    // Triangles, quads and hexagons that are only handled by HdMeshUtil
+    Polygons
+};
+
+struct TestMesh
+{
+    pxr::HdMeshTopology Topology;
+    std::vector<float>  Points;
+    size_t              NumPoints = 0;
+};
+
+// Generates a height field grid with random heights. Every grid cell is randomly split
+// into faces according to the Mode, so that all faces are consistently oriented and
+// the smooth normals are well defined.
+TestMesh GenerateGridMesh(Uint32 NumCellsX, Uint32 NumCellsY, FaceMode Mode, bool LeftHanded, bool AddHoles, Uint32 Seed)
+{
+    std::mt19937                          Gen{Seed};
+    std::uniform_real_distribution<float> HeightDistr{-0.5f, 0.5f};
+    std::uniform_int_distribution<int>    FaceDistr{0, 2};
+
+    const Uint32 NumVertsX = NumCellsX + 1;
+    const Uint32 NumVertsY = NumCellsY + 1;
+
+    TestMesh Mesh;
+    Mesh.NumPoints = size_t{NumVertsX} * NumVertsY;
+    Mesh.Points.resize(Mesh.NumPoints * 3);
+    for (Uint32 y = 0; y < NumVertsY; ++y)
+    {
+        for (Uint32 x = 0; x < NumVertsX; ++x)
+        {
+            float* Point = &Mesh.Points[(size_t{y} * NumVertsX + x) * 3];
+            Point[0]     = static_cast<float>(x);
+            Point[1]     = static_cast<float>(y);
+            Point[2]     = HeightDistr(Gen);
+        }
+    }
+
+    auto GetIdx = [NumVertsX](Uint32 x, Uint32 y) {
+        return static_cast<int>(y * NumVertsX + x);
+    };
+
+    pxr::VtIntArray FaceVertexCounts;
+    pxr::VtIntArray FaceVertexIndices;
+    auto            AddFace = [&](std::vector<int> Indices) {
+        // Reverse the winding of left-handed faces so that the geometry is the same
+        if (LeftHanded)
+            std::reverse(Indices.begin(), Indices.end());
+        FaceVertexCounts.push_back(static_cast<int>(Indices.size()));
+        for (int Idx : Indices)
+            FaceVertexIndices.push_back(Idx);
+    };
+
+    for (Uint32 y = 0; y < NumCellsY; ++y)
+    {
+        for (Uint32 x = 0; x < NumCellsX; ++x)
+        {
+            const int i00 = GetIdx(x, y);
+            const int i10 = GetIdx(x + 1, y);
+            const int i11 = GetIdx(x + 1, y + 1);
+            const int i01 = GetIdx(x, y + 1);
+
+            const int FaceType = FaceDistr(Gen);
+            if (Mode == FaceMode::Polygons && FaceType == 0 && x + 1 < NumCellsX)
+            {
+                // Merge two adjacent cells into a hexagon
+                const int i20 = GetIdx(x + 2, y);
+                const int i21 = GetIdx(x + 2, y + 1);
+                AddFace({i00, i10, i20, i21, i11, i01});
+                ++x;
+            }
+            else if (Mode == FaceMode::Quads || (Mode != FaceMode::Triangles && FaceType == 1))
+            {
+                AddFace({i00, i10, i11, i01});
+            }
+            else
+            {
+                AddFace({i00, i10, i11});
+                AddFace({i00, i11, i01});
+            }
+        }
+    }
+
+    pxr::VtIntArray HoleIndices;
+    if (AddHoles)
+    {
+        for (size_t i = 0; i < FaceVertexCounts.size(); i += 7)
+            HoleIndices.push_back(static_cast<int>(i));
+    }
+
+    Mesh.Topology = pxr::HdMeshTopology{
+        pxr::TfToken{"none"},
+        LeftHanded ? pxr::HdTokens->leftHanded : pxr::HdTokens->rightHanded,
+        FaceVertexCounts,
+        FaceVertexIndices,
+        HoleIndices,
+    };
+
+    return Mesh;
+}
+
+void ComputeReferenceTriangleIndices(const pxr::HdMeshTopology& Topology, const pxr::SdfPath& Id, pxr::VtVec3iArray& Triangles)
+{
+    pxr::HdMeshUtil MeshUtil{&Topology, Id};
+    pxr::VtIntArray PrimitiveParams;
+    MeshUtil.ComputeTriangleIndices(&Triangles, &PrimitiveParams, nullptr);
+}
+
+pxr::VtVec3fArray ComputeReferenceSmoothNormals(const TestMesh& Mesh)
+{
+    pxr::Hd_VertexAdjacency Adjacency;
+    Adjacency.BuildAdjacencyTable(&Mesh.Topology);
+    return pxr::Hd_SmoothNormals::ComputeSmoothNormals(&Adjacency,
+                                                       static_cast<int>(Mesh.NumPoints),
+                                                       reinterpret_cast<const pxr::GfVec3f*>(Mesh.Points.data()));
+}
+
+void TestTriangulation(FaceMode Mode, bool LeftHanded, bool AddHoles)
+{
+    const pxr::SdfPath Id{"/TestMesh"};
+    for (Uint32 Seed = 0; Seed < 4; ++Seed)
+    {
+        const TestMesh Mesh = GenerateGridMesh(37, 23, Mode, LeftHanded, AddHoles, Seed);
+
+        pxr::VtVec3iArray Triangles;
+        ComputeTriangleIndices(Mesh.Topology, Id, Triangles);
+
+        pxr::VtVec3iArray RefTriangles;
+        ComputeReferenceTriangleIndices(Mesh.Topology, Id, RefTriangles);
+
+        ASSERT_EQ(Triangles.size(), RefTriangles.size()) << "Seed: " << Seed;
+        for (size_t i = 0; i < Triangles.size(); ++i)
+        {
+            EXPECT_EQ(Triangles[i], RefTriangles[i]) << "Seed: " << Seed << ", triangle " << i;
+        }
+    }
+}
+
+void TestSmoothNormals(FaceMode Mode, bool LeftHanded)
+{
+    for (Uint32 Seed = 0; Seed < 4; ++Seed)
+    {
+        const TestMesh Mesh = GenerateGridMesh(37, 23, Mode, LeftHanded, /*AddHoles = */ false, Seed);
+
+        std::vector<float> Normals(Mesh.NumPoints * 3);
+        ASSERT_TRUE(ComputeSmoothNormals(Mesh.Topology, Mesh.Points.data(), Mesh.NumPoints, Normals.data()));
+
+        const pxr::VtVec3fArray RefNormals = ComputeReferenceSmoothNormals(Mesh);
+        ASSERT_EQ(RefNormals.size(), Mesh.NumPoints);
+        for (size_t i = 0; i < Mesh.NumPoints; ++i)
+        {
+            // The faces are summed in a different order, so the results may differ in the last bits
+            for (int c = 0; c < 3; ++c)
+                EXPECT_NEAR(Normals[i * 3 + c], RefNormals[i][c], 1e-5f) << "Seed: " << Seed << ", vertex " << i;
+        }
+    }
+}
+
+TEST(HnMeshUtilsTest, ComputeTriangleIndices)
+{
+    for (bool LeftHanded : {false, true})
+    {
+        TestTriangulation(FaceMode::Triangles, LeftHanded, /*AddHoles = */ false);
+        TestTriangulation(FaceMode::Quads, LeftHanded, /*AddHoles = */ false);
+        TestTriangulation(FaceMode::TrianglesAndQuads, LeftHanded, /*AddHoles = */ false);
+        TestTriangulation(FaceMode::Polygons, LeftHanded, /*AddHoles = */ false);
+        TestTriangulation(FaceMode::TrianglesAndQuads, LeftHanded, /*AddHoles = */ true);
+    }
+}
+
+TEST(HnMeshUtilsTest, ComputeSmoothNormals)
+{
+    for (bool LeftHanded : {false, true})
+    {
+        TestSmoothNormals(FaceMode::Triangles, LeftHanded);
+        TestSmoothNormals(FaceMode::Quads, LeftHanded);
+        TestSmoothNormals(FaceMode::TrianglesAndQuads, LeftHanded);
+        TestSmoothNormals(FaceMode::Polygons, LeftHanded);
+    }
+}
+
+TEST(HnMeshUtilsTest, InvalidTopology)
+{
+    // The face vertex counts reference more indices than there are
+    const pxr::HdMeshTopology Topology{
+        pxr::TfToken{"none"},
+        pxr::HdTokens->rightHanded,
+        pxr::VtIntArray{3, 3},
+        pxr::VtIntArray{0, 1, 2, 0},
+    };
+
+    const float        Points[] = {0, 0, 0, 1, 0, 0, 0, 1, 0};
+    std::vector<float> Normals(9);
+    EXPECT_FALSE(ComputeSmoothNormals(Topology, Points, 3, Normals.data()));
+}
+
+TEST(HnMeshUtilsTest, LoadPerformance)
+{
+    const pxr::SdfPath Id{"/TestMesh"};
+    for (Uint32 NumFaces : {1000u, 10000u, 100000u, 1000000u, 10000000u})
+    {
+        const Uint32   NumCellsX = static_cast<Uint32>(std::sqrt(static_cast<double>(NumFaces)));
+        const Uint32   NumCellsY = NumFaces / NumCellsX;
+        const TestMesh Mesh      = GenerateGridMesh(NumCellsX, NumCellsY, FaceMode::Quads, /*LeftHanded = */ false, /*AddHoles = */ false, 0);
+
+        // Run small meshes several times to get stable timings
+        const Uint32 NumIterations = std::max(10000000u / NumFaces, 1u);
+
+        double TriangulationTime    = 0;
+        double RefTriangulationTime = 0;
+        double NormalsTime          = 0;
+        double RefNormalsTime       = 0;
+        for (Uint32 i = 0; i < NumIterations; ++i)
+        {
+            {
+                Timer             T;
+                pxr::VtVec3iArray Triangles;
+                ComputeTriangleIndices(Mesh.Topology, Id, Triangles);
+                TriangulationTime += T.GetElapsedTime();
+            }
+
+            {
+                Timer             T;
+                pxr::VtVec3iArray Triangles;
+                ComputeReferenceTriangleIndices(Mesh.Topology, Id, Triangles);
+                RefTriangulationTime += T.GetElapsedTime();
+            }
+
+            {
+                Timer              T;
+                std::vector<float> Normals(Mesh.NumPoints * 3);
+                ComputeSmoothNormals(Mesh.Topology, Mesh.Points.data(), Mesh.NumPoints, Normals.data());
+                NormalsTime += T.GetElapsedTime();
+            }
+
+            {
+                Timer T;
+                ComputeReferenceSmoothNormals(Mesh);
+                RefNormalsTime += T.GetElapsedTime();
+            }
+        }
+
+        const double Scale = 1000.0 / NumIterations;
+        LOG_INFO_MESSAGE("Mesh load time, ", NumCellsX * NumCellsY, " faces:\n",
+                         "    Triangulation:  ", TriangulationTime * Scale, " ms (HdMeshUtil: ", RefTriangulationTime * Scale, " ms)\n",
+                         "    Smooth normals: ", NormalsTime * Scale, " ms (Hd_SmoothNormals: ", RefNormalsTime * Scale, " ms)");
+    }
+}
+
+} // namespace
@@ -0,0 +1,72 @@
+/*
+ *  Copyright 2024 Diligent Graphics LLC
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+#pragma once
+
+#include <cstring>
+#include <vector>
+
+#include "BasicTypes.h"
+
+namespace Diligent
+{
+
+/// Maps the float depth to an unsigned integer key that preserves the ordering.
+///
+/// \remarks    Negative zero maps to a smaller key than positive zero.
+///             NaNs are not supported.
+inline Uint32 DepthToSortKey(float Depth)
+{
+    Uint32 Bits;
+    std::memcpy(&Bits, &Depth, sizeof(Bits));
+    // Flip all bits of negative values and only the sign bit of positive values
+    return Bits ^ ((0u - (Bits >> 31u)) | 0x80000000u);
+}
+
+/// Sorts the order by the keys with the insertion sort.
+///
+/// \param [in, out] Order    - Indices of the keys to sort.
+/// \param [in]      Keys     - Sort keys.
+/// \param [in]      MaxMoves - The maximum number of moves.
+///
+/// \return     true if the order has been sorted, and false if the sort exceeded the
+///             given number of moves. In the latter case, Order is a valid permutation,
+///             but is not sorted.
+///
+/// \remarks    The insertion sort is stable and is very fast when the order is nearly sorted.
+bool InsertionSortByKey(std::vector<Uint32>& Order, const std::vector<Uint32>& Keys, size_t MaxMoves);
+
+/// Sorts the indices by 32-bit keys with the stable least-significant-digit radix sort.
+///
+/// \param [out] Order    - Indices of the keys in the sorted order.
+/// \param [in]  Keys     - Sort keys.
+/// \param [in]  TmpOrder - Temporary storage that is reused between the calls.
+///
+/// \remarks    All four histograms are computed in a single pass over the keys,
+///             and the passes where all keys have the same digit are skipped.
+void RadixSortByKey(std::vector<Uint32>& Order, const std::vector<Uint32>& Keys, std::vector<Uint32>& TmpOrder);
+
+} // namespace Diligent
@@ -0,0 +1,102 @@
+/*
+ *  Copyright 2024 Diligent Graphics LLC
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+#include "../interface/DepthSort.hpp"
+
+#include <array>
+
+namespace Diligent
+{
+
+bool InsertionSortByKey(std::vector<Uint32>& Order, const std::vector<Uint32>& Keys, size_t MaxMoves)
+{
+    size_t NumMoves = 0;
+    for (size_t i = 1; i < Order.size(); ++i)
+    {
+        const Uint32 Idx = Order[i];
+        const Uint32 Key = Keys[Idx];
+
+        size_t j = i;
+        while (j > 0 && Keys[Order[j - 1]] > Key)
+        {
+            Order[j] = Order[j - 1];
+            --j;
+            if (++NumMoves > MaxMoves)
+            {
+                // Keep the order a valid permutation
+                Order[j] = Idx;
+                return false;
+            }
+        }
+        Order[j] = Idx;
+    }
+    return true;
+}
+
+void RadixSortByKey(std::vector<Uint32>& Order, const std::vector<Uint32>& Keys, std::vector<Uint32>& TmpOrder)
+{
+    const Uint32 Count = static_cast<Uint32>(Keys.size());
+
+    Order.resize(Count);
+    for (Uint32 i = 0; i < Count; ++i)
+        Order[i] = i;
+    if (Count < 2)
+        return;
+
+    std::array<std::array<Uint32, 256>, 4> Histograms{};
+    for (Uint32 Key : Keys)
+    {
+        ++Histograms[0][Key & 0xFFu];
+        ++Histograms[1][(Key >> 8u) & 0xFFu];
+        ++Histograms[2][(Key >> 16u) & 0xFFu];
+        ++Histograms[3][Key >> 24u];
+    }
+
+    TmpOrder.resize(Count);
+
+    for (Uint32 Pass = 0; Pass < 4; ++Pass)
+    {
+        std::array<Uint32, 256>& Histogram = Histograms[Pass];
+
+        const Uint32 Shift = Pass * 8u;
+        if (Histogram[(Keys[0] >> Shift) & 0xFFu] == Count)
+            continue;
+
+        Uint32 Offset = 0;
+        for (Uint32& BucketOffset : Histogram)
+        {
+            const Uint32 BucketSize = BucketOffset;
+            BucketOffset            = Offset;
+            Offset += BucketSize;
+        }
+
+        for (Uint32 Idx : Order)
+            TmpOrder[Histogram[(Keys[Idx] >> Shift) & 0xFFu]++] = Idx;
+        Order.swap(TmpOrder);
+    }
+}
+
+} // namespace Diligent